@@ -410,7 +410,42 @@ void FillPackedRow( const DBResultRow& row, PyPackedRow* into )
 {
     uint32 cc = row.ColumnCount();
     for( uint32 i = 0; i < cc; i++ )
+    {
+        // packed fields go straight into the column buffer
+        if( into->IsFieldPacked( i ) && !row.IsNull( i ) )
+        {
+            switch( row.ColumnType( i ) )
+            {
+                case DBTYPE_I1:
+                case DBTYPE_UI1:
+                case DBTYPE_I2:
+                case DBTYPE_UI2:
+                case DBTYPE_I4:
+                case DBTYPE_UI4:
+                    into->SetFieldInt( i, row.GetInt( i ) );
+                    continue;
+
+                case DBTYPE_I8:
+                case DBTYPE_UI8:
+                    into->SetFieldInt( i, row.GetInt64( i ) );
+                    continue;
+
+                case DBTYPE_R8:
+                case DBTYPE_R4:
+                    into->SetFieldFloat( i, row.GetDouble( i ) );
+                    continue;
+
+                case DBTYPE_BOOL:
+                    into->SetFieldInt( i, row.GetBool( i ) );
+                    continue;
+
+                default:
+                    break;
+            }
+        }
+
         into->SetField( i, DBColumnToPyRep( row, i ) );
+    }
 }
 
 PyPackedRow* CreatePackedRow( const DBResultRow& row, DBRowDescriptor* header )
@@ -37,6 +37,7 @@
 #include "log/logsys.h"
 #include "log/LogNew.h"
 // network
+#include "network/NetReactor.h"
 #include "network/Socket.h"
 #include "network/StreamPacketizer.h"
 #include "network/TCPConnection.h"
@@ -0,0 +1,212 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#include "eve-common.h"
+
+#include "marshal/CompressionPolicy.h"
+
+/** Compression settings of a packet class. */
+struct CompressionSettings
+{
+    /** The least size of packet which gets compressed. */
+    uint32 threshold;
+    /** zlib compression level. */
+    int level;
+};
+
+/** Default settings of each packet class. */
+static const CompressionSettings COMPRESSION_SETTINGS[ CompressionPolicy::CLASS_COUNT ] =
+{
+    { 0x4000, Z_BEST_SPEED },       // CLASS_NOTIFICATION
+    { 0x2000, 6 },                  // CLASS_CALL_RETURN
+    { 0x0400, Z_BEST_COMPRESSION }, // CLASS_CACHED_OBJECT
+    { 0x2000, 6 }                   // CLASS_OTHER
+};
+
+/** Names of packet classes. */
+static const char* const COMPRESSION_CLASS_NAMES[ CompressionPolicy::CLASS_COUNT ] =
+{
+    "notification",
+    "call return",
+    "cached object",
+    "other"
+};
+
+/** Maximal server-wide backoff level. */
+static const uint32 COMPRESSION_MAX_BACKOFF = 3;
+/** Number of consecutive overrun ticks after which the backoff increases. */
+static const uint32 COMPRESSION_OVERRUN_TICKS = 10;
+/** Number of consecutive relaxed ticks after which the backoff decreases. */
+static const uint32 COMPRESSION_RELAXED_TICKS = 500;
+/** Compression ratio (in 1/256) above which compressing a class is considered useless. */
+static const uint32 COMPRESSION_POOR_RATIO = 230;
+/** A class with poor ratio is still compressed once per this many packets. */
+static const uint32 COMPRESSION_PROBE_INTERVAL = 16;
+
+/** Current server-wide backoff level. */
+static volatile uint32 compressionBackoff = 0;
+/** Number of consecutive overrun ticks; main thread only. */
+static uint32 overrunTicks = 0;
+/** Number of consecutive relaxed ticks; main thread only. */
+static uint32 relaxedTicks = 0;
+
+void CompressionPolicy::ReportTickTime( uint32 elapsed, uint32 budget )
+{
+    if( elapsed > budget )
+    {
+        relaxedTicks = 0;
+
+        if( COMPRESSION_OVERRUN_TICKS <= ++overrunTicks )
+        {
+            overrunTicks = 0;
+
+            if( COMPRESSION_MAX_BACKOFF > compressionBackoff )
+            {
+                ++compressionBackoff;
+                sLog.Warning( "Compression", "Server is overloaded, increasing compression backoff to %u.", compressionBackoff );
+            }
+        }
+    }
+    else if( elapsed <= budget / 2 )
+    {
+        overrunTicks = 0;
+
+        if( COMPRESSION_RELAXED_TICKS <= ++relaxedTicks )
+        {
+            relaxedTicks = 0;
+
+            if( 0 < compressionBackoff )
+            {
+                --compressionBackoff;
+                sLog.Log( "Compression", "Server load dropped, decreasing compression backoff to %u.", compressionBackoff );
+            }
+        }
+    }
+    else
+        overrunTicks = relaxedTicks = 0;
+}
+
+uint32 CompressionPolicy::GetBackoff()
+{
+    return compressionBackoff;
+}
+
+const char* CompressionPolicy::GetClassName( PacketClass packetClass )
+{
+    assert( packetClass < CLASS_COUNT );
+
+    return COMPRESSION_CLASS_NAMES[ packetClass ];
+}
+
+CompressionPolicy::CompressionPolicy()
+{
+    Reset();
+}
+
+int CompressionPolicy::SelectLevel( PacketClass packetClass, size_t size )
+{
+    assert( packetClass < CLASS_COUNT );
+
+    const CompressionSettings& settings = COMPRESSION_SETTINGS[ packetClass ];
+    const uint32 backoff = compressionBackoff;
+
+    // Under load, compress only larger packets ...
+    if( size < ( (uint64)settings.threshold << ( 2 * backoff ) ) )
+        return -1;
+
+    {
+        MutexLock lock( mMutex );
+
+        // ... and don't waste time on packets which don't shrink anyway
+        if( COMPRESSION_POOR_RATIO < mRatio[ packetClass ] )
+        {
+            if( COMPRESSION_PROBE_INTERVAL > ++mSkipped[ packetClass ] )
+                return -1;
+
+            mSkipped[ packetClass ] = 0;
+        }
+    }
+
+    // ... and faster.
+    return std::max< int >( Z_BEST_SPEED, settings.level - 3 * backoff );
+}
+
+void CompressionPolicy::Record( PacketClass packetClass, size_t rawSize, size_t compressedSize, uint64 cpuTime )
+{
+    assert( packetClass < CLASS_COUNT );
+
+    MutexLock lock( mMutex );
+
+    ClassStats& stats = mStats[ packetClass ];
+    ++stats.packets;
+
+    if( 0 == compressedSize || 0 == rawSize )
+        return;
+
+    ++stats.compressed;
+    stats.rawBytes += rawSize;
+    stats.compressedBytes += compressedSize;
+    stats.cpuTime += cpuTime;
+
+    // Exponential average of recent ratios
+    const uint32 ratio = (uint32)std::min< uint64 >( (uint64)compressedSize * 256 / rawSize, 0x1000 );
+    mRatio[ packetClass ] = ( 3 * mRatio[ packetClass ] + ratio ) / 4;
+}
+
+CompressionPolicy::ClassStats CompressionPolicy::GetStats( PacketClass packetClass ) const
+{
+    assert( packetClass < CLASS_COUNT );
+
+    MutexLock lock( mMutex );
+
+    return mStats[ packetClass ];
+}
+
+void CompressionPolicy::LogStats( const char* address ) const
+{
+    MutexLock lock( mMutex );
+
+    for( uint32 i = 0; i < CLASS_COUNT; ++i )
+    {
+        const ClassStats& stats = mStats[ i ];
+        if( 0 == stats.packets )
+            continue;
+
+        const double ratio = ( 0 < stats.rawBytes ? 100.0 * stats.compressedBytes / stats.rawBytes : 100.0 );
+
+        sLog.Debug( "Compression", "%s: %s: %" PRIu64 " packets, %" PRIu64 " compressed, %" PRIu64 " -> %" PRIu64 " bytes (%.1f%%) in %" PRIu64 " us.",
+                    address, COMPRESSION_CLASS_NAMES[ i ], stats.packets, stats.compressed,
+                    stats.rawBytes, stats.compressedBytes, ratio, stats.cpuTime );
+    }
+}
+
+void CompressionPolicy::Reset()
+{
+    MutexLock lock( mMutex );
+
+    memset( mStats, 0, sizeof( mStats ) );
+    memset( mRatio, 0, sizeof( mRatio ) );
+    memset( mSkipped, 0, sizeof( mSkipped ) );
+}
@@ -0,0 +1,138 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#ifndef __MARSHAL__COMPRESSION_POLICY_H__INCL__
+#define __MARSHAL__COMPRESSION_POLICY_H__INCL__
+
+#include "threading/Mutex.h"
+
+/**
+ * @brief Decides how outgoing packets of a connection get compressed.
+ *
+ * Each packet class has its own size threshold and zlib level:
+ * latency-critical notifications (destiny updates) are compressed
+ * rarely and fast, while cached objects are compressed eagerly.
+ *
+ * The policy adapts to the traffic: a class whose packets don't
+ * shrink on this connection is only compressed occasionally to
+ * re-check the ratio. It also backs off server-wide when the main
+ * loop overruns its tick (see ReportTickTime).
+ */
+class CompressionPolicy
+{
+public:
+    /** Classes of outgoing packets. */
+    enum PacketClass
+    {
+        CLASS_NOTIFICATION,  /**< Notifications, including destiny updates. */
+        CLASS_CALL_RETURN,   /**< Returns of remote calls. */
+        CLASS_CACHED_OBJECT, /**< Call returns carrying a cached object. */
+        CLASS_OTHER,         /**< Anything else (handshake, errors, ...). */
+
+        CLASS_COUNT
+    };
+
+    /** Statistics of a single packet class. */
+    struct ClassStats
+    {
+        /** Number of packets. */
+        uint64 packets;
+        /** Number of packets which have been compressed. */
+        uint64 compressed;
+        /** Size of compressed packets before compression. */
+        uint64 rawBytes;
+        /** Size of compressed packets after compression. */
+        uint64 compressedBytes;
+        /** Time spent compressing, in microseconds. */
+        uint64 cpuTime;
+    };
+
+    /**
+     * @brief Reports duration of a server tick.
+     *
+     * Should be called once per main loop iteration; drives
+     * the server-wide backoff of all policies.
+     *
+     * @param[in] elapsed Duration of the tick, in milliseconds.
+     * @param[in] budget  Intended duration of the tick, in milliseconds.
+     */
+    static void ReportTickTime( uint32 elapsed, uint32 budget );
+    /** @return Current server-wide backoff level. */
+    static uint32 GetBackoff();
+
+    /**
+     * @return Name of given packet class.
+     */
+    static const char* GetClassName( PacketClass packetClass );
+
+    CompressionPolicy();
+
+    /**
+     * @brief Picks a compression level for a packet.
+     *
+     * @param[in] packetClass Class of the packet.
+     * @param[in] size        Size of the marshaled packet.
+     *
+     * @return zlib compression level, -1 if the packet shouldn't be compressed.
+     */
+    int SelectLevel( PacketClass packetClass, size_t size );
+    /**
+     * @brief Records outcome of sending a packet.
+     *
+     * @param[in] packetClass    Class of the packet.
+     * @param[in] rawSize        Size of the marshaled packet.
+     * @param[in] compressedSize Size after compression; 0 if not compressed.
+     * @param[in] cpuTime        Time spent compressing, in microseconds.
+     */
+    void Record( PacketClass packetClass, size_t rawSize, size_t compressedSize, uint64 cpuTime );
+
+    /**
+     * @return Statistics of given packet class.
+     */
+    ClassStats GetStats( PacketClass packetClass ) const;
+    /**
+     * @brief Logs statistics of all classes.
+     *
+     * @param[in] address Address of the connection, used as a prefix.
+     */
+    void LogStats( const char* address ) const;
+    /**
+     * @brief Forgets all statistics and recent ratios.
+     */
+    void Reset();
+
+protected:
+    /** Protects all members. */
+    mutable Mutex mMutex;
+
+    /** Statistics of each class. */
+    ClassStats mStats[ CLASS_COUNT ];
+    /** Recent compression ratio of each class, in 1/256. */
+    uint32 mRatio[ CLASS_COUNT ];
+    /** Number of skipped packets of each class since the last probe. */
+    uint32 mSkipped[ CLASS_COUNT ];
+};
+
+#endif /* !__MARSHAL__COMPRESSION_POLICY_H__INCL__ */
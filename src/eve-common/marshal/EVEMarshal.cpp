@@ -28,9 +28,11 @@
 #include "marshal/EVEMarshal.h"
 #include "marshal/EVEMarshalOpcodes.h"
 #include "marshal/EVEMarshalStringTable.h"
+#include "marshal/EVEZeroCompress.h"
 #include "python/classes/PyDatabase.h"
 #include "python/PyRep.h"
 #include "python/PyVisitor.h"
+#include "threading/ThreadLocal.h"
 #include "utils/EVEUtils.h"
 
 bool Marshal( const PyRep* rep, Buffer& into )
@@ -41,173 +43,591 @@ bool Marshal( const PyRep* rep, Buffer& into )
 
 bool MarshalDeflate( const PyRep* rep, Buffer& into, const uint32 deflationLimit )
 {
-    Buffer data;
-    if( !Marshal( rep, data ) )
+    MarshalStream v;
+
+    size_t size;
+    if( !v.Measure( rep, size ) )
         return false;
 
-    if( data.size() >= deflationLimit )
+    if( size >= deflationLimit )
+    {
+        Buffer data;
+        if( !v.Save( rep, data ) )
+            return false;
+
         return DeflateData( data, into );
+    }
+    else
+        // no need for an intermediate buffer
+        return v.Save( rep, into );
+}
+
+bool MarshalDeflate( const PyRep* rep, Buffer& into, CompressionPolicy& policy, CompressionPolicy::PacketClass packetClass, size_t headroom )
+{
+    MarshalStream v;
+
+    size_t size;
+    if( !v.Measure( rep, size ) )
+        return false;
+
+    const int level = policy.SelectLevel( packetClass, size );
+    if( 0 <= level )
+    {
+        Buffer data;
+        if( !v.Save( rep, data ) )
+            return false;
+
+        into.Reserve<uint8>( into.size() + headroom + compressBound( size ) );
+        into.Resize<uint8>( into.size() + headroom );
+
+        const size_t start = into.size();
+        const uint64 startTime = GetTimeUSeconds();
+
+        if( !DeflateData( data, into, level ) )
+            return false;
+
+        policy.Record( packetClass, size, into.size() - start, GetTimeUSeconds() - startTime );
+    }
     else
     {
-        into.AppendSeq( data.begin<uint8>(), data.end<uint8>() );
-        return true;
+        // headroom and the stream share the allocation
+        into.Reserve<uint8>( into.size() + headroom + size );
+        into.Resize<uint8>( into.size() + headroom );
+
+        if( !v.Save( rep, into ) )
+            return false;
+
+        policy.Record( packetClass, size, 0, 0 );
     }
+
+    return true;
 }
 
+/** The least size of an object which is worth saving for referencing. */
+static const size_t MARSHAL_SHARED_MIN_SIZE = 8;
+/** The least number of objects within a stream which is worth measuring before saving. */
+static const size_t MARSHAL_MEASURE_MIN_OBJECTS = 128;
+/** The least number of objects within a stream which is worth counting for referencing. */
+static const size_t MARSHAL_SHARED_MIN_OBJECTS = 32;
+/** Number of maps of shared objects kept by each thread for the next streams. */
+static const size_t MARSHAL_SHARED_MAP_CACHE_SIZE = 4;
+/** The largest number of buckets of a map of shared objects worth keeping; clearing walks them all. */
+static const size_t MARSHAL_SHARED_MAP_MAX_BUCKETS = 0x4000;
+
+/************************************************************************/
+/* MarshalStream::ObjectProbe                                           */
+/************************************************************************/
+/**
+ * @brief Checks whether a stream has a given number of objects.
+ *
+ * Counts the objects ReferenceCounter would count, occurences
+ * rather than distinct ones, and stops at the limit; cheaper
+ * than counting the stream when it's small.
+ */
+class MarshalStream::ObjectProbe
+: public PyVisitor
+{
+public:
+    ObjectProbe( size_t limit ) : mRemaining( limit ) {}
+
+    /** @return True if the limit has been reached. */
+    bool reached() const { return 0 == mRemaining; }
+
+    bool VisitBuffer( const PyBuffer* rep ) { return Count(); }
+    bool VisitString( const PyString* rep ) { return Count(); }
+    bool VisitWString( const PyWString* rep ) { return Count(); }
+    bool VisitToken( const PyToken* rep ) { return Count(); }
+
+    bool VisitTuple( const PyTuple* rep ) { return Count() && PyVisitor::VisitTuple( rep ); }
+    bool VisitList( const PyList* rep ) { return Count() && PyVisitor::VisitList( rep ); }
+    bool VisitDict( const PyDict* rep ) { return Count() && PyVisitor::VisitDict( rep ); }
+
+    bool VisitObject( const PyObject* rep ) { return Count() && PyVisitor::VisitObject( rep ); }
+    bool VisitObjectEx( const PyObjectEx* rep ) { return Count() && PyVisitor::VisitObjectEx( rep ); }
+    bool VisitPackedRow( const PyPackedRow* rep ) { return Count() && PyVisitor::VisitPackedRow( rep ); }
+
+    bool VisitSubStruct( const PySubStruct* rep ) { return Count() && PyVisitor::VisitSubStruct( rep ); }
+    bool VisitSubStream( const PySubStream* rep ) { return Count(); }
+    bool VisitChecksumedStream( const PyChecksumedStream* rep ) { return Count() && PyVisitor::VisitChecksumedStream( rep ); }
+    bool VisitPreMarshaled( const PyPreMarshaled* rep ) { return Count(); }
+
+protected:
+    /** @return False to stop the walk once the limit has been reached. */
+    bool Count() { return 0 < --mRemaining; }
+
+    size_t mRemaining;
+};
+
+/************************************************************************/
+/* MarshalStream::SharedObjectMapCache                                  */
+/************************************************************************/
+/**
+ * @brief Maps of shared objects kept for the next streams of a thread.
+ *
+ * Reusing a map keeps its buckets, which otherwise had
+ * to be allocated again for every stream.
+ */
+class MarshalStream::SharedObjectMapCache
+{
+public:
+    ~SharedObjectMapCache()
+    {
+        for( size_t i = 0; i < mMaps.size(); ++i )
+            delete mMaps[ i ];
+    }
+
+    /** @return Map of calling thread. */
+    static SharedObjectMap* Acquire()
+    {
+        std::vector<SharedObjectMap*>& maps = Get().mMaps;
+        if( maps.empty() )
+            return new SharedObjectMap;
+
+        SharedObjectMap* map = maps.back();
+        maps.pop_back();
+        return map;
+    }
+    /** Keeps an emptied map for the next stream of calling thread. */
+    static void Release( SharedObjectMap* map )
+    {
+        std::vector<SharedObjectMap*>& maps = Get().mMaps;
+        if( MARSHAL_SHARED_MAP_CACHE_SIZE <= maps.size()
+            || MARSHAL_SHARED_MAP_MAX_BUCKETS < map->bucket_count() )
+        {
+            delete map;
+            return;
+        }
+
+        map->clear();
+        maps.push_back( map );
+    }
+
+protected:
+    static SharedObjectMapCache& Get()
+    {
+        static ThreadLocal<SharedObjectMapCache> cache;
+        return *cache;
+    }
+
+    std::vector<SharedObjectMap*> mMaps;
+};
+
+/************************************************************************/
+/* MarshalStream::ReferenceCounter                                      */
+/************************************************************************/
+
+/**
+ * @brief Counts occurences of objects within a stream.
+ *
+ * Scalars are not counted; they are cheaper to save again
+ * than to reference. Objects are descended into only once;
+ * substreams and pre-marshaled objects not at all, since
+ * their content is saved separately.
+ */
+class MarshalStream::ReferenceCounter
+: public PyVisitor
+{
+public:
+    ReferenceCounter( SharedObjectMap& objects ) : mObjects( objects ) {}
+
+    bool VisitBuffer( const PyBuffer* rep ) { Count( rep ); return true; }
+    bool VisitString( const PyString* rep ) { Count( rep ); return true; }
+    bool VisitWString( const PyWString* rep ) { Count( rep ); return true; }
+    bool VisitToken( const PyToken* rep ) { Count( rep ); return true; }
+
+    bool VisitTuple( const PyTuple* rep ) { return Count( rep ) || PyVisitor::VisitTuple( rep ); }
+    bool VisitList( const PyList* rep ) { return Count( rep ) || PyVisitor::VisitList( rep ); }
+    bool VisitDict( const PyDict* rep ) { return Count( rep ) || PyVisitor::VisitDict( rep ); }
+
+    bool VisitObject( const PyObject* rep ) { return Count( rep ) || PyVisitor::VisitObject( rep ); }
+    bool VisitObjectEx( const PyObjectEx* rep ) { return Count( rep ) || PyVisitor::VisitObjectEx( rep ); }
+
+    bool VisitPackedRow( const PyPackedRow* rep )
+    {
+        if( Count( rep ) )
+            return true;
+        if( !rep->header()->visit( *this ) )
+            return false;
+
+        // packed fields go into the column buffer
+        const uint32 cc = rep->ColumnCount();
+        for( uint32 i = 0; i < cc; i++ )
+        {
+            if( rep->IsFieldPacked( i ) )
+                continue;
+
+            const PyRep* field = rep->GetField( i );
+            if( NULL != field && !field->visit( *this ) )
+                return false;
+        }
+
+        return true;
+    }
+
+    bool VisitSubStruct( const PySubStruct* rep ) { return Count( rep ) || PyVisitor::VisitSubStruct( rep ); }
+    bool VisitSubStream( const PySubStream* rep ) { Count( rep ); return true; }
+    bool VisitChecksumedStream( const PyChecksumedStream* rep ) { return Count( rep ) || PyVisitor::VisitChecksumedStream( rep ); }
+    bool VisitPreMarshaled( const PyPreMarshaled* rep ) { Count( rep ); return true; }
+
+protected:
+    /**
+     * @brief Counts an occurence of given object.
+     *
+     * @param[in] rep The object.
+     *
+     * @return True if the object has been counted before.
+     */
+    bool Count( const PyRep* rep )
+    {
+        const SharedObject obj = { 1, 1, 0 };
+
+        std::pair<SharedObjectMap::iterator, bool> res = mObjects.insert( std::make_pair( rep, obj ) );
+        if( res.second )
+            return false;
+
+        ++res.first->second.count;
+        ++res.first->second.remaining;
+        return true;
+    }
+
+    SharedObjectMap& mObjects;
+};
+
 /************************************************************************/
 /* MarshalStream                                                        */
 /************************************************************************/
 MarshalStream::MarshalStream()
-: mBuffer( NULL )
+: mBuffer( NULL ),
+  mMeasuredSize( 0 ),
+  mMeasuredRep( NULL ),
+  mSharedObjects( NULL ),
+  mSavedCount( 0 ),
+  mSavingShared( false )
+{
+}
+
+MarshalStream::~MarshalStream()
 {
+    ClearShared();
+    ClearSubStreams();
+}
+
+bool MarshalStream::Measure( const PyRep* rep, size_t& size )
+{
+    if( rep == NULL )
+        return false;
+
+    CountShared( rep );
+    if( !MeasureStream( rep ) )
+        return false;
+
+    size = mMeasuredSize;
+    return true;
 }
 
 bool MarshalStream::Save( const PyRep* rep, Buffer& into )
 {
+    if( mMeasuredRep != rep )
+    {
+        if( rep == NULL )
+            return false;
+
+        CountShared( rep );
+
+        // the first allocation of the buffer usually fits small streams
+        if( NULL != mSharedObjects
+            && MARSHAL_MEASURE_MIN_OBJECTS <= mSharedObjects->size()
+            && !MeasureStream( rep ) )
+            return false;
+    }
+
+    // write the stream into a single, exactly-sized allocation
+    if( mMeasuredRep == rep )
+        into.Reserve<uint8>( into.size() + mMeasuredSize );
+
     mBuffer = &into;
     bool res = SaveStream( rep );
     mBuffer = NULL;
 
+    ClearShared();
+    mMeasuredRep = NULL;
+    ClearSubStreams();
+
     return res;
 }
 
-bool MarshalStream::SaveStream( const PyRep* rep )
+bool MarshalStream::SaveElement( const PyRep* rep, Buffer& into )
 {
     if( rep == NULL )
         return false;
 
+    mBuffer = &into;
+    bool res = rep->visit( *this );
+    mBuffer = NULL;
+
+    ClearSubStreams();
+
+    return res;
+}
+
+void MarshalStream::CountShared( const PyRep* rep )
+{
+    ClearShared();
+    mMeasuredRep = NULL;
+    ClearSubStreams();
+
+    // small streams have little to share
+    ObjectProbe probe( MARSHAL_SHARED_MIN_OBJECTS );
+    rep->visit( probe );
+    if( !probe.reached() )
+        return;
+
+    // find objects occuring more than once, so that SaveRep may save them only once
+    mSharedObjects = SharedObjectMapCache::Acquire();
+
+    ReferenceCounter counter( *mSharedObjects );
+    rep->visit( counter );
+}
+
+void MarshalStream::ClearShared()
+{
+    if( NULL != mSharedObjects )
+    {
+        SharedObjectMapCache::Release( mSharedObjects );
+        mSharedObjects = NULL;
+    }
+}
+
+bool MarshalStream::MeasureStream( const PyRep* rep )
+{
+    // save the stream without a buffer, counting the bytes only
+    mBuffer = NULL;
+    mMeasuredSize = 0;
+
+    if( !SaveStream( rep ) )
+    {
+        ClearShared();
+        return false;
+    }
+
+    // rewind the shared objects for saving
+    if( NULL != mSharedObjects )
+    {
+        SharedObjectMap::iterator cur, end;
+        cur = mSharedObjects->begin();
+        end = mSharedObjects->end();
+        for(; cur != end; ++cur)
+        {
+            cur->second.remaining = cur->second.count;
+            cur->second.index = 0;
+        }
+    }
+
+    mMeasuredRep = rep;
+    return true;
+}
+
+bool MarshalStream::SaveStream( const PyRep* rep )
+{
     Put<uint8>( MarshalHeaderByte );
     /*
      * Mapcount
-     * the amount of referenced objects within a marshal stream.
-     * Note: Atm not supported.
+     * the amount of referenced objects within a marshal stream;
+     * filled in once we know it.
      */
+    const size_t mapCount = GetStreamSize();
     Put<uint32>( 0 ); // Mapcount
 
-    return rep->visit( *this );
+    mSavedCount = 0;
+    const bool res = SaveRep( rep );
+
+    if( res && 0 < mSavedCount )
+    {
+        if( NULL != mBuffer )
+        {
+            const Buffer::const_iterator<uint8> mapCountItr = mBuffer->begin<uint8>() + mapCount;
+            mBuffer->AssignAt<uint32>( mapCountItr.As<uint32>(), mSavedCount );
+        }
+
+        /*
+         * The map assigns indexes to the saved objects in the order
+         * they appear in the stream. Since saved objects never nest
+         * (see SaveRep), that's also the order in which they finish.
+         */
+        for( uint32 i = 1; i <= mSavedCount; ++i )
+            Put<uint32>( i );
+    }
+
+    return res;
 }
 
-bool MarshalStream::VisitInteger( const PyInt* rep )
+bool MarshalStream::SaveRep( const PyRep* rep )
+{
+    if( NULL == mSharedObjects )
+        return rep->visit( *this );
+
+    SharedObjectMap::iterator res = mSharedObjects->find( rep );
+    if( mSharedObjects->end() == res )
+        return rep->visit( *this );
+
+    SharedObject& obj = res->second;
+    --obj.remaining;
+
+    if( 0 < obj.index )
+    {
+        Put<uint8>( Op_PySavedStreamElement );
+        PutSizeEx( obj.index );
+
+        return true;
+    }
+
+    // don't nest saved objects and don't save the last occurence
+    if( mSavingShared || 0 == obj.remaining )
+        return rep->visit( *this );
+
+    const size_t start = GetStreamSize();
+
+    mSavingShared = true;
+    const bool success = rep->visit( *this );
+    mSavingShared = false;
+
+    if( !success )
+        return false;
+
+    if( MARSHAL_SHARED_MIN_SIZE <= GetStreamSize() - start )
+    {
+        // flag the object so that it gets stored by unmarshaler
+        if( NULL != mBuffer )
+            ( *mBuffer )[ start ] |= PyRepSaveMask;
+        obj.index = ++mSavedCount;
+    }
+
+    return true;
+}
+
+void MarshalStream::BeginStream( Buffer& into )
+{
+    mBuffer = &into;
+
+    Put<uint8>( MarshalHeaderByte );
+    // Mapcount; direct saving makes no references
+    Put<uint32>( 0 );
+}
+
+void MarshalStream::BeginElement( Buffer& into )
 {
-    const int32 val = rep->value();
+    mBuffer = &into;
+}
+
+void MarshalStream::End()
+{
+    mBuffer = NULL;
+
+    ClearSubStreams();
+}
 
-    if( val == -1 )
+void MarshalStream::SaveInt( int32 value )
+{
+    if( value == -1 )
     {
         Put<uint8>( Op_PyMinusOne );
     }
-    else if( val == 0 )
+    else if( value == 0 )
     {
         Put<uint8>( Op_PyZeroInteger );
     }
-    else if( val == 1 )
+    else if( value == 1 )
     {
         Put<uint8>( Op_PyOneInteger );
     }
-    else if( val + 0x8000u > 0xFFFF )
+    else if( value + 0x8000u > 0xFFFF )
     {
         Put<uint8>( Op_PyLong );
-        Put<int32>( val );
+        Put<int32>( value );
     }
-    else if( val + 0x80u > 0xFF )
+    else if( value + 0x80u > 0xFF )
     {
         Put<uint8>( Op_PySignedShort );
-        Put<int16>( val );
+        Put<int16>( value );
     }
     else
     {
         Put<uint8>( Op_PyByte );
-        Put<int8>( val );
+        Put<int8>( value );
     }
-
-    return true;
 }
 
-bool MarshalStream::VisitLong( const PyLong* rep )
+void MarshalStream::SaveLong( int64 value )
 {
-    const int64 val = rep->value();
-
-    if( val == -1 )
+    if( value == -1 )
     {
         Put<uint8>( Op_PyMinusOne );
     }
-    else if( val == 0 )
+    else if( value == 0 )
     {
         Put<uint8>( Op_PyZeroInteger );
     }
-    else if( val == 1 )
+    else if( value == 1 )
     {
         Put<uint8>( Op_PyOneInteger );
     }
-    else if( val + 0x800000u > 0xFFFFFFFF )
+    else if( (uint64)value + 0x80000000u > 0xFFFFFFFFu )
     {
-        SaveVarInteger( rep );
+        SaveVarInteger( value );
     }
-    else if( val + 0x8000u > 0xFFFF )
+    else if( (uint64)value + 0x8000u > 0xFFFF )
     {
         Put<uint8>( Op_PyLong );
-        Put<int32>(static_cast<int32>(val));
+        Put<int32>(static_cast<int32>(value));
     }
-    else if( val + 0x80u > 0xFF )
+    else if( (uint64)value + 0x80u > 0xFF )
     {
         Put<uint8>( Op_PySignedShort );
-        Put<int16>(static_cast<int16>(val));
+        Put<int16>(static_cast<int16>(value));
     }
     else
     {
         Put<uint8>( Op_PyByte );
-        Put<int8>(static_cast<int8>(val));
+        Put<int8>(static_cast<int8>(value));
     }
-
-    return true;
-}
-
-bool MarshalStream::VisitBoolean( const PyBool* rep )
-{
-    if( rep->value() == true )
-        Put<uint8>( Op_PyTrue );
-    else
-        Put<uint8>( Op_PyFalse );
-
-    return true;
 }
 
-bool MarshalStream::VisitReal( const PyFloat* rep )
+void MarshalStream::SaveFloat( double value )
 {
-    if( rep->value() == 0.0 )
+    if( value == 0.0 )
     {
         Put<uint8>( Op_PyZeroReal );
     }
     else
     {
         Put<uint8>( Op_PyReal );
-        Put<double>( rep->value() );
+        Put<double>( value );
     }
+}
 
-    return true;
+void MarshalStream::SaveBool( bool value )
+{
+    if( value == true )
+        Put<uint8>( Op_PyTrue );
+    else
+        Put<uint8>( Op_PyFalse );
 }
 
-bool MarshalStream::VisitNone( const PyNone* rep )
+void MarshalStream::SaveNone()
 {
     Put<uint8>( Op_PyNone );
-    return true;
 }
 
-bool MarshalStream::VisitBuffer( const PyBuffer* rep )
+void MarshalStream::SaveBuffer( const Buffer& value )
 {
     Put<uint8>( Op_PyBuffer );
 
-    const Buffer& buf = rep->content();
-
-    PutSizeEx( buf.size() );
-    Put( buf.begin<uint8>(), buf.end<uint8>() );
-
-    return true;
+    PutSizeEx( value.size() );
+    Put( value.begin<uint8>(), value.end<uint8>() );
 }
 
-bool MarshalStream::VisitString( const PyString* rep )
+void MarshalStream::SaveString( const char* str, size_t len )
 {
-    size_t len = rep->content().size();
-
     if( len == 0 )
     {
         Put<uint8>( Op_PyEmptyString );
@@ -215,12 +635,12 @@ bool MarshalStream::VisitString( const PyString* rep )
     else if( len == 1 )
     {
         Put<uint8>( Op_PyCharString );
-        Put<uint8>( rep->content()[0] );
+        Put<uint8>( str[0] );
     }
     else
     {
         //string is long enough for a string table entry, check it.
-        const uint8 index = sMarshalStringTable.LookupIndex( rep->content() );
+        const uint8 index = MarshalStringTable::LookupIndex( str, len );
         if( STRING_TABLE_ERROR != index )
         {
             Put<uint8>( Op_PyStringTableItem );
@@ -231,17 +651,13 @@ bool MarshalStream::VisitString( const PyString* rep )
         {
             Put<uint8>( Op_PyLongString );
             PutSizeEx( len );
-            Put( rep->content().begin(), rep->content().end() );
+            Put( &str[0], &str[len] );
         }
     }
-
-    return true;
 }
 
-bool MarshalStream::VisitWString( const PyWString* rep )
+void MarshalStream::SaveWString( const char* str, size_t len )
 {
-    size_t len = rep->content().size();
-
     if( 0 == len )
     {
         Put<uint8>( Op_PyEmptyWString );
@@ -253,27 +669,20 @@ bool MarshalStream::VisitWString( const PyWString* rep )
 
         Put<uint8>( Op_PyWStringUTF8 );
         PutSizeEx( len );
-        Put( rep->content().begin(), rep->content().end() );
+        Put( &str[0], &str[len] );
     }
-
-    return true;
 }
 
-bool MarshalStream::VisitToken( const PyToken* rep )
+void MarshalStream::SaveToken( const char* str, size_t len )
 {
     Put<uint8>( Op_PyToken );
 
-    const std::string& str = rep->content();
-
-    PutSizeEx( str.size() );
-    Put( str.begin(), str.end() );
-
-    return true;
+    PutSizeEx( len );
+    Put( &str[0], &str[len] );
 }
 
-bool MarshalStream::VisitTuple( const PyTuple* rep )
+void MarshalStream::SaveTupleHeader( uint32 size )
 {
-    uint32 size = rep->size();
     if( size == 0 )
     {
         Put<uint8>( Op_PyEmptyTuple );
@@ -291,13 +700,10 @@ bool MarshalStream::VisitTuple( const PyTuple* rep )
         Put<uint8>( Op_PyTuple );
         PutSizeEx( size );
     }
-
-    return PyVisitor::VisitTuple( rep );
 }
 
-bool MarshalStream::VisitList( const PyList* rep )
+void MarshalStream::SaveListHeader( uint32 size )
 {
-    uint32 size = rep->size();
     if( size == 0 )
     {
         Put<uint8>( Op_PyEmptyList );
@@ -311,16 +717,121 @@ bool MarshalStream::VisitList( const PyList* rep )
         Put<uint8>( Op_PyList );
         PutSizeEx( size );
     }
-
-    return PyVisitor::VisitList( rep );
 }
 
-bool MarshalStream::VisitDict( const PyDict* rep )
+void MarshalStream::SaveDictHeader( uint32 size )
 {
-    uint32 size = rep->size();
-
     Put<uint8>( Op_PyDict );
     PutSizeEx( size );
+}
+
+void MarshalStream::SaveObjectHeader()
+{
+    Put<uint8>( Op_PyObject );
+}
+
+void MarshalStream::SaveSubStructHeader()
+{
+    Put<uint8>( Op_PySubStruct );
+}
+
+void MarshalStream::SaveSubStream( const Buffer& data )
+{
+    Put<uint8>( Op_PySubStream );
+
+    PutSizeEx( data.size() );
+    Put( data.begin<uint8>(), data.end<uint8>() );
+}
+
+bool MarshalStream::VisitInteger( const PyInt* rep )
+{
+    SaveInt( rep->value() );
+    return true;
+}
+
+bool MarshalStream::VisitLong( const PyLong* rep )
+{
+    SaveLong( rep->value() );
+    return true;
+}
+
+bool MarshalStream::VisitBoolean( const PyBool* rep )
+{
+    SaveBool( rep->value() );
+    return true;
+}
+
+bool MarshalStream::VisitReal( const PyFloat* rep )
+{
+    SaveFloat( rep->value() );
+    return true;
+}
+
+bool MarshalStream::VisitNone( const PyNone* rep )
+{
+    SaveNone();
+    return true;
+}
+
+bool MarshalStream::VisitBuffer( const PyBuffer* rep )
+{
+    SaveBuffer( rep->content() );
+    return true;
+}
+
+bool MarshalStream::VisitString( const PyString* rep )
+{
+    SaveString( rep->content() );
+    return true;
+}
+
+bool MarshalStream::VisitWString( const PyWString* rep )
+{
+    SaveWString( rep->content() );
+    return true;
+}
+
+bool MarshalStream::VisitToken( const PyToken* rep )
+{
+    SaveToken( rep->content() );
+    return true;
+}
+
+bool MarshalStream::VisitTuple( const PyTuple* rep )
+{
+    SaveTupleHeader( rep->size() );
+
+    PyTuple::const_iterator cur, end;
+    cur = rep->begin();
+    end = rep->end();
+    for(; cur != end; ++cur)
+    {
+        if( !SaveRep( *cur ) )
+            return false;
+    }
+
+    return true;
+}
+
+bool MarshalStream::VisitList( const PyList* rep )
+{
+    SaveListHeader( rep->size() );
+
+    PyList::const_iterator cur, end;
+    cur = rep->begin();
+    end = rep->end();
+    for(; cur != end; ++cur)
+    {
+        if( !SaveRep( *cur ) )
+            return false;
+    }
+
+    return true;
+}
+
+bool MarshalStream::VisitDict( const PyDict* rep )
+{
+    SaveDictHeader( rep->size() );
 
     //we have to reverse the order of key/value to be value/key, so do not call base class.
     PyDict::const_iterator cur, end;
@@ -328,9 +839,9 @@ bool MarshalStream::VisitDict( const PyDict* rep )
     end = rep->end();
     for(; cur != end; ++cur)
     {
-        if( !cur->second->visit( *this ) )
+        if( !SaveRep( cur->second ) )
             return false;
-        if( !cur->first->visit( *this ) )
+        if( !SaveRep( cur->first ) )
             return false;
     }
 
@@ -339,8 +850,14 @@ bool MarshalStream::VisitDict( const PyDict* rep )
 
 bool MarshalStream::VisitObject( const PyObject* rep )
 {
-    Put<uint8>( Op_PyObject );
-    return PyVisitor::VisitObject( rep );
+    SaveObjectHeader();
+
+    if( !SaveRep( rep->type() ) )
+        return false;
+    if( !SaveRep( rep->arguments() ) )
+        return false;
+
+    return true;
 }
 
 bool MarshalStream::VisitObjectEx( const PyObjectEx* rep )
@@ -350,7 +867,7 @@ bool MarshalStream::VisitObjectEx( const PyObjectEx* rep )
     else
         Put<uint8>( Op_PyObjectEx1 );
 
-    if( !rep->header()->visit( *this ) )
+    if( !SaveRep( rep->header() ) )
         return false;
 
     {
@@ -359,7 +876,7 @@ bool MarshalStream::VisitObjectEx( const PyObjectEx* rep )
         end = rep->list().end();
         for(; cur != end; ++cur)
         {
-           if( !(*cur)->visit( *this ) )
+           if( !SaveRep( *cur ) )
                return false;
         }
     }
@@ -371,9 +888,9 @@ bool MarshalStream::VisitObjectEx( const PyObjectEx* rep )
         end = rep->dict().end();
         for(; cur != end; ++cur)
         {
-            if( !cur->first->visit( *this ) )
+            if( !SaveRep( cur->first ) )
                 return false;
-            if( !cur->second->visit( *this ) )
+            if( !SaveRep( cur->second ) )
                 return false;
         }
     }
@@ -386,118 +903,21 @@ bool MarshalStream::VisitPackedRow( const PyPackedRow* rep )
 {
     Put<uint8>( Op_PyPackedRow );
 
-    DBRowDescriptor* header = rep->header();
-    header->visit( *this );
-
-    // Create size map, sorted from the greatest to the smallest value:
-    std::multimap< uint8, uint32, std::greater< uint8 > > sizeMap;
-    uint32 cc = header->ColumnCount();
-    size_t sum = 0;
-
-    for( uint32 i = 0; i < cc; i++ )
-    {
-        uint8 size = DBTYPE_GetSizeBits( header->GetColumnType( i ) );
-
-        sizeMap.insert( std::make_pair( size, i ) );
-        sum += size;
-    }
-
-    Buffer unpacked;
-    sum = ( ( sum + 7 ) >> 3 );
-    unpacked.Reserve<uint8>( sum );
-
-    std::multimap< uint8, uint32, std::greater< uint8 > >::iterator cur, end;
-    cur = sizeMap.begin();
-    end = sizeMap.lower_bound( 1 );
-    for(; cur != end; cur++)
-    {
-        const uint32 index = cur->second;
-        const PyRep* r = rep->GetField( index );
-
-        /* note the assert are disabled because of performance flows */
-        switch( header->GetColumnType( index ) )
-        {
-            case DBTYPE_I8:
-            case DBTYPE_UI8:
-            case DBTYPE_CY:
-            case DBTYPE_FILETIME:
-            {
-                unpacked.Append<int64>( r->IsNone() ? 0 : r->AsLong()->value() );
-            } break;
-
-            case DBTYPE_I4:
-            case DBTYPE_UI4:
-            {
-                unpacked.Append<int32>( r->IsNone() ? 0 : r->AsInt()->value() );
-            } break;
-
-            case DBTYPE_I2:
-            case DBTYPE_UI2:
-            {
-                unpacked.Append<int16>( r->IsNone() ? 0 : r->AsInt()->value() );
-            } break;
-
-            case DBTYPE_I1:
-            case DBTYPE_UI1:
-            {
-                unpacked.Append<int8>( r->IsNone() ? 0 : r->AsInt()->value() );
-            } break;
-
-            case DBTYPE_R8:
-            {
-                unpacked.Append<double>( r->IsNone() ? 0.0 : r->AsFloat()->value() );
-            } break;
-
-            case DBTYPE_R4:
-            {
-                unpacked.Append<float>(static_cast<float>(r->IsNone() ? 0.0 : r->AsFloat()->value()));
-            } break;
-
-            case DBTYPE_BOOL:
-            case DBTYPE_BYTES:
-            case DBTYPE_STR:
-            case DBTYPE_WSTR:
-            {
-                /* incorrect implemented so we make sure we crash here */
-                assert( false );
-            } break;
-        }
-    }
-
-    uint8 bitOffset = 0;
-    Buffer::iterator<uint8> bitByte;
-
-    cur = sizeMap.lower_bound( 1 );
-    end = sizeMap.lower_bound( 0 );
-    for(; cur != end; ++cur)
-    {
-        const uint32 index = cur->second;
-        const PyBool* r = rep->GetField( index )->AsBool();
-
-        if( 7 < bitOffset )
-            bitOffset = 0;
-        if( 0 == bitOffset )
-        {
-            bitByte = unpacked.end<uint8>();
-            unpacked.ResizeAt( bitByte, 1 );
-        }
-
-        *bitByte |= ( r->value() << bitOffset++ );
-    }
+    if( !SaveRep( rep->header() ) )
+        return false;
 
-    //pack the bytes with the zero compression algorithm.
-    if( !SaveZeroCompressed( unpacked ) )
+    // The row keeps packed fields in wire layout already.
+    if( !SaveZeroCompressed( rep->data() ) )
         return false;
 
     // Append fields that are not packed:
-    cur = sizeMap.lower_bound( 0 );
-    end = sizeMap.end();
-    for(; cur != end; cur++)
+    const uint32 cc = rep->ColumnCount();
+    for( uint32 i = 0; i < cc; i++ )
     {
-        const uint32 index = cur->second;
-        const PyRep* r = rep->GetField( index );
+        if( rep->IsFieldPacked( i ) )
+            continue;
 
-        if( !r->visit( *this ) )
+        if( !SaveRep( rep->GetField( i ) ) )
             return false;
     }
 
@@ -506,38 +926,56 @@ bool MarshalStream::VisitPackedRow( const PyPackedRow* rep )
 
 bool MarshalStream::VisitSubStruct( const PySubStruct* rep )
 {
-    Put<uint8>(Op_PySubStruct);
-    return PyVisitor::VisitSubStruct( rep );
+    SaveSubStructHeader();
+    return SaveRep( rep->sub() );
 }
 
 bool MarshalStream::VisitSubStream( const PySubStream* rep )
 {
-    Put<uint8>(Op_PySubStream);
+    if(rep->data() != NULL)
+    {
+        //we have the marshaled data, use it.
+        SaveSubStream( rep->data()->content() );
+        return true;
+    }
 
-    if(rep->data() == NULL)
+    if(rep->decoded() == NULL)
     {
-        if(rep->decoded() == NULL)
-        {
-            Put<uint8>(0);
-            return false;
-        }
+        Put<uint8>(Op_PySubStream);
+        Put<uint8>(0);
+        return false;
+    }
 
-        //unmarshaled stream
-        //we have to marshal the substream.
-        rep->EncodeData();
-        if( rep->data() == NULL )
+    //unmarshaled stream
+    //we have to marshal the substream; not by EncodeData, the rep
+    //may be shared with other threads.
+    SubStreamMap::iterator res = mSubStreams.find( rep );
+    if( res == mSubStreams.end() )
+    {
+        Buffer* data = new Buffer;
+        if( !Marshal( rep->decoded(), *data ) )
         {
+            SafeDelete( data );
+
+            Put<uint8>(Op_PySubStream);
             Put<uint8>(0);
             return false;
         }
+
+        res = mSubStreams.insert( std::make_pair( rep, data ) ).first;
     }
 
-    //we have the marshaled data, use it.
-    const Buffer& data = rep->data()->content();
+    SaveSubStream( *res->second );
+    return true;
+}
+
+bool MarshalStream::VisitPreMarshaled( const PyPreMarshaled* rep )
+{
+    const Buffer& data = rep->data();
+    if( 0 == data.size() )
+        return false;
 
-    PutSizeEx( data.size() );
     Put( data.begin<uint8>(), data.end<uint8>() );
-
     return true;
 }
 
@@ -550,18 +988,19 @@ bool MarshalStream::VisitChecksumedStream( const PyChecksumedStream* rep )
     Put<uint8>(Op_PyChecksumedStream);
 
     Put<uint32>( rep->checksum() );
-    return PyVisitor::VisitChecksumedStream( rep );
+    return SaveRep( rep->stream() );
 }
 
-void MarshalStream::SaveVarInteger( const PyLong* v )
+void MarshalStream::SaveVarInteger( int64 v )
 {
-    const uint64 value = v->value();
+    const uint64 value = v;
     uint8 integerSize = 0;
 
 #define DoIntegerSizeCheck(x) if( ( (uint8*)&value )[x] != 0 ) integerSize = x + 1;
     DoIntegerSizeCheck(4);
     DoIntegerSizeCheck(5);
     DoIntegerSizeCheck(6);
+    DoIntegerSizeCheck(7);
 #undef  DoIntegerSizeCheck
 
     if( integerSize > 0 && integerSize < 7 )
@@ -577,66 +1016,39 @@ void MarshalStream::SaveVarInteger( const PyLong* v )
     }
 }
 
-bool MarshalStream::SaveZeroCompressed( const Buffer& data )
+void MarshalStream::ClearSubStreams()
 {
-    Buffer packed;
-
-    Buffer::const_iterator<uint8> cur, end;
-    cur = data.begin<uint8>();
-    end = data.end<uint8>();
-    while( cur < end )
-    {
-        // Insert opcode
-        Buffer::iterator<ZeroCompressOpcode> opcode = packed.end<ZeroCompressOpcode>();
-        packed.ResizeAt( opcode, 1 );
-
-#   define OPCODE_ENCODE( opIsZero, opLen )     \
-        if( 0 == *cur )                         \
-        {                                       \
-            opIsZero = true;                    \
-            opLen    = 7;                       \
-                                                \
-            do                                  \
-            {                                   \
-                ++cur;                          \
-                ++opLen;                        \
-            } while( 7 > opLen && cur < end     \
-                     && 0 == *cur );            \
-        }                                       \
-        else /* 0 != *cur */                    \
-        {                                       \
-            opIsZero = false;                   \
-            opLen    = 0;                       \
-                                                \
-            do                                  \
-            {                                   \
-                packed.Append<uint8>( *cur++ ); \
-                --opLen;                        \
-            } while( 0 < opLen && cur < end     \
-                     && 0 != *cur );            \
-        }
+    SubStreamMap::iterator cur, end;
+    cur = mSubStreams.begin();
+    end = mSubStreams.end();
+    for(; cur != end; ++cur)
+        SafeDelete( cur->second );
 
-        // Encode first part
-        OPCODE_ENCODE( opcode->firstIsZero, opcode->firstLen );
+    mSubStreams.clear();
+}
 
-        // Check whether we have data for second part
-        if( end <= cur )
-        {
-            opcode->secondIsZero = true;
-            opcode->secondLen    = 0;
-            break;
-        }
+bool MarshalStream::SaveZeroCompressed( const Buffer& data )
+{
+    const size_t bound = ZeroCompressBound( data.size() );
+    const uint8* src = ( 0 < data.size() ? &data[ 0 ] : NULL );
 
-        // Encode second part
-        OPCODE_ENCODE( opcode->secondIsZero, opcode->secondLen );
+    if( bound < 0xFF )
+    {
+        // packed rows are small, don't allocate for them
+        uint8 packed[ 0xFF ];
+        const size_t packedLen = ZeroCompress( src, data.size(), packed );
 
-#   undef OPCODE_ENCODE
+        PutSizeEx( packedLen );
+        Put( &packed[ 0 ], &packed[ packedLen ] );
     }
+    else
+    {
+        Buffer packed( bound );
+        packed.Resize<uint8>( ZeroCompress( src, data.size(), &packed[ 0 ] ) );
 
-    // Write the packed data
-    PutSizeEx( packed.size() );
-    if( 0 < packed.size() )
+        PutSizeEx( packed.size() );
         Put( packed.begin<uint8>(), packed.end<uint8>() );
+    }
 
     return true;
 }
@@ -26,6 +26,7 @@
 #ifndef EVE_MARSHAL_H
 #define EVE_MARSHAL_H
 
+#include "marshal/CompressionPolicy.h"
 #include "marshal/EVEMarshalOpcodes.h"
 #include "python/PyVisitor.h"
 
@@ -50,6 +51,20 @@ extern bool Marshal( const PyRep* rep, Buffer& into );
  * @retval false Error occured during marshaling.
  */
 extern bool MarshalDeflate( const PyRep* rep, Buffer& into, const uint32 deflationLimit = 0x2000 );
+/*
+ * @brief Deflated Marshal Stream builder driven by a compression policy.
+ *
+ * @param[in]     rep         Python object to marshal.
+ * @param[out]    into        Buffer which receives (possibly deflated) marshaled stream.
+ * @param[in,out] policy      Policy which decides about deflation and records the outcome.
+ * @param[in]     packetClass Class of the packet being marshaled.
+ * @param[in]     headroom    Number of zeroed bytes to put in front of the stream
+ *                            (e.g. for a length prefix), within the same allocation.
+ *
+ * @retval true  Marshaling ran successfully.
+ * @retval false Error occured during marshaling.
+ */
+extern bool MarshalDeflate( const PyRep* rep, Buffer& into, CompressionPolicy& policy, CompressionPolicy::PacketClass packetClass, size_t headroom = 0 );
 
 /**
  * @brief Turns Python objects into marshal bytecode.
@@ -62,20 +77,126 @@ class MarshalStream
 public:
     /** initializes object */
     MarshalStream();
+    /** frees substreams encoded by us */
+    ~MarshalStream();
 
-    /** saves given rep to given buffer */
+    /**
+     * @brief Measures the stream of given rep.
+     *
+     * Runs the whole saving without a buffer. A following Save
+     * of the same (unchanged) rep doesn't measure it again.
+     *
+     * @param[in]  rep  The rep to measure.
+     * @param[out] size Exact size of the stream.
+     *
+     * @retval true  Measuring ran successfully.
+     * @retval false Error occured during measuring.
+     */
+    bool Measure( const PyRep* rep, size_t& size );
+    /** saves given rep to given buffer; larger streams are measured first */
     bool Save( const PyRep* rep, Buffer& into );
+    /** saves given rep to given buffer, without the stream header; see PyPreMarshaled */
+    bool SaveElement( const PyRep* rep, Buffer& into );
+
+    /**
+     * @name Direct saving
+     *
+     * Methods used to save values without building Python objects
+     * first, mostly by MarshalTo methods generated by eve-xmlpktgen.
+     * Saving is started by BeginStream or BeginElement, followed by
+     * the Save* calls in stream order and finished by End.
+     */
+    //@{
+    /** starts saving new stream to given buffer; writes the stream header */
+    void BeginStream( Buffer& into );
+    /** starts saving to given buffer, without the stream header; see PyPreMarshaled */
+    void BeginElement( Buffer& into );
+    /** finishes direct saving */
+    void End();
+
+    /** saves an integer */
+    void SaveInt( int32 value );
+    /** saves a long */
+    void SaveLong( int64 value );
+    /** saves a real */
+    void SaveFloat( double value );
+    /** saves a boolean */
+    void SaveBool( bool value );
+    /** saves None */
+    void SaveNone();
+    /** saves a buffer */
+    void SaveBuffer( const Buffer& value );
+    /** saves a string; str must be NUL-terminated */
+    void SaveString( const char* str, size_t len );
+    /** saves a string */
+    void SaveString( const std::string& str ) { SaveString( str.c_str(), str.size() ); }
+    /** saves a wide string given in UTF-8 */
+    void SaveWString( const char* str, size_t len );
+    /** saves a wide string given in UTF-8 */
+    void SaveWString( const std::string& str ) { SaveWString( str.c_str(), str.size() ); }
+    /** saves a token */
+    void SaveToken( const char* str, size_t len );
+    /** saves a token */
+    void SaveToken( const std::string& str ) { SaveToken( str.c_str(), str.size() ); }
+
+    /** starts a tuple; the items are to be saved next */
+    void SaveTupleHeader( uint32 size );
+    /** starts a list; the items are to be saved next */
+    void SaveListHeader( uint32 size );
+    /** starts a dict; the entries are to be saved next, each as value followed by key */
+    void SaveDictHeader( uint32 size );
+    /** starts an object; the type and arguments are to be saved next */
+    void SaveObjectHeader();
+    /** starts a sub structure; the content is to be saved next */
+    void SaveSubStructHeader();
+    /** saves a sub stream holding given marshaled stream */
+    void SaveSubStream( const Buffer& data );
+
+    /**
+     * @brief Saves given rep, or a reference to it if it has been saved before.
+     *
+     * All nested objects are saved through this method, so that
+     * objects referenced more than once within the stream are
+     * written only once; see SaveStream. No references are made
+     * when saving directly.
+     *
+     * @param[in] rep The rep to save.
+     *
+     * @retval true  Saving ran successfully.
+     * @retval false Error occured during saving.
+     */
+    bool SaveRep( const PyRep* rep );
+    //@}
 
 protected:
-    /** saves new stream with given rep. */
+    /** counts objects of given rep, unless there are too few to be worth it; see SaveRep */
+    void CountShared( const PyRep* rep );
+    /** forgets the counted objects, keeping their map for the next stream */
+    void ClearShared();
+    /** measures stream of given rep, the objects of which have been counted */
+    bool MeasureStream( const PyRep* rep );
+    /** saves new stream with given rep, the objects of which have been counted */
     bool SaveStream( const PyRep* rep );
-
     /** adds given value to the data stream */
     template<typename T>
-    void Put( const T& value ) { mBuffer->Append<T>( value ); }
+    void Put( const T& value )
+    {
+        if( NULL != mBuffer )
+            mBuffer->Append<T>( value );
+        else
+            mMeasuredSize += sizeof( T );
+    }
     /** adds given bytes to the data stream */
     template<typename Iter>
-    void Put( Iter first, Iter last ) { mBuffer->AppendSeq<Iter>( first, last ); }
+    void Put( Iter first, Iter last )
+    {
+        if( NULL != mBuffer )
+            mBuffer->AppendSeq<Iter>( first, last );
+        else
+            mMeasuredSize += ( last - first ) * sizeof( typename std::iterator_traits<Iter>::value_type );
+    }
+    /** @return current size of the data stream */
+    size_t GetStreamSize() const { return NULL != mBuffer ? mBuffer->size() : mMeasuredSize; }
 
     /** utility for extended size. */
     void PutSizeEx( uint32 size )
@@ -136,14 +257,54 @@ protected:
     bool VisitSubStream( const PySubStream* rep );
     //! Adds a checksumed stream to the stream
     bool VisitChecksumedStream( const PyChecksumedStream* rep );
+    //! Splices a pre-marshaled object into the stream
+    bool VisitPreMarshaled( const PyPreMarshaled* rep );
 
 private:
+    class ObjectProbe;
+    class ReferenceCounter;
+    class SharedObjectMapCache;
+
     // utility to handle Op_PyVarInteger (a bit hacky......)
-    void SaveVarInteger( const PyLong* v );
+    void SaveVarInteger( int64 value );
     // zero-compresses given buffer and adds it to the stream
     bool SaveZeroCompressed( const Buffer& data );
+    // frees substreams encoded by us
+    void ClearSubStreams();
+
+    /** Information about an object referenced more than once within the stream. */
+    struct SharedObject
+    {
+        /** Number of occurences within the stream. */
+        uint32 count;
+        /** Number of occurences not saved yet. */
+        uint32 remaining;
+        /** Index of the saved object; 0 if not saved yet. */
+        uint32 index;
+    };
+    typedef std::tr1::unordered_map<const PyRep*, SharedObject> SharedObjectMap;
+    typedef std::tr1::unordered_map<const PySubStream*, Buffer*> SubStreamMap;
 
+    /** Buffer we are saving to; NULL while measuring the stream. */
     Buffer* mBuffer;
+    /** Size of the stream measured so far. */
+    size_t mMeasuredSize;
+    /** The rep measured last; its shared objects are ready for saving. */
+    const PyRep* mMeasuredRep;
+
+    /** Shared objects of the stream being saved; NULL if they haven't been counted. */
+    SharedObjectMap* mSharedObjects;
+    /** Number of objects saved for referencing. */
+    uint32 mSavedCount;
+    /** Whether we are saving an object saved for referencing. */
+    bool mSavingShared;
+
+    /**
+     * Encoded substreams which had no data. Their data is left alone,
+     * since the rep may be shared with other threads; kept from
+     * measuring till saving, so they're encoded only once.
+     */
+    SubStreamMap mSubStreams;
 };
 
 #endif
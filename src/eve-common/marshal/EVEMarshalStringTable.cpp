@@ -27,234 +27,37 @@
 
 #include "marshal/EVEMarshalStringTable.h"
 
-/* we made up this list so we have efficient string communication with the client */
-const char* const MarshalStringTable::s_mStringTable[] =
+/* lookup a index using a string */
+uint8 MarshalStringTable::LookupIndex( const char* str, size_t len )
 {
-    "*corpid",
-    "*locationid",
-    "age",
-    "Asteroid",
-    "authentication",
-    "ballID",
-    "beyonce",
-    "bloodlineID",
-    "capacity",
-    "categoryID",
-    "character",
-    "characterID",
-    "characterName",
-    "characterType",
-    "charID",
-    "chatx",
-    "clientID",
-    "config",
-    "contraband",
-    "corporationDateTime",
-    "corporationID",
-    "createDateTime",
-    "customInfo",
-    "description",
-    "divisionID",
-    "DoDestinyUpdate",
-    "dogmaIM",
-    "EVE System",
-    "flag",
-    "foo.SlimItem",
-    "gangID",
-    "Gemini",
-    "gender",
-    "graphicID",
-    "groupID",
-    "header",
-    "idName",
-    "invbroker",
-    "itemID",
-    "items",
-    "jumps",
-    "line",
-    "lines",
-    "locationID",
-    "locationName",
-    "macho.CallReq",
-    "macho.CallRsp",
-    "macho.MachoAddress",
-    "macho.Notification",
-    "macho.SessionChangeNotification",
-    "modules",
-    "name",
-    "objectCaching",
-    "objectCaching.CachedObject",
-    "OnChatJoin",
-    "OnChatLeave",
-    "OnChatSpeak",
-    "OnGodmaShipEffect",
-    "OnItemChange",
-    "OnModuleAttributeChange",
-    "OnMultiEvent",
-    "orbitID",
-    "ownerID",
-    "ownerName",
-    "quantity",
-    "raceID",
-    "RowClass",
-    "securityStatus",
-    "Sentry Gun",
-    "sessionchange",
-    "singleton",
-    "skillEffect",
-    "squadronID",
-    "typeID",
-    "used",
-    "userID",
-    "util.CachedObject",
-    "util.IndexRowset",
-    "util.Moniker",
-    "util.Row",
-    "util.Rowset",
-    "*multicastID",
-    "AddBalls",
-    "AttackHit3",
-    "AttackHit3R",
-    "AttackHit4R",
-    "DoDestinyUpdates",
-    "GetLocationsEx",
-    "InvalidateCachedObjects",
-    "JoinChannel",
-    "LSC",
-    "LaunchMissile",
-    "LeaveChannel",
-    "OID+",
-    "OID-",
-    "OnAggressionChange",
-    "OnCharGangChange",
-    "OnCharNoLongerInStation",
-    "OnCharNowInStation",
-    "OnDamageMessage",
-    "OnDamageStateChange",
-    "OnEffectHit",
-    "OnGangDamageStateChange",
-    "OnLSC",
-    "OnSpecialFX",
-    "OnTarget",
-    "RemoveBalls",
-    "SendMessage",
-    "SetMaxSpeed",
-    "SetSpeedFraction",
-    "TerminalExplosion",
-    "address",
-    "alert",
-    "allianceID",
-    "allianceid",
-    "bid",
-    "bookmark",
-    "bounty",
-    "channel",
-    "charid",
-    "constellationid",
-    "corpID",
-    "corpid",
-    "corprole",
-    "damage",
-    "duration",
-    "effects.Laser",
-    "gangid",
-    "gangrole",
-    "hqID",
-    "issued",
-    "jit",
-    "languageID",
-    "locationid",
-    "machoVersion",
-    "marketProxy",
-    "minVolume",
-    "orderID",
-    "price",
-    "range",
-    "regionID",
-    "regionid",
-    "role",
-    "rolesAtAll",
-    "rolesAtBase",
-    "rolesAtHQ",
-    "rolesAtOther",
-    "shipid",
-    "sn",
-    "solarSystemID",
-    "solarsystemid",
-    "solarsystemid2",
-    "source",
-    "splash",
-    "stationID",
-    "stationid",
-    "target",
-    "userType",
-    "userid",
-    "volEntered",
-    "volRemaining",
-    "weapon",
-    "agent.missionTemplatizedContent_BasicKillMission",
-    "agent.missionTemplatizedContent_ResearchKillMission",
-    "agent.missionTemplatizedContent_StorylineKillMission",
-    "agent.missionTemplatizedContent_GenericStorylineKillMission",
-    "agent.missionTemplatizedContent_BasicCourierMission",
-    "agent.missionTemplatizedContent_ResearchCourierMission",
-    "agent.missionTemplatizedContent_StorylineCourierMission",
-    "agent.missionTemplatizedContent_GenericStorylineCourierMission",
-    "agent.missionTemplatizedContent_BasicTradeMission",
-    "agent.missionTemplatizedContent_ResearchTradeMission",
-    "agent.missionTemplatizedContent_StorylineTradeMission",
-    "agent.missionTemplatizedContent_GenericStorylineTradeMission",
-    "agent.offerTemplatizedContent_BasicExchangeOffer",
-    "agent.offerTemplatizedContent_BasicExchangeOffer_ContrabandDemand",
-    "agent.offerTemplatizedContent_BasicExchangeOffer_Crafting",
-    "agent.LoyaltyPoints",
-    "agent.ResearchPoints",
-    "agent.Credits",
-    "agent.Item",
-    "agent.Entity",
-    "agent.Objective",
-    "agent.FetchObjective",
-    "agent.EncounterObjective",
-    "agent.DungeonObjective",
-    "agent.TransportObjective",
-    "agent.Reward",
-    "agent.TimeBonusReward",
-    "agent.MissionReferral",
-    "agent.Location",
-    "agent.StandardMissionDetails",
-    "agent.OfferDetails",
-    "agent.ResearchMissionDetails",
-    "agent.StorylineMissionDetails",
-};
-
-const size_t MarshalStringTable::s_mStringTableSize = sizeof( MarshalStringTable::s_mStringTable ) / sizeof( const char* );
+    typedef MarshalStringTableData Data;
 
-MarshalStringTable::MarshalStringTable()
-{
-    for( uint8 i = 1; i <= s_mStringTableSize; i++ )
-        mStringTableMap.insert( std::make_pair( hash( LookupString( i ) ), i ) );
-}
+    const uint32 hash = fnv1a_hash( str, len );
+    const uint16 seed = Data::seeds[ hash & ( Data::bucketCount - 1 ) ];
 
-/* lookup a index using a string */
-uint8 MarshalStringTable::LookupIndex( const std::string& str )
-{
-    return LookupIndex( str.c_str() );
-}
+    const uint8 index = Data::slots[ hash_mix( hash, seed ) & ( Data::slotCount - 1 ) ];
+    if( STRING_TABLE_ERROR == index )
+        return STRING_TABLE_ERROR;
 
-/* lookup a index using a string */
-uint8 MarshalStringTable::LookupIndex( const char* str )
-{
-    StringTableMapConstItr res = mStringTableMap.find( hash( str ) );
-    if( mStringTableMap.end() == res )
+    // the hash is perfect only for the strings within the table
+    if( Data::lengths[ index - 1 ] != len || 0 != memcmp( Data::strings[ index - 1 ], str, len ) )
         return STRING_TABLE_ERROR;
 
-    return res->second;
+    return index;
 }
 
 const char* MarshalStringTable::LookupString( uint8 index )
 {
-    if( --index < s_mStringTableSize )
-        return s_mStringTable[ index ];
+    if( --index < MarshalStringTableData::size )
+        return MarshalStringTableData::strings[ index ];
+    else
+        return NULL;
+}
+
+PyString* MarshalStringTable::LookupPyString( uint8 index )
+{
+    if( --index < MarshalStringTableData::size )
+        return MarshalStringTableData::pyStrings[ index ];
     else
         return NULL;
 }
@@ -27,46 +27,42 @@
 #define __EVE_MARSHAL_STRING_TABLE_H__INCL__
 
 #include "python/PyRep.h"
+#include "marshal/EVEMarshalStringTableData.h"
 
 /* Since returned index is always > 0, we may use 0 as error signal. */
 #define STRING_TABLE_ERROR 0
 
 /**
- * @brief a singleton data container for communication string lookup.
+ * @brief Lookup of communication strings.
  *
- * this class is a data container for communication string lookup.
- * eventually this class should be available to every thread the unmarshal's.
- * so only until we have solved the entire mess.. this is a singleton with mutex locks.
+ * The table is fixed by the protocol, so it is generated at build
+ * time by eve-xmlpktgen (see EVEMarshalStringTableData.xmlp) along
+ * with a perfect hash; a lookup neither allocates nor locks and
+ * compares at most one string.
  *
- * @todo when the object puzzle is solved this class should be available to every thread.
- * it doesn't take much mem. So it means the mutexes can be removed when every thread has its own resource.
- *
- * @author Captnoord
- * @date December 2008
+ * @author Captnoord, Bloody.Rabbit
  */
 class MarshalStringTable
-: public Singleton<MarshalStringTable>
 {
 public:
-    MarshalStringTable();
-
     /**
      * @brief lookup a index nr using a string
      *
-     * @param[in] string that needs a lookup for a index nr.
+     * @param[in] str string that needs a lookup for a index nr.
      *
      * @return the index number of the string that was given; STRING_TABLE_ERROR if string is not found.
      */
-    uint8 LookupIndex( const std::string& str );
+    static uint8 LookupIndex( const std::string& str ) { return LookupIndex( str.data(), str.size() ); }
 
     /**
-    * @brief lookup a index nr using a string
-    *
-    * @param[in] string that needs a lookup for a index nr.
-    *
-    * @return the index number of the string that was given; STRING_TABLE_ERROR if string is not found.
-    */
-    uint8 LookupIndex( const char* str );
+     * @brief lookup a index nr using a string
+     *
+     * @param[in] str string that needs a lookup for a index nr.
+     * @param[in] len length of the string.
+     *
+     * @return the index number of the string that was given; STRING_TABLE_ERROR if string is not found.
+     */
+    static uint8 LookupIndex( const char* str, size_t len );
 
     /**
      * @brief lookup a string using a index
@@ -75,44 +71,19 @@ public:
      *
      * @return if succeeds returns pointer to static string; if fails returns NULL.
      */
-    const char* LookupString( uint8 index );
+    static const char* LookupString( uint8 index );
 
-private:
     /**
-     * @brief djb2 algorithm taken from http://www.cse.yorku.ca/~oz/hash.html slightly modified
+     * @brief lookup a prebuilt string object using a index
      *
-     * @param[in] oStr string that needs to be hashed.
+     * The object is immortal, so it may be shared by
+     * any thread without adding a reference.
      *
-     * @return djb2 has of the string.
+     * @param[in] index is the index of the string that needs to be looked up.
+     *
+     * @return if succeeds returns the borrowed object; if fails returns NULL.
      */
-    uint32 hash( const char* str )
-    {
-        uint32 hash = 5381;
-        int c;
-
-        while( ( c = *str++ ) )
-            hash = ( ( hash << 5 ) + hash ) + c; /* hash * 33 + c */
-
-        return hash;
-    }
-
-    typedef std::tr1::unordered_map<uint32, uint8>  StringTableMap;
-    typedef StringTableMap::iterator                StringTableMapItr;
-    typedef StringTableMap::const_iterator          StringTableMapConstItr;
-
-    StringTableMap  mStringTableMap;
-
-    /* we made up this list so we have efficient string communication with the client */
-    static const char* const s_mStringTable[];
-
-    /* the current string count of the string table */
-    static const size_t s_mStringTableSize;
+    static PyString* LookupPyString( uint8 index );
 };
 
-#define sMarshalStringTable \
-    ( MarshalStringTable::get() )
-
 #endif /* !__EVE_MARSHAL_STRING_TABLE_H__INCL__ */
-
-
-
@@ -32,9 +32,51 @@
 #include "marshal/EVEUnmarshal.h"
 #include "marshal/EVEMarshalOpcodes.h"
 #include "marshal/EVEMarshalStringTable.h"
+#include "marshal/EVEZeroCompress.h"
 
 #include "utils/EVEUtils.h"
 
+/** Maximal nesting depth of elements in a stream. */
+static const uint32 UNMARSHAL_MAX_DEPTH = 1000;
+
+/**
+ * @brief Increments given depth for its lifetime.
+ */
+class UnmarshalDepthGuard
+{
+public:
+    UnmarshalDepthGuard( uint32& depth ) : mDepth( depth ) { ++mDepth; }
+    ~UnmarshalDepthGuard() { --mDepth; }
+
+protected:
+    uint32& mDepth;
+};
+
+/**
+ * @brief Converts UTF-16 string to UTF-8.
+ *
+ * @param[in]  first Iterator pointing to the first character.
+ * @param[in]  last  Iterator pointing after the last character.
+ * @param[out] into  The converted string is appended here.
+ *
+ * @retval true  Conversion succeeded.
+ * @retval false The string is not valid UTF-16.
+ */
+template<typename Iter>
+static bool ConvertUTF16( Iter first, Iter last, std::string& into )
+{
+    try
+    {
+        utf8::utf16to8( first, last, std::back_inserter( into ) );
+    }
+    catch( const utf8::exception& )
+    {
+        return false;
+    }
+
+    return true;
+}
+
 PyRep* Unmarshal( const Buffer& data )
 {
     UnmarshalStream v;
@@ -129,8 +171,14 @@ PyRep* ( UnmarshalStream::* const UnmarshalStream::s_mLoadMap[ PyRepOpcodeMask +
 PyRep* UnmarshalStream::Load( const Buffer& data )
 {
     mInItr = data.begin<uint8>();
+    mInEnd = data.end<uint8>();
+    mInOverrun = false;
+    mDepth = 0;
+
     PyRep* res = LoadStream( data.size() );
+
     mInItr = Buffer::const_iterator<uint8>();
+    mInEnd = Buffer::const_iterator<uint8>();
 
     return res;
 }
@@ -145,9 +193,25 @@ PyRep* UnmarshalStream::LoadStream( size_t streamLength )
     }
 
     const uint32 saveCount = Read<uint32>();
-    CreateObjectStore( streamLength - sizeof( uint8 ) - sizeof( uint32 ), saveCount );
+    if( mInOverrun )
+    {
+        sLog.Error( "Unmarshal", "Invalid stream received (truncated header)." );
+        return NULL;
+    }
+
+    if( !CreateObjectStore( streamLength - sizeof( uint8 ) - sizeof( uint32 ), saveCount ) )
+    {
+        sLog.Error( "Unmarshal", "Invalid stream received (too many saved objects: %u).", saveCount );
+        return NULL;
+    }
 
     PyRep* rep = LoadRep();
+    if( mInOverrun )
+    {
+        sLog.Error( "Unmarshal", "Invalid stream received (truncated)." );
+        PySafeDecRef( rep );
+        rep = NULL;
+    }
 
     DestroyObjectStore();
     return rep;
@@ -155,6 +219,13 @@ PyRep* UnmarshalStream::LoadStream( size_t streamLength )
 
 PyRep* UnmarshalStream::LoadRep()
 {
+    if( UNMARSHAL_MAX_DEPTH <= mDepth )
+    {
+        sLog.Error( "Unmarshal", "Invalid stream received (nested too deep)." );
+        return NULL;
+    }
+    UnmarshalDepthGuard guard( mDepth );
+
     const uint8 header = Read<uint8>();
 
     const bool flagUnknown = ( header & PyRepUnknownMask ) != 0;
@@ -164,36 +235,628 @@ PyRep* UnmarshalStream::LoadRep()
     if( flagUnknown )
         sLog.Warning( "Unmarshal", "Encountered flagUnknown in header 0x%X.", header );
 
-    const uint32 storageIndex = ( flagSave ? GetStorageIndex() : 0 );
+    uint32 storageIndex = 0;
+    if( flagSave )
+    {
+        storageIndex = GetStorageIndex();
+        if( 0 == storageIndex )
+        {
+            sLog.Error( "Unmarshal", "Invalid storage index for saved object (opcode 0x%X).", opcode );
+            return NULL;
+        }
+    }
 
     PyRep* rep = ( this->*s_mLoadMap[ opcode ] )();
 
-    if( 0 != storageIndex )
+    if( NULL != rep && 0 != storageIndex )
         StoreObject( storageIndex, rep );
 
     return rep;
 }
 
-void UnmarshalStream::CreateObjectStore( size_t streamLength, uint32 saveCount )
+bool UnmarshalStream::BeginStream( const Buffer& data )
+{
+    if( sizeof( uint8 ) + sizeof( uint32 ) > data.size() )
+        return false;
+
+    mInItr = data.begin<uint8>();
+    mInEnd = data.end<uint8>();
+    mInOverrun = false;
+    mDepth = 0;
+
+    if( MarshalHeaderByte != Read<uint8>() )
+    {
+        End();
+        return false;
+    }
+
+    // saved objects are referenced by index, which requires the objects
+    if( 0 != Read<uint32>() )
+    {
+        End();
+        return false;
+    }
+
+    return true;
+}
+
+void UnmarshalStream::End()
+{
+    mInItr = Buffer::const_iterator<uint8>();
+    mInEnd = Buffer::const_iterator<uint8>();
+}
+
+bool UnmarshalStream::SkipNone()
+{
+    if( Op_PyNone != PeekOpcode() )
+        return false;
+
+    Read<uint8>();
+    return true;
+}
+
+bool UnmarshalStream::LoadInt( int32& into )
+{
+    switch( PeekOpcode() )
+    {
+        case Op_PyLong:
+        {
+            Read<uint8>();
+            into = Read<int32>();
+        } return true;
+
+        case Op_PySignedShort:
+        {
+            Read<uint8>();
+            into = Read<int16>();
+        } return true;
+
+        case Op_PyByte:
+        {
+            Read<uint8>();
+            into = Read<int8>();
+        } return true;
+
+        case Op_PyMinusOne:
+        {
+            Read<uint8>();
+            into = -1;
+        } return true;
+
+        case Op_PyZeroInteger:
+        {
+            Read<uint8>();
+            into = 0;
+        } return true;
+
+        case Op_PyOneInteger:
+        {
+            Read<uint8>();
+            into = 1;
+        } return true;
+
+        case Op_PyVarInteger:
+        {
+            int64 value;
+            if( !ReadIntegerVar( value, sizeof( int32 ) ) )
+                return false;
+
+            into = static_cast<int32>( value );
+        } return true;
+
+        default:
+            return false;
+    }
+}
+
+bool UnmarshalStream::LoadLong( int64& into )
+{
+    switch( PeekOpcode() )
+    {
+        case Op_PyLongLong:
+        {
+            Read<uint8>();
+            into = Read<int64>();
+        } return true;
+
+        case Op_PyVarInteger:
+            return ReadIntegerVar( into, sizeof( int64 ) );
+
+        default:
+        {
+            int32 value;
+            if( !LoadInt( value ) )
+                return false;
+
+            into = value;
+        } return true;
+    }
+}
+
+bool UnmarshalStream::LoadFloat( double& into )
+{
+    switch( PeekOpcode() )
+    {
+        case Op_PyReal:
+        {
+            Read<uint8>();
+            into = Read<double>();
+        } return true;
+
+        case Op_PyZeroReal:
+        {
+            Read<uint8>();
+            into = 0.0;
+        } return true;
+
+        default:
+            return false;
+    }
+}
+
+bool UnmarshalStream::LoadBool( bool& into )
+{
+    switch( PeekOpcode() )
+    {
+        case Op_PyTrue:
+        {
+            Read<uint8>();
+            into = true;
+        } return true;
+
+        case Op_PyFalse:
+        {
+            Read<uint8>();
+            into = false;
+        } return true;
+
+        default:
+            return false;
+    }
+}
+
+bool UnmarshalStream::LoadString( std::string& into )
+{
+    switch( PeekOpcode() )
+    {
+        case Op_PyEmptyString:
+        {
+            Read<uint8>();
+            into.clear();
+        } return true;
+
+        case Op_PyCharString:
+        {
+            Read<uint8>();
+
+            into.assign( 1, Read<char>() );
+        } return true;
+
+        case Op_PyShortString:
+        {
+            Read<uint8>();
+
+            const uint8 len = Read<uint8>();
+            if( !Require<char>( len ) )
+                return false;
+
+            const Buffer::const_iterator<char> str = Read<char>( len );
+            into.assign( str, str + len );
+        } return true;
+
+        case Op_PyLongString:
+        {
+            Read<uint8>();
+
+            const uint32 len = ReadSizeEx();
+            if( !Require<char>( len ) )
+                return false;
+
+            const Buffer::const_iterator<char> str = Read<char>( len );
+            into.assign( str, str + len );
+        } return true;
+
+        case Op_PyStringTableItem:
+        {
+            Read<uint8>();
+
+            const uint8 index = Read<uint8>();
+
+            const char* str = MarshalStringTable::LookupString( index );
+            if( NULL == str )
+            {
+                sLog.Error( "Unmarshal", "String Table Item %u is out of range!", index );
+                return false;
+            }
+
+            into = str;
+        } return true;
+
+        default:
+            return false;
+    }
+}
+
+bool UnmarshalStream::LoadWString( std::string& into )
+{
+    switch( PeekOpcode() )
+    {
+        case Op_PyEmptyWString:
+        {
+            Read<uint8>();
+            into.clear();
+        } return true;
+
+        case Op_PyWStringUCS2Char:
+        {
+            Read<uint8>();
+
+            const uint16 wchar = Read<uint16>();
+
+            into.clear();
+            return ConvertUTF16( &wchar, &wchar + 1, into );
+        }
+
+        case Op_PyWStringUCS2:
+        {
+            Read<uint8>();
+
+            const uint32 len = ReadSizeEx();
+            if( !Require<uint16>( len ) )
+                return false;
+
+            const Buffer::const_iterator<uint16> wstr = Read<uint16>( len );
+
+            into.clear();
+            return ConvertUTF16( wstr, wstr + len, into );
+        }
+
+        case Op_PyWStringUTF8:
+        {
+            Read<uint8>();
+
+            const uint32 len = ReadSizeEx();
+            if( !Require<char>( len ) )
+                return false;
+
+            const Buffer::const_iterator<char> wstr = Read<char>( len );
+            into.assign( wstr, wstr + len );
+        } return true;
+
+        default:
+            return false;
+    }
+}
+
+bool UnmarshalStream::LoadToken( std::string& into )
+{
+    if( Op_PyToken != PeekOpcode() )
+        return false;
+
+    Read<uint8>();
+
+    const uint8 len = Read<uint8>();
+    if( !Require<char>( len ) )
+        return false;
+
+    const Buffer::const_iterator<char> str = Read<char>( len );
+    into.assign( str, str + len );
+
+    return true;
+}
+
+bool UnmarshalStream::LoadTupleHeader( uint32& size )
+{
+    switch( PeekOpcode() )
+    {
+        case Op_PyEmptyTuple:
+        {
+            Read<uint8>();
+            size = 0;
+        } return true;
+
+        case Op_PyOneTuple:
+        {
+            Read<uint8>();
+            size = 1;
+        } return true;
+
+        case Op_PyTwoTuple:
+        {
+            Read<uint8>();
+            size = 2;
+        } return true;
+
+        case Op_PyTuple:
+        {
+            Read<uint8>();
+            size = ReadSizeEx();
+        } return true;
+
+        default:
+            return false;
+    }
+}
+
+bool UnmarshalStream::LoadListHeader( uint32& size )
+{
+    switch( PeekOpcode() )
+    {
+        case Op_PyEmptyList:
+        {
+            Read<uint8>();
+            size = 0;
+        } return true;
+
+        case Op_PyOneList:
+        {
+            Read<uint8>();
+            size = 1;
+        } return true;
+
+        case Op_PyList:
+        {
+            Read<uint8>();
+            size = ReadSizeEx();
+        } return true;
+
+        default:
+            return false;
+    }
+}
+
+bool UnmarshalStream::LoadDictHeader( uint32& size )
+{
+    if( Op_PyDict != PeekOpcode() )
+        return false;
+
+    Read<uint8>();
+    size = ReadSizeEx();
+
+    return true;
+}
+
+bool UnmarshalStream::LoadObjectHeader()
+{
+    if( Op_PyObject != PeekOpcode() )
+        return false;
+
+    Read<uint8>();
+    return true;
+}
+
+bool UnmarshalStream::LoadSubStructHeader()
+{
+    if( Op_PySubStruct != PeekOpcode() )
+        return false;
+
+    Read<uint8>();
+    return true;
+}
+
+bool UnmarshalStream::LoadElementStream( Buffer& into )
+{
+    const Buffer::const_iterator<uint8> start = mInItr;
+    if( !SkipRep() )
+        return false;
+
+    // the element cannot reference saved objects; see BeginStream
+    into.Append<uint8>( MarshalHeaderByte );
+    into.Append<uint32>( 0 );
+    into.AppendSeq( start, mInItr );
+
+    return true;
+}
+
+uint8 UnmarshalStream::PeekOpcode() const
+{
+    return ( Peek<uint8>() & PyRepOpcodeMask );
+}
+
+bool UnmarshalStream::SkipRep()
+{
+    if( UNMARSHAL_MAX_DEPTH <= mDepth )
+        return false;
+    UnmarshalDepthGuard guard( mDepth );
+
+    const Buffer::const_iterator<uint8> start = mInItr;
+    const uint8 opcode = ( Read<uint8>() & PyRepOpcodeMask );
+
+    uint32 count = 0;
+    switch( opcode )
+    {
+        case Op_PyNone:
+        case Op_PyMinusOne:
+        case Op_PyZeroInteger:
+        case Op_PyOneInteger:
+        case Op_PyZeroReal:
+        case Op_PyEmptyString:
+        case Op_PyTrue:
+        case Op_PyFalse:
+        case Op_PyEmptyTuple:
+        case Op_PyEmptyList:
+        case Op_PyEmptyWString:
+            return true;
+
+        case Op_PyLongLong:
+        case Op_PyReal:
+            return Skip<uint8>( 8 );
+
+        case Op_PyLong:
+            return Skip<uint8>( 4 );
+
+        case Op_PySignedShort:
+        case Op_PyWStringUCS2Char:
+            return Skip<uint8>( 2 );
+
+        case Op_PyByte:
+        case Op_PyCharString:
+        case Op_PyStringTableItem:
+            return Skip<uint8>( 1 );
+
+        case Op_PyShortString:
+        case Op_PyToken:
+            return Skip<uint8>( Read<uint8>() );
+
+        case Op_PyVarInteger:
+        case Op_PyBuffer:
+        case Op_PyLongString:
+        case Op_PyWStringUTF8:
+        case Op_PySubStream:
+            return Skip<uint8>( ReadSizeEx() );
+
+        case Op_PyWStringUCS2:
+            return Skip<uint16>( ReadSizeEx() );
+
+        case Op_PyChecksumedStream:
+            Read<uint32>();
+            count = 1;
+            break;
+
+        case Op_PyOneTuple:
+        case Op_PyOneList:
+        case Op_PySubStruct:
+            count = 1;
+            break;
+
+        case Op_PyTwoTuple:
+        case Op_PyObject:
+            count = 2;
+            break;
+
+        case Op_PyTuple:
+        case Op_PyList:
+            count = ReadSizeEx();
+            break;
+
+        case Op_PyDict:
+            count = 2 * ReadSizeEx();
+            break;
+
+        case Op_PyObjectEx1:
+        case Op_PyObjectEx2:
+        {
+            // header, list items, terminator, dict entries, terminator
+            if( !SkipRep() )
+                return false;
+
+            for( int i = 0; i < 2; ++i )
+            {
+                while( Op_PackedTerminator != Peek<uint8>() )
+                {
+                    if( !SkipRep() )
+                        return false;
+                }
+                Read<uint8>();
+            }
+        } return true;
+
+        case Op_PyPackedRow:
+        case Op_PySavedStreamElement:
+        {
+            // layout depends on the loaded objects; load it then
+            mInItr = start;
+
+            PyRep* rep = LoadRep();
+            if( NULL == rep )
+                return false;
+
+            PyDecRef( rep );
+        } return true;
+
+        default:
+            LoadError();
+            return false;
+    }
+
+    for( uint32 i = 0; i < count; ++i )
+    {
+        if( !SkipRep() )
+            return false;
+    }
+
+    return true;
+}
+
+bool UnmarshalStream::ReadIntegerVar( int64& into, size_t maxLength )
+{
+    // see LoadIntegerVar
+    const Buffer::const_iterator<uint8> start = mInItr;
+    Read<uint8>();
+
+    const uint32 len = ReadSizeEx();
+    if( maxLength < len )
+    {
+        mInItr = start;
+        return false;
+    }
+    if( !Require<uint8>( len ) )
+        return false;
+
+    const Buffer::const_iterator<uint8> data = Read<uint8>( len );
+
+    if( sizeof( int32 ) >= len )
+    {
+        int32 intval = 0;
+        memcpy( &intval, &*data, len );
+
+        into = intval;
+    }
+    else
+    {
+        int64 intval = 0;
+        memcpy( &intval, &*data, len );
+
+        into = intval;
+    }
+
+    return true;
+}
+
+bool UnmarshalStream::CreateObjectStore( size_t streamLength, uint32 saveCount )
 {
     DestroyObjectStore();
 
     if( 0 < saveCount )
     {
-        mStoreIndexItr = ( ( mInItr + streamLength ).As<uint32>() - saveCount );
+        if( streamLength / sizeof( uint32 ) < saveCount )
+            return false;
+
+        mStoreIndexEnd = ( mInItr + streamLength ).As<uint32>();
+        mStoreIndexItr = mStoreIndexEnd - saveCount;
         mStoredObjects = new PyList( saveCount );
+
+        // the indexes are not part of the data
+        mInEnd = mStoreIndexItr.As<uint8>();
     }
+
+    return true;
 }
 
 void UnmarshalStream::DestroyObjectStore()
 {
     mStoreIndexItr = Buffer::const_iterator<uint32>();
+    mStoreIndexEnd = Buffer::const_iterator<uint32>();
+
     PySafeDecRef( mStoredObjects );
+    mStoredObjects = NULL;
+}
+
+uint32 UnmarshalStream::GetStorageIndex()
+{
+    if( NULL == mStoredObjects || mStoreIndexEnd <= mStoreIndexItr )
+        return 0;
+
+    const uint32 index = *mStoreIndexItr++;
+    if( mStoredObjects->size() < index )
+        return 0;
+
+    return index;
 }
 
 PyRep* UnmarshalStream::GetStoredObject( uint32 index )
 {
-    if( 0 < index )
+    if( NULL != mStoredObjects && 0 < index && index <= mStoredObjects->size() )
         return mStoredObjects->GetItem( --index );
     return NULL;
 }
@@ -217,6 +880,9 @@ PyRep* UnmarshalStream::LoadIntegerVar()
      */
 
     const uint32 len = ReadSizeEx();
+    if( !Require<uint8>( len ) )
+        return NULL;
+
     const Buffer::const_iterator<uint8> data = Read<uint8>( len );
 
     if( sizeof( int32 ) >= len )
@@ -224,7 +890,7 @@ PyRep* UnmarshalStream::LoadIntegerVar()
         int32 intval = 0;
         memcpy( &intval, &*data, len );
 
-        return new PyInt( intval );
+        return new_int( intval );
     }
     else if( sizeof( int64 ) >= len )
     {
@@ -243,52 +909,66 @@ PyRep* UnmarshalStream::LoadIntegerVar()
 
 PyRep* UnmarshalStream::LoadStringChar()
 {
-    const Buffer::const_iterator<char> str = Read<char>( 1 );
+    const char c = Read<char>();
 
-    return new PyString( str, str + 1 );
+    return new_string( &c, 1 );
 }
 
 PyRep* UnmarshalStream::LoadStringShort()
 {
     const uint8 len = Read<uint8>();
+    if( 0 == len )
+        return new_string( "", 0 );
+    if( !Require<char>( len ) )
+        return NULL;
+
     const Buffer::const_iterator<char> str = Read<char>( len );
 
-    return new PyString( str, str + len );
+    return new_string( &*str, len );
 }
 
 PyRep* UnmarshalStream::LoadStringLong()
 {
     const uint32 len = ReadSizeEx();
+    if( 0 == len )
+        return new_string( "", 0 );
+    if( !Require<char>( len ) )
+        return NULL;
+
     const Buffer::const_iterator<char> str = Read<char>( len );
 
-    return new PyString( str, str + len );
+    return new_string( &*str, len );
 }
 
 PyRep* UnmarshalStream::LoadStringTable()
 {
     const uint8 index = Read<uint8>();
 
-    const char* str = sMarshalStringTable.LookupString( index );
+    PyString* str = MarshalStringTable::LookupPyString( index );
     if( NULL == str )
     {
-        assert( false );
         sLog.Error( "Unmarshal", "String Table Item %u is out of range!", index );
-
-        char ebuf[64];
-        snprintf( ebuf, 64, "Invalid String Table Item %u", index );
-        return new PyString( ebuf );
+        return NULL;
     }
     else
-        return new PyString( str );
+    {
+        // share the prebuilt object
+        PyIncRef( str );
+        return str;
+    }
 }
 
 PyRep* UnmarshalStream::LoadWStringUCS2Char()
 {
-    const Buffer::const_iterator<uint16> wstr = Read<uint16>( 1 );
+    const uint16 wchar = Read<uint16>();
 
     // convert to UTF-8
     std::string str;
-    utf8::utf16to8( wstr, wstr + 1, std::back_inserter( str ) );
+    if( !ConvertUTF16( &wchar, &wchar + 1, str ) )
+    {
+        sLog.Error( "Unmarshal", "Invalid UCS-2 character." );
+        return NULL;
+    }
 
     return new PyWString( str );
 }
@@ -296,11 +976,18 @@ PyRep* UnmarshalStream::LoadWStringUCS2Char()
 PyRep* UnmarshalStream::LoadWStringUCS2()
 {
     const uint32 len = ReadSizeEx();
+    if( !Require<uint16>( len ) )
+        return NULL;
+
     const Buffer::const_iterator<uint16> wstr = Read<uint16>( len );
 
     // convert to UTF-8
     std::string str;
-    utf8::utf16to8( wstr, wstr + len, std::back_inserter( str ) );
+    if( !ConvertUTF16( wstr, wstr + len, str ) )
+    {
+        sLog.Error( "Unmarshal", "Invalid UCS-2 string." );
+        return NULL;
+    }
 
     return new PyWString( str );
 }
@@ -308,6 +995,9 @@ PyRep* UnmarshalStream::LoadWStringUCS2()
 PyRep* UnmarshalStream::LoadWStringUTF8()
 {
     const uint32 len = ReadSizeEx();
+    if( !Require<char>( len ) )
+        return NULL;
+
     const Buffer::const_iterator<char> wstr = Read<char>( len );
 
     return new PyWString( wstr, wstr + len );
@@ -316,6 +1006,9 @@ PyRep* UnmarshalStream::LoadWStringUTF8()
 PyRep* UnmarshalStream::LoadToken()
 {
     const uint8 len = Read<uint8>();
+    if( !Require<char>( len ) )
+        return NULL;
+
     const Buffer::const_iterator<char> str = Read<char>( len );
 
     return new PyToken( str, str + len );
@@ -324,6 +1017,9 @@ PyRep* UnmarshalStream::LoadToken()
 PyRep* UnmarshalStream::LoadBuffer()
 {
     const uint32 len = ReadSizeEx();
+    if( !Require<uint8>( len ) )
+        return NULL;
+
     const Buffer::const_iterator<uint8> data = Read<uint8>( len );
 
     return new PyBuffer( data, data + len );
@@ -331,7 +1027,11 @@ PyRep* UnmarshalStream::LoadBuffer()
 
 PyRep* UnmarshalStream::LoadTuple()
 {
+    // every item takes at least a byte
     const uint32 count = ReadSizeEx();
+    if( !Require<uint8>( count ) )
+        return NULL;
+
     PyTuple* tuple = new PyTuple( count );
 
     for( uint32 i = 0; i < count; i++ )
@@ -383,7 +1083,11 @@ PyRep* UnmarshalStream::LoadTupleTwo()
 
 PyRep* UnmarshalStream::LoadList()
 {
+    // every item takes at least a byte
     const uint32 count = ReadSizeEx();
+    if( !Require<uint8>( count ) )
+        return NULL;
+
     PyList* list = new PyList( count );
 
     for( uint32 i = 0; i < count; i++ )
@@ -415,23 +1119,35 @@ PyRep* UnmarshalStream::LoadListOne()
 
 PyRep* UnmarshalStream::LoadDict()
 {
+    // every entry takes at least two bytes
     const uint32 count = ReadSizeEx();
+    if( !Require<uint16>( count ) )
+        return NULL;
+
     PyDict* dict = new PyDict;
+    dict->items.reserve( count );
 
     for( uint32 i = 0; i < count; i++ )
     {
         PyRep* value = LoadRep();
         if( NULL == value )
+        {
+            PyDecRef( dict );
             return NULL;
+        }
 
         PyRep* key = LoadRep();
         if( NULL == key )
         {
             PyDecRef( value );
+            PyDecRef( dict );
             return NULL;
         }
 
+        // SetItem takes its own references
         dict->SetItem( key, value );
+        PyDecRef( key );
+        PyDecRef( value );
     }
 
     return dict;
@@ -474,6 +1190,9 @@ PyRep* UnmarshalStream::LoadObjectEx2()
 PyRep* UnmarshalStream::LoadSubStream()
 {
     const uint32 len = ReadSizeEx();
+    if( !Require<uint8>( len ) )
+        return NULL;
+
     const Buffer::const_iterator<uint8> data = Read<uint8>( len );
 
     return new PySubStream( new PyBuffer( data, data + len ) );
@@ -513,9 +1232,10 @@ PyRep* UnmarshalStream::LoadPackedRow()
     if( NULL == header_element )
         return NULL;
 
-    Buffer unpacked;
-    if( !LoadZeroCompressed( unpacked ) )
+    if( !DBRowDescriptor::IsValid( header_element ) )
     {
+        sLog.Error( "Unmarshal", "PackedRow: Invalid row descriptor." );
+
         PyDecRef( header_element );
         return NULL;
     }
@@ -524,108 +1244,28 @@ PyRep* UnmarshalStream::LoadPackedRow()
     // support anything else ....
     PyPackedRow* row = new PyPackedRow( (DBRowDescriptor*)header_element );
 
-    // Create size map, sorted from the greatest to the smallest value
-    std::multimap< uint8, uint32, std::greater< uint8 > > sizeMap;
-    uint32 cc = row->header()->ColumnCount();
-    size_t sum = 0;
-
-    for( uint32 i = 0; i < cc; i++ )
+    // Packed fields are unpacked right into the column buffer:
+    if( !LoadZeroCompressed( row->data() ) )
     {
-        uint8 size = DBTYPE_GetSizeBits( row->header()->GetColumnType( i ) );
-
-        sizeMap.insert( std::make_pair( size, i ) );
-        sum += size;
+        PyDecRef( row );
+        return NULL;
     }
 
-    // make sure there is enough data in buffer
-    sum = ( ( sum + 7 ) >> 3 );
-    unpacked.Resize<uint8>( sum );
-
-    Buffer::const_iterator<uint8> unpackedItr = unpacked.begin<uint8>();
-    uint8 bitOffset = 0;
-
-    std::multimap< uint8, uint32, std::greater< uint8 > >::iterator cur, end;
-    cur = sizeMap.begin();
-    end = sizeMap.end();
-    for(; cur != end; ++cur)
+    // Fields that are not packed follow:
+    const uint32 cc = row->ColumnCount();
+    for( uint32 i = 0; i < cc; i++ )
     {
-        const uint32 index = cur->second;
+        if( row->IsFieldPacked( i ) )
+            continue;
 
-        switch( row->header()->GetColumnType( index ) )
+        PyRep* el = LoadRep();
+        if( NULL == el )
         {
-            case DBTYPE_I8:
-            case DBTYPE_UI8:
-            case DBTYPE_CY:
-            case DBTYPE_FILETIME:
-            {
-                Buffer::const_iterator<int64> v = unpackedItr.As<int64>();
-                row->SetField( index, new PyLong( *v++ ) );
-                unpackedItr = v.As<uint8>();
-            } break;
-
-            case DBTYPE_I4:
-            case DBTYPE_UI4:
-            {
-                Buffer::const_iterator<int32> v = unpackedItr.As<int32>();
-                row->SetField( index, new PyInt( *v++ ) );
-                unpackedItr = v.As<uint8>();
-            } break;
-
-            case DBTYPE_I2:
-            case DBTYPE_UI2:
-            {
-                Buffer::const_iterator<int16> v = unpackedItr.As<int16>();
-                row->SetField( index, new PyInt( *v++ ) );
-                unpackedItr = v.As<uint8>();
-            } break;
-
-            case DBTYPE_I1:
-            case DBTYPE_UI1:
-            {
-                Buffer::const_iterator<int8> v = unpackedItr.As<int8>();
-                row->SetField( index, new PyInt( *v++ ) );
-                unpackedItr = v.As<uint8>();
-            } break;
-
-            case DBTYPE_R8:
-            {
-                Buffer::const_iterator<double> v = unpackedItr.As<double>();
-                row->SetField( index, new PyFloat( *v++ ) );
-                unpackedItr = v.As<uint8>();
-            } break;
-
-            case DBTYPE_R4:
-            {
-                Buffer::const_iterator<float> v = unpackedItr.As<float>();
-                row->SetField( index, new PyFloat( *v++ ) );
-                unpackedItr = v.As<uint8>();
-            } break;
-
-            case DBTYPE_BOOL:
-            {
-                if( 7 < bitOffset )
-                {
-                    bitOffset = 0;
-                    ++unpackedItr;
-                }
-
-                row->SetField( index, new PyBool( ( *unpackedItr >> bitOffset++ ) & 0x01 ) );
-            } break;
-
-            case DBTYPE_BYTES:
-            case DBTYPE_STR:
-            case DBTYPE_WSTR:
-            {
-                PyRep* el = LoadRep();
-                if( NULL == el )
-                {
-                    PyDecRef( row );
-                    return NULL;
-                }
-
-                row->SetField( index, el );
-            } break;
+            PyDecRef( row );
+            return NULL;
         }
+
+        row->SetField( i, el );
     }
 
     return row;
@@ -691,7 +1331,10 @@ PyObjectEx* UnmarshalStream::LoadObjectEx( bool is_type_2 )
             return NULL;
         }
 
+        // SetItem takes its own references
         obj->dict().SetItem( key, value );
+        PyDecRef( key );
+        PyDecRef( value );
     }
     //skip Op_PackedTerminator
     Read<uint8>();
@@ -702,41 +1345,11 @@ PyObjectEx* UnmarshalStream::LoadObjectEx( bool is_type_2 )
 bool UnmarshalStream::LoadZeroCompressed( Buffer& into )
 {
     const uint32 packedLen = ReadSizeEx();
+    if( !Require<uint8>( packedLen ) )
+        return false;
 
-    Buffer::const_iterator<uint8> cur, end;
-    cur = Read<uint8>( packedLen );
-    end = cur + packedLen;
-    while( cur < end )
-    {
-        // Load opcode
-        const Buffer::const_iterator<ZeroCompressOpcode> opcode = cur.As<ZeroCompressOpcode>();
-        ++cur;
-
-#   define OPCODE_DECODE( opIsZero, opLen )     \
-        if( opIsZero )                          \
-        {                                       \
-            uint8 len = opLen + 1;              \
-            while( 0 < len-- )                  \
-                into.Append<uint8>( 0 );        \
-        }                                       \
-        else                                    \
-        {                                       \
-            const Buffer::const_iterator<uint8> \
-                dataEnd = 8 - opLen < end - cur \
-                          ? cur + ( 8 - opLen ) \
-                          : end;                \
-                                                \
-            into.AppendSeq( cur, dataEnd );     \
-            cur = dataEnd;                      \
-        }
-
-        // Decode first part
-        OPCODE_DECODE( opcode->firstIsZero, opcode->firstLen )
-        // Decode second part
-        OPCODE_DECODE( opcode->secondIsZero, opcode->secondLen )
-
-#   undef OPCODE_DECODE
-    }
+    const uint8* packed = ( 0 < packedLen ? &*Read<uint8>( packedLen ) : NULL );
 
+    ZeroUncompress( packed, packedLen, ( 0 < into.size() ? &into[ 0 ] : NULL ), into.size() );
     return true;
 }
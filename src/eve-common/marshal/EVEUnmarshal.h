@@ -54,7 +54,9 @@ class UnmarshalStream
 {
 public:
     UnmarshalStream()
-    : mStoredObjects( NULL )
+    : mInOverrun( false ),
+      mDepth( 0 ),
+      mStoredObjects( NULL )
     {
     }
 
@@ -67,21 +69,132 @@ public:
      */
     PyRep* Load( const Buffer& data );
 
+    /**
+     * @name Direct loading
+     *
+     * Methods used to load values without building Python objects,
+     * mostly by UnmarshalFrom methods generated by eve-xmlpktgen.
+     * Loading is started by BeginStream, followed by the Load* calls
+     * in stream order and finished by End. The typed Load* methods
+     * leave the stream untouched and return false if the next element
+     * is of different type, so that alternatives may be tried.
+     */
+    //@{
+    /**
+     * @brief Starts loading given stream.
+     *
+     * Streams which save objects for later reference are refused;
+     * these have to be loaded whole by Load.
+     *
+     * @param[in] data Buffer containing marshal bytecode.
+     *
+     * @retval true  The stream may be loaded directly.
+     * @retval false The stream is invalid or saves objects.
+     */
+    bool BeginStream( const Buffer& data );
+    /** finishes direct loading */
+    void End();
+
+    /** moves past None */
+    bool SkipNone();
+    /** loads an integer */
+    bool LoadInt( int32& into );
+    /** loads a long; integers are accepted as well */
+    bool LoadLong( int64& into );
+    /** loads a real */
+    bool LoadFloat( double& into );
+    /** loads a boolean */
+    bool LoadBool( bool& into );
+    /** loads a string */
+    bool LoadString( std::string& into );
+    /** loads a wide string, converted to UTF-8 */
+    bool LoadWString( std::string& into );
+    /** loads a token */
+    bool LoadToken( std::string& into );
+
+    /** starts a tuple; the items are to be loaded next */
+    bool LoadTupleHeader( uint32& size );
+    /** starts a list; the items are to be loaded next */
+    bool LoadListHeader( uint32& size );
+    /** starts a dict; the entries are to be loaded next, each as value followed by key */
+    bool LoadDictHeader( uint32& size );
+    /** starts an object; the type and arguments are to be loaded next */
+    bool LoadObjectHeader();
+    /** starts a sub structure; the content is to be loaded next */
+    bool LoadSubStructHeader();
+
+    /** Loads rep from stream. */
+    PyRep* LoadRep();
+    /**
+     * @brief Moves past the next element, copying it out as a stream of its own.
+     *
+     * @param[out] into Buffer to which the stream is appended.
+     *
+     * @retval true  The element has been copied.
+     * @retval false The element is invalid.
+     */
+    bool LoadElementStream( Buffer& into );
+    //@}
+
 protected:
-    /** Peeks element from stream. */
+    /** @return True if there are at least @a count elements left in stream. */
+    template<typename T>
+    bool CanRead( size_t count ) const { return count <= (size_t)( mInEnd - mInItr ) / sizeof( T ); }
+
+    /** Peeks element from stream; zero if there is none. */
     template<typename T>
-    const T& Peek() const { return *Peek<T>( 1 ); }
-    /** Peeks elements from stream. */
+    const T& Peek() const
+    {
+        static const T zero = T();
+        return ( CanRead<T>( 1 ) ? *Peek<T>( 1 ) : zero );
+    }
+    /** Peeks elements from stream; these must be checked by CanRead. */
     template<typename T>
     Buffer::const_iterator<T> Peek( size_t count ) const { return mInItr.As<T>(); }
 
-    /** Reads element from stream. */
+    /**
+     * @brief Reads element from stream.
+     *
+     * Reading past the end of stream yields zero and
+     * marks the stream as overrun; the load fails then.
+     */
+    template<typename T>
+    const T& Read()
+    {
+        static const T zero = T();
+        return ( Require<T>( 1 ) ? *Read<T>( 1 ) : zero );
+    }
+    /**
+     * @brief Checks there are at least @a count elements left in stream.
+     *
+     * Marks the stream as overrun if there are not.
+     */
+    template<typename T>
+    bool Require( size_t count )
+    {
+        if( CanRead<T>( count ) )
+            return true;
+
+        mInItr = mInEnd;
+        mInOverrun = true;
+        return false;
+    }
+    /** Moves past elements in stream; false if there are not enough of them. */
     template<typename T>
-    const T& Read() { return *Read<T>( 1 ); }
-    /** Reads elements from stream. */
+    bool Skip( size_t count )
+    {
+        if( !Require<T>( count ) )
+            return false;
+
+        Read<T>( count );
+        return true;
+    }
+    /** Reads elements from stream; these must be checked by CanRead. */
     template<typename T>
     Buffer::const_iterator<T> Read( size_t count )
     {
+        assert( CanRead<T>( count ) );
+
         Buffer::const_iterator<T> res = Peek<T>( count );
         mInItr = ( res + count ).template As<uint8>();
         return res;
@@ -100,16 +213,21 @@ protected:
     /** Initializes loading and loads rep from stream. */
     PyRep* LoadStream( size_t streamLength );
 
-    /** Loads rep from stream. */
-    PyRep* LoadRep();
+    /** Peeks opcode of the next element, without the flags. */
+    uint8 PeekOpcode() const;
+    /** Moves past the next element without loading it. */
+    bool SkipRep();
 
     /**
      * @brief Initializes object store.
      *
      * @param[in] streamLength Length of stream.
      * @param[in] saveCount    Number of saved objects within the stream.
+     *
+     * @retval true  Object store created.
+     * @retval false The stream is too short for given number of saved objects.
      */
-    void CreateObjectStore( size_t streamLength, uint32 saveCount );
+    bool CreateObjectStore( size_t streamLength, uint32 saveCount );
     /**
      * @brief Destroys object store.
      */
@@ -118,9 +236,9 @@ protected:
     /**
      * @brief Obtains storage index for StoreObject.
      *
-     * @return Storage index.
+     * @return Storage index; 0 if the stream doesn't provide a valid one.
      */
-    uint32 GetStorageIndex() { return *mStoreIndexItr++; }
+    uint32 GetStorageIndex();
     /**
      * @brief Obtains previously stored object.
      *
@@ -139,29 +257,29 @@ protected:
 
 private:
     /** Loads none from stream. */
-    PyRep* LoadNone() { return new PyNone; }
+    PyRep* LoadNone() { return new_none(); }
 
     /** Loads true boolean from stream. */
-    PyRep* LoadBoolTrue() { return new PyBool( true ); }
+    PyRep* LoadBoolTrue() { return new_bool( true ); }
     /** Loads false boolean from stream. */
-    PyRep* LoadBoolFalse() { return new PyBool( false ); }
+    PyRep* LoadBoolFalse() { return new_bool( false ); }
 
     /** Loads long long integer from stream. */
     PyRep* LoadIntegerLongLong() { return new PyLong( Read<int64>() ); }
     /** Loads long integer from stream. */
-    PyRep* LoadIntegerLong() { return new PyInt( Read<int32>() ); }
+    PyRep* LoadIntegerLong() { return new_int( Read<int32>() ); }
     /** Loads signed short from stream. */
-    PyRep* LoadIntegerSignedShort() { return new PyInt( Read<int16>() ); }
+    PyRep* LoadIntegerSignedShort() { return new_int( Read<int16>() ); }
     /** Loads byte integer from stream. */
-    PyRep* LoadIntegerByte() { return new PyInt( Read<int8>() ); }
+    PyRep* LoadIntegerByte() { return new_int( Read<int8>() ); }
     /** Loads variable length integer from stream. */
     PyRep* LoadIntegerVar();
     /** Loads minus one integer from stream. */
-    PyRep* LoadIntegerMinusOne() { return new PyInt( -1 ); }
+    PyRep* LoadIntegerMinusOne() { return new_int( -1 ); }
     /** Loads zero integer from stream. */
-    PyRep* LoadIntegerZero() { return new PyInt( 0 ); }
+    PyRep* LoadIntegerZero() { return new_int( 0 ); }
     /** Loads one integer from stream. */
-    PyRep* LoadIntegerOne() { return new PyInt( 1 ); }
+    PyRep* LoadIntegerOne() { return new_int( 1 ); }
 
     /** Loads real from stream. */
     PyRep* LoadReal() { return new PyFloat( Read<double>() ); }
@@ -169,7 +287,7 @@ private:
     PyRep* LoadRealZero() { return new PyFloat( 0.0 ); }
 
     /** Loads empty string from stream. */
-    PyRep* LoadStringEmpty() { return new PyString( "" ); }
+    PyRep* LoadStringEmpty() { return new_string( "", 0 ); }
     /** Loads single character string from stream. */
     PyRep* LoadStringChar();
     /** Loads short (up to 255 chars) string from stream. */
@@ -237,14 +355,24 @@ private:
 
     /** Helper; loads extended object from stream. */
     PyObjectEx* LoadObjectEx( bool is_type_2 );
-    /** Helper; loads zero-compressed buffer from stream. */
+    /** Helper; loads zero-compressed buffer from stream, filling the whole @a into. */
     bool LoadZeroCompressed( Buffer& into );
+    /** Helper; reads variable length integer of at most maxLength bytes from stream. */
+    bool ReadIntegerVar( int64& into, size_t maxLength );
 
     /** Buffer iterator we are processing. */
     Buffer::const_iterator<uint8> mInItr;
+    /** End of data in the buffer. */
+    Buffer::const_iterator<uint8> mInEnd;
+    /** Whether we attempted to read past mInEnd. */
+    bool mInOverrun;
+    /** Current nesting depth of loaded elements. */
+    uint32 mDepth;
 
     /** Next store index for referencing in the buffer. */
     Buffer::const_iterator<uint32> mStoreIndexItr;
+    /** End of store indexes in the buffer. */
+    Buffer::const_iterator<uint32> mStoreIndexEnd;
     /** Referenced objects within the buffer. */
     PyList* mStoredObjects;
 
@@ -0,0 +1,174 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#include "eve-common.h"
+
+#include "marshal/EVEMarshalOpcodes.h"
+#include "marshal/EVEZeroCompress.h"
+
+/* The opcode layout matches ZeroCompressOpcode: the low nibble
+   describes the first run, the high nibble the second one. */
+static const uint8 ZERO_RUN_FLAG = 0x08;
+static const uint8 ZERO_RUN_LEN_MASK = 0x07;
+
+static const uint64 BYTE_HIGH_BITS = 0x8080808080808080ULL;
+
+/**
+ * @brief Loads up to 8 bytes into a word, zero-padded.
+ */
+static inline uint64 LoadWord( const uint8* p, size_t avail )
+{
+    uint64 v = 0;
+    memcpy( &v, p, 8 < avail ? 8 : avail );
+    return v;
+}
+
+/**
+ * @return Word with the high bit of each non-zero byte of @a v set.
+ */
+static inline uint64 NonZeroBytes( uint64 v )
+{
+    return ( ( ( v & ~BYTE_HIGH_BITS ) + ~BYTE_HIGH_BITS ) | v ) & BYTE_HIGH_BITS;
+}
+
+/**
+ * @return Number of bytes preceding the first byte of @a mask with its high bit set.
+ */
+static inline size_t LeadingClearBytes( uint64 mask )
+{
+    if( 0 == mask )
+        return 8;
+
+    // the lowest set bit is the high bit of byte k; the multiplication
+    // moves the k-th byte of the constant, which holds k, to the top
+    const uint64 lowest = mask & ( 0 - mask );
+    return (size_t)( ( ( lowest >> 7 ) * 0x0001020304050607ULL ) >> 56 );
+}
+
+size_t ZeroCompressBound( size_t len )
+{
+    // every opcode but the last one covers at least 2 bytes
+    return len + ( len + 1 ) / 2;
+}
+
+size_t ZeroCompress( const uint8* src, size_t len, uint8* dst )
+{
+    const uint8* cur = src;
+    const uint8* const end = src + len;
+    uint8* out = dst;
+
+    while( cur < end )
+    {
+        uint8* const opcode = out++;
+        *opcode = 0;
+
+        for( int shift = 0; shift < 8; shift += 4 )
+        {
+            if( end <= cur )
+            {
+                // empty zero run
+                *opcode |= ZERO_RUN_FLAG << shift;
+                break;
+            }
+
+            const size_t avail = end - cur;
+            const uint64 nonZero = NonZeroBytes( LoadWord( cur, avail ) );
+
+            size_t run;
+            if( 0 == ( nonZero & 0x80 ) )
+            {
+                run = LeadingClearBytes( nonZero );
+                if( avail < run )
+                    run = avail;
+
+                *opcode |= ( ZERO_RUN_FLAG | ( run - 1 ) ) << shift;
+            }
+            else
+            {
+                // zero padding of a short load ends the run by itself
+                run = LeadingClearBytes( ~nonZero & BYTE_HIGH_BITS );
+
+                *opcode |= ( ( 8 - run ) & ZERO_RUN_LEN_MASK ) << shift;
+                memcpy( out, cur, run );
+                out += run;
+            }
+
+            cur += run;
+        }
+    }
+
+    return out - dst;
+}
+
+size_t ZeroUncompress( const uint8* src, size_t srcLen, uint8* dst, size_t dstLen )
+{
+    const uint8* cur = src;
+    const uint8* const end = src + srcLen;
+    uint8* out = dst;
+    uint8* const dstEnd = dst + dstLen;
+    size_t total = 0;
+
+    while( cur < end )
+    {
+        const uint8 opcode = *cur++;
+
+        for( int shift = 0; shift < 8; shift += 4 )
+        {
+            const uint8 op = ( opcode >> shift ) & 0x0F;
+            const size_t room = dstEnd - out;
+
+            size_t run;
+            if( op & ZERO_RUN_FLAG )
+            {
+                run = ( op & ZERO_RUN_LEN_MASK ) + 1;
+
+                // whatever we write past the run is overwritten by the next one
+                if( 8 <= room )
+                    memset( out, 0, 8 );
+                else
+                    memset( out, 0, run < room ? run : room );
+            }
+            else
+            {
+                run = 8 - op;
+                if( (size_t)( end - cur ) < run )
+                    run = end - cur;
+
+                if( 8 <= room && 8 <= end - cur )
+                    memcpy( out, cur, 8 );
+                else
+                    memcpy( out, cur, run < room ? run : room );
+
+                cur += run;
+            }
+
+            out += run < room ? run : room;
+            total += run;
+        }
+    }
+
+    memset( out, 0, dstEnd - out );
+    return total;
+}
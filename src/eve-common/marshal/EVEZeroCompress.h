@@ -0,0 +1,78 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#ifndef __EVE_ZERO_COMPRESS_H__INCL__
+#define __EVE_ZERO_COMPRESS_H__INCL__
+
+/*
+ * Zero compression is the run-length encoding the client uses for
+ * data of packed rows. Each opcode byte (see ZeroCompressOpcode)
+ * describes two runs of 1 to 8 bytes; a run is either zeros, which
+ * are not stored, or non-zero bytes, which follow the opcode.
+ *
+ * Runs never exceed 8 bytes, so both directions work on whole
+ * 64-bit words: the encoder finds run lengths from a zero-byte
+ * mask of the next 8 bytes and the decoder stores each run with
+ * a single 8-byte copy or fill.
+ */
+
+/**
+ * @brief Returns upper bound of zero-compressed size.
+ *
+ * @param[in] len Length of data to be compressed.
+ *
+ * @return Maximal size of the compressed data.
+ */
+size_t ZeroCompressBound( size_t len );
+
+/**
+ * @brief Zero-compresses data.
+ *
+ * The output is byte-for-byte the same the client produces.
+ *
+ * @param[in]  src Data to be compressed.
+ * @param[in]  len Length of the data.
+ * @param[out] dst Destination; must hold at least ZeroCompressBound( len ) bytes.
+ *
+ * @return Size of the compressed data.
+ */
+size_t ZeroCompress( const uint8* src, size_t len, uint8* dst );
+
+/**
+ * @brief Unpacks zero-compressed data.
+ *
+ * Unpacked data beyond the destination is dropped, space
+ * not covered by the data is zero-filled.
+ *
+ * @param[in]  src    Compressed data.
+ * @param[in]  srcLen Length of the compressed data.
+ * @param[out] dst    Destination.
+ * @param[in]  dstLen Length of the destination.
+ *
+ * @return Length the data unpacks to.
+ */
+size_t ZeroUncompress( const uint8* src, size_t srcLen, uint8* dst, size_t dstLen );
+
+#endif /* !__EVE_ZERO_COMPRESS_H__INCL__ */
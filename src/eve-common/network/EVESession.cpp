@@ -35,6 +35,51 @@
 #include "python/PyDumpVisitor.h"
 #include "EVEVersion.h"
 
+/**
+ * @brief Determines compression class of given packet.
+ *
+ * @param[in] packet The packet to classify.
+ *
+ * @return Compression class of the packet.
+ */
+static CompressionPolicy::PacketClass ClassifyPacket( const PyPacket* packet )
+{
+    switch( packet->type )
+    {
+        case NOTIFICATION:
+        case SESSIONCHANGENOTIFICATION:
+        case SESSIONINITIALSTATENOTIFICATION:
+        case MOVEMENTNOTIFICATION:
+            return CompressionPolicy::CLASS_NOTIFICATION;
+
+        case CALL_RSP:
+        {
+            // Call returns are wrapped in a substream, see Client::_SendCallReturn
+            if( NULL == packet->payload || 0 == packet->payload->size() )
+                return CompressionPolicy::CLASS_CALL_RETURN;
+
+            const PyRep* item = packet->payload->GetItem( 0 );
+            if( NULL == item || !item->IsSubStream() )
+                return CompressionPolicy::CLASS_CALL_RETURN;
+
+            const PyRep* result = item->AsSubStream()->decoded();
+            if( NULL == result || !result->IsObject() )
+                return CompressionPolicy::CLASS_CALL_RETURN;
+
+            const std::string& type = result->AsObject()->type()->content();
+            if( "objectCaching.CachedObject" == type
+                || "objectCaching.CachedMethodCallResult" == type
+                || "util.CachedObject" == type )
+                return CompressionPolicy::CLASS_CACHED_OBJECT;
+
+            return CompressionPolicy::CLASS_CALL_RETURN;
+        }
+
+        default:
+            return CompressionPolicy::CLASS_OTHER;
+    }
+}
+
 EVEClientSession::EVEClientSession( EVETCPConnection** n )
 : mNet( *n ),
   mPacketHandler( NULL )
@@ -51,6 +96,7 @@ EVEClientSession::~EVEClientSession()
 void EVEClientSession::Reset()
 {
     mPacketHandler = NULL;
+    mNet->SetPacketDecoding( false );
 
     if( GetState() != TCPConnection::STATE_CONNECTED )
         // Connection has been lost, there's no point in reset
@@ -86,28 +132,27 @@ void EVEClientSession::FastQueuePacket( PyPacket** p )
     if(p == NULL || *p == NULL)
         return;
 
-    PyRep* r = (*p)->Encode();
-    // maybe change PyPacket to a object with a reference..
-    SafeDelete( *p );
-    if( r == NULL )
-    {
-        sLog.Error("Network", "%s: Failed to encode a Fast queue packet???", GetAddress().c_str());
-        return;
-    }
+    const CompressionPolicy::PacketClass packetClass = ClassifyPacket( *p );
 
-    mNet->QueueRep( r );
-    PyDecRef( r );
+    // encoded, marshaled and sent by a serializer thread
+    mNet->QueuePacket( p, packetClass );
 }
 
 PyPacket* EVEClientSession::PopPacket()
 {
-    PyRep* r = mNet->PopRep();
-    if( r == NULL )
+    PyRep* r;
+    PyPacket* p;
+    if( !mNet->PopReceived( r, p ) )
         return NULL;
 
-    if(is_log_enabled(NET__PRES_REP)) {
-        _log(NET__PRES_REP, "%s: Raw Rep Dump:", GetAddress().c_str());
-        r->Dump(NET__PRES_REP, "    ");
+    if( p != NULL )
+    {
+        // already decoded by the network thread
+        if( mPacketHandler == &EVEClientSession::_HandlePacket )
+            return p;
+
+        // the session has been reset meanwhile
+        r = PyPacket::Encode( &p );
     }
 
     assert( mPacketHandler );
@@ -212,7 +257,11 @@ PyPacket* EVEClientSession::_HandleFuncResult( PyRep* rep )
     if( !hr.Decode( &rep ) )
         sLog.Error("Network", "%s: Received invalid crypto handshake result!", GetAddress().c_str());
     else if( _VerifyFuncResult( hr ) )
+    {
         mPacketHandler = &EVEClientSession::_HandlePacket;
+        // let the network thread decode packets from now on
+        mNet->SetPacketDecoding( true );
+    }
 
     // recurse
     return PopPacket();
@@ -220,6 +269,7 @@ PyPacket* EVEClientSession::_HandleFuncResult( PyRep* rep )
 
 PyPacket* EVEClientSession::_HandlePacket( PyRep* rep )
 {
+    // only reps received before packet decoding was enabled get here
     //take the PyRep and turn it into a PyPacket
     PyPacket* p = new PyPacket;
     if( !p->Decode( &rep ) ) //rep is consumed here
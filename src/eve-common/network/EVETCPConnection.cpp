@@ -28,6 +28,9 @@
 #include "marshal/EVEMarshal.h"
 #include "marshal/EVEUnmarshal.h"
 #include "network/EVETCPConnection.h"
+#include "python/PyArena.h"
+#include "python/PyPacket.h"
+#include "python/PyRep.h"
 
 /*************************************************************************/
 /* EVETCPConnection                                                      */
@@ -35,96 +38,229 @@
 const uint32 EVETCPConnection::TIMEOUT_MS = 10 * 60 * 1000; // 10 minutes
 const uint32 EVETCPConnection::PACKET_SIZE_LIMIT = 10 * 1024 * 1024; // 10 megabytes
 
+/** Number of packets waiting to be serialized, over all connections. */
+static volatile long serializeQueueDepth = 0;
+/** Maximal value of serializeQueueDepth. */
+static volatile long serializeMaxQueueDepth = 0;
+
+/**
+ * @return Pool of threads which serialize outgoing packets.
+ */
+static WorkerPool& GetSerializerPool()
+{
+    static WorkerPool pool( "Network" );
+    return pool;
+}
+
+bool EVETCPConnection::StartSerializers( uint32 threadCount )
+{
+    return GetSerializerPool().Start( threadCount );
+}
+
+void EVETCPConnection::StopSerializers()
+{
+    GetSerializerPool().Stop();
+}
+
+EVETCPConnection::SerializeStats EVETCPConnection::GetSerializeStats()
+{
+    SerializeStats stats;
+    stats.queueDepth = AtomicLoad( serializeQueueDepth );
+    stats.maxQueueDepth = AtomicLoad( serializeMaxQueueDepth );
+    stats.pool = GetSerializerPool().GetStats();
+
+    return stats;
+}
+
 EVETCPConnection::EVETCPConnection()
 : TCPConnection(),
-  mTimeoutTimer( TIMEOUT_MS )
+  mTimeoutTimer( TIMEOUT_MS ),
+  mDecodePackets( false ),
+  mSerializeQueueDepth( 0 ),
+  mSerializeJob( *this )
 {
 }
 
 EVETCPConnection::EVETCPConnection( Socket* sock, uint32 rIP, uint16 rPort )
 : TCPConnection( sock, rIP, rPort ),
-  mTimeoutTimer( TIMEOUT_MS )
+  mTimeoutTimer( TIMEOUT_MS ),
+  mDecodePackets( false ),
+  mSerializeQueueDepth( 0 ),
+  mSerializeJob( *this )
 {
 }
 
-void EVETCPConnection::QueueRep( const PyRep* rep )
+EVETCPConnection::~EVETCPConnection()
 {
-    Buffer* buf = new Buffer;
+    // Let the serializer send everything queued so far
+    Disconnect();
+    while( 0 < AtomicLoad( mSerializeQueueDepth ) )
+        Sleep( 1 );
+
+    // The network thread pushes into our queues, so stop it
+    // now rather than in ~TCPConnection, when they're gone.
+    WaitLoop();
+    DoDisconnect();
+
+    PyRep* rep;
+    PyPacket* packet;
+    while( PopReceived( rep, packet ) )
+    {
+        PySafeDecRef( rep );
+        SafeDelete( packet );
+    }
 
-    // make room for length
-    const Buffer::iterator<uint32> bufLen = buf->end<uint32>();
-    buf->ResizeAt( bufLen, 1 );
+    ReleaseSent();
+}
 
-    if( !MarshalDeflate( rep, *buf ) )
-        sLog.Error( "Network", "Failed to marshal new packet." );
-    else if( PACKET_SIZE_LIMIT < buf->size() )
-        sLog.Error( "Network", "Packet length %u exceeds hardcoded packet length limit %lu.", buf->size(), PACKET_SIZE_LIMIT );
-    else
-    {
-        //DumpBuffer( buf, PACKET_OUTBOUND );
-        // write length
-        *bufLen = ( buf->size() - sizeof( uint32 ) );
+void EVETCPConnection::QueueRep( const PyRep* rep, CompressionPolicy::PacketClass packetClass )
+{
+    Outgoing out = { const_cast< PyRep* >( rep ), NULL, packetClass };
+    PyIncRef( out.rep );
 
-        Send( &buf );
+    Enqueue( out );
+}
 
-    }
+void EVETCPConnection::QueuePacket( PyPacket** packet, CompressionPolicy::PacketClass packetClass )
+{
+    Outgoing out = { NULL, *packet, packetClass };
+    *packet = NULL;
 
-    SafeDelete( buf );
+    Enqueue( out );
 }
 
-PyRep* EVETCPConnection::PopRep()
+void EVETCPConnection::Disconnect()
 {
-    Buffer* packet = NULL;
-    PyRep* res = NULL;
+    Outgoing out = { NULL, NULL, CompressionPolicy::CLASS_OTHER };
 
-    {
-        MutexLock lock( mMInQueue );
-        packet = mInQueue.PopPacket();
-    }
+    Enqueue( out );
+}
+
+void EVETCPConnection::Enqueue( const Outgoing& out )
+{
+    // good time to get rid of what's been sent already
+    ReleaseSent();
+
+    mSerializeQueue.Push( out );
 
-    if( NULL != packet )
+    // packets are queued by many threads; raise the maximum only if nobody raised it further meanwhile
+    const long depth = AtomicIncrement( serializeQueueDepth );
+    long maxDepth = AtomicLoad( serializeMaxQueueDepth );
+    while( maxDepth < depth && !AtomicCompareExchange( serializeMaxQueueDepth, maxDepth, depth ) )
+        maxDepth = AtomicLoad( serializeMaxQueueDepth );
+
+    // the job runs until the queue is empty; post it if it's not running
+    if( 1 == AtomicIncrement( mSerializeQueueDepth ) )
+        GetSerializerPool().Post( &mSerializeJob );
+}
+
+void EVETCPConnection::SerializeQueued()
+{
+    do
     {
-        if( PACKET_SIZE_LIMIT < packet->size() )
-            sLog.Error( "Network", "Packet length %lu exceeds hardcoded packet length limit %u.", packet->size(), PACKET_SIZE_LIMIT );
+        Outgoing out;
+        const bool popped = mSerializeQueue.Pop( out );
+        assert( popped );
+
+        AtomicDecrement( serializeQueueDepth );
+
+        if( NULL != out.packet )
+            out.rep = PyPacket::Encode( &out.packet );
+
+        if( NULL == out.rep )
+        {
+            TCPConnection::Disconnect();
+            continue;
+        }
+
+        Buffer* buf = new Buffer;
+
+        // make room for length, in the same allocation as the packet
+        const Buffer::iterator<uint32> bufLen = buf->begin<uint32>();
+
+        if( !MarshalDeflate( out.rep, *buf, mCompression, out.packetClass, sizeof( uint32 ) ) )
+            sLog.Error( "Network", "Failed to marshal new packet." );
+        else if( PACKET_SIZE_LIMIT < buf->size() )
+            sLog.Error( "Network", "Packet length %u exceeds hardcoded packet length limit %lu.", buf->size(), PACKET_SIZE_LIMIT );
         else
         {
-            //DumpBuffer( packet, PACKET_INBOUND );
-            res = InflateUnmarshal( *packet );
+            //DumpBuffer( buf, PACKET_OUTBOUND );
+            // write length
+            *bufLen = ( buf->size() - sizeof( uint32 ) );
+
+            Send( &buf );
         }
+
+        SafeDelete( buf );
+
+        // immutable parts of the rep may be shared with the
+        // queueing thread, so leave releasing it to that thread
+        mSent.Push( out.rep );
     }
+    while( 0 < AtomicDecrement( mSerializeQueueDepth ) );
+}
+
+void EVETCPConnection::ReleaseSent()
+{
+    PyRep* rep;
+    while( mSent.Pop( rep ) )
+        PyDecRef( rep );
+}
 
-    SafeDelete( packet );
-    return res;
+void EVETCPConnection::SetPacketDecoding( bool enable )
+{
+    AtomicStore( mDecodePackets, enable );
+}
+
+bool EVETCPConnection::PopReceived( PyRep*& rep, PyPacket*& packet )
+{
+    ReleaseSent();
+
+    Received received;
+    if( !mReceived.Pop( received ) )
+        return false;
+
+    rep = received.rep;
+    packet = received.packet;
+
+    return true;
 }
 
-bool EVETCPConnection::ProcessReceivedData( char* errbuf )
+uint8* EVETCPConnection::GetRecvWindow( size_t& len )
+{
+    // receive straight into the packetizer
+    return mInQueue.GetInputWindow( len );
+}
+
+bool EVETCPConnection::ProcessReceivedData( size_t len, char* errbuf )
 {
     if( errbuf )
         errbuf[0] = 0;
 
-    {
-        MutexLock lock( mMInQueue );
+    // commit received bytes
+    mInQueue.CommitInput( len );
+    // process packetizer
+    mInQueue.Process();
 
-        // put bytes into packetizer
-        mInQueue.InputData( *mRecvBuf );
-        // process packetizer
-        mInQueue.Process();
-    }
+    // decode complete packets here rather than in the main loop
+    Buffer* packet;
+    while( NULL != ( packet = mInQueue.PopPacket() ) )
+        DecodePacket( &packet );
 
     mTimeoutTimer.Start();
 
     return true;
 }
 
-bool EVETCPConnection::RecvData( char* errbuf )
+bool EVETCPConnection::CheckTimeout( char* errbuf )
 {
-    if( !TCPConnection::RecvData( errbuf ) )
-        return false;
+    if( errbuf )
+        errbuf[0] = 0;
 
     if( mTimeoutTimer.Check() )
     {
         if( errbuf )
-            snprintf( errbuf, TCPCONN_ERRBUF_SIZE, "EVETCPConnection::RecvData(): Connection timeout" );
+            snprintf( errbuf, TCPCONN_ERRBUF_SIZE, "EVETCPConnection::CheckTimeout(): Connection timeout" );
         return false;
     }
 
@@ -137,11 +273,53 @@ void EVETCPConnection::ClearBuffers()
 
     mTimeoutTimer.Start();
 
+    mCompression.LogStats( GetAddress().c_str() );
+    mCompression.Reset();
+
+    mInQueue.ClearBuffers();
+}
+
+void EVETCPConnection::DecodePacket( Buffer** packet )
+{
+    Buffer* buf = *packet;
+    *packet = NULL;
+
+    Received received = { NULL, NULL };
+
+    if( PACKET_SIZE_LIMIT < buf->size() )
+        sLog.Error( "Network", "Packet length %lu exceeds hardcoded packet length limit %u.", buf->size(), PACKET_SIZE_LIMIT );
+    else
     {
-        MutexLock lock( mMInQueue );
+        //DumpBuffer( buf, PACKET_INBOUND );
+        // decode the whole packet into a single arena
+        PyArena arena( buf->size() );
+        received.rep = InflateUnmarshal( *buf );
 
-        mInQueue.ClearBuffers();
+        if( NULL != received.rep )
+        {
+            if( is_log_enabled( NET__PRES_REP ) )
+            {
+                _log( NET__PRES_REP, "%s: Raw Rep Dump:", GetAddress().c_str() );
+                received.rep->Dump( NET__PRES_REP, "    " );
+            }
+
+            if( AtomicLoad( mDecodePackets ) )
+            {
+                //take the PyRep and turn it into a PyPacket
+                received.packet = new PyPacket;
+                if( !received.packet->Decode( &received.rep ) ) //rep is consumed here
+                {
+                    sLog.Error( "Network", "%s: Failed to decode packet rep", GetAddress().c_str() );
+                    SafeDelete( received.packet );
+                }
+            }
+        }
     }
+
+    SafeDelete( buf );
+
+    if( NULL != received.rep || NULL != received.packet )
+        mReceived.Push( received );
 }
 
 void EVETCPConnection::DumpBuffer( Buffer* buf, packet_direction packet_direction)
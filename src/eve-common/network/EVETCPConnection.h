@@ -26,6 +26,11 @@
 #ifndef __NETWORK__EVE_TCP_CONNECTION_H__INCL__
 #define __NETWORK__EVE_TCP_CONNECTION_H__INCL__
 
+#include "marshal/CompressionPolicy.h"
+#include "threading/SPSCQueue.h"
+#include "threading/WorkerPool.h"
+
+class PyPacket;
 class PyRep;
 class EVETCPServer;
 
@@ -45,24 +50,107 @@ public:
     /// Hardcoded limit of packet size (NetClient.dll).
     static const uint32 PACKET_SIZE_LIMIT;
 
+    /**
+     * @brief Statistics of outgoing packets waiting to be serialized.
+     */
+    struct SerializeStats
+    {
+        /** Number of packets currently waiting, over all connections. */
+        size_t queueDepth;
+        /** Maximal number of packets which have been waiting at once. */
+        size_t maxQueueDepth;
+        /** Statistics of the thread pool; its jobs are connections with waiting packets. */
+        WorkerPool::Stats pool;
+    };
+
+    /**
+     * @brief Starts threads which marshal and deflate outgoing packets.
+     *
+     * Until they're started, packets are serialized right away
+     * by the thread which queues them.
+     *
+     * @param[in] threadCount Number of threads to start.
+     *
+     * @return True if the threads are running, false if not.
+     */
+    static bool StartSerializers( uint32 threadCount );
+    /**
+     * @brief Stops the serializer threads, serializing all waiting packets first.
+     */
+    static void StopSerializers();
+    /** @return Statistics of the serializer threads. */
+    static SerializeStats GetSerializeStats();
+
     /**
      * @brief Creates empty EVE connection.
      */
     EVETCPConnection();
+    /**
+     * @brief Sends queued packets, stops receiving and frees objects which haven't been popped.
+     */
+    ~EVETCPConnection();
 
     /**
      * @brief Queues given PyRep into send queue.
      *
-     * @param[in] rep PyRep to be queued.
+     * The PyRep is marshaled and deflated by one of the serializer
+     * threads, so it must not be modified once queued. Packets are
+     * sent in the order they've been queued. All packets of
+     * a connection must be queued by the same thread.
+     *
+     * @param[in] rep         PyRep to be queued.
+     * @param[in] packetClass Class of the packet, used to pick compression.
+     */
+    void QueueRep( const PyRep* rep, CompressionPolicy::PacketClass packetClass = CompressionPolicy::CLASS_OTHER );
+    /**
+     * @brief Queues given PyPacket into send queue.
+     *
+     * Like QueueRep, but the packet is encoded by the serializer
+     * thread too, taking over its payload instead of cloning it.
+     *
+     * @param[in] packet      PyPacket to be queued; consumed.
+     * @param[in] packetClass Class of the packet, used to pick compression.
+     */
+    void QueuePacket( PyPacket** packet, CompressionPolicy::PacketClass packetClass = CompressionPolicy::CLASS_OTHER );
+    /**
+     * @brief Schedules disconnect once all queued packets are sent.
+     *
+     * Must be called from the thread which queues packets.
+     */
+    void Disconnect();
+
+    /** @return Number of queued packets which haven't been serialized yet. */
+    size_t GetSerializeQueueDepth() const { return AtomicLoad( mSerializeQueueDepth ); }
+
+    /**
+     * @return Compression policy of this connection.
+     */
+    const CompressionPolicy& GetCompression() const { return mCompression; }
+
+    /**
+     * @brief Enables decoding of received PyReps into PyPackets.
+     *
+     * Objects received after this call are handed out as
+     * PyPackets by PopReceived; may be called from any thread.
+     *
+     * @param[in] enable Whether to decode received PyReps.
      */
-    void QueueRep( const PyRep* rep );
+    void SetPacketDecoding( bool enable );
 
     /**
-     * @brief Pops PyRep from receive queue.
+     * @brief Pops an object from receive queue.
+     *
+     * Received data are inflated, unmarshaled and (if enabled)
+     * decoded into PyPacket by the network thread as soon as
+     * they arrive, so popping costs next to nothing.
      *
-     * @return Popped PyRep; NULL if nothing was received.
+     * @param[out] rep    Popped PyRep; NULL if a packet has been popped.
+     * @param[out] packet Popped PyPacket; NULL if a PyRep has been popped.
+     *
+     * @retval true  An object has been popped.
+     * @retval false Nothing was received.
      */
-    PyRep* PopRep();
+    bool PopReceived( PyRep*& rep, PyPacket*& packet );
 
     /**
      * @brief Dumps buffer to file
@@ -87,18 +175,95 @@ protected:
      */
     EVETCPConnection( Socket* sock, uint32 rIP, uint16 rPort );
 
-    bool RecvData( char* errbuf = 0 );
-    bool ProcessReceivedData( char* errbuf = 0 );
+    uint8* GetRecvWindow( size_t& len );
+    bool ProcessReceivedData( size_t len, char* errbuf = 0 );
+    bool CheckTimeout( char* errbuf = 0 );
 
     void ClearBuffers();
 
+    /**
+     * @brief Decodes a received packet and queues the result.
+     *
+     * Called by the network thread.
+     *
+     * @param[in] packet The packet; consumed.
+     */
+    void DecodePacket( Buffer** packet );
+
+    /** A decoded object; exactly one of the members is set. */
+    struct Received
+    {
+        /** Object received while packet decoding was disabled. */
+        PyRep* rep;
+        /** Packet received while packet decoding was enabled. */
+        PyPacket* packet;
+    };
+
+    /** An outgoing object; a disconnect request if neither rep nor packet is set. */
+    struct Outgoing
+    {
+        /** PyRep to be sent; owns a reference. */
+        PyRep* rep;
+        /** PyPacket to be encoded and sent. */
+        PyPacket* packet;
+        /** Class of the packet, used to pick compression. */
+        CompressionPolicy::PacketClass packetClass;
+    };
+
+    /** Runs SerializeQueued of its connection. */
+    class SerializeJob
+    : public WorkerJob
+    {
+    public:
+        SerializeJob( EVETCPConnection& connection ) : mConnection( connection ) {}
+
+        void Run() { mConnection.SerializeQueued(); }
+
+    protected:
+        EVETCPConnection& mConnection;
+    };
+
+    /**
+     * @brief Queues an outgoing object and wakes up the serializer.
+     *
+     * @param[in] out The object.
+     */
+    void Enqueue( const Outgoing& out );
+    /**
+     * @brief Serializes and sends queued objects until the queue is empty.
+     *
+     * Called by a serializer thread.
+     */
+    void SerializeQueued();
+    /**
+     * @brief Releases PyReps which have been sent.
+     *
+     * Called by the thread which queues packets.
+     */
+    void ReleaseSent();
+
     /// Timer used to implement timeout.
     Timer mTimeoutTimer;
 
-    /// Mutex to protect received data queue.
-    Mutex mMInQueue;
-    /// Received data queue.
+    /// Received data queue; only touched by the I/O thread holding mMSock.
     StreamPacketizer mInQueue;
+
+    /// Whether to decode received PyReps into PyPackets.
+    volatile bool mDecodePackets;
+    /// Decoded objects; pushed by the network thread, popped by the main loop.
+    SPSCQueue< Received > mReceived;
+
+    /// Compression policy of outgoing packets.
+    CompressionPolicy mCompression;
+
+    /// Objects to be sent; pushed by the queueing thread, popped by a serializer thread.
+    SPSCQueue< Outgoing > mSerializeQueue;
+    /// Number of objects in mSerializeQueue; the serializer job is posted whenever it rises from 0.
+    volatile long mSerializeQueueDepth;
+    /// Job which serializes mSerializeQueue.
+    SerializeJob mSerializeJob;
+    /// Sent PyReps, released by the queueing thread as they may share objects with it.
+    SPSCQueue< PyRep* > mSent;
 };
 
 #endif /* !__NETWORK__EVE_TCP_CONNECTION_H__INCL__ */
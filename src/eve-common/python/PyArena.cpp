@@ -0,0 +1,308 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#include "eve-common.h"
+
+#include "python/PyArena.h"
+#include "threading/Atomic.h"
+#include "threading/ThreadLocal.h"
+
+/** Size of the first chunk per byte of size hint. */
+static const size_t PYARENA_HINT_FACTOR = 4;
+/** Minimal size of a chunk. */
+static const size_t PYARENA_MIN_CHUNK = 0x400;
+/** Maximal size of a chunk (unless an object doesn't fit). */
+static const size_t PYARENA_MAX_CHUNK = 0x10000;
+
+/** Alignment of objects. */
+static const size_t PYARENA_ALIGNMENT = 8;
+
+/**
+ * @brief Rounds given size up to keep objects aligned.
+ */
+static size_t AlignSize( size_t size )
+{
+    return ( size + PYARENA_ALIGNMENT - 1 ) / PYARENA_ALIGNMENT * PYARENA_ALIGNMENT;
+}
+
+/**
+ * @brief Header of each allocation.
+ *
+ * Tells whether the object lives in a chunk and if so, in which one.
+ */
+union PyArena::Header
+{
+    /** The chunk; NULL if allocated from heap. */
+    Chunk* chunk;
+
+    /** Keeps the objects aligned. */
+    uint8 align[ PYARENA_ALIGNMENT ];
+};
+
+/**
+ * @brief Block of memory objects are carved from.
+ *
+ * The memory follows immediately after the chunk.
+ */
+class PyArena::Chunk
+{
+public:
+    /**
+     * @brief Allocates a new chunk.
+     *
+     * @param[in] size Usable size of the chunk.
+     *
+     * @return The new chunk.
+     */
+    static Chunk* Create( size_t size );
+
+    /**
+     * @brief Carves memory out of the chunk.
+     *
+     * @param[in] size Required size.
+     *
+     * @return Pointer to the memory; NULL if it doesn't fit.
+     */
+    void* Allocate( size_t size )
+    {
+        if( size > (size_t)( mEnd - mPos ) )
+            return NULL;
+
+        void* p = mPos;
+        mPos += size;
+
+        AtomicIncrement( mLive );
+        return p;
+    }
+    /**
+     * @brief Returns memory of an object to the chunk.
+     *
+     * May be called by any thread.
+     */
+    void Free()
+    {
+        Release();
+    }
+
+    /**
+     * @brief Detaches the chunk from its arena.
+     *
+     * The chunk is destroyed once there are no objects living in it.
+     */
+    void Retire()
+    {
+        Release();
+    }
+
+protected:
+    /**
+     * @brief Drops a reference, destroying the chunk with the last one.
+     */
+    void Release()
+    {
+        const long live = AtomicDecrement( mLive );
+        assert( 0 <= live );
+
+        if( 0 == live )
+            Destroy();
+    }
+    /**
+     * @brief Frees the chunk.
+     */
+    void Destroy();
+
+    /**
+     * Number of objects living in the chunk, plus one while it's
+     * attached to its arena; the last one to go destroys the chunk.
+     * Objects may be freed by any thread, so it's updated atomically.
+     */
+    volatile long mLive;
+
+    /** Next free byte. */
+    uint8* mPos;
+    /** End of the chunk. */
+    uint8* mEnd;
+};
+
+/**
+ * @return Current arena of each thread.
+ *
+ * Created on first use, since static objects of other
+ * translation units may allocate Python objects.
+ */
+static ThreadLocal< PyArena* >& CurrentArena()
+{
+    static ThreadLocal< PyArena* > currentArena;
+    return currentArena;
+}
+/* Arena statistics; updated by any thread decoding or freeing objects. */
+static volatile long allocationCount = 0;
+static volatile long chunkCount = 0;
+static volatile long chunkByteCount = 0;
+
+/*************************************************************************/
+/* PyArena::Chunk                                                        */
+/*************************************************************************/
+PyArena::Chunk* PyArena::Chunk::Create( size_t size )
+{
+    const size_t total = AlignSize( sizeof( Chunk ) ) + size;
+
+    void* p = malloc( total );
+    if( NULL == p )
+        throw std::bad_alloc();
+
+    Chunk* chunk = static_cast< Chunk* >( p );
+    // the reference of the arena
+    chunk->mLive = 1;
+    chunk->mPos = static_cast< uint8* >( p ) + AlignSize( sizeof( Chunk ) );
+    chunk->mEnd = static_cast< uint8* >( p ) + total;
+
+    AtomicIncrement( chunkCount );
+    AtomicAdd( chunkByteCount, (long)total );
+
+    return chunk;
+}
+
+void PyArena::Chunk::Destroy()
+{
+    AtomicDecrement( chunkCount );
+    AtomicAdd( chunkByteCount, -(long)( mEnd - reinterpret_cast< uint8* >( this ) ) );
+
+    free( this );
+}
+
+/*************************************************************************/
+/* PyArena                                                               */
+/*************************************************************************/
+void* PyArena::Allocate( size_t size )
+{
+    const size_t total = sizeof( Header ) + AlignSize( size );
+
+    PyArena* arena = *CurrentArena();
+    Header* header;
+
+    if( NULL != arena )
+    {
+        header = static_cast< Header* >( arena->_Allocate( total ) );
+        header->chunk = arena->mChunk;
+
+        AtomicIncrement( allocationCount );
+    }
+    else
+    {
+        header = static_cast< Header* >( ::operator new( total ) );
+        header->chunk = NULL;
+    }
+
+    return header + 1;
+}
+
+void PyArena::Free( void* p )
+{
+    if( NULL == p )
+        return;
+
+    Header* header = static_cast< Header* >( p ) - 1;
+
+    if( NULL != header->chunk )
+        header->chunk->Free();
+    else
+        ::operator delete( header );
+}
+
+bool PyArena::Contains( const void* p )
+{
+    const Header* header = static_cast< const Header* >( p ) - 1;
+
+    return NULL != header->chunk;
+}
+
+PyArena::Stats PyArena::GetStats()
+{
+    Stats stats;
+    stats.allocations = (unsigned long)AtomicLoad( allocationCount );
+    stats.chunks = (unsigned long)AtomicLoad( chunkCount );
+    stats.chunkBytes = (unsigned long)AtomicLoad( chunkByteCount );
+
+    return stats;
+}
+
+PyArena::PyArena( size_t sizeHint )
+: mPrevious( *CurrentArena() ),
+  mChunk( NULL ),
+  mNextChunkSize( std::min( std::max( PYARENA_HINT_FACTOR * sizeHint, PYARENA_MIN_CHUNK ), PYARENA_MAX_CHUNK ) )
+{
+    *CurrentArena() = this;
+}
+
+PyArena::~PyArena()
+{
+    assert( this == *CurrentArena() );
+    *CurrentArena() = mPrevious;
+
+    _RetireChunk();
+}
+
+void* PyArena::_Allocate( size_t size )
+{
+    void* p = ( NULL != mChunk ? mChunk->Allocate( size ) : NULL );
+
+    if( NULL == p )
+    {
+        _RetireChunk();
+
+        mChunk = Chunk::Create( std::max( mNextChunkSize, size ) );
+        mNextChunkSize = std::min( 2 * mNextChunkSize, PYARENA_MAX_CHUNK );
+
+        p = mChunk->Allocate( size );
+        assert( NULL != p );
+    }
+
+    return p;
+}
+
+void PyArena::_RetireChunk()
+{
+    if( NULL != mChunk )
+    {
+        mChunk->Retire();
+        mChunk = NULL;
+    }
+}
+
+/*************************************************************************/
+/* PyHeapScope                                                           */
+/*************************************************************************/
+PyHeapScope::PyHeapScope()
+: mArena( *CurrentArena() )
+{
+    *CurrentArena() = NULL;
+}
+
+PyHeapScope::~PyHeapScope()
+{
+    assert( NULL == *CurrentArena() );
+    *CurrentArena() = mArena;
+}
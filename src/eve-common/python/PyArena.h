@@ -0,0 +1,156 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#ifndef __PYTHON__PY_ARENA_H__INCL__
+#define __PYTHON__PY_ARENA_H__INCL__
+
+/**
+ * @brief Bump allocator for Python objects.
+ *
+ * While an arena exists, all Python objects created by the same
+ * thread are carved out of its chunks instead of being allocated
+ * one by one. It's meant to be scoped around decoding of a single
+ * packet:
+ *
+ * @code
+ * PyArena arena( packet.size() );
+ * PyRep* rep = Unmarshal( packet );
+ * @endcode
+ *
+ * Objects do not have to die with the arena. Each chunk counts the
+ * objects living in it and is freed when the arena is gone and
+ * the last of them dies, so objects which outlive the packet
+ * (cached results, bound object arguments, ...) merely keep their
+ * chunk alive. Code keeping such objects for long should store
+ * their Clone(), which never lives in the arena of the original.
+ *
+ * Arenas nest; the innermost one is used.
+ */
+class PyArena
+{
+public:
+    /** Arena statistics; counted atomically, allocations wrap around at the range of long. */
+    struct Stats
+    {
+        /** Number of objects allocated from arenas. */
+        uint64 allocations;
+        /** Number of chunks currently allocated. */
+        uint64 chunks;
+        /** Total size of chunks currently allocated. */
+        uint64 chunkBytes;
+    };
+
+    /**
+     * @brief Allocates memory for a Python object.
+     *
+     * Uses the current arena of calling thread, if any;
+     * heap otherwise.
+     *
+     * @param[in] size Size of the object.
+     *
+     * @return Pointer to the memory.
+     */
+    static void* Allocate( size_t size );
+    /**
+     * @brief Frees memory obtained from Allocate.
+     *
+     * @param[in] p Pointer to the memory.
+     */
+    static void Free( void* p );
+    /**
+     * @brief Checks whether memory comes from an arena.
+     *
+     * @param[in] p Pointer obtained from Allocate.
+     *
+     * @return True if the memory comes from an arena.
+     */
+    static bool Contains( const void* p );
+
+    /**
+     * @return Arena statistics.
+     */
+    static Stats GetStats();
+
+    /**
+     * @brief Creates an arena and makes it current for the calling thread.
+     *
+     * @param[in] sizeHint Expected amount of data to be decoded.
+     */
+    PyArena( size_t sizeHint = 0 );
+    /**
+     * @brief Restores the previous arena and releases unused chunks.
+     */
+    ~PyArena();
+
+protected:
+    class Chunk;
+    union Header;
+
+    /**
+     * @brief Carves memory out of the current chunk.
+     *
+     * @param[in] size Required size, including the header.
+     *
+     * @return Pointer to the memory.
+     */
+    void* _Allocate( size_t size );
+    /**
+     * @brief Detaches the current chunk from the arena.
+     */
+    void _RetireChunk();
+
+    /** Arena which was current before us. */
+    PyArena* const mPrevious;
+    /** Chunk we are allocating from. */
+    Chunk* mChunk;
+    /** Size of the next chunk. */
+    size_t mNextChunkSize;
+};
+
+/**
+ * @brief Suspends the current PyArena.
+ *
+ * While it exists, Python objects created by the same thread
+ * are allocated from heap; meant for objects which are known
+ * to live long (e.g. the interned ones).
+ */
+class PyHeapScope
+{
+public:
+    /**
+     * @brief Suspends the current arena of the calling thread.
+     */
+    PyHeapScope();
+    /**
+     * @brief Restores the suspended arena.
+     */
+    ~PyHeapScope();
+
+protected:
+    /** The suspended arena. */
+    PyArena* const mArena;
+};
+
+#endif /* !__PYTHON__PY_ARENA_H__INCL__ */
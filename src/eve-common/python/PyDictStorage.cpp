@@ -0,0 +1,218 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#include "eve-common.h"
+
+#include "python/PyDictStorage.h"
+#include "python/PyRep.h"
+
+PyDictStorage::PyDictStorage()
+: mItems( mInlineItems ),
+  mHashes( mInlineHashes ),
+  mSize( 0 ),
+  mCapacity( InlineSize ),
+  mIndex( NULL ),
+  mIndexMask( 0 ),
+  mIndexShift( 0 )
+{
+}
+
+PyDictStorage::~PyDictStorage()
+{
+    if( mInlineItems != mItems )
+    {
+        SafeDeleteArray( mItems );
+        SafeDeleteArray( mHashes );
+    }
+
+    SafeDeleteArray( mIndex );
+}
+
+void PyDictStorage::clear()
+{
+    mSize = 0;
+
+    if( NULL != mIndex )
+        memset( mIndex, 0, ( mIndexMask + 1 ) * sizeof( uint32 ) );
+}
+
+void PyDictStorage::reserve( size_t count )
+{
+    if( mCapacity < count )
+        _Grow( count );
+}
+
+std::pair<PyDictStorage::iterator, bool> PyDictStorage::insert( const value_type& item )
+{
+    const int32 hash = Hash( item.first );
+
+    const size_t pos = _Find( hash );
+    if( pos < mSize )
+        return std::make_pair( mItems + pos, false );
+
+    if( mCapacity == mSize )
+        _Grow( mSize + 1 );
+
+    mItems[ mSize ] = item;
+    mHashes[ mSize ] = hash;
+
+    if( NULL != mIndex )
+    {
+        size_t slot = _HomeSlot( hash );
+        while( 0 != mIndex[ slot ] )
+            slot = ( slot + 1 ) & mIndexMask;
+
+        mIndex[ slot ] = mSize + 1;
+    }
+
+    return std::make_pair( mItems + mSize++, true );
+}
+
+void PyDictStorage::erase( iterator pos )
+{
+    const size_t i = pos - mItems;
+    const size_t last = mSize - 1;
+    assert( i < mSize );
+
+    if( NULL != mIndex )
+    {
+        /*
+         * Backward shift deletion: entries following the removed one
+         * within its cluster are moved back, unless that would put
+         * them in front of their home slot.
+         */
+        size_t hole = _IndexSlot( i );
+        for( size_t slot = ( hole + 1 ) & mIndexMask; 0 != mIndex[ slot ]; slot = ( slot + 1 ) & mIndexMask )
+        {
+            const size_t home = _HomeSlot( mHashes[ mIndex[ slot ] - 1 ] );
+            if( ( ( slot - home ) & mIndexMask ) >= ( ( slot - hole ) & mIndexMask ) )
+            {
+                mIndex[ hole ] = mIndex[ slot ];
+                hole = slot;
+            }
+        }
+        mIndex[ hole ] = 0;
+
+        if( last != i )
+            mIndex[ _IndexSlot( last ) ] = i + 1;
+    }
+
+    if( last != i )
+    {
+        mItems[ i ] = mItems[ last ];
+        mHashes[ i ] = mHashes[ last ];
+    }
+
+    --mSize;
+}
+
+int32 PyDictStorage::Hash( const PyRep* key )
+{
+    assert( key );
+
+    return key->hash();
+}
+
+size_t PyDictStorage::_Find( int32 hash ) const
+{
+    if( NULL == mIndex )
+    {
+        // few enough to scan them
+        for( size_t i = 0; i < mSize; ++i )
+        {
+            if( mHashes[ i ] == hash )
+                return i;
+        }
+
+        return mSize;
+    }
+
+    for( size_t slot = _HomeSlot( hash ); 0 != mIndex[ slot ]; slot = ( slot + 1 ) & mIndexMask )
+    {
+        const size_t pos = mIndex[ slot ] - 1;
+        if( mHashes[ pos ] == hash )
+            return pos;
+    }
+
+    return mSize;
+}
+
+size_t PyDictStorage::_IndexSlot( size_t pos ) const
+{
+    size_t slot = _HomeSlot( mHashes[ pos ] );
+    while( pos + 1 != mIndex[ slot ] )
+        slot = ( slot + 1 ) & mIndexMask;
+
+    return slot;
+}
+
+void PyDictStorage::_Grow( size_t count )
+{
+    size_t capacity = 2 * mCapacity;
+    while( capacity < count )
+        capacity *= 2;
+
+    value_type* items = new value_type[ capacity ];
+    int32* hashes = new int32[ capacity ];
+
+    std::copy( mItems, mItems + mSize, items );
+    std::copy( mHashes, mHashes + mSize, hashes );
+
+    if( mInlineItems != mItems )
+    {
+        SafeDeleteArray( mItems );
+        SafeDeleteArray( mHashes );
+    }
+
+    mItems = items;
+    mHashes = hashes;
+    mCapacity = capacity;
+
+    _Reindex();
+}
+
+void PyDictStorage::_Reindex()
+{
+    // keep the index at most half full
+    size_t slots = 2 * mCapacity;
+
+    mIndexShift = 32;
+    for( size_t s = slots; 1 < s; s >>= 1 )
+        --mIndexShift;
+
+    SafeDeleteArray( mIndex );
+    mIndex = new uint32[ slots ];
+    mIndexMask = slots - 1;
+    memset( mIndex, 0, slots * sizeof( uint32 ) );
+
+    for( size_t i = 0; i < mSize; ++i )
+    {
+        size_t slot = _HomeSlot( mHashes[ i ] );
+        while( 0 != mIndex[ slot ] )
+            slot = ( slot + 1 ) & mIndexMask;
+
+        mIndex[ slot ] = i + 1;
+    }
+}
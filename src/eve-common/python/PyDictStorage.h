@@ -0,0 +1,173 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#ifndef __PYTHON__PY_DICT_STORAGE_H__INCL__
+#define __PYTHON__PY_DICT_STORAGE_H__INCL__
+
+class PyRep;
+
+/**
+ * @brief Storage of PyDict entries.
+ *
+ * Open-addressing hash table which keeps the entries in one dense
+ * array, in order of insertion, and the hashes of their keys in
+ * another. Keys are matched by their hashes only, just like PyDict
+ * always did, so once an entry is stored its key never has to be
+ * consulted again.
+ *
+ * Dicts of up to InlineSize entries (most of them) are stored inline
+ * and looked up by scanning the hashes; no memory is allocated for
+ * them at all. Larger dicts move their entries to the heap and add
+ * an index, which maps hashes to entries using linear probing.
+ */
+class PyDictStorage
+{
+public:
+    typedef std::pair<PyRep*, PyRep*> value_type;
+    typedef value_type*               iterator;
+    typedef const value_type*         const_iterator;
+
+    /** Number of entries stored inline. */
+    static const size_t InlineSize = 8;
+
+    PyDictStorage();
+    ~PyDictStorage();
+
+    iterator begin() { return mItems; }
+    iterator end() { return mItems + mSize; }
+    const_iterator begin() const { return mItems; }
+    const_iterator end() const { return mItems + mSize; }
+
+    size_t size() const { return mSize; }
+    bool empty() const { return 0 == mSize; }
+
+    /**
+     * @brief Removes all entries.
+     *
+     * Does not touch the references held by the entries.
+     */
+    void clear();
+    /**
+     * @brief Makes room for given number of entries.
+     *
+     * @param[in] count Number of entries.
+     */
+    void reserve( size_t count );
+
+    /**
+     * @brief Looks up the entry with given key.
+     *
+     * @param[in] key The key.
+     *
+     * @return The entry; end() if there is none.
+     */
+    iterator find( const PyRep* key ) { return find( Hash( key ) ); }
+    /**
+     * @brief Looks up the entry with given key.
+     *
+     * @param[in] key The key.
+     *
+     * @return The entry; end() if there is none.
+     */
+    const_iterator find( const PyRep* key ) const { return find( Hash( key ) ); }
+    /**
+     * @brief Looks up the entry whose key has given hash.
+     *
+     * @param[in] hash The hash of the key.
+     *
+     * @return The entry; end() if there is none.
+     */
+    iterator find( int32 hash ) { return mItems + _Find( hash ); }
+    /**
+     * @brief Looks up the entry whose key has given hash.
+     *
+     * @param[in] hash The hash of the key.
+     *
+     * @return The entry; end() if there is none.
+     */
+    const_iterator find( int32 hash ) const { return mItems + _Find( hash ); }
+
+    /**
+     * @brief Inserts given entry unless its key is present already.
+     *
+     * @param[in] item The entry.
+     *
+     * @return The entry with the key and whether it has been inserted.
+     */
+    std::pair<iterator, bool> insert( const value_type& item );
+    /**
+     * @brief Removes given entry.
+     *
+     * The last entry takes its place, so the order of the
+     * entries is not kept.
+     *
+     * @param[in] pos The entry.
+     */
+    void erase( iterator pos );
+
+protected:
+    /** Obtains the hash of given key. */
+    static int32 Hash( const PyRep* key );
+
+    /** Looks up the position of entry whose key has given hash; mSize if there is none. */
+    size_t _Find( int32 hash ) const;
+    /** Obtains the slot of index where the search for given hash starts. */
+    size_t _HomeSlot( int32 hash ) const { return ( (uint32)hash * 0x9E3779B9u ) >> mIndexShift; }
+    /** Obtains the slot of index which refers to given entry. */
+    size_t _IndexSlot( size_t pos ) const;
+
+    /** Moves the entries to the heap, making room for given number of entries. */
+    void _Grow( size_t count );
+    /** Builds the index from scratch. */
+    void _Reindex();
+
+    /** The entries. */
+    value_type* mItems;
+    /** Hashes of keys of the entries. */
+    int32* mHashes;
+    /** Number of entries. */
+    size_t mSize;
+    /** Number of entries we have room for. */
+    size_t mCapacity;
+
+    /** The index; positions of entries plus one, 0 marks an empty slot. NULL while inline. */
+    uint32* mIndex;
+    /** Number of slots of the index minus one. */
+    size_t mIndexMask;
+    /** Shift which maps a hash to a slot of index. */
+    uint32 mIndexShift;
+
+    /** Inline entries. */
+    value_type mInlineItems[ InlineSize ];
+    /** Hashes of inline entries. */
+    int32 mInlineHashes[ InlineSize ];
+
+private:
+    // the entries are owned by PyDict; copy it instead
+    PyDictStorage( const PyDictStorage& oth );
+    PyDictStorage& operator=( const PyDictStorage& oth );
+};
+
+#endif /* !__PYTHON__PY_DICT_STORAGE_H__INCL__ */
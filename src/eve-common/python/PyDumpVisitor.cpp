@@ -305,18 +305,18 @@ bool PyDumpVisitor::VisitPackedRow( const PyPackedRow* rep )
     _print( "%sPacked Row:", _pfx() );
     _print( "%s column_count=%u", _pfx(), rep->header()->ColumnCount() );
 
-    PyPackedRow::const_iterator cur, end;
-    cur = rep->begin();
-    end = rep->end();
-    for( uint32 i = 0; cur != end; cur++, i++ )
+    const uint32 cc = rep->ColumnCount();
+    for( uint32 i = 0; i < cc; i++ )
     {
         _pfxExtend( "  [%2u] %s: ", i, rep->header()->GetColumnName( i )->content().c_str() );
 
+        const PyRep* field = rep->GetField( i );
+
         bool res = true;
-        if( (*cur) == NULL )
+        if( field == NULL )
             _print( "%s(None)", _pfx() );
         else
-            res = (*cur)->visit( *this );
+            res = field->visit( *this );
 
         _pfxWithdraw();
 
@@ -360,6 +360,17 @@ bool PyDumpVisitor::VisitChecksumedStream( const PyChecksumedStream* rep )
     return res;
 }
 
+bool PyDumpVisitor::VisitPreMarshaled( const PyPreMarshaled* rep )
+{
+    _print( "%sPre-marshaled: %lu bytes", _pfx(), rep->data().size() );
+
+    _pfxExtend( "  " );
+    bool res = PyVisitor::VisitPreMarshaled( rep );
+    _pfxWithdraw();
+
+    return res;
+}
+
 PyLogDumpVisitor::PyLogDumpVisitor( LogType log_type, LogType log_hex_type, const char* pfx, bool full_nested, bool full_hex )
 : PyDumpVisitor( pfx, full_nested ),
   mFullHex( full_hex ),
@@ -65,6 +65,7 @@ protected:
     bool VisitSubStruct( const PySubStruct* rep );
     bool VisitSubStream( const PySubStream* rep );
     bool VisitChecksumedStream( const PyChecksumedStream* rep );
+    bool VisitPreMarshaled( const PyPreMarshaled* rep );
 
 private:
     const bool mFullNested;
@@ -29,6 +29,7 @@
 #include "python/PyVisitor.h"
 #include "python/PyRep.h"
 #include "python/PyDumpVisitor.h"
+#include "marshal/EVEUnmarshal.h"
 
 const char* MACHONETMSG_TYPE_NAMES[MACHONETMSG_TYPE_COUNT] =
 {
@@ -265,10 +266,35 @@ bool PyPacket::Decode(PyRep **in_packet)
 
 
 PyRep *PyPacket::Encode() {
+    //payload
+    PyRep *payload_rep = payload->Clone();
+
+    //named arguments
+    PyRep *named_payload_rep = NULL;
+    if(named_payload != NULL)
+        named_payload_rep = named_payload->Clone();
+
+    return _Encode(payload_rep, named_payload_rep);
+}
+
+PyRep *PyPacket::Encode(PyPacket **packet) {
+    PyPacket *p = *packet;
+    *packet = NULL;
+
+    //the packet goes away, so its payload can be moved instead of cloned
+    PyRep *res = p->_Encode(p->payload, p->named_payload);
+    p->payload = NULL;
+    p->named_payload = NULL;
+
+    delete p;
+    return res;
+}
+
+PyRep *PyPacket::_Encode(PyRep *payload_rep, PyRep *named_payload_rep) const {
     PyTuple *arg_tuple = new PyTuple(7);
 
     //command
-    arg_tuple->items[0] = new PyInt(type);
+    arg_tuple->items[0] = new_int(type);
 
     //source
     arg_tuple->items[1] = source.Encode();
@@ -278,24 +304,22 @@ PyRep *PyPacket::Encode() {
 
     //unknown3
     if(userid == 0)
-        arg_tuple->items[3] = new PyNone();
+        arg_tuple->items[3] = new_none();
     else
-        arg_tuple->items[3] = new PyInt(userid);
+        arg_tuple->items[3] = new_int(userid);
 
     //payload
-    //TODO: we don't really need to clone this if we can figure out a way to say "this is read only"
-    //or if we can change this encode method to consume the PyPacket (which will almost always be the case)
-    arg_tuple->items[4] = payload->Clone();
+    arg_tuple->items[4] = payload_rep;
 
     //named arguments
-    if(named_payload == NULL) {
-        arg_tuple->items[5] = new PyNone();
+    if(named_payload_rep == NULL) {
+        arg_tuple->items[5] = new_none();
     } else {
-        arg_tuple->items[5] = named_payload->Clone();
+        arg_tuple->items[5] = named_payload_rep;
     }
 
     //TODO: Not sure what this is, On packets so far they always have as PyNone
-    arg_tuple->items[6] = new PyNone();
+    arg_tuple->items[6] = new_none();
 
     return new PyObject( type_string.c_str(), arg_tuple );
 }
@@ -484,15 +508,15 @@ PyRep *PyAddress::Encode() {
     switch(type) {
     case Any:
         t = new PyTuple(3);
-        t->items[0] = new PyInt((int)type);
+        t->items[0] = new_int((int)type);
 
         if(service == "")
-            t->items[1] = new PyNone();
+            t->items[1] = new_none();
         else
-            t->items[1] = new PyString(service.c_str());
+            t->items[1] = new_string(service);
 
         if(typeID == 0)
-            t->items[2] = new PyNone();
+            t->items[2] = new_none();
         else
             t->items[2] = new PyLong(typeID);
 
@@ -500,16 +524,16 @@ PyRep *PyAddress::Encode() {
 
     case Node:
         t = new PyTuple(4);
-        t->items[0] = new PyInt((int)type);
+        t->items[0] = new_int((int)type);
         t->items[1] = new PyLong(typeID);
 
         if(service == "")
-            t->items[2] = new PyNone();
+            t->items[2] = new_none();
         else
-            t->items[2] = new PyString(service.c_str());
+            t->items[2] = new_string(service);
 
         if(callID == 0)
-            t->items[3] = new PyNone();
+            t->items[3] = new_none();
         else
             t->items[3] = new PyLong(callID);
 
@@ -517,28 +541,28 @@ PyRep *PyAddress::Encode() {
 
     case Client:
         t = new PyTuple(4);
-        t->items[0] = new PyInt((int)type);
+        t->items[0] = new_int((int)type);
         t->items[1] = new PyLong(typeID);
         t->items[2] = new PyLong(callID);
         if(service == "")
-            t->items[3] = new PyNone();
+            t->items[3] = new_none();
         else
-            t->items[3] = new PyString(service.c_str());
+            t->items[3] = new_string(service);
 
         break;
 
     case Broadcast:
         t = new PyTuple(4);
-        t->items[0] = new PyInt((int)type);
+        t->items[0] = new_int((int)type);
         //broadcastID
         if(service == "")
-            t->items[1] = new PyNone();
+            t->items[1] = new_none();
         else
-            t->items[1] = new PyString(service.c_str());
+            t->items[1] = new_string(service);
         //narrowcast
         t->items[2] = new PyList();
         //typeID
-        t->items[3] = new PyString(bcast_idtype.c_str());
+        t->items[3] = new_string(bcast_idtype);
 
         break;
 
@@ -598,12 +622,14 @@ PyCallStream::PyCallStream()
 : remoteObject(0),
   method(""),
   arg_tuple(NULL),
+  arg_stream(NULL),
   arg_dict(NULL)
 {
 }
 
 PyCallStream::~PyCallStream() {
     PySafeDecRef(arg_tuple);
+    PySafeDecRef(arg_stream);
     PySafeDecRef(arg_dict);
 }
 
@@ -612,7 +638,10 @@ PyCallStream *PyCallStream::Clone() const {
     res->remoteObject = remoteObject;
     res->remoteObjectStr = remoteObjectStr;
     res->method = method;
-    res->arg_tuple = new PyTuple( *arg_tuple );
+    if(arg_tuple != NULL)
+        res->arg_tuple = new PyTuple( *arg_tuple );
+    if(arg_stream != NULL)
+        res->arg_stream = new PySubStream( *arg_stream );
     if(arg_dict == NULL) {
         res->arg_dict = NULL;
     } else {
@@ -630,7 +659,8 @@ void PyCallStream::Dump(LogType type, PyVisitor& dumper)
         _log(type, "  Remote Object: %d", remoteObject);
     _log(type, "  Method: %s", method.c_str());
     _log(type, "  Arguments:");
-    arg_tuple->visit( dumper );
+    if(DecodeArgs())
+        arg_tuple->visit( dumper );
     if(arg_dict == NULL) {
         _log(type, "  Named Arguments: None");
     } else {
@@ -644,8 +674,10 @@ bool PyCallStream::Decode(const std::string &type, PyTuple *&in_payload) {
     in_payload = NULL;
 
     PySafeDecRef(arg_tuple);
+    PySafeDecRef(arg_stream);
     PySafeDecRef(arg_dict);
     arg_tuple = NULL;
+    arg_stream = NULL;
     arg_dict = NULL;
 
     if(type != "macho.CallReq") {
@@ -681,6 +713,12 @@ bool PyCallStream::Decode(const std::string &type, PyTuple *&in_payload) {
     }
     PySubStream *ss = (PySubStream *) payload2->items[1];
 
+    //try to get away without unmarshaling the arguments
+    if(_DecodeStream(ss)) {
+        PyDecRef(payload);
+        return true;
+    }
+
     ss->DecodeData();
     if(ss->decoded() == NULL) {
         codelog(NET__PACKET_ERROR, "Unable to decode call stream");
@@ -762,38 +800,125 @@ bool PyCallStream::Decode(const std::string &type, PyTuple *&in_payload) {
     return true;
 }
 
+bool PyCallStream::_DecodeStream(const PySubStream *ss) {
+    if(ss->data() == NULL)
+        return false;
+
+    UnmarshalStream stream;
+    if(!stream.BeginStream(ss->data()->content()))
+        return false;
+
+    uint32 size;
+    int32 obj;
+    Buffer *args = new Buffer;
+    PyRep *dict = NULL;
+
+    bool res = (stream.LoadTupleHeader(size) && size == 4);
+
+    //remote object, either an int or a bind string
+    if(res && stream.LoadInt(obj)) {
+        remoteObject = obj;
+        remoteObjectStr = "";
+    } else if(res && stream.LoadString(remoteObjectStr)) {
+        remoteObject = 0;
+    } else
+        res = false;
+
+    //method name, then the arguments; these are kept marshaled
+    res = (res
+           && stream.LoadString(method)
+           && stream.LoadElementStream(*args));
+
+    //the first opcode follows the stream header
+    if(res) {
+        switch((*args)[5] & PyRepOpcodeMask) {
+            case Op_PyTuple:
+            case Op_PyEmptyTuple:
+            case Op_PyOneTuple:
+            case Op_PyTwoTuple:
+                break;
+            default:
+                res = false;
+        }
+    }
+
+    //options dict
+    if(res) {
+        dict = stream.LoadRep();
+        res = (dict != NULL && (dict->IsNone() || dict->IsDict()));
+    }
+
+    stream.End();
+
+    if(!res) {
+        //let the generic path do the complaining
+        PySafeDecRef(dict);
+        SafeDelete(args);
+        return false;
+    }
+
+    arg_stream = new PySubStream(new PyBuffer(&args));
+    if(dict->IsDict())
+        arg_dict = dict->AsDict();
+    else
+        PyDecRef(dict);
+
+    return true;
+}
+
+bool PyCallStream::DecodeArgs() {
+    if(arg_tuple != NULL)
+        return true;
+    if(arg_stream == NULL)
+        return false;
+
+    arg_stream->DecodeData();
+    if(arg_stream->decoded() == NULL || !arg_stream->decoded()->IsTuple()) {
+        codelog(NET__PACKET_ERROR, "Unable to decode call arguments");
+        return false;
+    }
+
+    arg_tuple = arg_stream->decoded()->AsTuple();
+    PyIncRef(arg_tuple);
+
+    return true;
+}
+
 PyTuple *PyCallStream::Encode() {
     PyTuple *res_tuple = new PyTuple(4);
 
     //remoteObject
     if(remoteObject == 0)
-        res_tuple->items[0] = new PyString(remoteObjectStr.c_str());
+        res_tuple->items[0] = new_string(remoteObjectStr);
     else
-        res_tuple->items[0] = new PyInt(remoteObject);
+        res_tuple->items[0] = new_int(remoteObject);
 
     //method name
-    res_tuple->items[1] = new PyString(method.c_str());
+    res_tuple->items[1] = new_string(method);
 
     //args
     //TODO: we dont really need to clone this if we can figure out a way to say "this is read only"
     //or if we can change this encode method to consume the PyCallStream (which will almost always be the case)
-    res_tuple->items[2] = new PyTuple( *arg_tuple );
+    if(DecodeArgs())
+        res_tuple->items[2] = new PyTuple( *arg_tuple );
+    else
+        res_tuple->items[2] = new PyTuple( 0 );
 
     //options
     if(arg_dict == NULL) {
-        res_tuple->items[3] = new PyNone();
+        res_tuple->items[3] = new_none();
     } else {
         res_tuple->items[3] = new PyDict( *arg_dict );
     }
 
     //now that we have the main arg tuple, build the unknown stuff around it...
     PyTuple *it2 = new PyTuple(2);
-    it2->items[0] = new PyInt(remoteObject==0?1:0); /* some sort of flag, "process here or call UP"....*/
+    it2->items[0] = new_int(remoteObject==0?1:0); /* some sort of flag, "process here or call UP"....*/
     it2->items[1] = new PySubStream(res_tuple);
 
     PyTuple *it1 = new PyTuple(2);
     it1->items[0] = it2;
-    it1->items[1] = new PyNone();    //this is the "channel" dict if populated.
+    it1->items[1] = new_none();    //this is the "channel" dict if populated.
 
     return(it1);
 }
@@ -803,17 +928,23 @@ PyTuple *PyCallStream::Encode() {
 EVENotificationStream::EVENotificationStream()
 : notifyType("NO TYPE SET"),
   remoteObject(0),
-  args(NULL)
+  args(NULL),
+  body(NULL)
 {
 }
 
 EVENotificationStream::~EVENotificationStream() {
     PySafeDecRef(args);
+    PySafeDecRef(body);
 }
 
 EVENotificationStream *EVENotificationStream::Clone() const {
     EVENotificationStream *res = new EVENotificationStream();
-    res->args = (PyTuple *) args->Clone();
+    if(args != NULL)
+        res->args = (PyTuple *) args->Clone();
+    //the body never changes, share it.
+    res->body = body;
+    PySafeIncRef(body);
     return res;
 }
 
@@ -826,7 +957,10 @@ void EVENotificationStream::Dump(LogType type, PyVisitor& dumper)
         _log(type, "  Remote Object: %u", remoteObject);
     }
     _log(type, "  Arguments:");
-    args->visit( dumper );
+    if(args != NULL)
+        args->visit( dumper );
+    else if(body != NULL)
+        body->visit( dumper );
 }
 
 bool EVENotificationStream::Decode(const std::string &pkt_type, const std::string &notify_type, PyTuple *&in_payload) {
@@ -835,6 +969,8 @@ bool EVENotificationStream::Decode(const std::string &pkt_type, const std::strin
 
     PySafeDecRef(args);
     args = NULL;
+    PySafeDecRef(body);
+    body = NULL;
 
     if(pkt_type != "macho.Notification") {
         codelog(NET__PACKET_ERROR, "notification payload has unknown string type %s", pkt_type.c_str());
@@ -956,33 +1092,40 @@ bool EVENotificationStream::Decode(const std::string &pkt_type, const std::strin
 
 PyTuple *EVENotificationStream::Encode() {
 
-    PyTuple *t4 = new PyTuple(2);
-    t4->items[0] = new PyInt(1);
-    //see notes in other objects about what we could do to avoid this clone.
-    t4->items[1] = args->Clone();
+    PyTuple *t2 = new PyTuple(2);
+    t2->items[0] = new_int(0);
 
-    PyTuple *t3 = new PyTuple(2);
-    t3->items[0] = new PyInt(0);
-    t3->items[1] = t4;
+    if(body != NULL) {
+        //marshaled already, share it.
+        PyIncRef(body);
+        t2->items[1] = body;
+    } else {
+        PyTuple *t4 = new PyTuple(2);
+        t4->items[0] = new_int(1);
+        //see notes in other objects about what we could do to avoid this clone.
+        t4->items[1] = args->Clone();
 
-    PyTuple *t2 = new PyTuple(2);
-    t2->items[0] = new PyInt(0);
-    t2->items[1] = new PySubStream(t3);
+        PyTuple *t3 = new PyTuple(2);
+        t3->items[0] = new_int(0);
+        t3->items[1] = t4;
+
+        t2->items[1] = new PySubStream(t3);
+    }
 
     PyTuple *t1 = new PyTuple(2);
     t1->items[0] = t2;
-    t1->items[1] = new PyNone();
+    t1->items[1] = new_none();
 
     return(t1);
 /*
     //remoteObject
     if(remoteObject == 0)
-        arg_tuple->items[0] = new PyString(remoteObjectStr.c_str());
+        arg_tuple->items[0] = new_string(remoteObjectStr);
     else
-        arg_tuple->items[0] = new PyInt(remoteObject);
+        arg_tuple->items[0] = new_int(remoteObject);
 
     //method name
-    arg_tuple->items[1] = new PyString(method.c_str());
+    arg_tuple->items[1] = new_string(method);
 
     //args
     //TODO: we dont really need to clone this if we can figure out a way to say "this is read only"
@@ -991,14 +1134,35 @@ PyTuple *EVENotificationStream::Encode() {
 
     //options
     if(included_options == 0) {
-        arg_tuple->items[3] = new PyNone();
+        arg_tuple->items[3] = new_none();
     } else {
         PyDict *d = new PyDict();
         arg_tuple->items[3] = d;
         if(included_options & oMachoVersion) {
-            d->items[ new PyString("machoVersion") ] = new PyInt( macho_version );
+            d->items[ new_string("machoVersion") ] = new_int( macho_version );
         }
     }
     return(arg_tuple);
     */
 }
+
+void EVENotificationStream::_MarshalBodyHeader( MarshalStream& stream ) const {
+    //same layout as Encode builds: (0, (1, args))
+    stream.SaveTupleHeader(2);
+    stream.SaveInt(0);
+    stream.SaveTupleHeader(2);
+    stream.SaveInt(1);
+}
+
+bool EVENotificationStream::_SetBody( Buffer** data, bool success ) {
+    if(!success) {
+        codelog(NET__PACKET_ERROR, "Failed to marshal notification arguments.");
+        SafeDelete(*data);
+        return false;
+    }
+
+    PySafeDecRef(body);
+    body = new PySubStream(new PyBuffer(data));
+
+    return true;
+}
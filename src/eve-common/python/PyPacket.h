@@ -26,11 +26,13 @@
 #ifndef EVE_PY_PACKET_H
 #define EVE_PY_PACKET_H
 
+#include "marshal/EVEMarshal.h"
 #include "network/packet_types.h"
 
 class PyRep;
 class PyTuple;
 class PyDict;
+class PySubStream;
 class PyVisitor;
 
 class PyAddress {
@@ -92,6 +94,7 @@ public:
     void Dump(LogType type, PyVisitor& dumper);
     bool Decode(PyRep **packet);    //consumes packet
     PyRep *Encode();
+    static PyRep *Encode(PyPacket **packet);    //consumes packet
     PyPacket *Clone() const;
 
     //the "type" of object this represents
@@ -124,6 +127,9 @@ public:
     std::string channel;
     uint32 sequence_number;
 #endif
+
+protected:
+    PyRep *_Encode(PyRep *payload_rep, PyRep *named_payload_rep) const;    //consumes both reps
 };
 
 class PyCallStream {
@@ -136,12 +142,28 @@ public:
     PyTuple *Encode();
     PyCallStream *Clone() const;
 
+    /**
+     * @brief Makes sure arg_tuple is set.
+     *
+     * Decode leaves the arguments marshaled in arg_stream if it can;
+     * this method unmarshals them.
+     *
+     * @retval true  arg_tuple is set.
+     * @retval false The arguments could not be unmarshaled.
+     */
+    bool DecodeArgs();
+
     uint32 remoteObject;        //seen 1, hack: 0 means it was a string
     std::string remoteObjectStr;
 
     std::string method;
-    PyTuple *arg_tuple;
+    PyTuple *arg_tuple;  //NULL until DecodeArgs() if arg_stream is set.
+    PySubStream *arg_stream; //marshaled arguments, as received; may be NULL.
     PyDict  *arg_dict;   //named parameters
+
+protected:
+    //reads the call straight from the marshaled body; false if it cannot be done.
+    bool _DecodeStream(const PySubStream *ss);
 };
 
 class EVENotificationStream {
@@ -154,12 +176,45 @@ public:
     PyTuple *Encode();
     EVENotificationStream *Clone() const;
 
+    /**
+     * @brief Marshals given packet directly as the arguments.
+     *
+     * The body of the notification is saved straight from a packet
+     * generated by eve-xmlpktgen, without building args first;
+     * Encode then shares it among all the packets it builds.
+     *
+     * @param[in] packet The arguments; anything with a MarshalInto method.
+     *
+     * @retval true  Marshaling ran successfully.
+     * @retval false Error occured during marshaling.
+     */
+    template<typename T>
+    bool MarshalArgs( const T& packet )
+    {
+        Buffer* data = new Buffer;
+
+        MarshalStream stream;
+        stream.BeginStream( *data );
+        _MarshalBodyHeader( stream );
+        const bool res = packet.MarshalInto( stream );
+        stream.End();
+
+        return _SetBody( &data, res );
+    }
+
     std::string notifyType; //not encoded by Encode() since it is in the address part, mainly here for convenience.
 
     uint32 remoteObject;        //seen 1, hack: 0 means it was a string
     std::string remoteObjectStr;
 
     PyTuple *args;
+    PySubStream *body;  //marshaled by MarshalArgs; if set, it's used instead of args.
+
+protected:
+    //saves what precedes args within the body.
+    void _MarshalBodyHeader( MarshalStream& stream ) const;
+    //takes ownership of data and sets it as body if success.
+    bool _SetBody( Buffer** data, bool success );
 };
 
 
@@ -28,10 +28,14 @@
 #include "marshal/EVEMarshal.h"
 #include "marshal/EVEUnmarshal.h"
 #include "marshal/EVEMarshalOpcodes.h"
+#include "marshal/EVEMarshalStringTable.h"
 #include "python/classes/PyDatabase.h"
+#include "python/PyArena.h"
 #include "python/PyDumpVisitor.h"
 #include "python/PyVisitor.h"
 #include "python/PyRep.h"
+#include "threading/Atomic.h"
+#include "threading/ThreadLocal.h"
 #include "utils/EVEUtils.h"
 
 /************************************************************************/
@@ -57,11 +61,141 @@ const char* const PyRep::s_mTypeString[] =
     "Object",           //15
     "ObjectEx",         //16
     "PackedRow",        //17
-    "UNKNOWN TYPE",     //18
+    "PreMarshaled",     //18
+    "UNKNOWN TYPE",     //19
 };
 
-PyRep::PyRep( PyType t ) : RefObject( 1 ), mType( t ) {}
-PyRep::~PyRep() {}
+/* Allocation statistics; see PyRep::GetAllocStats. */
+struct AllocCounts
+{
+    volatile long allocated;
+    volatile long alive;
+    volatile long shared;
+    volatile long interned;
+};
+
+/* Counts of a thread; only the thread updates them, so they need no atomic operations. */
+struct ThreadAllocCounts
+: public AllocCounts
+{
+    ThreadAllocCounts();
+    ~ThreadAllocCounts();
+};
+
+/* Counts of all threads, summed up by GetAllocStats. */
+struct AllocCountsRegistry
+{
+    AllocCountsRegistry() { retired.allocated = retired.alive = retired.shared = retired.interned = 0; }
+
+    Mutex lock;
+    std::set< ThreadAllocCounts* > threads;
+    /* Counts of terminated threads. */
+    AllocCounts retired;
+};
+
+/* Created on first use, since static objects of other translation units may be Python objects. */
+static AllocCountsRegistry& GetAllocCountsRegistry()
+{
+    static AllocCountsRegistry registry;
+    return registry;
+}
+
+static AllocCounts& GetAllocCounts()
+{
+    static ThreadLocal< ThreadAllocCounts > counts;
+    return *counts;
+}
+
+ThreadAllocCounts::ThreadAllocCounts()
+{
+    allocated = alive = shared = interned = 0;
+
+    AllocCountsRegistry& registry = GetAllocCountsRegistry();
+    MutexLock lock( registry.lock );
+
+    registry.threads.insert( this );
+}
+
+ThreadAllocCounts::~ThreadAllocCounts()
+{
+    AllocCountsRegistry& registry = GetAllocCountsRegistry();
+    MutexLock lock( registry.lock );
+
+    registry.retired.allocated += allocated;
+    registry.retired.alive += alive;
+    registry.retired.shared += shared;
+    registry.retired.interned += interned;
+
+    registry.threads.erase( this );
+}
+
+PyRep::AllocStats PyRep::GetAllocStats()
+{
+    AllocCountsRegistry& registry = GetAllocCountsRegistry();
+    MutexLock lock( registry.lock );
+
+    // objects freed by another thread than the one allocating them
+    // make single alive counts negative, the sum is right
+    long allocated = registry.retired.allocated;
+    long alive = registry.retired.alive;
+    long shared = registry.retired.shared;
+    long interned = registry.retired.interned;
+
+    std::set< ThreadAllocCounts* >::const_iterator cur, end;
+    cur = registry.threads.begin();
+    end = registry.threads.end();
+    for(; cur != end; ++cur )
+    {
+        allocated += AtomicLoad( ( *cur )->allocated );
+        alive += AtomicLoad( ( *cur )->alive );
+        shared += AtomicLoad( ( *cur )->shared );
+        interned += AtomicLoad( ( *cur )->interned );
+    }
+
+    AllocStats stats;
+    stats.allocated = (unsigned long)allocated;
+    stats.alive = (unsigned long)alive;
+    stats.shared = (unsigned long)shared;
+    stats.interned = (unsigned long)interned;
+
+    return stats;
+}
+
+void* PyRep::operator new( size_t size )
+{
+    return PyArena::Allocate( size );
+}
+
+void PyRep::operator delete( void* p )
+{
+    PyArena::Free( p );
+}
+
+PyRep::PyRep( PyType t ) : RefObject( 1 ), mType( t )
+{
+    AllocCounts& counts = GetAllocCounts();
+    ++counts.allocated;
+    ++counts.alive;
+}
+
+PyRep::~PyRep()
+{
+    --GetAllocCounts().alive;
+}
+
+bool PyRep::IsInArena() const
+{
+    return PyArena::Contains( this );
+}
+
+PyRep* PyRep::Share() const
+{
+    PyRep* self = const_cast< PyRep* >( this );
+    PyIncRef( self );
+
+    ++GetAllocCounts().shared;
+    return self;
+}
 
 const char* PyRep::TypeString() const
 {
@@ -99,7 +233,7 @@ PyInt::PyInt( const PyInt& oth ) : PyRep( PyRep::PyTypeInt ), mValue( oth.value(
 
 PyRep* PyInt::Clone() const
 {
-    return new PyInt( *this );
+    return CloneImmutable( this );
 }
 
 bool PyInt::visit( PyVisitor& v ) const
@@ -125,7 +259,7 @@ PyLong::PyLong( const PyLong& oth ) : PyRep( PyRep::PyTypeLong ), mValue( oth.va
 
 PyRep* PyLong::Clone() const
 {
-    return new PyLong( *this );
+    return CloneImmutable( this );
 }
 
 bool PyLong::visit( PyVisitor& v ) const
@@ -188,7 +322,7 @@ PyFloat::PyFloat( const PyFloat& oth ) : PyRep( PyRep::PyTypeFloat ), mValue( ot
 
 PyRep* PyFloat::Clone() const
 {
-    return new PyFloat( *this );
+    return CloneImmutable( this );
 }
 
 bool PyFloat::visit( PyVisitor& v ) const
@@ -272,7 +406,7 @@ PyBool::PyBool( const PyBool& oth ) : PyRep( PyRep::PyTypeBool ), mValue( oth.va
 
 PyRep* PyBool::Clone() const
 {
-    return new PyBool( *this );
+    return CloneImmutable( this );
 }
 
 bool PyBool::visit( PyVisitor& v ) const
@@ -288,7 +422,7 @@ PyNone::PyNone( const PyNone& oth ) : PyRep( PyRep::PyTypeNone ) {}
 
 PyRep* PyNone::Clone() const
 {
-    return new PyNone( *this );
+    return CloneImmutable( this );
 }
 
 bool PyNone::visit( PyVisitor& v ) const
@@ -317,7 +451,7 @@ PyBuffer::~PyBuffer() { delete mValue; }
 
 PyRep* PyBuffer::Clone() const
 {
-    return new PyBuffer( *this );
+    return CloneImmutable( this );
 }
 
 bool PyBuffer::visit( PyVisitor& v ) const
@@ -350,8 +484,15 @@ int32 PyBuffer::hash() const
 
     //if (!get_buf(self, &ptr, &size, ANY_BUFFER))
     //    return -1;
-    p = (unsigned char *) &content()[0];
     len = content().size();
+    if( 0 == len )
+    {
+        // hashes the same as an empty string
+        mHashCache = 0;
+        return 0;
+    }
+
+    p = (unsigned char *) &content()[0];
     x = *p << 7;
     while( --len >= 0 )
         x = (1000003*x) ^ *p++;
@@ -380,7 +521,7 @@ PyString::PyString( const PyString& oth ) : PyRep( PyRep::PyTypeString ), mValue
 
 PyRep* PyString::Clone() const
 {
-    return new PyString( *this );
+    return CloneImmutable( this );
 }
 
 bool PyString::visit( PyVisitor& v ) const
@@ -421,7 +562,7 @@ PyWString::PyWString( const PyWString& oth ) : PyRep( PyRep::PyTypeWString ), mV
 
 PyRep* PyWString::Clone() const
 {
-    return new PyWString( *this );
+    return CloneImmutable( this );
 }
 
 bool PyWString::visit( PyVisitor& v ) const
@@ -468,7 +609,7 @@ PyToken::PyToken( const PyToken& oth ) : PyRep( PyRep::PyTypeToken ), mValue( ot
 
 PyRep* PyToken::Clone() const
 {
-    return new PyToken( *this );
+    return CloneImmutable( this );
 }
 
 bool PyToken::visit( PyVisitor& v ) const
@@ -514,6 +655,9 @@ void PyTuple::clear()
 
 PyTuple& PyTuple::operator=( const PyTuple& oth )
 {
+    if( this == &oth )
+        return *this;
+
     clear();
     items.resize( oth.size() );
 
@@ -594,6 +738,9 @@ void PyList::clear()
 
 PyList& PyList::operator=( const PyList& oth )
 {
+    if( this == &oth )
+        return *this;
+
     clear();
     items.resize( oth.size() );
 
@@ -690,24 +837,21 @@ void PyDict::SetItem( PyRep* key, PyRep* value )
 
     /* note: needs to be enabled when object reference is working.
      */
-    PyIncRef( key );
-    PyIncRef( value );
+    PySafeIncRef( value );
 
-    /* check if we need to replace a dictionary entry */
-    iterator itr = items.find( key );
-    if( itr == items.end() )
+    /* a single lookup either adds the entry or finds the one to replace */
+    std::pair<iterator, bool> res = items.insert( std::make_pair( key, value ) );
+    if( res.second )
     {
         // Keep both key & value
-        items.insert( std::make_pair( key, value ) );
+        PyIncRef( key );
     }
     else
     {
-        // We don't need it anymore, we're using itr->first.
-        PyDecRef( key );
-
-        // Replace itr->second with value.
-        PySafeDecRef( itr->second );
-        itr->second = value;
+        // We're using res.first->first as the key.
+        // Replace res.first->second with value.
+        PySafeDecRef( res.first->second );
+        res.first->second = value;
     }
 }
 
@@ -725,17 +869,24 @@ void PyDict::SetItem( const char* key, PyRep* value )
 
 PyDict& PyDict::operator=( const PyDict& oth )
 {
+    if( this == &oth )
+        return *this;
+
     clear();
+    items.reserve( oth.size() );
 
     const_iterator cur, end;
     cur = oth.begin();
     end = oth.end();
     for(; cur != end; cur++)
     {
-        if( cur->second == NULL )
-            SetItem( cur->first->Clone(), NULL );
-        else
-            SetItem( cur->first->Clone(), cur->second->Clone() );
+        PyRep* key = cur->first->Clone();
+        PyRep* value = ( cur->second == NULL ? NULL : cur->second->Clone() );
+
+        // SetItem takes its own references
+        SetItem( key, value );
+        PyDecRef( key );
+        PySafeDecRef( value );
     }
 
     return *this;
@@ -750,7 +901,7 @@ PyObject::PyObject( const char* type, PyRep* args ) : PyRep( PyRep::PyTypeObject
     mType = new PyString(type);
 }
 
-PyObject::PyObject( const PyObject& oth ) : PyRep( PyRep::PyTypeObject ), mType( new PyString( *oth.type() ) ), mArguments( oth.arguments()->Clone() ) {}
+PyObject::PyObject( const PyObject& oth ) : PyRep( PyRep::PyTypeObject ), mType( oth.type()->Clone()->AsString() ), mArguments( oth.arguments()->Clone() ) {}
 PyObject::~PyObject()
 {
     PyDecRef( mType );
@@ -946,9 +1097,28 @@ PyTuple* PyObjectEx_Type2::_CreateHeader( PyTuple* args, PyDict* keywords )
 /************************************************************************/
 /* PyPackedRow                                                          */
 /************************************************************************/
-PyPackedRow::PyPackedRow( DBRowDescriptor* header ) : PyRep( PyRep::PyTypePackedRow ), mHeader( header ), mFields( new PyList( header->ColumnCount() ) ) {}
-PyPackedRow::PyPackedRow( const PyPackedRow& oth ) : PyRep( PyRep::PyTypePackedRow ),
-  mHeader( oth.header() ), mFields( new PyList( oth.header()->ColumnCount() ) )
+/** Reads a field value from the column buffer. */
+template<typename T>
+static inline T ReadFieldValue( const uint8* p )
+{
+    T value;
+    memcpy( &value, p, sizeof( T ) );
+    return value;
+}
+
+/** Writes a field value into the column buffer. */
+template<typename T>
+static inline void WriteFieldValue( uint8* p, T value )
+{
+    memcpy( p, &value, sizeof( T ) );
+}
+
+PyPackedRow::PyPackedRow( DBRowDescriptor* header ) : PyRep( PyRep::PyTypePackedRow ), mHeader( header )
+{
+    _Layout();
+}
+
+PyPackedRow::PyPackedRow( const PyPackedRow& oth ) : PyRep( PyRep::PyTypePackedRow ), mHeader( oth.header() )
 {
     PyIncRef( mHeader );
 
@@ -957,8 +1127,13 @@ PyPackedRow::PyPackedRow( const PyPackedRow& oth ) : PyRep( PyRep::PyTypePackedR
 
 PyPackedRow::~PyPackedRow()
 {
+    std::vector<Field>::iterator cur, end;
+    cur = mFields.begin();
+    end = mFields.end();
+    for(; cur != end; ++cur)
+        PySafeDecRef( cur->value );
+
     PyDecRef( mHeader );
-    PyDecRef( mFields );
 }
 
 PyRep* PyPackedRow::Clone() const
@@ -971,15 +1146,48 @@ bool PyPackedRow::visit( PyVisitor& v ) const
     return v.VisitPackedRow( this );
 }
 
+PyRep* PyPackedRow::GetField( uint32 index ) const
+{
+    const Field& field = mFields[ index ];
+    if( NULL == field.value && IsFieldPacked( index ) )
+    {
+        // the row keeps it, so don't pin the current arena
+        PyHeapScope heap;
+
+        field.value = _Load( field );
+    }
+
+    return field.value;
+}
+
 bool PyPackedRow::SetField( uint32 index, PyRep* value )
 {
-    if( !header()->VerifyValue( index, value ) )
+    if( ColumnCount() <= index || !header()->VerifyValue( index, value ) )
     {
         PyDecRef( value );
         return false;
     }
 
-    mFields->SetItem( index, value );
+    Field& field = mFields[ index ];
+    if( IsFieldPacked( index ) )
+    {
+        // None (NULL) goes out as zero
+        if( value->IsLong() )
+            _StoreInt( field, value->AsLong()->value() );
+        else if( value->IsInt() )
+            _StoreInt( field, value->AsInt()->value() );
+        else if( value->IsFloat() )
+            _StoreFloat( field, value->AsFloat()->value() );
+        else if( value->IsBool() )
+            _StoreInt( field, value->AsBool()->value() );
+        else
+            _StoreInt( field, 0 );
+    }
+
+    // it's been created already, so keep it
+    PySafeDecRef( field.value );
+    field.value = value;
+
     return true;
 }
 
@@ -988,19 +1196,240 @@ bool PyPackedRow::SetField( const char* colName, PyRep* value )
     return SetField( header()->FindColumn( colName ), value );
 }
 
+bool PyPackedRow::SetFieldInt( uint32 index, int64 value )
+{
+    if( ColumnCount() <= index || !IsFieldPacked( index ) )
+        return false;
+
+    Field& field = mFields[ index ];
+    _StoreInt( field, value );
+
+    PySafeDecRef( field.value );
+    field.value = NULL;
+
+    return true;
+}
+
+bool PyPackedRow::SetFieldInt( const char* colName, int64 value )
+{
+    return SetFieldInt( header()->FindColumn( colName ), value );
+}
+
+bool PyPackedRow::SetFieldFloat( uint32 index, double value )
+{
+    if( ColumnCount() <= index || !IsFieldPacked( index ) )
+        return false;
+
+    Field& field = mFields[ index ];
+    _StoreFloat( field, value );
+
+    PySafeDecRef( field.value );
+    field.value = NULL;
+
+    return true;
+}
+
+bool PyPackedRow::SetFieldFloat( const char* colName, double value )
+{
+    return SetFieldFloat( header()->FindColumn( colName ), value );
+}
+
 PyPackedRow& PyPackedRow::operator=( const PyPackedRow& oth )
 {
-    *mFields = *oth.mFields;
+    if( this == &oth )
+        return *this;
+
+    std::vector<Field>::iterator cur, end;
+    cur = mFields.begin();
+    end = mFields.end();
+    for(; cur != end; ++cur)
+        PySafeDecRef( cur->value );
+
+    mFields = oth.mFields;
+    mData = oth.mData;
+
+    cur = mFields.begin();
+    end = mFields.end();
+    for(; cur != end; ++cur)
+    {
+        if( NULL != cur->value )
+            cur->value = cur->value->Clone();
+    }
 
     return *this;
 }
 
 int32 PyPackedRow::hash() const
 {
-    assert(false);
     return PyRep::hash();
 }
 
+void PyPackedRow::_Layout()
+{
+    const uint32 cc = mHeader->ColumnCount();
+    mFields.resize( cc );
+
+    // Columns are packed from the widest to the narrowest one,
+    // keeping their order within the same width; booleans are
+    // packed as bits after them.
+    uint32 offsets[ 4 ] = { 0, 0, 0, 0 };
+    uint32 bools = 0;
+
+    for( uint32 i = 0; i < cc; i++ )
+    {
+        Field& field = mFields[ i ];
+        field.type = mHeader->GetColumnType( i );
+        field.offset = 0;
+        field.bit = 0;
+        field.value = NULL;
+
+        switch( DBTYPE_GetSizeBits( field.type ) )
+        {
+            case 64: offsets[ 0 ] += 8; break;
+            case 32: offsets[ 1 ] += 4; break;
+            case 16: offsets[ 2 ] += 2; break;
+            case 8:  offsets[ 3 ] += 1; break;
+            case 1:  ++bools;           break;
+            default: field.type = DBTYPE_ERROR; break;
+        }
+    }
+
+    // turn sizes into starting offsets
+    uint32 start = 0;
+    for( uint32 i = 0; i < 4; i++ )
+    {
+        const uint32 size = offsets[ i ];
+        offsets[ i ] = start;
+        start += size;
+    }
+
+    uint32 bit = 0;
+    for( uint32 i = 0; i < cc; i++ )
+    {
+        Field& field = mFields[ i ];
+
+        switch( DBTYPE_GetSizeBits( field.type ) )
+        {
+            case 64: field.offset = offsets[ 0 ]; offsets[ 0 ] += 8; break;
+            case 32: field.offset = offsets[ 1 ]; offsets[ 1 ] += 4; break;
+            case 16: field.offset = offsets[ 2 ]; offsets[ 2 ] += 2; break;
+            case 8:  field.offset = offsets[ 3 ]; offsets[ 3 ] += 1; break;
+            case 1:
+            {
+                field.offset = start + ( bit >> 3 );
+                field.bit = bit & 0x07;
+                ++bit;
+            } break;
+        }
+    }
+
+    mData.Resize<uint8>( start + ( ( bools + 7 ) >> 3 ) );
+}
+
+void PyPackedRow::_StoreInt( const Field& field, int64 value )
+{
+    uint8* p = &mData[ field.offset ];
+
+    switch( field.type )
+    {
+        case DBTYPE_I8:
+        case DBTYPE_UI8:
+        case DBTYPE_CY:
+        case DBTYPE_FILETIME:
+            WriteFieldValue<int64>( p, value );
+            break;
+
+        case DBTYPE_I4:
+        case DBTYPE_UI4:
+            WriteFieldValue<int32>( p, static_cast<int32>( value ) );
+            break;
+
+        case DBTYPE_I2:
+        case DBTYPE_UI2:
+            WriteFieldValue<int16>( p, static_cast<int16>( value ) );
+            break;
+
+        case DBTYPE_I1:
+        case DBTYPE_UI1:
+            WriteFieldValue<int8>( p, static_cast<int8>( value ) );
+            break;
+
+        case DBTYPE_R8:
+        case DBTYPE_R4:
+            _StoreFloat( field, static_cast<double>( value ) );
+            break;
+
+        case DBTYPE_BOOL:
+        {
+            if( 0 != value )
+                *p |= ( 1 << field.bit );
+            else
+                *p &= ~( 1 << field.bit );
+        } break;
+
+        default:
+            break;
+    }
+}
+
+void PyPackedRow::_StoreFloat( const Field& field, double value )
+{
+    uint8* p = &mData[ field.offset ];
+
+    switch( field.type )
+    {
+        case DBTYPE_R8:
+            WriteFieldValue<double>( p, value );
+            break;
+
+        case DBTYPE_R4:
+            WriteFieldValue<float>( p, static_cast<float>( value ) );
+            break;
+
+        default:
+            _StoreInt( field, static_cast<int64>( value ) );
+            break;
+    }
+}
+
+PyRep* PyPackedRow::_Load( const Field& field ) const
+{
+    const uint8* p = &mData[ field.offset ];
+
+    switch( field.type )
+    {
+        case DBTYPE_I8:
+        case DBTYPE_UI8:
+        case DBTYPE_CY:
+        case DBTYPE_FILETIME:
+            return new PyLong( ReadFieldValue<int64>( p ) );
+
+        case DBTYPE_I4:
+        case DBTYPE_UI4:
+            return new_int( ReadFieldValue<int32>( p ) );
+
+        case DBTYPE_I2:
+        case DBTYPE_UI2:
+            return new_int( ReadFieldValue<int16>( p ) );
+
+        case DBTYPE_I1:
+        case DBTYPE_UI1:
+            return new_int( ReadFieldValue<int8>( p ) );
+
+        case DBTYPE_R8:
+            return new PyFloat( ReadFieldValue<double>( p ) );
+
+        case DBTYPE_R4:
+            return new PyFloat( ReadFieldValue<float>( p ) );
+
+        case DBTYPE_BOOL:
+            return new_bool( ( *p >> field.bit ) & 0x01 );
+
+        default:
+            return NULL;
+    }
+}
+
 /************************************************************************/
 /* PyRep SubStruct Class                                                */
 /************************************************************************/
@@ -1091,6 +1520,41 @@ bool PyChecksumedStream::visit( PyVisitor& v ) const
     return v.VisitChecksumedStream( this );
 }
 
+/************************************************************************/
+/* PyRep PreMarshaled Class                                             */
+/************************************************************************/
+PyPreMarshaled::PyPreMarshaled( PyRep* rep ) : PyRep( PyRep::PyTypePreMarshaled ), mRep( rep ), mData( new Buffer )
+{
+    MarshalStream v;
+    if( !v.SaveElement( mRep, *mData ) )
+    {
+        sLog.Error( "Marshal", "Failed to pre-marshal rep %p.", mRep );
+
+        mData->Resize< uint8 >( 0 );
+    }
+}
+
+PyPreMarshaled::~PyPreMarshaled()
+{
+    PyDecRef( mRep );
+    delete mData;
+}
+
+PyRep* PyPreMarshaled::Clone() const
+{
+    return Share();
+}
+
+bool PyPreMarshaled::visit( PyVisitor& v ) const
+{
+    return v.VisitPreMarshaled( this );
+}
+
+int32 PyPreMarshaled::hash() const
+{
+    return rep()->hash();
+}
+
 
 /************************************************************************/
 /* tuple large integer helper functions                                 */
@@ -1175,3 +1639,189 @@ PyTuple * new_tuple( PyRep* arg1 )
     res->SetItem(0, arg1);
     return res;
 }
+
+/************************************************************************/
+/* interned object helper functions                                     */
+/************************************************************************/
+/** The lowest interned integer. */
+static const int32 PYINTERN_INT_MIN = -1;
+/** The highest interned integer. */
+static const int32 PYINTERN_INT_MAX = 255;
+
+/** Interned strings in addition to the prebuilt ones of the marshal string table. */
+static const char* const s_mInternedStrings[] =
+{
+    "",
+    "location",
+    "proxy",
+    "solarsystem",
+    "stacksize",
+    "station"
+};
+
+/**
+ * @brief Table of interned objects.
+ *
+ * The interned objects are immortal, so they can be handed out
+ * to any thread. They are allocated from heap even if the table
+ * is first used while decoding into a PyArena.
+ */
+class PyInternTable
+: public Singleton<PyInternTable>
+{
+public:
+    PyInternTable();
+
+    PyNone* GetNone() const { return mNone; }
+    PyBool* GetBool( bool value ) const { return value ? mTrue : mFalse; }
+    /** @return The interned integer; NULL if not interned. */
+    PyInt* GetInt( int32 value ) const
+    {
+        if( PYINTERN_INT_MIN <= value && value <= PYINTERN_INT_MAX )
+            return mInts[ value - PYINTERN_INT_MIN ];
+
+        return NULL;
+    }
+    /** @return The interned string; NULL if not interned. */
+    PyString* GetString( const char* str, size_t len ) const;
+
+protected:
+    /** djb2 hash of a string. */
+    static uint32 hash( const char* str, size_t len )
+    {
+        uint32 hash = 5381;
+
+        for(; 0 < len; --len )
+            hash = ( ( hash << 5 ) + hash ) + *str++; /* hash * 33 + c */
+
+        return hash;
+    }
+
+    /**
+     * @brief Interns a string.
+     *
+     * @param[in] str The string.
+     */
+    void AddString( const char* str );
+
+    PyNone* mNone;
+    PyBool* mTrue;
+    PyBool* mFalse;
+    PyInt* mInts[ PYINTERN_INT_MAX - PYINTERN_INT_MIN + 1 ];
+
+    typedef std::tr1::unordered_map<uint32, PyString*>  StringMap;
+    typedef StringMap::iterator                         StringMapItr;
+    typedef StringMap::const_iterator                   StringMapConstItr;
+
+    /** Interned strings by their hash. */
+    StringMap mStrings;
+    /** Length of the longest interned string. */
+    size_t mMaxStringLength;
+};
+
+PyInternTable::PyInternTable()
+: mMaxStringLength( 0 )
+{
+    PyHeapScope heap;
+
+    mNone = PyRep::MakeImmortal( new PyNone );
+    mTrue = PyRep::MakeImmortal( new PyBool( true ) );
+    mFalse = PyRep::MakeImmortal( new PyBool( false ) );
+
+    for( int32 i = PYINTERN_INT_MIN; i <= PYINTERN_INT_MAX; ++i )
+        mInts[ i - PYINTERN_INT_MIN ] = PyRep::MakeImmortal( new PyInt( i ) );
+
+    for( size_t i = 0; i < sizeof( s_mInternedStrings ) / sizeof( const char* ); ++i )
+        AddString( s_mInternedStrings[ i ] );
+}
+
+PyString* PyInternTable::GetString( const char* str, size_t len ) const
+{
+    const uint8 index = MarshalStringTable::LookupIndex( str, len );
+    if( STRING_TABLE_ERROR != index )
+        return MarshalStringTable::LookupPyString( index );
+
+    if( mMaxStringLength < len )
+        return NULL;
+
+    StringMapConstItr res = mStrings.find( hash( str, len ) );
+    if( mStrings.end() == res )
+        return NULL;
+
+    const std::string& content = res->second->content();
+    if( content.size() != len || 0 != memcmp( content.data(), str, len ) )
+        return NULL;
+
+    return res->second;
+}
+
+void PyInternTable::AddString( const char* str )
+{
+    const size_t len = strlen( str );
+
+    /* on a hash collision, the first string wins */
+    if( mStrings.insert( std::make_pair( hash( str, len ), PyRep::MakeImmortal( new PyString( str, len ) ) ) ).second )
+        mMaxStringLength = std::max( mMaxStringLength, len );
+}
+
+#define sPyInternTable \
+    ( PyInternTable::get() )
+
+/**
+ * @brief Hands out an interned object.
+ *
+ * The object is immortal, so no reference needs to be taken.
+ */
+template<typename T>
+static T* ShareInterned( T* rep )
+{
+    ++GetAllocCounts().interned;
+    return rep;
+}
+
+void init_interned()
+{
+    PyInternTable::get();
+}
+
+PyNone * new_none()
+{
+    return ShareInterned( sPyInternTable.GetNone() );
+}
+
+PyBool * new_bool(bool value)
+{
+    return ShareInterned( sPyInternTable.GetBool( value ) );
+}
+
+PyInt * new_int(int32 value)
+{
+    PyInt* res = sPyInternTable.GetInt( value );
+    if( NULL != res )
+        return ShareInterned( res );
+
+    return new PyInt( value );
+}
+
+PyString * new_string(const char* str)
+{
+    return new_string( str, strlen( str ) );
+}
+
+PyString * new_string(const char* str, size_t len)
+{
+    PyString* res = sPyInternTable.GetString( str, len );
+    if( NULL != res )
+        return ShareInterned( res );
+
+    return new PyString( str, len );
+}
+
+PyString * new_string(const std::string& str)
+{
+    PyString* res = sPyInternTable.GetString( str.data(), str.size() );
+    if( NULL != res )
+        return ShareInterned( res );
+
+    return new PyString( str );
+}
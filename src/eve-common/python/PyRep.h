@@ -33,6 +33,8 @@
  */
 //#pragma pack(push,1)
 
+#include "python/PyDictStorage.h"
+
 class PyInt;
 class PyLong;
 class PyFloat;
@@ -48,6 +50,7 @@ class PyNone;
 class PySubStruct;
 class PySubStream;
 class PyChecksumedStream;
+class PyPreMarshaled;
 class PyObject;
 class PyObjectEx;
 class PyPackedRow;
@@ -95,8 +98,9 @@ public:
         PyTypeObject            = 15,
         PyTypeObjectEx          = 16,
         PyTypePackedRow         = 17,
-        PyTypeError             = 18,
-        PyTypeMax               = 18,
+        PyTypePreMarshaled      = 18,
+        PyTypeError             = 19,
+        PyTypeMax               = 19,
     };
 
     /** PyType check functions
@@ -128,6 +132,7 @@ public:
     bool IsSubStruct() const        { return mType == PyTypeSubStruct; }
     bool IsSubStream() const        { return mType == PyTypeSubStream; }
     bool IsChecksumedStream() const { return mType == PyTypeChecksumedStream; }
+    bool IsPreMarshaled() const     { return mType == PyTypePreMarshaled; }
     bool IsObject() const           { return mType == PyTypeObject; }
     bool IsObjectEx() const         { return mType == PyTypeObjectEx; }
     bool IsPackedRow() const        { return mType == PyTypePackedRow; }
@@ -165,6 +170,8 @@ public:
     const PySubStream* AsSubStream() const               { assert( IsSubStream() ); return (const PySubStream*)this; }
     PyChecksumedStream* AsChecksumedStream()             { assert( IsChecksumedStream() ); return (PyChecksumedStream*)this; }
     const PyChecksumedStream* AsChecksumedStream() const { assert( IsChecksumedStream() ); return (const PyChecksumedStream*)this; }
+    PyPreMarshaled* AsPreMarshaled()                     { assert( IsPreMarshaled() ); return (PyPreMarshaled*)this; }
+    const PyPreMarshaled* AsPreMarshaled() const         { assert( IsPreMarshaled() ); return (const PyPreMarshaled*)this; }
     PyObject* AsObject()                                 { assert( IsObject() ); return (PyObject*)this; }
     const PyObject* AsObject() const                     { assert( IsObject() ); return (const PyObject*)this; }
     PyObjectEx* AsObjectEx()                             { assert( IsObjectEx() ); return (PyObjectEx*)this; }
@@ -172,8 +179,67 @@ public:
     PyPackedRow* AsPackedRow()                           { assert( IsPackedRow() ); return (PyPackedRow*)this; }
     const PyPackedRow* AsPackedRow() const               { assert( IsPackedRow() ); return (const PyPackedRow*)this; }
 
-    using RefObject::IncRef;
-    using RefObject::DecRef;
+    /** Increments reference count, unless the object is immortal. */
+    void IncRef() const
+    {
+        if( !IsImmortal() )
+            RefObject::IncRef();
+    }
+    /** Decrements reference count, unless the object is immortal. */
+    void DecRef() const
+    {
+        if( !IsImmortal() )
+            RefObject::DecRef();
+    }
+
+    /**
+     * @brief Makes an object immortal.
+     *
+     * Reference count of an immortal object is never touched
+     * again and the object is never freed, so it may be shared
+     * by several threads; meant for interned objects.
+     *
+     * @param[in] rep The object.
+     *
+     * @return The object.
+     */
+    template< typename T >
+    static T* MakeImmortal( T* rep )
+    {
+        rep->mRefCount = IMMORTAL_REF_COUNT;
+        return rep;
+    }
+    /** @return True if the object is immortal. */
+    bool IsImmortal() const { return IMMORTAL_REF_COUNT == mRefCount; }
+
+    /**
+     * @brief Object allocation statistics.
+     *
+     * Counted by each thread on its own, since objects are created
+     * and destroyed by network and serializer threads too, and summed
+     * up on request. Cumulative counts wrap around at the range of long.
+     */
+    struct AllocStats
+    {
+        /** Number of objects constructed. */
+        uint64 allocated;
+        /** Number of objects currently alive. */
+        uint64 alive;
+        /** Number of clones satisfied by sharing an immutable object. */
+        uint64 shared;
+        /** Number of allocations avoided by handing out interned objects. */
+        uint64 interned;
+    };
+
+    /**
+     * @return Object allocation statistics.
+     */
+    static AllocStats GetAllocStats();
+
+    /** Allocates from the current PyArena, if any. */
+    static void* operator new( size_t size );
+    /** Frees memory allocated by operator new. */
+    static void operator delete( void* p );
 
     /**
      * @brief Dumps object to file.
@@ -193,6 +259,11 @@ public:
     /**
      * @brief Clones object.
      *
+     * Immutable objects (numbers, strings, buffers, ...) are
+     * shared rather than copied, so cloning a container only
+     * allocates its mutable parts. Objects decoded into a
+     * PyArena are always copied, though.
+     *
      * @return Indentical copy of object.
      */
     virtual PyRep* Clone() const = 0;
@@ -218,8 +289,41 @@ protected:
     PyRep( PyType t );
     virtual ~PyRep();
 
+    /**
+     * @return True if the object has been allocated from a PyArena.
+     */
+    bool IsInArena() const;
+    /**
+     * @brief Shares the object.
+     *
+     * @return This object with reference count increased.
+     */
+    PyRep* Share() const;
+    /**
+     * @brief Implements Clone for immutable objects.
+     *
+     * Objects living in a PyArena are copied, so cloning
+     * is the way to get objects out of an arena. Immortal
+     * objects are always shared.
+     *
+     * @param[in] rep The object to clone.
+     *
+     * @return The clone.
+     */
+    template< typename T >
+    static PyRep* CloneImmutable( const T* rep )
+    {
+        if( !rep->IsImmortal() && rep->IsInArena() )
+            return new T( *rep );
+
+        return rep->Share();
+    }
+
     const PyType mType;
 
+    /** Reference count marking immortal objects. */
+    static const size_t IMMORTAL_REF_COUNT = (size_t)-1;
+
     /** Lookup table for PyRep type object type names. */
     static const char* const s_mTypeString[];
 };
@@ -652,38 +756,10 @@ protected:
  */
 class PyDict : public PyRep
 {
-protected:
-    // hash function
-    class _hash : public std::unary_function<PyRep*, size_t>
-    {
-    public:
-        size_t operator()( const PyRep* _Keyval ) const
-        {
-            assert( _Keyval );
-
-            return (size_t)_Keyval->hash();
-        }
-    };
-
-    // comparison function
-    class _comp : public std::binary_function<PyRep*, PyRep*, bool>
-    {
-    public:
-        bool operator()( const PyRep* _Arg1, const PyRep* _Arg2 ) const
-        {
-            assert( _Arg1 );
-            assert( _Arg2 );
-
-            // Suffers from hash collision but whatever ... still
-            // better than raw pointer comparison
-            return ( _Arg1->hash() == _Arg2->hash() );
-        }
-    };
-
 public:
-    typedef std::tr1::unordered_map<PyRep*, PyRep*, _hash, _comp>   storage_type;
-    typedef storage_type::iterator                                  iterator;
-    typedef storage_type::const_iterator                            const_iterator;
+    typedef PyDictStorage                   storage_type;
+    typedef storage_type::iterator          iterator;
+    typedef storage_type::const_iterator    const_iterator;
 
     PyDict();
     PyDict( const PyDict& oth );
@@ -876,18 +952,17 @@ protected:
 };
 
 /**
- * @brief Packed row.
+ * @brief Python object "blue.DBRow".
  *
- * Special row which packs all its values
- * with zero-compression algorithm.
+ * Fixed-size fields are kept in their wire form: a column buffer
+ * laid out the way the row is packed (widest columns first, then
+ * bit-packed booleans). A PyRep for such a field is created only
+ * when asked for by GetField. Fields of variable size (strings,
+ * buffers) are kept as PyReps.
  */
 class PyPackedRow : public PyRep
 {
 public:
-    typedef PyList                          storage_type;
-    typedef storage_type::iterator          iterator;
-    typedef storage_type::const_iterator    const_iterator;
-
     PyPackedRow( DBRowDescriptor* header );
     PyPackedRow( const PyPackedRow& oth );
 
@@ -898,15 +973,49 @@ public:
     DBRowDescriptor* header() const { return mHeader; }
 
     // Fields:
-    const_iterator begin() const { return mFields->begin(); }
-    const_iterator end() const { return mFields->end(); }
-    void clear() { mFields->clear(); }
+    uint32 ColumnCount() const { return mFields.size(); }
 
-    PyRep* GetField( size_t index ) const { return mFields->GetItem( index ); }
+    /**
+     * @param[in] index Index of the field.
+     *
+     * @return True if the field is stored in the column buffer.
+     */
+    bool IsFieldPacked( uint32 index ) const { return DBTYPE_ERROR != mFields[ index ].type; }
+
+    /**
+     * @brief Column buffer, in wire layout.
+     *
+     * Its size is fixed by the header.
+     */
+    Buffer& data() { return mData; }
+    const Buffer& data() const { return mData; }
+
+    /**
+     * @brief Obtains a field.
+     *
+     * @param[in] index Index of the field.
+     *
+     * @return Borrowed reference to the field; NULL if not set.
+     */
+    PyRep* GetField( uint32 index ) const;
 
     bool SetField( uint32 index, PyRep* value );
     bool SetField( const char* colName, PyRep* value );
 
+    /**
+     * @brief Sets a packed field without creating a PyRep.
+     *
+     * The value is converted to the type of the column.
+     *
+     * @retval true  The field has been set.
+     * @retval false The field isn't packed.
+     */
+    bool SetFieldInt( uint32 index, int64 value );
+    bool SetFieldInt( const char* colName, int64 value );
+    /** @copydoc SetFieldInt */
+    bool SetFieldFloat( uint32 index, double value );
+    bool SetFieldFloat( const char* colName, double value );
+
     /**
      * @brief Assigment operator to handle ownership things.
      *
@@ -918,10 +1027,34 @@ public:
     int32 hash() const;
 
 protected:
+    /** Location and cached PyRep of a field. */
+    struct Field
+    {
+        /** Type of packed field; DBTYPE_ERROR if not packed. */
+        DBTYPE type;
+        /** Byte offset within the column buffer. */
+        uint32 offset;
+        /** Bit within the byte (booleans only). */
+        uint8 bit;
+        /** The PyRep; created on demand for packed fields. */
+        mutable PyRep* value;
+    };
+
     virtual ~PyPackedRow();
 
+    /** Lays out fields according to the header. */
+    void _Layout();
+
+    /** Stores a value into the column buffer. */
+    void _StoreInt( const Field& field, int64 value );
+    void _StoreFloat( const Field& field, double value );
+    /** Creates a PyRep from the column buffer. */
+    PyRep* _Load( const Field& field ) const;
+
     DBRowDescriptor* const mHeader;
-    storage_type* const mFields;
+
+    std::vector<Field> mFields;
+    Buffer mData;
 };
 
 class PySubStruct : public PyRep
@@ -987,6 +1120,43 @@ protected:
     const uint32 mChecksum;
 };
 
+/**
+ * @brief Shared, immutable, pre-marshaled object.
+ *
+ * Keeps an object together with its marshaled form, so the same
+ * object may be sent to many clients while being marshaled only
+ * once. MarshalStream splices the stored bytes into the stream;
+ * all other visitors see the wrapped object.
+ *
+ * Neither the wrapped object nor the bytes may change after
+ * construction; that's why cloning just shares the instance.
+ */
+class PyPreMarshaled : public PyRep
+{
+public:
+    /**
+     * @brief Marshals given object.
+     *
+     * @param[in] rep The object; ownership is taken.
+     */
+    PyPreMarshaled( PyRep* rep );
+
+    PyRep* Clone() const;
+    bool visit( PyVisitor& v ) const;
+
+    PyRep* rep() const { return mRep; }
+    /** @return Marshaled object (without stream header); empty if marshaling failed. */
+    const Buffer& data() const { return *mData; }
+
+    int32 hash() const;
+
+protected:
+    virtual ~PyPreMarshaled();
+
+    PyRep* const mRep;
+    Buffer* const mData;
+};
+
 /* note: this will decrease memory use with 50% but increase load time with 50%
  * enabling this would have to wait until references work properly.
  */
@@ -1020,4 +1190,25 @@ PyTuple * new_tuple(const char* arg1, PyRep* arg2, PyRep* arg3);
 PyTuple * new_tuple(PyRep* arg1);
 PyTuple * new_tuple(PyRep* arg1, PyRep* arg2);
 
+/************************************************************************/
+/* interned object helper functions                                     */
+/************************************************************************/
+/*
+ * Common immutable objects (None, booleans, small integers and
+ * frequently used strings) are interned; these return a new
+ * reference to the interned object if there is one and allocate
+ * a new object otherwise. Either way, the caller owns the reference.
+ *
+ * The table is built on first use; a program calling these from
+ * more than one thread must build it by init_interned() before
+ * starting the threads.
+ */
+void init_interned();
+PyNone * new_none();
+PyBool * new_bool(bool value);
+PyInt * new_int(int32 value);
+PyString * new_string(const char* str);
+PyString * new_string(const char* str, size_t len);
+PyString * new_string(const std::string& str);
+
 #endif//EVE_PY_REP_H
@@ -119,12 +119,10 @@ bool PyVisitor::VisitPackedRow( const PyPackedRow* rep )
     if( !rep->header()->visit( *this ) )
         return false;
 
-    PyPackedRow::const_iterator cur, end;
-    cur = rep->begin();
-    end = rep->end();
-    for(; cur != end; cur++)
+    const uint32 cc = rep->ColumnCount();
+    for( uint32 i = 0; i < cc; i++ )
     {
-        if( !(*cur)->visit( *this ) )
+        if( !rep->GetField( i )->visit( *this ) )
             return false;
     }
 
@@ -161,6 +159,11 @@ bool PyVisitor::VisitChecksumedStream( const PyChecksumedStream* rep )
     return true;
 }
 
+bool PyVisitor::VisitPreMarshaled( const PyPreMarshaled* rep )
+{
+    return rep->rep()->visit( *this );
+}
+
 /************************************************************************/
 /* PyPfxVisitor                                                         */
 /************************************************************************/
@@ -41,6 +41,7 @@ class PyObjectEx;
 class PySubStruct;
 class PySubStream;
 class PyChecksumedStream;
+class PyPreMarshaled;
 class PyDict;
 class PyList;
 class PyTuple;
@@ -78,6 +79,8 @@ public:
     virtual bool VisitSubStruct( const PySubStruct* rep );
     virtual bool VisitSubStream( const PySubStream* rep );
     virtual bool VisitChecksumedStream( const PyChecksumedStream* rep );
+    /** visits the wrapped object by default */
+    virtual bool VisitPreMarshaled( const PyPreMarshaled* rep );
 };
 
 class PyPfxVisitor : public PyVisitor
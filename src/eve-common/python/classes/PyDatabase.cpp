@@ -108,6 +108,36 @@ void DBRowDescriptor::AddColumn( const char* name, DBTYPE type )
     _GetColumnList()->items.push_back( col );
 }
 
+bool DBRowDescriptor::IsValid( const PyRep* rep )
+{
+    if( !rep->IsObjectEx() || rep->AsObjectEx()->isType2() )
+        return false;
+
+    const PyRep* header = rep->AsObjectEx()->header();
+    if( NULL == header || !header->IsTuple() || 2 > header->AsTuple()->size() )
+        return false;
+
+    const PyTuple* head = header->AsTuple();
+    if( !head->GetItem( 0 )->IsToken() || !head->GetItem( 1 )->IsTuple() )
+        return false;
+
+    const PyTuple* args = head->GetItem( 1 )->AsTuple();
+    if( 1 > args->size() || !args->GetItem( 0 )->IsTuple() )
+        return false;
+
+    const PyTuple* columns = args->GetItem( 0 )->AsTuple();
+    for( size_t i = 0; i < columns->size(); i++ )
+    {
+        const PyRep* column = columns->GetItem( i );
+        if( !column->IsTuple() || 2 > column->AsTuple()->size() )
+            return false;
+        if( !column->AsTuple()->GetItem( 0 )->IsString() || !column->AsTuple()->GetItem( 1 )->IsInt() )
+            return false;
+    }
+
+    return true;
+}
+
 PyTuple* DBRowDescriptor::_GetColumnList() const
 {
     return GetArgs()->GetItem( 0 )->AsTuple();
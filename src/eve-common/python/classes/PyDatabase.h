@@ -98,6 +98,16 @@ public:
      */
     void AddColumn( const char* name, DBTYPE type );
 
+    /**
+     * @brief Checks whether an object is laid out like a row descriptor.
+     *
+     * @param[in] rep The object, e.g. as unmarshaled.
+     *
+     * @retval true  The object may be used as DBRowDescriptor.
+     * @retval false The object is something else.
+     */
+    static bool IsValid( const PyRep* rep );
+
 protected:
     // Helper functions:
     PyTuple* _GetColumnList() const;
@@ -29,53 +29,263 @@
 
 #include "log/LogNew.h"
 #include "log/logsys.h"
+#include "threading/Atomic.h"
+#include "threading/ThreadLocal.h"
 #include "utils/misc.h"
 
 //#define COLUMN_BOUNDS_CHECKING
 
-DBcore::DBcore(bool compress, bool ssl) : pCompress(compress), pSSL(ssl)
+/* connection a thread uses; frees the thread's MySQL state when the thread terminates */
+struct ThreadConnection
+{
+    ThreadConnection() : index(0), threads(NULL) {}
+    ~ThreadConnection()
+    {
+        if(threads != NULL)
+            AtomicDecrement(*threads);
+        if(index != 0)
+            mysql_thread_end();
+    }
+
+    //index of the connection, plus one; zero until the thread's first query
+    uint32 index;
+    //thread count of the connection
+    volatile long* threads;
+};
+static ThreadLocal<ThreadConnection> threadConnection;
+
+/* number of finished asynchronous queries which may wait for ProcessCompletions without locking */
+static const size_t COMPLETION_QUEUE_SIZE = 0x400;
+
+/* an asynchronous query and its result */
+class DBcore::AsyncQuery
+: public WorkerJob
+{
+public:
+    AsyncQuery(DBcore &db, DBQueryCompletion *completion, char *query, int32 querylen)
+    : mDB(db), mCompletion(completion), mQuery(query), mQueryLen(querylen), mSuccess(false) {}
+    ~AsyncQuery() { free(mQuery); SafeDelete(mCompletion); }
+
+    //runs the query on a database worker
+    void Run()
+    {
+        Execute();
+        mDB.PushCompleted(this);
+    }
+
+    void Execute() { mSuccess = mDB.DoResultQuery(mResult, mQuery, mQueryLen); }
+    void Complete() { mCompletion->Complete(mSuccess, mResult); }
+
+protected:
+    DBcore &mDB;
+    DBQueryCompletion *mCompletion;
+    char *mQuery;
+    int32 mQueryLen;
+
+    bool mSuccess;
+    DBQueryResult mResult;
+};
+
+DBcore::Connection::Connection() : status(Closed), threads(0)
 {
     mysql_init(&mysql);
-    pStatus = Closed;
 }
 
-DBcore::~DBcore()
+DBcore::Connection::~Connection()
 {
+    CloseStatements();
     mysql_close(&mysql);
 }
 
+void DBcore::Connection::CloseStatements()
+{
+    std::map<std::string, DBStatement::Handle*>::iterator cur, end;
+    cur = statements.begin();
+    end = statements.end();
+    for(; cur != end; cur++) {
+        DBStatement::Handle *h = cur->second;
+
+        //a result still being fetched keeps its handle until it's released
+        h->detached = true;
+        if(!h->busy)
+            DBStatement::Release(h);
+    }
+
+    statements.clear();
+}
+
+DBcore::DBcore(bool compress, bool ssl)
+: mWorkers("Database"),
+  mCompleted(COMPLETION_QUEUE_SIZE),
+  mCompletedOverflowCount(0),
+  pCompress(compress),
+  pSSL(ssl)
+{
+    mConnections.push_back(new Connection);
+}
+
+DBcore::~DBcore()
+{
+    StopWorkers();
+    ProcessCompletions();
+
+    for(size_t i = 0; i < mConnections.size(); i++)
+        SafeDelete(mConnections[i]);
+}
+
+DBcore::eStatus DBcore::GetStatus()
+{
+    Connection &conn = GetConnection();
+    MutexLock lock(conn.lock);
+
+    return conn.status;
+}
+
+DBcore::Connection& DBcore::GetConnection()
+{
+    const uint32 index = threadConnection->index;
+    if(index != 0)
+        return *mConnections[index - 1];
+
+    //first query of this thread; the first connection belongs to
+    //the thread which opened the database, pick the least used one
+    //of the others
+    MutexLock lock(MDatabase);
+
+    size_t best = (mConnections.size() > 1 ? 1 : 0);
+    for(size_t i = best + 1; i < mConnections.size(); i++) {
+        if(AtomicLoad(mConnections[i]->threads) < AtomicLoad(mConnections[best]->threads))
+            best = i;
+    }
+
+    BindThread_locked(best);
+    return *mConnections[best];
+}
+
+void DBcore::BindThread_locked(size_t index) {
+    ThreadConnection &tc = *threadConnection;
+    if(tc.index == 0)
+        mysql_thread_init();
+    if(tc.threads != NULL)
+        AtomicDecrement(*tc.threads);
+
+    tc.index = (uint32)index + 1;
+    tc.threads = &mConnections[index]->threads;
+    AtomicIncrement(*tc.threads);
+}
+
 // Sends the MySQL server a ping
 void DBcore::ping()
 {
-    // well, if it's locked, someone's using it. If someone's using it, it doesn't need a ping
-    if( MDatabase.TryLock() )
-    {
-        mysql_ping( &mysql );
-        MDatabase.Unlock();
+    for(size_t i = 0; i < mConnections.size(); i++) {
+        Connection &conn = *mConnections[i];
+
+        // well, if it's locked, someone's using it. If someone's using it, it doesn't need a ping
+        if( conn.lock.TryLock() )
+        {
+            if( conn.status == Connected && mysql_ping( &conn.mysql ) != 0 )
+                conn.status = Error;
+            // reconnect now rather than on the next query
+            if( conn.status == Error )
+                Open_locked( conn );
+
+            conn.lock.Unlock();
+        }
     }
 }
 
 //query which returns a result (error is stored in the result if it occurs)
 bool DBcore::RunQuery(DBQueryResult &into, const char *query_fmt, ...) {
-    MutexLock lock(MDatabase);
-
     char query[16384];
     va_list vlist;
     va_start(vlist, query_fmt);
     uint32 querylen = vsnprintf(query, 16384, query_fmt, vlist);
     va_end(vlist);
 
-    if(!DoQuery_locked(into.error, query, querylen))
+    return DoResultQuery(into, query, querylen);
+}
+
+void DBcore::RunQueryAsync(DBQueryCompletion *completion, const char *query_fmt, ...) {
+    va_list args;
+    va_start(args, query_fmt);
+    char *query = NULL;
+    uint32 querylen = vasprintf(&query, query_fmt, args);
+    va_end(args);
+
+    AsyncQuery *q = new AsyncQuery(*this, completion, query, querylen);
+
+    if(mWorkers.IsRunning()) {
+        mWorkers.Post(q);
+        return;
+    }
+
+    //no workers, do it right away
+    q->Execute();
+    q->Complete();
+    delete q;
+}
+
+void DBcore::ProcessCompletions() {
+    AsyncQuery *q;
+    while(mCompleted.Pop(q)) {
+        q->Complete();
+        delete q;
+    }
+
+    if(0 == AtomicLoad(mCompletedOverflowCount))
+        return;
+
+    std::queue<AsyncQuery*> overflow;
+    {
+        MutexLock lock(MCompletedOverflow);
+        overflow.swap(mCompletedOverflow);
+        AtomicStore(mCompletedOverflowCount, 0L);
+    }
+
+    while(!overflow.empty()) {
+        q = overflow.front();
+        overflow.pop();
+
+        q->Complete();
+        delete q;
+    }
+}
+
+void DBcore::PushCompleted(AsyncQuery *q) {
+    //keep the order while the overflow is in use
+    if(0 == AtomicLoad(mCompletedOverflowCount) && mCompleted.Push(q))
+        return;
+
+    //the main loop is behind; don't wait for it, it may be waiting
+    //for us in StopWorkers
+    MutexLock lock(MCompletedOverflow);
+    mCompletedOverflow.push(q);
+    AtomicIncrement(mCompletedOverflowCount);
+}
+
+bool DBcore::StartWorkers(uint32 count) {
+    return mWorkers.Start(count);
+}
+
+void DBcore::StopWorkers() {
+    mWorkers.Stop();
+}
+
+bool DBcore::DoResultQuery(DBQueryResult &into, const char *query, int32 querylen) {
+    Connection &conn = GetConnection();
+    MutexLock lock(conn.lock);
+
+    if(!DoQuery_locked(conn, into.error, query, querylen))
         return false;
 
-    uint32 col_count = mysql_field_count(&mysql);
+    uint32 col_count = mysql_field_count(&conn.mysql);
     if(col_count == 0) {
         into.error.SetError(0xFFFF, "DBcore::RunQuery: No Result");
         sLog.Error("DBCore Query", "Query: %s failed because did not return a result", query);
         return false;
     }
 
-    MYSQL_RES *result = mysql_store_result(&mysql);
+    MYSQL_RES *result = mysql_store_result(&conn.mysql);
 
     //give them the result set.
     into.SetResult(&result, col_count);
@@ -90,7 +300,8 @@ bool DBcore::RunQuery(DBQueryResult &into, const char *query_fmt, ...) {
 
 //query which returns no information except error status
 bool DBcore::RunQuery(DBerror &err, const char *query_fmt, ...) {
-    MutexLock lock(MDatabase);
+    Connection &conn = GetConnection();
+    MutexLock lock(conn.lock);
 
     va_list args;
     va_start(args, query_fmt);
@@ -98,7 +309,7 @@ bool DBcore::RunQuery(DBerror &err, const char *query_fmt, ...) {
     uint32 querylen = vasprintf(&query, query_fmt, args);
     va_end(args);
 
-    if(!DoQuery_locked(err, query, querylen)) {
+    if(!DoQuery_locked(conn, err, query, querylen)) {
         free(query);
         return false;
     }
@@ -109,7 +320,8 @@ bool DBcore::RunQuery(DBerror &err, const char *query_fmt, ...) {
 
 //query which returns affected rows:
 bool DBcore::RunQuery(DBerror &err, uint32 &affected_rows, const char *query_fmt, ...) {
-    MutexLock lock(MDatabase);
+    Connection &conn = GetConnection();
+    MutexLock lock(conn.lock);
 
     va_list args;
     va_start(args, query_fmt);
@@ -117,20 +329,21 @@ bool DBcore::RunQuery(DBerror &err, uint32 &affected_rows, const char *query_fmt
     uint32 querylen = vasprintf(&query, query_fmt, args);
     va_end(args);
 
-    if(!DoQuery_locked(err, query, querylen)) {
+    if(!DoQuery_locked(conn, err, query, querylen)) {
         free(query);
         return false;
     }
     free(query);
 
-    affected_rows = (uint32)mysql_affected_rows(&mysql);
+    affected_rows = (uint32)mysql_affected_rows(&conn.mysql);
 
     return true;
 }
 
 //query which returns last insert ID:
 bool DBcore::RunQueryLID(DBerror &err, uint32 &last_insert_id, const char *query_fmt, ...) {
-    MutexLock lock(MDatabase);
+    Connection &conn = GetConnection();
+    MutexLock lock(conn.lock);
 
     va_list args;
     va_start(args, query_fmt);
@@ -138,36 +351,142 @@ bool DBcore::RunQueryLID(DBerror &err, uint32 &last_insert_id, const char *query
     uint32 querylen = vasprintf(&query, query_fmt, args);
     va_end(args);
 
-    if(!DoQuery_locked(err, query, querylen)) {
+    if(!DoQuery_locked(conn, err, query, querylen)) {
         free(query);
         return false;
     }
     free(query);
 
-    last_insert_id = (uint32)mysql_insert_id(&mysql);
+    last_insert_id = (uint32)mysql_insert_id(&conn.mysql);
 
     return true;
 }
 
-bool DBcore::DoQuery_locked(DBerror &err, const char *query, int32 querylen, bool retry)
+bool DBcore::RunStatement(DBStatement &stmt) {
+    Connection &conn = GetConnection();
+    conn.lock.Lock();
+
+    if(!DoStatement_locked(conn, stmt)) {
+        conn.lock.Unlock();
+        return false;
+    }
+
+    //without a result, there's nothing to keep the connection for
+    if(stmt.mColumns.empty())
+        stmt.Free();
+
+    return true;
+}
+
+DBStatement::Handle* DBcore::Prepare_locked(Connection &conn, DBerror &err, const char *sql)
+{
+    std::map<std::string, DBStatement::Handle*>::iterator res = conn.statements.find(sql);
+    if(res != conn.statements.end() && !res->second->busy)
+        return res->second;
+
+    MYSQL_STMT *stmt = mysql_stmt_init(&conn.mysql);
+    if(stmt == NULL) {
+        err.SetError(mysql_errno(&conn.mysql), mysql_error(&conn.mysql));
+        sLog.Error("DBCore Statement", "#%d preparing '%s': %s", err.GetErrNo(), sql, err.c_str());
+        return NULL;
+    }
+
+    if(mysql_stmt_prepare(stmt, sql, (unsigned long)strlen(sql))) {
+        err.SetError(mysql_stmt_errno(stmt), mysql_stmt_error(stmt));
+        sLog.Error("DBCore Statement", "#%d preparing '%s': %s", err.GetErrNo(), sql, err.c_str());
+        mysql_stmt_close(stmt);
+        return NULL;
+    }
+
+    DBStatement::Handle *h = new DBStatement::Handle;
+    h->stmt = stmt;
+    h->busy = false;
+    //a nested use of a busy statement gets a handle of its own
+    h->detached = (res != conn.statements.end());
+
+    if(!h->detached)
+        conn.statements[sql] = h;
+    return h;
+}
+
+bool DBcore::DoStatement_locked(Connection &conn, DBStatement &stmt, bool retry)
+{
+    if (conn.status != Connected)
+        Open_locked(conn);
+
+    DBStatement::Handle *h = Prepare_locked(conn, stmt.error, stmt.sql());
+    if (h == NULL) {
+        uint32 num = stmt.error.GetErrNo();
+        if (num == CR_SERVER_LOST || num == CR_SERVER_GONE_ERROR) {
+            conn.status = Error;
+            if (retry) {
+                sLog.Error("DBCore", "Lost connection, attempting to recover....");
+                return DoStatement_locked(conn, stmt, false);
+            }
+        }
+        return false;
+    }
+
+    if (mysql_stmt_param_count(h->stmt) != stmt.mParams.size()
+        || mysql_stmt_field_count(h->stmt) != stmt.mColumns.size())
+    {
+        stmt.error.SetError(0xFFFF, "DBcore::RunStatement: Bind count mismatch");
+        sLog.Error("DBCore Statement", "'%s' takes %lu parameters and returns %u columns, %lu and %lu bound", stmt.sql(),
+                   (unsigned long)mysql_stmt_param_count(h->stmt), mysql_stmt_field_count(h->stmt),
+                   (unsigned long)stmt.mParams.size(), (unsigned long)stmt.mColumns.size());
+        DBStatement::Release(h);
+        return false;
+    }
+
+    stmt.Bind();
+    h->busy = true;
+
+    if ((!stmt.mParamBinds.empty() && mysql_stmt_bind_param(h->stmt, &stmt.mParamBinds[0]))
+        || mysql_stmt_execute(h->stmt)
+        || (!stmt.mColumnBinds.empty() && (mysql_stmt_bind_result(h->stmt, &stmt.mColumnBinds[0])
+                                           || mysql_stmt_store_result(h->stmt))))
+    {
+        int num = mysql_stmt_errno(h->stmt);
+        stmt.error.SetError(num, mysql_stmt_error(h->stmt));
+        DBStatement::Release(h);
+
+        if (num == CR_SERVER_LOST || num == CR_SERVER_GONE_ERROR) {
+            conn.status = Error;
+            if (retry) {
+                sLog.Error("DBCore", "Lost connection, attempting to recover....");
+                return DoStatement_locked(conn, stmt, false);
+            }
+        }
+
+        sLog.Error("DBCore Statement", "#%d in '%s': %s", stmt.error.GetErrNo(), stmt.sql(), stmt.error.c_str());
+        return false;
+    }
+
+    stmt.error.ClearError();
+    stmt.SetHandle(h, &conn.lock);
+    return true;
+}
+
+bool DBcore::DoQuery_locked(Connection &conn, DBerror &err, const char *query, int32 querylen, bool retry)
 {
-    if (pStatus != Connected)
-        Open_locked();
+    if (conn.status != Connected)
+        Open_locked(conn);
 
-    if (mysql_real_query(&mysql, query, querylen)) {
-        int num = mysql_errno(&mysql);
+    if (mysql_real_query(&conn.mysql, query, querylen)) {
+        int num = mysql_errno(&conn.mysql);
 
         if (num == CR_SERVER_GONE_ERROR)
-            pStatus = Error;
+            conn.status = Error;
 
         if (retry && (num == CR_SERVER_LOST || num == CR_SERVER_GONE_ERROR))
         {
             sLog.Error("DBCore", "Lost connection, attempting to recover....");
-            return DoQuery_locked(err, query, querylen, false);
+            conn.status = Error;
+            return DoQuery_locked(conn, err, query, querylen, false);
         }
 
-        pStatus = Error;
-        err.SetError(num, mysql_error(&mysql));
+        conn.status = Error;
+        err.SetError(num, mysql_error(&conn.mysql));
         sLog.Error("DBCore Query", "#%d in '%s': %s", err.GetErrNo(), query, err.c_str());
         return false;
     }
@@ -182,10 +501,11 @@ bool DBcore::RunQuery(const char* query, int32 querylen, char* errbuf, MYSQL_RES
         *errnum = 0;
     if (errbuf)
         errbuf[0] = 0;
-    MutexLock lock(MDatabase);
+    Connection &conn = GetConnection();
+    MutexLock lock(conn.lock);
 
     DBerror err;
-    if(!DoQuery_locked(err, query, querylen, retry))
+    if(!DoQuery_locked(conn, err, query, querylen, retry))
     {
         sLog.Error("DBCore Query", "Query: %s failed", query);
         if(errnum != NULL)
@@ -200,8 +520,8 @@ bool DBcore::RunQuery(const char* query, int32 querylen, char* errbuf, MYSQL_RES
     }
 
     if (result) {
-        if(mysql_field_count(&mysql)) {
-            *result = mysql_store_result(&mysql);
+        if(mysql_field_count(&conn.mysql)) {
+            *result = mysql_store_result(&conn.mysql);
         } else {
             *result = NULL;
             if (errnum)
@@ -217,22 +537,28 @@ bool DBcore::RunQuery(const char* query, int32 querylen, char* errbuf, MYSQL_RES
         }
     }
     if (affected_rows)
-        *affected_rows = (uint32)mysql_affected_rows(&mysql);
+        *affected_rows = (uint32)mysql_affected_rows(&conn.mysql);
     if (last_insert_id)
-        *last_insert_id = (uint32)mysql_insert_id(&mysql);
+        *last_insert_id = (uint32)mysql_insert_id(&conn.mysql);
     return true;
 }
 
 int32 DBcore::DoEscapeString(char* tobuf, const char* frombuf, int32 fromlen)
 {
-    return mysql_real_escape_string(&mysql, tobuf, frombuf, fromlen);
+    Connection &conn = GetConnection();
+    MutexLock lock(conn.lock);
+
+    return mysql_real_escape_string(&conn.mysql, tobuf, frombuf, fromlen);
 }
 
 void DBcore::DoEscapeString(std::string &to, const std::string &from)
 {
+    Connection &conn = GetConnection();
+    MutexLock lock(conn.lock);
+
     uint32 len = (uint32)from.length();
     to.resize(len*2 + 1);   // make enough room
-    uint32 esc_len = mysql_real_escape_string(&mysql, &to[0], from.c_str(), len);
+    uint32 esc_len = mysql_real_escape_string(&conn.mysql, &to[0], from.c_str(), len);
     to.resize(esc_len+1); // optional.
 }
 
@@ -248,7 +574,7 @@ bool DBcore::IsSafeString(const char *str) {
     return true;
 }
 
-bool DBcore::Open(const char* iHost, const char* iUser, const char* iPassword, const char* iDatabase, int16 iPort, int32* errnum, char* errbuf, bool iCompress, bool iSSL) {
+bool DBcore::Open(const char* iHost, const char* iUser, const char* iPassword, const char* iDatabase, int16 iPort, int32* errnum, char* errbuf, bool iCompress, bool iSSL, uint32 iConnections) {
     MutexLock lock(MDatabase);
 
     pHost = iHost;
@@ -259,10 +585,10 @@ bool DBcore::Open(const char* iHost, const char* iUser, const char* iPassword, c
     pPort = iPort;
     pSSL = iSSL;
 
-    return Open_locked(errnum, errbuf);
+    return Open_locked(iConnections, errnum, errbuf);
 }
 
-bool DBcore::Open(DBerror &err, const char* iHost, const char* iUser, const char* iPassword, const char* iDatabase, int16 iPort, bool iCompress, bool iSSL) {
+bool DBcore::Open(DBerror &err, const char* iHost, const char* iUser, const char* iPassword, const char* iDatabase, int16 iPort, bool iCompress, bool iSSL, uint32 iConnections) {
     MutexLock lock(MDatabase);
 
     pHost = iHost;
@@ -276,7 +602,7 @@ bool DBcore::Open(DBerror &err, const char* iHost, const char* iUser, const char
     int32 errnum;
     char errbuf[1024];
 
-    if(!Open_locked(&errnum, errbuf)) {
+    if(!Open_locked(iConnections, &errnum, errbuf)) {
         err.SetError(errnum, errbuf);
         return false;
     }
@@ -284,14 +610,37 @@ bool DBcore::Open(DBerror &err, const char* iHost, const char* iUser, const char
     return true;
 }
 
+bool DBcore::Open_locked(uint32 connections, int32* errnum, char* errbuf) {
+    //the pool only grows, threads may already hold a connection
+    while (mConnections.size() < connections)
+        mConnections.push_back(new Connection);
+
+    for(size_t i = 0; i < mConnections.size(); i++) {
+        Connection &conn = *mConnections[i];
+        MutexLock lock(conn.lock);
+
+        if (!Open_locked(conn, errnum, errbuf))
+            return false;
+    }
+
+    //keep the first connection to the opening thread, usually the main loop
+    BindThread_locked(0);
+
+    sLog.Log("dbcore", "Opened %lu connections to the database.", (unsigned long)mConnections.size());
+    return true;
+}
 
-bool DBcore::Open_locked(int32* errnum, char* errbuf) {
+bool DBcore::Open_locked(Connection &conn, int32* errnum, char* errbuf) {
     if (errbuf)
         errbuf[0] = 0;
-    if (GetStatus() == Connected)
+    if (conn.status == Connected)
         return true;
-    if (GetStatus() == Error)
-        mysql_close(&mysql);    //do we need to call init again?
+    if (conn.status == Error) {
+        //the handle is freed by close; get a fresh one
+        conn.CloseStatements();
+        mysql_close(&conn.mysql);
+        mysql_init(&conn.mysql);
+    }
     if (pHost.empty())
         return false;
 
@@ -307,24 +656,24 @@ bool DBcore::Open_locked(int32* errnum, char* errbuf) {
         flags |= CLIENT_COMPRESS;
     if (pSSL)
         flags |= CLIENT_SSL;
-    if (mysql_real_connect(&mysql, pHost.c_str(), pUser.c_str(), pPassword.c_str(), pDatabase.c_str(), pPort, 0, flags)) {
-        pStatus = Connected;
+    if (mysql_real_connect(&conn.mysql, pHost.c_str(), pUser.c_str(), pPassword.c_str(), pDatabase.c_str(), pPort, 0, flags)) {
+        conn.status = Connected;
     } else {
-        pStatus = Error;
+        conn.status = Error;
         if (errnum)
-            *errnum = mysql_errno(&mysql);
+            *errnum = mysql_errno(&conn.mysql);
         if (errbuf)
-            snprintf(errbuf, MYSQL_ERRMSG_SIZE, "#%i: %s", mysql_errno(&mysql), mysql_error(&mysql));
+            snprintf(errbuf, MYSQL_ERRMSG_SIZE, "#%i: %s", mysql_errno(&conn.mysql), mysql_error(&conn.mysql));
         return false;
     }
 
     // Setup character set we wish to use
-    if(mysql_set_character_set(&mysql, "utf8") != 0) {
-        pStatus = Error;
+    if(mysql_set_character_set(&conn.mysql, "utf8") != 0) {
+        conn.status = Error;
         if(errnum)
-            *errnum = mysql_errno(&mysql);
+            *errnum = mysql_errno(&conn.mysql);
         if(errbuf)
-            snprintf(errbuf, MYSQL_ERRMSG_SIZE, "#%i: %s", mysql_errno(&mysql), mysql_error(&mysql));
+            snprintf(errbuf, MYSQL_ERRMSG_SIZE, "#%i: %s", mysql_errno(&conn.mysql), mysql_error(&conn.mysql));
         return false;
     }
 
@@ -351,6 +700,259 @@ void DBerror::ClearError()
     mErrNo = 0;
 }
 
+/************************************************************************/
+/* DBStatement                                                          */
+/************************************************************************/
+DBStatement::DBStatement( const char* sql )
+: mSQL( sql ),
+  mHandle( NULL ),
+  mLock( NULL )
+{
+}
+
+DBStatement::~DBStatement()
+{
+    Free();
+}
+
+void DBStatement::Param( int32 value )
+{
+    AddParam( MYSQL_TYPE_LONG, false ).value.l = value;
+}
+
+void DBStatement::Param( uint32 value )
+{
+    AddParam( MYSQL_TYPE_LONG, true ).value.l = (int32)value;
+}
+
+void DBStatement::Param( int64 value )
+{
+    AddParam( MYSQL_TYPE_LONGLONG, false ).value.ll = value;
+}
+
+void DBStatement::Param( uint64 value )
+{
+    AddParam( MYSQL_TYPE_LONGLONG, true ).value.ll = (int64)value;
+}
+
+void DBStatement::Param( double value )
+{
+    AddParam( MYSQL_TYPE_DOUBLE, false ).value.d = value;
+}
+
+void DBStatement::Param( const std::string& value )
+{
+    AddParam( MYSQL_TYPE_STRING, false ).str = value;
+}
+
+void DBStatement::ParamNull()
+{
+    AddParam( MYSQL_TYPE_NULL, false ).isNull = 1;
+}
+
+void DBStatement::Result( int32& into, bool* isNull )
+{
+    AddResult( MYSQL_TYPE_LONG, false, &into, isNull );
+}
+
+void DBStatement::Result( uint32& into, bool* isNull )
+{
+    AddResult( MYSQL_TYPE_LONG, true, &into, isNull );
+}
+
+void DBStatement::Result( int64& into, bool* isNull )
+{
+    AddResult( MYSQL_TYPE_LONGLONG, false, &into, isNull );
+}
+
+void DBStatement::Result( uint64& into, bool* isNull )
+{
+    AddResult( MYSQL_TYPE_LONGLONG, true, &into, isNull );
+}
+
+void DBStatement::Result( double& into, bool* isNull )
+{
+    AddResult( MYSQL_TYPE_DOUBLE, false, &into, isNull );
+}
+
+void DBStatement::Result( std::string& into, bool* isNull )
+{
+    AddResult( MYSQL_TYPE_STRING, false, &into, isNull );
+}
+
+bool DBStatement::Fetch()
+{
+    if( NULL == mHandle )
+        return false;
+
+    // strings are not bound to a buffer, so they're always reported as truncated
+    int res = mysql_stmt_fetch( mHandle->stmt );
+    if( 0 != res && MYSQL_DATA_TRUNCATED != res )
+    {
+        if( MYSQL_NO_DATA != res )
+        {
+            error.SetError( mysql_stmt_errno( mHandle->stmt ), mysql_stmt_error( mHandle->stmt ) );
+            sLog.Error( "DBCore Statement", "#%d fetching '%s': %s", error.GetErrNo(), mSQL, error.c_str() );
+        }
+
+        Free();
+        return false;
+    }
+
+    // strings are fetched below, any other column must have fit
+    if( MYSQL_DATA_TRUNCATED == res )
+    {
+        for( uint32 i = 0; i < mColumns.size(); ++i )
+        {
+            const Column& col = mColumns[ i ];
+            if( MYSQL_TYPE_STRING == col.type || 0 == col.truncated )
+                continue;
+
+            error.SetError( 0xFFFF, "DBStatement::Fetch: Column truncated" );
+            sLog.Error( "DBCore Statement", "Column %u of '%s' doesn't fit its type.", i, mSQL );
+
+            Free();
+            return false;
+        }
+    }
+
+    for( uint32 i = 0; i < mColumns.size(); ++i )
+    {
+        Column& col = mColumns[ i ];
+        if( NULL != col.isNull )
+            *col.isNull = ( 0 != col.null );
+
+        if( MYSQL_TYPE_STRING == col.type )
+        {
+            std::string& str = *(std::string*)col.into;
+            str.resize( col.null ? 0 : col.length );
+            if( str.empty() )
+                continue;
+
+            MYSQL_BIND bind;
+            memset( &bind, 0, sizeof( bind ) );
+            bind.buffer_type = MYSQL_TYPE_STRING;
+            bind.buffer = &str[ 0 ];
+            bind.buffer_length = col.length;
+
+            if( mysql_stmt_fetch_column( mHandle->stmt, &bind, i, 0 ) )
+            {
+                error.SetError( mysql_stmt_errno( mHandle->stmt ), mysql_stmt_error( mHandle->stmt ) );
+                sLog.Error( "DBCore Statement", "#%d fetching column %u of '%s': %s", error.GetErrNo(), i, mSQL, error.c_str() );
+                str.clear();
+            }
+        }
+        else if( col.null )
+        {
+            memset( col.into, 0, ( MYSQL_TYPE_LONG == col.type ? sizeof( int32 ) : sizeof( int64 ) ) );
+        }
+    }
+
+    return true;
+}
+
+DBStatement::Parameter& DBStatement::AddParam( enum_field_types type, bool isUnsigned )
+{
+    mParams.push_back( Parameter() );
+
+    Parameter& param = mParams.back();
+    param.type = type;
+    param.isUnsigned = isUnsigned;
+    param.value.ll = 0;
+    param.isNull = 0;
+    param.length = 0;
+
+    return param;
+}
+
+void DBStatement::AddResult( enum_field_types type, bool isUnsigned, void* into, bool* isNull )
+{
+    mColumns.push_back( Column() );
+
+    Column& col = mColumns.back();
+    col.type = type;
+    col.isUnsigned = isUnsigned;
+    col.into = into;
+    col.isNull = isNull;
+    col.null = 0;
+    col.truncated = 0;
+    col.length = 0;
+}
+
+void DBStatement::Bind()
+{
+    // vectors don't grow anymore, so pointers into them stay valid
+    mParamBinds.resize( mParams.size() );
+    for( uint32 i = 0; i < mParams.size(); ++i )
+    {
+        Parameter& param = mParams[ i ];
+        MYSQL_BIND& bind = mParamBinds[ i ];
+        memset( &bind, 0, sizeof( bind ) );
+
+        bind.buffer_type = param.type;
+        bind.is_unsigned = param.isUnsigned;
+        bind.is_null = &param.isNull;
+
+        if( MYSQL_TYPE_STRING == param.type )
+        {
+            param.length = (unsigned long)param.str.length();
+            bind.buffer = const_cast<char*>( param.str.c_str() );
+            bind.buffer_length = param.length;
+            bind.length = &param.length;
+        }
+        else
+            bind.buffer = &param.value;
+    }
+
+    mColumnBinds.resize( mColumns.size() );
+    for( uint32 i = 0; i < mColumns.size(); ++i )
+    {
+        Column& col = mColumns[ i ];
+        MYSQL_BIND& bind = mColumnBinds[ i ];
+        memset( &bind, 0, sizeof( bind ) );
+
+        bind.buffer_type = col.type;
+        bind.is_unsigned = col.isUnsigned;
+        bind.is_null = &col.null;
+        bind.error = &col.truncated;
+        bind.length = &col.length;
+
+        // strings are fetched by Fetch once their length is known
+        if( MYSQL_TYPE_STRING != col.type )
+            bind.buffer = col.into;
+    }
+}
+
+void DBStatement::SetHandle( Handle* handle, Mutex* lock )
+{
+    mHandle = handle;
+    mLock = lock;
+}
+
+void DBStatement::Free()
+{
+    if( NULL == mHandle )
+        return;
+
+    mysql_stmt_free_result( mHandle->stmt );
+    Release( mHandle );
+    mHandle = NULL;
+
+    mLock->Unlock();
+    mLock = NULL;
+}
+
+void DBStatement::Release( Handle* handle )
+{
+    handle->busy = false;
+
+    if( handle->detached )
+    {
+        mysql_stmt_close( handle->stmt );
+        delete handle;
+    }
+}
+
 /************************************************************************/
 /* DBQueryResult                                                        */
 /************************************************************************/
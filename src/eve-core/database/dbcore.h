@@ -30,7 +30,9 @@
 //if you can get over the SQL incompatibilities and mysql auto increment problems.
 
 #include "database/dbtype.h"
+#include "threading/MPSCQueue.h"
 #include "threading/Mutex.h"
+#include "threading/WorkerPool.h"
 #include "utils/Singleton.h"
 
 class DBcore;
@@ -48,6 +50,7 @@ public:
 protected:
     //for DBcore:
     friend class DBcore;
+    friend class DBStatement;
     void SetError( uint32 err, const char* str );
     void ClearError();
 
@@ -126,6 +129,142 @@ protected:
     DBQueryResult* mResult;
 };
 
+/*
+ * A statement prepared by the database server. Parameters ('?' in the SQL)
+ * and result columns are bound in order and transferred in binary form,
+ * so nothing needs to be formatted or escaped. The server parses the SQL
+ * once per connection, handles are cached by the SQL text.
+ *
+ *  DBStatement stmt( "SELECT typeID FROM entity WHERE itemID=?" );
+ *  stmt.Param( itemID );
+ *  stmt.Result( typeID );
+ *  if( !sDatabase.RunStatement( stmt ) )
+ *      ... stmt.error ...
+ *  while( stmt.Fetch() )
+ *      ... typeID ...
+ *
+ * The connection stays locked until all rows are fetched or the statement
+ * is destroyed.
+ */
+class DBStatement
+{
+public:
+    DBStatement( const char* sql );
+    ~DBStatement();
+
+    /* error during the statement, if RunStatement or Fetch failed. */
+    DBerror error;
+
+    const char* sql() const { return mSQL; }
+
+    //parameters are copied:
+    void Param( int32 value );
+    void Param( uint32 value );
+    void Param( int64 value );
+    void Param( uint64 value );
+    void Param( double value );
+    void Param( const std::string& value );
+    void ParamNull();
+
+    //results are written into the variables by Fetch; isNull may be NULL,
+    //the variable is zeroed/emptied for NULL columns then.
+    void Result( int32& into, bool* isNull = NULL );
+    void Result( uint32& into, bool* isNull = NULL );
+    void Result( int64& into, bool* isNull = NULL );
+    void Result( uint64& into, bool* isNull = NULL );
+    void Result( double& into, bool* isNull = NULL );
+    void Result( std::string& into, bool* isNull = NULL );
+
+    //fetches next row of the result; false if there is none
+    bool Fetch();
+
+protected:
+    //for DBcore:
+    friend class DBcore;
+
+    struct Parameter
+    {
+        enum_field_types type;
+        bool isUnsigned;
+        union
+        {
+            int32 l;
+            int64 ll;
+            double d;
+        } value;
+        std::string str;
+        my_bool isNull;
+        unsigned long length;
+    };
+
+    struct Column
+    {
+        enum_field_types type;
+        bool isUnsigned;
+        void* into;
+        bool* isNull;
+        my_bool null;
+        my_bool truncated;
+        unsigned long length;
+    };
+
+    //a prepared handle of a connection
+    struct Handle
+    {
+        MYSQL_STMT* stmt;
+        //set while a result is being fetched
+        bool busy;
+        //not (or no longer) cached by its connection, closed once released
+        bool detached;
+    };
+
+    Parameter& AddParam( enum_field_types type, bool isUnsigned );
+    void AddResult( enum_field_types type, bool isUnsigned, void* into, bool* isNull );
+
+    //sets up binds, once no more parameters or results are added:
+    void Bind();
+    //handle has been executed; rows are fetched until Free
+    void SetHandle( Handle* handle, Mutex* lock );
+    //releases handle and connection
+    void Free();
+
+    //marks handle as not busy, closing it if it's detached
+    static void Release( Handle* handle );
+
+    const char* mSQL;
+
+    std::vector<Parameter> mParams;
+    std::vector<MYSQL_BIND> mParamBinds;
+    std::vector<Column> mColumns;
+    std::vector<MYSQL_BIND> mColumnBinds;
+
+    Handle* mHandle;
+    //lock of the connection, held until Free
+    Mutex* mLock;
+};
+
+/*
+ * Completion of an asynchronous query (see DBcore::RunQueryAsync).
+ */
+class DBQueryCompletion
+{
+public:
+    virtual ~DBQueryCompletion() {}
+
+    //called from DBcore::ProcessCompletions; result.error tells what went wrong if !success
+    virtual void Complete(bool success, DBQueryResult &result) = 0;
+};
+
+/*
+ * DBcore keeps a pool of connections to the database server. Each
+ * thread sticks to one of them, so queries of different threads run
+ * concurrently while a thread's queries keep their order and session
+ * state. The first connection is kept to the thread which opened the
+ * database (the main loop), other threads take the least used one of
+ * the rest at their first query, so with enough connections each
+ * worker thread has its own. Connections are reopened automatically
+ * once they are lost.
+ */
 class DBcore
 : public Singleton<DBcore>
 {
@@ -134,7 +273,9 @@ public:
 
     DBcore(bool compress=false, bool ssl=false);
     ~DBcore();
-    eStatus GetStatus() const { return pStatus; }
+    //status of the connection used by calling thread
+    eStatus GetStatus();
+    uint32  GetConnectionCount() const { return (uint32)mConnections.size(); }
 
     //new shorter syntax:
     //query which returns a result (error is stored in the result if it occurs)
@@ -145,6 +286,19 @@ public:
     bool    RunQuery(DBerror &err, uint32 &affected_rows, const char *query_fmt, ...);
     //query which returns last insert ID:
     bool    RunQueryLID(DBerror &err, uint32 &last_insert_id, const char *query_fmt, ...);
+    //prepared statement (error is stored in the statement if it occurs)
+    bool    RunStatement(DBStatement &stmt);
+
+    //query which runs on a database worker; once it's done, completion is
+    //called from ProcessCompletions and deleted. Without running workers,
+    //the query and the completion run right away.
+    void    RunQueryAsync(DBQueryCompletion *completion, const char *query_fmt, ...);
+    //calls completions of finished asynchronous queries; called from the main loop
+    void    ProcessCompletions();
+
+    bool    StartWorkers(uint32 count);
+    //waits for queued asynchronous queries; call ProcessCompletions afterwards
+    void    StopWorkers();
 
     //old style to be used with MakeAnyLengthString
     bool    RunQuery(const char* query, int32 querylen, char* errbuf = 0, MYSQL_RES** result = 0, int32* affected_rows = 0, int32* last_insert_id = 0, int32* errnum = 0, bool retry = true);
@@ -152,23 +306,71 @@ public:
     int32   DoEscapeString(char* tobuf, const char* frombuf, int32 fromlen);
     void    DoEscapeString(std::string &to, const std::string &from);
     static bool IsSafeString(const char *str);
+    //pings idle connections, reopening those which have been lost
     void    ping();
 
 //  static bool ReadDBINI(char *host, char *user, char *pass, char *db, int32 &port, bool &compress, bool *items);
-    bool    Open(const char* iHost, const char* iUser, const char* iPassword, const char* iDatabase, int16 iPort, int32* errnum = 0, char* errbuf = 0, bool iCompress = false, bool iSSL = false);
-    bool    Open(DBerror &err, const char* iHost, const char* iUser, const char* iPassword, const char* iDatabase, int16 iPort, bool iCompress = false, bool iSSL = false);
+    //must be called before other threads start using the database
+    bool    Open(const char* iHost, const char* iUser, const char* iPassword, const char* iDatabase, int16 iPort, int32* errnum = 0, char* errbuf = 0, bool iCompress = false, bool iSSL = false, uint32 iConnections = 1);
+    bool    Open(DBerror &err, const char* iHost, const char* iUser, const char* iPassword, const char* iDatabase, int16 iPort, bool iCompress = false, bool iSSL = false, uint32 iConnections = 1);
 
 protected:
-    MYSQL*  getMySQL(){ return &mysql; }
+    //a connection of the pool
+    struct Connection
+    {
+        Connection();
+        ~Connection();
+
+        //closes prepared statements, before mysql is closed
+        void CloseStatements();
+
+        MYSQL   mysql;
+        //must be locked while using mysql:
+        Mutex   lock;
+        eStatus status;
+        //number of threads using this connection
+        volatile long threads;
+        //prepared statements by their SQL
+        std::map<std::string, DBStatement::Handle*> statements;
+    };
+
+    //connection used by calling thread
+    Connection& GetConnection();
+    MYSQL*  getMySQL(){ return &GetConnection().mysql; }
 
 private:
-    //MDatabase must be locked before these calls:
-    bool    Open_locked(int32* errnum = 0, char* errbuf = 0);
-    bool    DoQuery_locked(DBerror &err, const char *query, int32 querylen, bool retry = true);
-
-    MYSQL   mysql;
+    class AsyncQuery;
+
+    //makes connection index the one of calling thread; MDatabase must be locked
+    void    BindThread_locked(size_t index);
+    //query which returns a result, already formatted
+    bool    DoResultQuery(DBQueryResult &into, const char *query, int32 querylen);
+    //hands a finished asynchronous query to ProcessCompletions; never blocks
+    void    PushCompleted(AsyncQuery *q);
+
+    //MDatabase must be locked before this call:
+    bool    Open_locked(uint32 connections, int32* errnum = 0, char* errbuf = 0);
+    //Connection::lock must be locked before these calls:
+    bool    Open_locked(Connection &conn, int32* errnum = 0, char* errbuf = 0);
+    bool    DoQuery_locked(Connection &conn, DBerror &err, const char *query, int32 querylen, bool retry = true);
+    bool    DoStatement_locked(Connection &conn, DBStatement &stmt, bool retry = true);
+    //returns a prepared handle for sql, from the cache if it's not busy
+    DBStatement::Handle* Prepare_locked(Connection &conn, DBerror &err, const char *sql);
+
+    std::vector<Connection*> mConnections;
+
+    //runs asynchronous queries
+    WorkerPool mWorkers;
+    //finished asynchronous queries, waiting for ProcessCompletions
+    MPSCQueue<AsyncQuery*> mCompleted;
+    //finished asynchronous queries which didn't fit into mCompleted
+    std::queue<AsyncQuery*> mCompletedOverflow;
+    //number of queries in mCompletedOverflow, so it's checked without locking
+    volatile long mCompletedOverflowCount;
+    //protects mCompletedOverflow
+    Mutex   MCompletedOverflow;
+    //protects connection settings and opening
     Mutex   MDatabase;
-    eStatus pStatus;
 
     std::string pHost;
     std::string pUser;
@@ -30,6 +30,9 @@ void Sleep( uint32 x )
 {
     if( 0 < x )
         ::usleep( 1000 * x );
+    else
+        // give up the rest of the time slice, like Windows does
+        ::sched_yield();
 }
 
 uint32 GetTickCount()
@@ -110,6 +110,10 @@
 #   include <inttypes.h>
 #endif /* HAVE_INTTYPES_H */
 
+#ifdef HAVE_SYS_EPOLL_H
+#   include <sys/epoll.h>
+#endif /* HAVE_SYS_EPOLL_H */
+
 #ifdef HAVE_SYS_STAT_H
 #   include <sys/stat.h>
 #else /* !HAVE_SYS_STAT_H */
@@ -132,6 +136,7 @@
 #   include <dirent.h>
 #   include <execinfo.h>
 #   include <pthread.h>
+#   include <sched.h>
 #   include <unistd.h>
 #endif /* !HAVE_WINDOWS_H */
 
@@ -143,6 +148,7 @@
 #   include <arpa/inet.h>
 #   include <netinet/in.h>
 #   include <sys/socket.h>
+#   include <sys/uio.h>
 #endif /* !HAVE_WINSOCK2_H */
 
 #ifndef HAVE_ASINH
@@ -0,0 +1,566 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#include "eve-core.h"
+
+#include "log/LogNew.h"
+#include "network/NetReactor.h"
+
+const uint32 NETREACTOR_EVENT_BATCH = 64;
+const uint32 NETREACTOR_TIMER_GRANULARITY = 1000;
+const uint32 NETREACTOR_DEFAULT_THREAD_COUNT = 4;
+
+#ifndef HAVE_SYS_EPOLL_H
+/** Time (in milliseconds) a select()-based worker waits before rebuilding its socket sets. */
+static const uint32 NETREACTOR_SELECT_GRANULARITY = 5;
+#endif /* !HAVE_SYS_EPOLL_H */
+
+/*************************************************************************/
+/* NetReactor                                                            */
+/*************************************************************************/
+NetReactor::NetReactor()
+{
+}
+
+NetReactor::~NetReactor()
+{
+    Stop();
+}
+
+bool NetReactor::IsRunning() const
+{
+    MutexLock lock( mMWorkers );
+
+    return !mWorkers.empty();
+}
+
+uint32 NetReactor::GetThreadCount() const
+{
+    MutexLock lock( mMWorkers );
+
+    return mWorkers.size();
+}
+
+bool NetReactor::Start( uint32 threadCount )
+{
+    MutexLock lock( mMWorkers );
+
+    if( !mWorkers.empty() )
+        return true;
+
+    if( 0 == threadCount )
+        threadCount = 1;
+
+    for( uint32 i = 0; i < threadCount; ++i )
+    {
+        Worker* worker = new Worker;
+        if( !worker->Start() )
+        {
+            sLog.Error( "NetReactor", "Failed to start I/O thread %u.", i );
+
+            SafeDelete( worker );
+            continue;
+        }
+
+        mWorkers.push_back( worker );
+    }
+
+    if( mWorkers.empty() )
+        return false;
+
+    sLog.Log( "NetReactor", "Started %lu I/O threads.", mWorkers.size() );
+    return true;
+}
+
+void NetReactor::Stop()
+{
+    std::vector< Worker* > workers;
+
+    {
+        MutexLock lock( mMWorkers );
+
+        // Don't keep the lock while waiting for the workers,
+        // their handlers may need it.
+        workers.swap( mWorkers );
+        mRegistry.clear();
+    }
+
+    std::vector< Worker* >::iterator cur, end;
+    cur = workers.begin();
+    end = workers.end();
+    for(; cur != end; ++cur )
+    {
+        (*cur)->Stop();
+        SafeDelete( *cur );
+    }
+
+    // Nobody is dispatched anymore
+    MutexLock lock( mMWorkers );
+
+    std::multimap< NetEventHandler*, Semaphore* >::iterator wcur, wend;
+    wcur = mWaiters.begin();
+    wend = mWaiters.end();
+    for(; wcur != wend; ++wcur )
+        wcur->second->Post();
+
+    mWaiters.clear();
+}
+
+bool NetReactor::Register( Socket* sock, NetEventHandler* handler, uint32 events )
+{
+    if( !IsRunning() && !Start( NETREACTOR_DEFAULT_THREAD_COUNT ) )
+        return false;
+
+    MutexLock lock( mMWorkers );
+
+    if( mWorkers.empty() || mRegistry.find( handler ) != mRegistry.end() )
+        return false;
+
+    // Pick the least loaded worker
+    Worker* worker = mWorkers.front();
+
+    std::vector< Worker* >::const_iterator cur, end;
+    cur = mWorkers.begin();
+    end = mWorkers.end();
+    for(; cur != end; ++cur )
+    {
+        if( (*cur)->GetHandlerCount() < worker->GetHandlerCount() )
+            worker = *cur;
+    }
+
+    if( !worker->Add( sock, handler, events ) )
+        return false;
+
+    mRegistry.insert( std::make_pair( handler, worker ) );
+    return true;
+}
+
+bool NetReactor::Modify( NetEventHandler* handler, uint32 events )
+{
+    MutexLock lock( mMWorkers );
+
+    std::map< NetEventHandler*, Worker* >::const_iterator res = mRegistry.find( handler );
+    if( res == mRegistry.end() )
+        return false;
+
+    return res->second->Modify( handler, events );
+}
+
+void NetReactor::Unregister( NetEventHandler* handler )
+{
+    Worker* worker = NULL;
+
+    {
+        MutexLock lock( mMWorkers );
+
+        std::map< NetEventHandler*, Worker* >::iterator res = mRegistry.find( handler );
+        if( res == mRegistry.end() )
+            return;
+
+        worker = res->second;
+        mRegistry.erase( res );
+    }
+
+    // The handler may be being dispatched right now, so we must not
+    // hold our lock while waiting for the dispatch to finish.
+    worker->Remove( handler );
+
+    MutexLock lock( mMWorkers );
+
+    std::multimap< NetEventHandler*, Semaphore* >::iterator begin, end, cur;
+    begin = mWaiters.lower_bound( handler );
+    end = mWaiters.upper_bound( handler );
+    for( cur = begin; cur != end; ++cur )
+        cur->second->Post();
+
+    mWaiters.erase( begin, end );
+}
+
+bool NetReactor::IsRegistered( NetEventHandler* handler ) const
+{
+    MutexLock lock( mMWorkers );
+
+    return mRegistry.find( handler ) != mRegistry.end();
+}
+
+void NetReactor::WaitUnregistered( NetEventHandler* handler )
+{
+    Semaphore released;
+
+    {
+        MutexLock lock( mMWorkers );
+
+        if( mWorkers.empty() || mRegistry.find( handler ) == mRegistry.end() )
+            return;
+
+        mWaiters.insert( std::make_pair( handler, &released ) );
+    }
+
+    released.Wait();
+}
+
+/*************************************************************************/
+/* NetReactor::Worker                                                    */
+/*************************************************************************/
+NetReactor::Worker::Worker()
+: mRunning( false ),
+  mThreadValid( false )
+{
+#ifdef HAVE_SYS_EPOLL_H
+    mEpoll = ::epoll_create( NETREACTOR_EVENT_BATCH );
+#endif /* HAVE_SYS_EPOLL_H */
+}
+
+NetReactor::Worker::~Worker()
+{
+    Stop();
+
+#ifdef HAVE_SYS_EPOLL_H
+    if( -1 != mEpoll )
+        ::close( mEpoll );
+#endif /* HAVE_SYS_EPOLL_H */
+}
+
+size_t NetReactor::Worker::GetHandlerCount() const
+{
+    MutexLock lock( mMHandlers );
+
+    return mHandlers.size();
+}
+
+bool NetReactor::Worker::Start()
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if( -1 == mEpoll )
+        return false;
+#endif /* HAVE_SYS_EPOLL_H */
+
+    if( mThreadValid )
+        return true;
+
+    mRunning = true;
+
+#ifdef HAVE_WINDOWS_H
+    mThread = CreateThread( NULL, 0, WorkerLoop, this, 0, NULL );
+    mThreadValid = ( NULL != mThread );
+#else /* !HAVE_WINDOWS_H */
+    mThreadValid = ( 0 == pthread_create( &mThread, NULL, WorkerLoop, this ) );
+#endif /* !HAVE_WINDOWS_H */
+
+    if( !mThreadValid )
+        mRunning = false;
+
+    return mThreadValid;
+}
+
+void NetReactor::Worker::Stop()
+{
+    if( !mThreadValid )
+        return;
+
+    // The worker notices within NETREACTOR_TIMER_GRANULARITY
+    mRunning = false;
+
+#ifdef HAVE_WINDOWS_H
+    WaitForSingleObject( mThread, INFINITE );
+    CloseHandle( mThread );
+#else /* !HAVE_WINDOWS_H */
+    pthread_join( mThread, NULL );
+#endif /* !HAVE_WINDOWS_H */
+
+    mThreadValid = false;
+}
+
+bool NetReactor::Worker::Add( Socket* sock, NetEventHandler* handler, uint32 events )
+{
+    MutexLock lock( mMHandlers );
+
+#ifdef HAVE_SYS_EPOLL_H
+    epoll_event ev;
+    memset( &ev, 0, sizeof( ev ) );
+
+    ev.events = ( ( events & NetEventHandler::EVENT_READ ) ? EPOLLIN : 0 )
+              | ( ( events & NetEventHandler::EVENT_WRITE ) ? EPOLLOUT : 0 );
+    ev.data.ptr = handler;
+
+    if( 0 != ::epoll_ctl( mEpoll, EPOLL_CTL_ADD, sock->handle(), &ev ) )
+    {
+        sLog.Error( "NetReactor", "epoll_ctl() failed: %s", strerror( errno ) );
+        return false;
+    }
+#else /* !HAVE_SYS_EPOLL_H */
+    if( FD_SETSIZE <= mHandlers.size() )
+    {
+        sLog.Error( "NetReactor", "Too many sockets per I/O thread (limit is %u).", FD_SETSIZE );
+        return false;
+    }
+#endif /* !HAVE_SYS_EPOLL_H */
+
+    Registration& reg = mHandlers[ handler ];
+    reg.sock = sock;
+    reg.events = events;
+
+    return true;
+}
+
+bool NetReactor::Worker::Modify( NetEventHandler* handler, uint32 events )
+{
+    MutexLock lock( mMHandlers );
+
+    std::map< NetEventHandler*, Registration >::iterator res = mHandlers.find( handler );
+    if( res == mHandlers.end() )
+        return false;
+
+    if( res->second.events == events )
+        return true;
+
+#ifdef HAVE_SYS_EPOLL_H
+    epoll_event ev;
+    memset( &ev, 0, sizeof( ev ) );
+
+    ev.events = ( ( events & NetEventHandler::EVENT_READ ) ? EPOLLIN : 0 )
+              | ( ( events & NetEventHandler::EVENT_WRITE ) ? EPOLLOUT : 0 );
+    ev.data.ptr = handler;
+
+    if( 0 != ::epoll_ctl( mEpoll, EPOLL_CTL_MOD, res->second.sock->handle(), &ev ) )
+    {
+        sLog.Error( "NetReactor", "epoll_ctl() failed: %s", strerror( errno ) );
+        return false;
+    }
+#endif /* HAVE_SYS_EPOLL_H */
+
+    res->second.events = events;
+    return true;
+}
+
+void NetReactor::Worker::Remove( NetEventHandler* handler )
+{
+    // Wait for any dispatch in progress
+    MutexLock dispatchLock( mMDispatch );
+    MutexLock lock( mMHandlers );
+
+    std::map< NetEventHandler*, Registration >::iterator res = mHandlers.find( handler );
+    if( res == mHandlers.end() )
+        return;
+
+#ifdef HAVE_SYS_EPOLL_H
+    // Errors are ignored; the socket may have been closed already,
+    // in which case it has been removed from the set anyway.
+    epoll_event ev;
+    ::epoll_ctl( mEpoll, EPOLL_CTL_DEL, res->second.sock->handle(), &ev );
+#endif /* HAVE_SYS_EPOLL_H */
+
+    mHandlers.erase( res );
+}
+
+void NetReactor::Worker::Run()
+{
+    uint32 nextTimer = GetTickCount() + NETREACTOR_TIMER_GRANULARITY;
+
+#ifdef HAVE_SYS_EPOLL_H
+    std::vector< epoll_event > events( NETREACTOR_EVENT_BATCH );
+#else /* !HAVE_SYS_EPOLL_H */
+    std::vector< std::pair< NetEventHandler*, SOCKET > > sockets;
+    sockets.reserve( FD_SETSIZE );
+#endif /* !HAVE_SYS_EPOLL_H */
+
+    while( mRunning )
+    {
+        const int32 remaining = (int32)( nextTimer - GetTickCount() );
+
+#ifdef HAVE_SYS_EPOLL_H
+        const int count = ::epoll_wait( mEpoll, &events[0], events.size(), 0 < remaining ? remaining : 0 );
+        if( 0 > count && EINTR != errno )
+        {
+            sLog.Error( "NetReactor", "epoll_wait() failed: %s", strerror( errno ) );
+            break;
+        }
+
+        if( 0 < count )
+        {
+            MutexLock lock( mMDispatch );
+
+            for( int i = 0; i < count; ++i )
+            {
+                const uint32 flags = events[i].events;
+
+                // Report errors as both events; the handler
+                // finds out what's wrong once it touches the socket.
+                uint32 ev = 0;
+                if( flags & ( EPOLLIN | EPOLLERR | EPOLLHUP ) )
+                    ev |= NetEventHandler::EVENT_READ;
+                if( flags & ( EPOLLOUT | EPOLLERR | EPOLLHUP ) )
+                    ev |= NetEventHandler::EVENT_WRITE;
+
+                Dispatch( reinterpret_cast< NetEventHandler* >( events[i].data.ptr ), ev );
+            }
+        }
+#else /* !HAVE_SYS_EPOLL_H */
+        fd_set rset, wset, eset;
+        FD_ZERO( &rset );
+        FD_ZERO( &wset );
+        FD_ZERO( &eset );
+
+        SOCKET maxfd = 0;
+        sockets.clear();
+
+        {
+            MutexLock lock( mMHandlers );
+
+            std::map< NetEventHandler*, Registration >::const_iterator cur, end;
+            cur = mHandlers.begin();
+            end = mHandlers.end();
+            for(; cur != end; ++cur )
+            {
+                const SOCKET fd = cur->second.sock->handle();
+
+                if( cur->second.events & NetEventHandler::EVENT_READ )
+                    FD_SET( fd, &rset );
+                if( cur->second.events & NetEventHandler::EVENT_WRITE )
+                    FD_SET( fd, &wset );
+                FD_SET( fd, &eset );
+
+                maxfd = std::max( maxfd, fd );
+                sockets.push_back( std::make_pair( cur->first, fd ) );
+            }
+        }
+
+        timeval tv;
+        tv.tv_sec = 0;
+        tv.tv_usec = 1000 * std::min< int32 >( std::max< int32 >( remaining, 0 ), NETREACTOR_SELECT_GRANULARITY );
+
+        int count = 0;
+        if( sockets.empty() )
+            Sleep( tv.tv_usec / 1000 );
+        else
+            count = ::select( maxfd + 1, &rset, &wset, &eset, &tv );
+
+        if( 0 < count )
+        {
+            MutexLock lock( mMDispatch );
+
+            std::vector< std::pair< NetEventHandler*, SOCKET > >::const_iterator cur, end;
+            cur = sockets.begin();
+            end = sockets.end();
+            for(; cur != end; ++cur )
+            {
+                uint32 ev = 0;
+                if( FD_ISSET( cur->second, &rset ) || FD_ISSET( cur->second, &eset ) )
+                    ev |= NetEventHandler::EVENT_READ;
+                if( FD_ISSET( cur->second, &wset ) || FD_ISSET( cur->second, &eset ) )
+                    ev |= NetEventHandler::EVENT_WRITE;
+
+                if( 0 != ev )
+                    Dispatch( cur->first, ev );
+            }
+        }
+#endif /* !HAVE_SYS_EPOLL_H */
+
+        if( 0 >= (int32)( nextTimer - GetTickCount() ) )
+        {
+            DispatchTimer();
+            nextTimer = GetTickCount() + NETREACTOR_TIMER_GRANULARITY;
+        }
+    }
+}
+
+void NetReactor::Worker::Dispatch( NetEventHandler* handler, uint32 events )
+{
+    {
+        MutexLock lock( mMHandlers );
+
+        // The handler may have been removed by an earlier event
+        // of the same batch.
+        std::map< NetEventHandler*, Registration >::const_iterator res = mHandlers.find( handler );
+        if( res == mHandlers.end() )
+            return;
+
+        events &= res->second.events;
+    }
+
+    if( 0 != events )
+        handler->HandleEvent( events );
+}
+
+void NetReactor::Worker::DispatchTimer()
+{
+    MutexLock dispatchLock( mMDispatch );
+
+    std::vector< NetEventHandler* > handlers;
+
+    {
+        MutexLock lock( mMHandlers );
+
+        handlers.reserve( mHandlers.size() );
+
+        std::map< NetEventHandler*, Registration >::const_iterator cur, end;
+        cur = mHandlers.begin();
+        end = mHandlers.end();
+        for(; cur != end; ++cur )
+            handlers.push_back( cur->first );
+    }
+
+    std::vector< NetEventHandler* >::const_iterator cur, end;
+    cur = handlers.begin();
+    end = handlers.end();
+    for(; cur != end; ++cur )
+    {
+        {
+            MutexLock lock( mMHandlers );
+
+            // Skip handlers removed by previous callbacks
+            if( mHandlers.find( *cur ) == mHandlers.end() )
+                continue;
+        }
+
+        (*cur)->HandleTimer();
+    }
+}
+
+#ifdef HAVE_WINDOWS_H
+DWORD WINAPI NetReactor::Worker::WorkerLoop( LPVOID arg )
+#else /* !HAVE_WINDOWS_H */
+void* NetReactor::Worker::WorkerLoop( void* arg )
+#endif /* !HAVE_WINDOWS_H */
+{
+    Worker* worker = reinterpret_cast< Worker* >( arg );
+    assert( worker != NULL );
+
+#ifdef HAVE_WINDOWS_H
+    SetThreadPriority( GetCurrentThread(), THREAD_PRIORITY_ABOVE_NORMAL );
+#else /* !HAVE_WINDOWS_H */
+    sLog.Log( "Threading", "Starting NetReactor worker with thread ID %d", pthread_self() );
+#endif /* !HAVE_WINDOWS_H */
+
+    worker->Run();
+
+#ifdef HAVE_WINDOWS_H
+    return 0;
+#else /* !HAVE_WINDOWS_H */
+    sLog.Log( "Threading", "Ending NetReactor worker with thread ID %d", pthread_self() );
+
+    return NULL;
+#endif /* !HAVE_WINDOWS_H */
+}
@@ -0,0 +1,262 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#ifndef __NETWORK__NET_REACTOR_H__INCL__
+#define __NETWORK__NET_REACTOR_H__INCL__
+
+#include "network/Socket.h"
+#include "threading/Mutex.h"
+#include "threading/Semaphore.h"
+#include "utils/Singleton.h"
+
+/** Maximal number of events a single I/O thread dispatches per wakeup. */
+extern const uint32 NETREACTOR_EVENT_BATCH;
+/** Time (in milliseconds) between periodical timer callbacks of registered handlers. */
+extern const uint32 NETREACTOR_TIMER_GRANULARITY;
+/** Number of I/O threads started if nobody calls NetReactor::Start explicitly. */
+extern const uint32 NETREACTOR_DEFAULT_THREAD_COUNT;
+
+/**
+ * @brief Interface of an object which wants to be notified about socket events.
+ *
+ * Objects implementing this interface are registered with NetReactor
+ * along with the socket they own. All callbacks are invoked from one
+ * of the reactor's I/O threads.
+ */
+class NetEventHandler
+{
+public:
+    /** Event flags. */
+    enum
+    {
+        EVENT_READ  = 0x01, /**< Socket is readable (or has been closed/reset). */
+        EVENT_WRITE = 0x02  /**< Socket is writable (or asynchronous connect has finished). */
+    };
+
+    virtual ~NetEventHandler() {}
+
+    /**
+     * @brief Called when any of registered events occurs.
+     *
+     * @param[in] events Combination of EVENT_* flags which occurred.
+     */
+    virtual void HandleEvent( uint32 events ) = 0;
+    /**
+     * @brief Called periodically (see NETREACTOR_TIMER_GRANULARITY).
+     *
+     * Used for housekeeping which is not bound to any socket
+     * activity, like connection timeouts.
+     */
+    virtual void HandleTimer() {}
+};
+
+/**
+ * @brief Event-driven dispatcher of socket events.
+ *
+ * Instead of spawning a thread per socket, sockets are registered
+ * with the reactor, which waits for them in a small fixed pool of
+ * I/O threads (epoll on Linux, select elsewhere) and dispatches
+ * the events to the registered handlers. Idle sockets therefore
+ * cost nothing.
+ *
+ * Once NetReactor::Unregister returns, it is guaranteed that the
+ * handler is not being dispatched and won't be dispatched anymore.
+ */
+class NetReactor
+: public Singleton< NetReactor >
+{
+public:
+    /**
+     * @brief Primary constructor; does not start any threads.
+     */
+    NetReactor();
+    /**
+     * @brief Destructor; stops I/O threads.
+     */
+    ~NetReactor();
+
+    /** @return True if I/O threads are running, false if not. */
+    bool IsRunning() const;
+    /** @return Number of running I/O threads. */
+    uint32 GetThreadCount() const;
+
+    /**
+     * @brief Starts I/O threads.
+     *
+     * Does nothing if the reactor is already running.
+     *
+     * @param[in] threadCount Number of I/O threads to start.
+     *
+     * @return True if the reactor is running, false if not.
+     */
+    bool Start( uint32 threadCount );
+    /**
+     * @brief Stops I/O threads.
+     *
+     * Blocks calling thread until all I/O threads terminate,
+     * so it must not be called from within a handler. All handlers
+     * are unregistered.
+     */
+    void Stop();
+
+    /**
+     * @brief Registers a socket with the reactor.
+     *
+     * Starts the reactor with NETREACTOR_DEFAULT_THREAD_COUNT
+     * threads if it is not running yet.
+     *
+     * @param[in] sock    Socket to wait for; must be non-blocking.
+     * @param[in] handler Handler to dispatch the events to.
+     * @param[in] events  Combination of NetEventHandler::EVENT_* flags to wait for.
+     *
+     * @retval true  Registration successful.
+     * @retval false Registration failed.
+     */
+    bool Register( Socket* sock, NetEventHandler* handler, uint32 events );
+    /**
+     * @brief Changes events the handler waits for.
+     *
+     * May be called from any thread.
+     *
+     * @param[in] handler Registered handler.
+     * @param[in] events  Combination of NetEventHandler::EVENT_* flags to wait for.
+     *
+     * @retval true  Modification successful.
+     * @retval false The handler is not registered or modification failed.
+     */
+    bool Modify( NetEventHandler* handler, uint32 events );
+    /**
+     * @brief Unregisters a handler.
+     *
+     * Blocks calling thread until the handler's I/O thread
+     * finishes the current dispatch. It's safe to call this
+     * from within the handler's callback.
+     *
+     * @param[in] handler The handler to unregister.
+     */
+    void Unregister( NetEventHandler* handler );
+
+    /**
+     * @brief Checks whether a handler is registered.
+     *
+     * @param[in] handler The handler to check.
+     *
+     * @retval true  The handler is registered.
+     * @retval false The handler is not registered.
+     */
+    bool IsRegistered( NetEventHandler* handler ) const;
+    /**
+     * @brief Blocks calling thread until a handler is unregistered.
+     *
+     * Returns right away if the handler isn't registered,
+     * and once the reactor stops.
+     *
+     * @param[in] handler The handler to wait for.
+     */
+    void WaitUnregistered( NetEventHandler* handler );
+
+protected:
+    /**
+     * @brief A single I/O thread of the reactor.
+     */
+    class Worker
+    {
+    public:
+        Worker();
+        ~Worker();
+
+        /** @return Count of handlers this worker dispatches. */
+        size_t GetHandlerCount() const;
+
+        bool Start();
+        void Stop();
+
+        bool Add( Socket* sock, NetEventHandler* handler, uint32 events );
+        bool Modify( NetEventHandler* handler, uint32 events );
+        void Remove( NetEventHandler* handler );
+
+    protected:
+        /** Waits for events and dispatches them. */
+        void Run();
+        /** Dispatches single event to given handler, if it's still registered. */
+        void Dispatch( NetEventHandler* handler, uint32 events );
+        /** Dispatches timer callback to all registered handlers. */
+        void DispatchTimer();
+
+#ifdef HAVE_WINDOWS_H
+        static DWORD WINAPI WorkerLoop( LPVOID arg );
+#else /* !HAVE_WINDOWS_H */
+        static void* WorkerLoop( void* arg );
+#endif /* !HAVE_WINDOWS_H */
+
+        /** A registration record. */
+        struct Registration
+        {
+            /** Socket being waited for. */
+            Socket* sock;
+            /** Events being waited for. */
+            uint32 events;
+        };
+
+        /** Held while dispatching events; Remove acquires it to make sure no dispatch is in progress. */
+        Mutex mMDispatch;
+        /** Protects mHandlers; never held while calling a handler. */
+        mutable Mutex mMHandlers;
+        /** Registered handlers. */
+        std::map< NetEventHandler*, Registration > mHandlers;
+
+        /** Set while the worker should run. */
+        volatile bool mRunning;
+#ifdef HAVE_WINDOWS_H
+        /** Handle of the worker thread. */
+        HANDLE mThread;
+#else /* !HAVE_WINDOWS_H */
+        /** The worker thread. */
+        pthread_t mThread;
+#endif /* !HAVE_WINDOWS_H */
+        /** True if mThread is valid. */
+        bool mThreadValid;
+
+#ifdef HAVE_SYS_EPOLL_H
+        /** The epoll instance. */
+        int mEpoll;
+#endif /* HAVE_SYS_EPOLL_H */
+    };
+
+    /** Protects the worker list and the registry. */
+    mutable Mutex mMWorkers;
+    /** The I/O threads. */
+    std::vector< Worker* > mWorkers;
+    /** Maps handlers to workers they've been registered with. */
+    std::map< NetEventHandler*, Worker* > mRegistry;
+    /** Threads blocked in WaitUnregistered, by the handler they wait for. */
+    std::multimap< NetEventHandler*, Semaphore* > mWaiters;
+};
+
+/// A macro for easier access to the singleton.
+#define sNetReactor \
+    ( NetReactor::get() )
+
+#endif /* !__NETWORK__NET_REACTOR_H__INCL__ */
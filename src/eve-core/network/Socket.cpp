@@ -85,6 +85,41 @@ unsigned int Socket::sendto( const void* buf, unsigned int len, int flags, const
     return ::sendto( mSock, (const char*)buf, len, flags, to, tolen );
 }
 
+unsigned int Socket::sendv( const Chunk* chunks, unsigned int count, int flags )
+{
+    assert( count <= SENDV_MAX_CHUNKS );
+
+#ifdef HAVE_WINSOCK2_H
+    WSABUF bufs[ SENDV_MAX_CHUNKS ];
+    for( unsigned int i = 0; i < count; ++i )
+    {
+        bufs[i].buf = (char*)chunks[i].data;
+        bufs[i].len = chunks[i].len;
+    }
+
+    DWORD sent = 0;
+    if( ::WSASend( mSock, bufs, count, &sent, flags, NULL, NULL ) == SOCKET_ERROR )
+        return SOCKET_ERROR;
+
+    return sent;
+#else /* !HAVE_WINSOCK2_H */
+    iovec bufs[ SENDV_MAX_CHUNKS ];
+    for( unsigned int i = 0; i < count; ++i )
+    {
+        bufs[i].iov_base = const_cast< void* >( chunks[i].data );
+        bufs[i].iov_len = chunks[i].len;
+    }
+
+    msghdr msg;
+    memset( &msg, 0, sizeof( msg ) );
+
+    msg.msg_iov = bufs;
+    msg.msg_iovlen = count;
+
+    return ::sendmsg( mSock, &msg, flags );
+#endif /* !HAVE_WINSOCK2_H */
+}
+
 int Socket::bind( const sockaddr* name, unsigned int namelen )
 {
     return ::bind( mSock, name, namelen );
@@ -109,6 +144,15 @@ Socket* Socket::accept( sockaddr* addr, unsigned int* addrlen )
         return NULL;
 }
 
+int Socket::getopt( int level, int optname, void* optval, unsigned int* optlen )
+{
+#ifdef HAVE_WINSOCK2_H
+    return ::getsockopt( mSock, level, optname, (char*)optval, (int*)optlen );
+#else /* !HAVE_WINSOCK2_H */
+    return ::getsockopt( mSock, level, optname, optval, optlen );
+#endif /* !HAVE_WINSOCK2_H */
+}
+
 int Socket::setopt( int level, int optname, const void* optval, unsigned int optlen )
 {
     return ::setsockopt( mSock, level, optname, (const char*)optval, optlen );
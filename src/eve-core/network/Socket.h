@@ -34,6 +34,20 @@
 class Socket
 {
 public:
+    /** Maximal number of chunks accepted by Socket::sendv. */
+    static const unsigned int SENDV_MAX_CHUNKS = 64;
+
+    /**
+     * @brief A chunk of data for vectored send.
+     */
+    struct Chunk
+    {
+        /** Data to be sent. */
+        const void* data;
+        /** Length of the data. */
+        unsigned int len;
+    };
+
     Socket( int af, int type, int protocol );
     ~Socket();
 
@@ -43,12 +57,14 @@ public:
     unsigned int recvfrom( void* buf, unsigned int len, int flags, sockaddr* from, unsigned int* fromlen );
     unsigned int send( const void* buf, unsigned int len, int flags );
     unsigned int sendto( const void* buf, unsigned int len, int flags, const sockaddr* to, unsigned int tolen );
+    unsigned int sendv( const Chunk* chunks, unsigned int count, int flags );
 
     int bind( const sockaddr* name, unsigned int namelen );
     int listen( int backlog = SOMAXCONN );
 
     Socket* accept( sockaddr* addr, unsigned int* addrlen );
 
+    int getopt( int level, int optname, void* optval, unsigned int* optlen );
     int setopt( int level, int optname, const void* optval, unsigned int optlen );
 #ifdef HAVE_WINSOCK2_H
     int ioctl( long cmd, unsigned long* argp );
@@ -56,6 +72,9 @@ public:
     int fcntl( int cmd, long arg );
 #endif /* !HAVE_WINSOCK2_H */
 
+    /** @return The native socket handle. */
+    SOCKET handle() const { return mSock; }
+
 protected:
     Socket( SOCKET sock );
 
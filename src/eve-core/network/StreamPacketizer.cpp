@@ -27,38 +27,161 @@
 
 #include "network/StreamPacketizer.h"
 
+const size_t STREAMPACKETIZER_MIN_WINDOW = 0x1000;
+const size_t STREAMPACKETIZER_MAX_WINDOW = 0x100000;
+
+/** Number of consecutive small inputs after which the ring shrinks. */
+static const uint32 STREAMPACKETIZER_SHRINK_DELAY = 64;
+
+StreamPacketizer::StreamPacketizer()
+: mRing( STREAMPACKETIZER_MIN_WINDOW ),
+  mRingStart( 0 ),
+  mRingSize( 0 ),
+  mWindowSize( 0 ),
+  mIdleInputs( 0 ),
+  mPacket( NULL ),
+  mPacketSize( 0 ),
+  mPacketLength( 0 )
+{
+}
+
 StreamPacketizer::~StreamPacketizer()
 {
     ClearBuffers();
 }
 
-void StreamPacketizer::InputData( const Buffer& data )
+uint8* StreamPacketizer::GetInputWindow( size_t& len )
 {
-    mBuffer.AppendSeq( data.begin<uint8>(), data.end<uint8>() );
+    mWindowSize = 0;
+
+    if( NULL != mPacket )
+    {
+        // Grow the packet as the data arrive
+        if( mPacket->size() == mPacketSize )
+            mPacket->Resize<uint8>( std::min( mPacketLength, 2 * mPacketSize ) );
+
+        len = mPacket->size() - mPacketSize;
+        return &( *mPacket )[ mPacketSize ];
+    }
+
+    // Process() never leaves the ring full
+    assert( mRingSize < mRing.size() );
+
+    const size_t end = ( mRingStart + mRingSize ) & ( mRing.size() - 1 );
+    if( end < mRingStart )
+        len = mRingStart - end;
+    else
+        len = mRing.size() - end;
+
+    mWindowSize = len;
+    return &mRing[ end ];
 }
 
-void StreamPacketizer::Process()
+void StreamPacketizer::CommitInput( size_t len )
+{
+    if( NULL != mPacket )
+    {
+        assert( mPacketSize + len <= mPacket->size() );
+        mPacketSize += len;
+
+        return;
+    }
+
+    assert( len <= mWindowSize );
+    mWindowSize = 0;
+
+    mRingSize += len;
+
+    if( mRing.size() == mRingSize )
+    {
+        // The peer is faster than us, enlarge the window
+        if( mRing.size() < STREAMPACKETIZER_MAX_WINDOW )
+            ResizeRing( 2 * mRing.size() );
+
+        mIdleInputs = 0;
+    }
+    else if( len < mRing.size() / 4 )
+    {
+        // Shrink the window once it's been oversized for a while
+        if( STREAMPACKETIZER_SHRINK_DELAY <= ++mIdleInputs
+            && STREAMPACKETIZER_MIN_WINDOW < mRing.size()
+            && mRingSize < mRing.size() / 4 )
+        {
+            ResizeRing( mRing.size() / 2 );
+
+            mIdleInputs = 0;
+        }
+    }
+    else
+        mIdleInputs = 0;
+}
+
+void StreamPacketizer::InputData( const Buffer& data )
 {
     Buffer::const_iterator<uint8> cur, end;
-    cur = mBuffer.begin<uint8>();
-    end = mBuffer.end<uint8>();
-    while( true )
+    cur = data.begin<uint8>();
+    end = data.end<uint8>();
+    while( cur != end )
     {
-        if( sizeof( uint32 ) > ( end - cur ) )
-            break;
+        size_t len;
+        uint8* window = GetInputWindow( len );
 
-        const Buffer::const_iterator<uint32> len = cur.As<uint32>();
-        const Buffer::const_iterator<uint8> start = ( len + 1 ).As<uint8>();
+        len = std::min< size_t >( len, end - cur );
+        memcpy( window, &*cur, len );
 
-        if( *len > (uint32)( end - start ) )
-            break;
+        CommitInput( len );
+        cur += len;
 
-        mPackets.push( new Buffer( start, start + *len ) );
-        cur = ( start + *len );
+        // Process() makes sure there is space in the ring.
+        Process();
     }
+}
 
-    if( cur != mBuffer.begin<uint8>() )
-        mBuffer.AssignSeq( cur, end );
+void StreamPacketizer::Process()
+{
+    if( NULL != mPacket )
+    {
+        if( mPacketLength != mPacketSize )
+            return;
+
+        mPackets.push( mPacket );
+        mPacket = NULL;
+
+        mPacketSize = mPacketLength = 0;
+    }
+
+    while( sizeof( uint32 ) <= mRingSize )
+    {
+        uint32 len;
+        ReadRing( 0, (uint8*)&len, sizeof( len ) );
+
+        const size_t total = sizeof( uint32 ) + len;
+        if( total <= mRingSize )
+        {
+            // Complete packet
+            Buffer* packet = new Buffer( len );
+            if( 0 < len )
+                ReadRing( sizeof( uint32 ), &( *packet )[ 0 ], len );
+
+            SkipRing( total );
+            mPackets.push( packet );
+        }
+        else if( mRing.size() / 2 < total )
+        {
+            // Too large for the ring, receive the rest straight into the packet
+            mPacketLength = len;
+            mPacketSize = mRingSize - sizeof( uint32 );
+
+            mPacket = new Buffer( std::max( mPacketSize, std::min< size_t >( mPacketLength, STREAMPACKETIZER_MAX_WINDOW ) ) );
+            if( 0 < mPacketSize )
+                ReadRing( sizeof( uint32 ), &( *mPacket )[ 0 ], mPacketSize );
+
+            SkipRing( mRingSize );
+            break;
+        }
+        else
+            break;
+    }
 }
 
 Buffer* StreamPacketizer::PopPacket()
@@ -78,10 +201,46 @@ void StreamPacketizer::ClearBuffers()
     Buffer* buf;
     while( ( buf = PopPacket() ) )
         SafeDelete( buf );
+
+    SafeDelete( mPacket );
+    mPacketSize = mPacketLength = 0;
+
+    mRingStart = mRingSize = 0;
+    mWindowSize = 0;
 }
 
+void StreamPacketizer::ReadRing( size_t offset, uint8* into, size_t len ) const
+{
+    assert( offset + len <= mRingSize );
 
+    const size_t start = ( mRingStart + offset ) & ( mRing.size() - 1 );
+    const size_t first = std::min( len, mRing.size() - start );
 
+    memcpy( into, &mRing[ start ], first );
+    if( first < len )
+        memcpy( into + first, &mRing[ 0 ], len - first );
+}
 
+void StreamPacketizer::SkipRing( size_t len )
+{
+    assert( len <= mRingSize );
 
+    mRingStart = ( mRingStart + len ) & ( mRing.size() - 1 );
+    mRingSize -= len;
 
+    // Keep the free space contiguous
+    if( 0 == mRingSize )
+        mRingStart = 0;
+}
+
+void StreamPacketizer::ResizeRing( size_t size )
+{
+    assert( mRingSize <= size );
+
+    Buffer ring( size );
+    if( 0 < mRingSize )
+        ReadRing( 0, &ring[ 0 ], mRingSize );
+
+    mRing = ring;
+    mRingStart = 0;
+}
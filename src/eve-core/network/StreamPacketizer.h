@@ -28,24 +28,96 @@
 
 #include "utils/Buffer.h"
 
+/** Initial (and minimal) size of the receive window. */
+extern const size_t STREAMPACKETIZER_MIN_WINDOW;
+/** Maximal size of the receive window. */
+extern const size_t STREAMPACKETIZER_MAX_WINDOW;
+
+/**
+ * @brief Splits a stream of length-prefixed packets.
+ *
+ * Incoming data are received directly into a ring buffer owned
+ * by the packetizer (see GetInputWindow/CommitInput), so no
+ * intermediate receive buffer is needed. Small packets are copied
+ * out of the ring once; packets too large for the ring are received
+ * straight into their own Buffer, so the bulk of large packets isn't
+ * copied at all.
+ *
+ * The ring grows while the peer keeps filling it and shrinks back
+ * once the traffic calms down.
+ */
 class StreamPacketizer
 {
 public:
+    StreamPacketizer();
     ~StreamPacketizer();
 
+    /**
+     * @brief Provides memory for incoming data.
+     *
+     * @param[out] len Size of the provided memory.
+     *
+     * @return Pointer to the memory.
+     */
+    uint8* GetInputWindow( size_t& len );
+    /**
+     * @brief Marks data written to the input window as received.
+     *
+     * @param[in] len Number of bytes written; must not exceed the window size.
+     */
+    void CommitInput( size_t len );
+    /**
+     * @brief Copies data into the packetizer.
+     *
+     * @param[in] data The data.
+     */
     void InputData( const Buffer& data );
+    /**
+     * @brief Splits received data into packets.
+     */
     void Process();
 
+    /** @return Size of the receive ring. */
+    size_t GetWindowSize() const { return mRing.size(); }
+
+    /**
+     * @brief Pops a complete packet.
+     *
+     * @return The packet (without length prefix), NULL if there are none.
+     */
     Buffer* PopPacket();
 
     void ClearBuffers();
 
 protected:
-    Buffer mBuffer;
+    /** Copies data out of the ring, taking care of wrapping. */
+    void ReadRing( size_t offset, uint8* into, size_t len ) const;
+    /** Drops data from the ring. */
+    void SkipRing( size_t len );
+    /** Changes size of the ring, keeping its content. */
+    void ResizeRing( size_t size );
+
+    /** The receive ring; its size is always a power of 2. */
+    Buffer mRing;
+    /** Position of the first byte stored in the ring. */
+    size_t mRingStart;
+    /** Number of bytes stored in the ring. */
+    size_t mRingSize;
+
+    /** Size of the last window handed out from the ring; 0 if none. */
+    size_t mWindowSize;
+    /** Number of consecutive inputs which didn't use even a quarter of the ring. */
+    uint32 mIdleInputs;
 
+    /** Large packet being received directly, NULL if none. */
+    Buffer* mPacket;
+    /** Number of bytes of mPacket received so far. */
+    size_t mPacketSize;
+    /** Length of mPacket announced by its prefix; mPacket grows up to it as data arrive. */
+    size_t mPacketLength;
+
+    /** Complete packets. */
     std::queue<Buffer*> mPackets;
 };
 
 #endif /* !__STREAM_PACKETIZER_H__INCL__ */
-
-
@@ -22,7 +22,6 @@
     ------------------------------------------------------------------------------------
     Author:     Zhur
 */
-
 #include "eve-core.h"
 
 #include "log/logsys.h"
@@ -32,17 +31,29 @@
 #include "utils/timer.h"
 
 const uint32 TCPCONN_RECVBUF_SIZE = 0x1000;
-const uint32 TCPCONN_LOOP_GRANULARITY = 5;
+const uint32 TCPCONN_SEND_INBOX_SIZE = 0x400;
+const uint32 TCPCONN_DISCONNECT_TIMEOUT = 10000;
 
 #ifdef HAVE_WINSOCK2_H
 static InitWinsock winsock;
 #endif /* HAVE_WINSOCK2_H */
 
+/** Send statistics of all connections. */
+static TCPConnection::SendStats totalSendStats;
+/** Protection of totalSendStats. */
+static Mutex totalSendStatsLock;
+
 TCPConnection::TCPConnection()
 : mSock( NULL ),
   mSockState( STATE_DISCONNECTED ),
   mrIP( 0 ),
   mrPort( 0 ),
+  mWriteInterest( false ),
+  mDisconnectDeadline( 0 ),
+  mSendInbox( TCPCONN_SEND_INBOX_SIZE ),
+  mSendSignaled( 0 ),
+  mSendOffset( 0 ),
+  mSendStats(),
   mRecvBuf( NULL )
 {
 }
@@ -52,9 +63,15 @@ TCPConnection::TCPConnection( Socket* socket, uint32 mrIP, uint16 mrPort )
   mSockState( STATE_CONNECTED ),
   mrIP( mrIP ),
   mrPort( mrPort ),
+  mWriteInterest( false ),
+  mDisconnectDeadline( 0 ),
+  mSendInbox( TCPCONN_SEND_INBOX_SIZE ),
+  mSendSignaled( 0 ),
+  mSendOffset( 0 ),
+  mSendStats(),
   mRecvBuf( NULL )
 {
-    // Start worker thread
+    // Register with the reactor
     StartLoop();
 }
 
@@ -63,13 +80,30 @@ TCPConnection::~TCPConnection()
     // Make sure we are disconnected
     Disconnect();
 
-    // Wait for loop to stop
+    // Wait for pending data to be sent
     WaitLoop();
 
+    // Close the socket if the reactor didn't do so
+    DoDisconnect();
+
     // Clear buffers
     ClearBuffers();
 }
 
+TCPConnection::SendStats TCPConnection::GetTotalSendStats()
+{
+    MutexLock lock( totalSendStatsLock );
+
+    return totalSendStats;
+}
+
+TCPConnection::SendStats TCPConnection::GetSendStats() const
+{
+    MutexLock lock( mMSock );
+
+    return mSendStats;
+}
+
 std::string TCPConnection::GetAddress()
 {
     /* "The Matrix is a system, 'Neo'. That system is our enemy. But when you're inside, you look around, what do you see?" */
@@ -93,19 +127,7 @@ bool TCPConnection::Connect( uint32 rIP, uint16 rPort, char* errbuf )
 
     MutexLock lock( mMSock );
 
-    state_t oldState = GetState();
-    if( oldState == STATE_DISCONNECTED )
-    {
-        mMSock.Unlock();
-
-        // Wait for working thread to stop.
-        WaitLoop();
-
-        mMSock.Lock();
-    }
-
-    oldState = GetState();
-    if( oldState != STATE_DISCONNECTED && oldState != STATE_CONNECTING )
+    if( GetState() != STATE_DISCONNECTED )
         return false;
 
     mSock = new Socket( AF_INET, SOCK_STREAM, 0 );
@@ -142,11 +164,17 @@ bool TCPConnection::Connect( uint32 rIP, uint16 rPort, char* errbuf )
     mrIP = rIP;
     mrPort = rPort;
 
-    mSockState = STATE_CONNECTED;
+    AtomicStore( mSockState, STATE_CONNECTED );
 
-    // Start processing thread if necessary
-    if( oldState == STATE_DISCONNECTED )
-        StartLoop();
+    // Register with the reactor
+    if( !StartLoop() )
+    {
+        if( errbuf )
+            snprintf( errbuf, TCPCONN_ERRBUF_SIZE, "TCPConnection::Connect(): Failed to register with the reactor." );
+
+        DoDisconnect();
+        return false;
+    }
 
     return true;
 }
@@ -156,28 +184,50 @@ void TCPConnection::AsyncConnect( uint32 rIP, uint16 rPort )
     // Changing state; acquire mutex
     MutexLock lock( mMSock );
 
-    state_t state = GetState();
-    if( state == STATE_DISCONNECTED )
-    {
-        mMSock.Unlock();
+    if( GetState() != STATE_DISCONNECTED )
+        return;
 
-        // Wait for working thread to stop.
-        WaitLoop();
+    mSock = new Socket( AF_INET, SOCK_STREAM, 0 );
 
-        mMSock.Lock();
-    }
+#ifdef HAVE_WINSOCK2_H
+    unsigned long nonblocking = 1;
+    mSock->ioctl( FIONBIO, &nonblocking );
+#else /* !HAVE_WINSOCK2_H */
+    mSock->fcntl( F_SETFL, O_NONBLOCK );
+#endif /* !HAVE_WINSOCK2_H */
 
-    state = GetState();
-    if( state != STATE_DISCONNECTED )
-        return;
+    sockaddr_in server_sin;
+    server_sin.sin_family = AF_INET;
+    server_sin.sin_addr.s_addr = rIP;
+    server_sin.sin_port = htons( rPort );
+
+    // Start connecting; the socket becomes writable once it's done.
+    if( mSock->connect( (sockaddr*)&server_sin, sizeof( server_sin ) ) == SOCKET_ERROR )
+    {
+#ifdef HAVE_WINSOCK2_H
+        if( WSAGetLastError() != WSAEWOULDBLOCK )
+#else /* !HAVE_WINSOCK2_H */
+        if( errno != EINPROGRESS )
+#endif /* !HAVE_WINSOCK2_H */
+        {
+            SafeDelete( mSock );
+            return;
+        }
+    }
 
     mrIP = rIP;
     mrPort = rPort;
 
-    mSockState = STATE_CONNECTING;
+    AtomicStore( mSockState, STATE_CONNECTING );
 
-    // Start processing thread
-    StartLoop();
+    // Register with the reactor
+    if( !StartLoop( EVENT_WRITE ) )
+    {
+        SafeDelete( mSock );
+        mrIP = mrPort = 0;
+
+        AtomicStore( mSockState, STATE_DISCONNECTED );
+    }
 }
 
 void TCPConnection::Disconnect()
@@ -189,7 +239,13 @@ void TCPConnection::Disconnect()
         return;
 
     // Change state
-    mSockState = STATE_DISCONNECTING;
+    AtomicStore( mSockState, STATE_DISCONNECTING );
+    mDisconnectDeadline = GetTickCount() + TCPCONN_DISCONNECT_TIMEOUT;
+
+    // Make the reactor flush the send queue and disconnect; we don't
+    // read anymore, so wait for writability only.
+    if( sNetReactor.Modify( this, EVENT_WRITE ) )
+        mWriteInterest = true;
 }
 
 bool TCPConnection::Send( Buffer** data )
@@ -198,46 +254,117 @@ bool TCPConnection::Send( Buffer** data )
     Buffer* buf = *data;
     *data = NULL;
 
-    // Check we are in STATE_CONNECTED
-    MutexLock sockLock( mMSock );
+    // Nothing to send
+    if( 0 == buf->size() )
+    {
+        SafeDelete( buf );
 
-    state_t state = GetState();
-    if( state != STATE_CONNECTED )
+        return true;
+    }
+
+    // Check we are in STATE_CONNECTED
+    if( GetState() != STATE_CONNECTED )
     {
         SafeDelete( buf );
 
         return false;
     }
 
-    // Push buffer to the send queue
-    MutexLock queueLock( mMSendQueue );
+    // Push buffer to the send inbox
+    while( !mSendInbox.Push( buf ) )
+    {
+        // The inbox is full; empty it ourselves
+        MutexLock sockLock( mMSock );
 
-    mSendQueue.push_back( buf );
-    buf = NULL;
+        DrainSendInbox();
+    }
+
+    // Wake the I/O thread up unless it's been done already
+    if( 0 == AtomicExchange( mSendSignaled, 1 ) )
+    {
+        MutexLock sockLock( mMSock );
+
+        // Wait for the socket to become writable
+        if( GetState() == STATE_CONNECTED )
+            SetWriteInterest( true );
+    }
 
     return true;
 }
 
-void TCPConnection::StartLoop()
+bool TCPConnection::StartLoop( uint32 events )
 {
-    // Spawn new thread
-#ifdef HAVE_WINDOWS_H
-    CreateThread( NULL, 0, TCPConnectionLoop, this, 0, NULL );
-#else /* !HAVE_WINDOWS_H */
-    pthread_t thread;
-    pthread_create( &thread, NULL, TCPConnectionLoop, this );
-#endif /* !HAVE_WINDOWS_H */
+    mWriteInterest = ( 0 != ( events & EVENT_WRITE ) );
+
+    return sNetReactor.Register( mSock, this, events );
 }
 
 void TCPConnection::WaitLoop()
 {
-    // Block calling thread until work thread terminates
-    mMLoopRunning.Lock();
-    mMLoopRunning.Unlock();
+    // Block calling thread until the reactor disconnects us
+    sNetReactor.WaitUnregistered( this );
+
+    // Make sure we won't be dispatched anymore
+    sNetReactor.Unregister( this );
+}
+
+void TCPConnection::SetWriteInterest( bool enable )
+{
+    if( mWriteInterest == enable )
+        return;
+
+    // Unless connected we wait for writability only
+    const uint32 events = ( GetState() == STATE_CONNECTED ? EVENT_READ : 0 )
+                        | ( enable ? EVENT_WRITE : 0 );
+
+    if( sNetReactor.Modify( this, events ) )
+        mWriteInterest = enable;
+}
+
+void TCPConnection::HandleEvent( uint32 events )
+{
+    Process();
+}
+
+void TCPConnection::HandleTimer()
+{
+    char errbuf[ TCPCONN_ERRBUF_SIZE ];
+
+    MutexLock lock( mMSock );
+    switch( GetState() )
+    {
+        case STATE_CONNECTED:
+        {
+            if( !CheckTimeout( errbuf ) )
+            {
+                sLog.Error( "TCPConnection", "%s: %s.", GetAddress().c_str(), errbuf );
+
+                DoDisconnect();
+            }
+        } break;
+
+        case STATE_DISCONNECTING:
+        {
+            if( 0 < (int32)( mDisconnectDeadline - GetTickCount() ) )
+            {
+                // Keep flushing the send queue
+                Process();
+            }
+            else
+            {
+                // The send queue wasn't flushed in time; give up.
+                sLog.Error( "TCPConnection", "%s: Failed to send pending data before disconnect timeout.", GetAddress().c_str() );
+
+                DoDisconnect();
+            }
+        } break;
+
+        default:
+            break;
+    }
 }
 
-/* This is always called from an IO thread. Either the server socket's thread, or a
- * special thread we create when we make an outbound connection. */
+/* This is always called from one of the NetReactor's I/O threads. */
 bool TCPConnection::Process()
 {
     char errbuf[ TCPCONN_ERRBUF_SIZE ];
@@ -254,16 +381,29 @@ bool TCPConnection::Process()
 
         case STATE_CONNECTING:
         {
-            // Connect
-            if( !Connect( GetrIP(), GetrPort(), errbuf ) )
+            // Check outcome of the connect
+            int error = 0;
+            unsigned int len = sizeof( error );
+
+            if( mSock->getopt( SOL_SOCKET, SO_ERROR, &error, &len ) == SOCKET_ERROR )
+                error = -1;
+
+            if( 0 != error )
             {
-                sLog.Error( "TCPConnection", "%s: %s.", GetAddress().c_str(), errbuf );
+                sLog.Error( "TCPConnection", "%s: TCPConnection::Process(): connect() failed. Error: %s.", GetAddress().c_str(), strerror( error ) );
 
                 DoDisconnect();
                 return false;
             }
 
-            // All we had to do is connect, and it succeeded
+            int bufsize = 64 * 1024; // 64kbyte recieve buffer, up from default of 8k
+            mSock->setopt( SOL_SOCKET, SO_RCVBUF, (char*) &bufsize, sizeof( bufsize ) );
+
+            AtomicStore( mSockState, STATE_CONNECTED );
+
+            // Start waiting for incoming data
+            SetWriteInterest( false );
+
             return true;
         }
 
@@ -302,6 +442,16 @@ bool TCPConnection::Process()
                 return false;
             }
 
+            // Pick up whatever has been pushed meanwhile
+            DrainSendInbox();
+
+            // Wait until the socket is writable again
+            if( !mSendQueue.empty() )
+            {
+                SetWriteInterest( true );
+                return true;
+            }
+
             // Send queue is empty, disconnect
             DoDisconnect();
             return true;
@@ -320,14 +470,35 @@ bool TCPConnection::SendData( char* errbuf )
     if( state != STATE_CONNECTED && state != STATE_DISCONNECTING )
         return false;
 
-    mMSendQueue.Lock();
+    // Buffers pushed from now on have to wake us up again
+    AtomicExchange( mSendSignaled, 0 );
+    DrainSendInbox();
+
+    SendStats stats = SendStats();
+    bool error = false;
+
     while( !mSendQueue.empty() )
     {
-        Buffer* buf = mSendQueue.front();
-        mSendQueue.pop_front();
-        mMSendQueue.Unlock();
+        // Gather as much of the queue as possible
+        Socket::Chunk chunks[ Socket::SENDV_MAX_CHUNKS ];
+        unsigned int count = 0;
+        size_t total = 0;
+
+        std::deque<Buffer*>::const_iterator cur, end;
+        cur = mSendQueue.begin();
+        end = mSendQueue.end();
+        for(; cur != end && count < Socket::SENDV_MAX_CHUNKS; ++cur, ++count )
+        {
+            const size_t offset = ( 0 == count ? mSendOffset : 0 );
+
+            chunks[ count ].data = &( **cur )[ offset ];
+            chunks[ count ].len = ( *cur )->size() - offset;
+
+            total += chunks[ count ].len;
+        }
 
-        int status = mSock->send( &(*buf)[ 0 ], buf->size(), MSG_NOSIGNAL );
+        int status = mSock->sendv( chunks, count, MSG_NOSIGNAL );
+        ++stats.sendCalls;
 
         if( status == SOCKET_ERROR )
         {
@@ -349,37 +520,66 @@ bool TCPConnection::SendData( char* errbuf )
                     snprintf( errbuf, TCPCONN_ERRBUF_SIZE, "TCPConnection::SendData(): send(): Errorcode: %s", strerror( errno ) );
 #endif /* !HAVE_WINSOCK2_H */
 
-                SafeDelete( buf );
-                return false;
+                error = true;
+                break;
             }
         }
 
-        if( (size_t)status > buf->size() )
+        if( (size_t)status > total )
         {
             if( errbuf )
                 snprintf( errbuf, TCPCONN_ERRBUF_SIZE, "TCPConnection::SendData(): WTF! status > size." );
 
-            SafeDelete( buf );
-            return false;
+            error = true;
+            break;
         }
-        else if( (size_t)status < buf->size() )
-        {
-            if( status > 0 )
-                buf->AssignSeq( buf->begin<uint8>() + status, buf->end<uint8>() );
 
-            MutexLock queueLock( mMSendQueue );
+        // Drop whatever has been sent completely
+        size_t sent = status;
+        stats.bytes += sent;
 
-            mSendQueue.push_front( buf );
-            buf = NULL;
-        }
-        else
+        while( 0 < sent )
         {
+            Buffer* buf = mSendQueue.front();
+
+            const size_t left = buf->size() - mSendOffset;
+            if( sent < left )
+            {
+                // Partial write, remember where to continue
+                mSendOffset += sent;
+                break;
+            }
+
+            sent -= left;
+            mSendOffset = 0;
+
+            mSendQueue.pop_front();
             SafeDelete( buf );
+
+            ++stats.packets;
         }
 
-        mMSendQueue.Lock();
+        // The socket is full, wait until it's writable again
+        if( (size_t)status < total )
+            break;
     }
-    mMSendQueue.Unlock();
+
+    mSendStats.sendCalls += stats.sendCalls;
+    mSendStats.packets += stats.packets;
+    mSendStats.bytes += stats.bytes;
+
+    {
+        MutexLock lock( totalSendStatsLock );
+
+        totalSendStats.sendCalls += stats.sendCalls;
+        totalSendStats.packets += stats.packets;
+        totalSendStats.bytes += stats.bytes;
+    }
+
+    if( error )
+        return false;
+
+    SetWriteInterest( !mSendQueue.empty() );
 
     return true;
 }
@@ -397,18 +597,14 @@ bool TCPConnection::RecvData( char* errbuf )
 
     while( true )
     {
-        if( mRecvBuf == NULL )
-            mRecvBuf = new Buffer( TCPCONN_RECVBUF_SIZE );
-        else if( mRecvBuf->size() < TCPCONN_RECVBUF_SIZE )
-            mRecvBuf->Resize<uint8>( TCPCONN_RECVBUF_SIZE );
+        size_t len;
+        uint8* window = GetRecvWindow( len );
 
-        int status = mSock->recv( &(*mRecvBuf)[ 0 ], mRecvBuf->size(), 0 );
+        int status = mSock->recv( window, len, 0 );
 
         if( status > 0 )
         {
-            mRecvBuf->Resize<uint8>( status );
-
-            if( !ProcessReceivedData( errbuf ) )
+            if( !ProcessReceivedData( status, errbuf ) )
                 return false;
         }
         else if( status == 0 )
@@ -442,24 +638,56 @@ bool TCPConnection::RecvData( char* errbuf )
     }
 }
 
+uint8* TCPConnection::GetRecvWindow( size_t& len )
+{
+    if( mRecvBuf == NULL )
+        mRecvBuf = new Buffer( TCPCONN_RECVBUF_SIZE );
+
+    len = mRecvBuf->size();
+    return &(*mRecvBuf)[ 0 ];
+}
+
+bool TCPConnection::CheckTimeout( char* errbuf )
+{
+    return true;
+}
+
 void TCPConnection::DoDisconnect()
 {
+    // Stop dispatching before the socket goes away. I/O threads lock
+    // mMSock while dispatching, so we must not hold it while waiting
+    // for the dispatch to finish.
+    sNetReactor.Unregister( this );
+
     MutexLock lock( mMSock );
 
-    state_t state = GetState();
-    if( state != STATE_CONNECTED && state != STATE_DISCONNECTING )
+    if( GetState() == STATE_DISCONNECTED )
         return;
 
+    mWriteInterest = false;
+
+    sLog.Debug( "TCPConnection", "%s: Sent %" PRIu64 " packets (%" PRIu64 " bytes) in %" PRIu64 " send calls.",
+                GetAddress().c_str(), mSendStats.packets, mSendStats.bytes, mSendStats.sendCalls );
+
     SafeDelete( mSock );
-    mrIP = mrPort = 0;
+    // Derived classes may want to know the address in ClearBuffers
     ClearBuffers();
+    mrIP = mrPort = 0;
+
+    AtomicStore( mSockState, STATE_DISCONNECTED );
+}
 
-    mSockState = STATE_DISCONNECTED;
+void TCPConnection::DrainSendInbox()
+{
+    Buffer* buf;
+    while( mSendInbox.Pop( buf ) )
+        mSendQueue.push_back( buf );
 }
 
 void TCPConnection::ClearBuffers()
 {
-    MutexLock lock( mMSendQueue );
+    DrainSendInbox();
+    AtomicStore( mSendSignaled, 0L );
 
     while( !mSendQueue.empty() )
     {
@@ -468,60 +696,7 @@ void TCPConnection::ClearBuffers()
 
         SafeDelete( buf );
     }
+    mSendOffset = 0;
 
     SafeDelete( mRecvBuf );
 }
-
-#ifdef HAVE_WINDOWS_H
-DWORD WINAPI TCPConnection::TCPConnectionLoop( LPVOID arg )
-#else /* !HAVE_WINDOWS_H */
-void* TCPConnection::TCPConnectionLoop( void* arg )
-#endif /* !HAVE_WINDOWS_H */
-{
-    TCPConnection* tcpc = reinterpret_cast< TCPConnection* >( arg );
-    assert( tcpc != NULL );
-
-    tcpc->TCPConnectionLoop();
-
-#ifdef HAVE_WINDOWS_H
-    return 0;
-#else /* !HAVE_WINDOWS_H */
-    return NULL;
-#endif /* !HAVE_WINDOWS_H */
-}
-
-void TCPConnection::TCPConnectionLoop()
-{
-#ifdef HAVE_WINDOWS_H
-    SetThreadPriority( GetCurrentThread(), THREAD_PRIORITY_ABOVE_NORMAL );
-#endif /* HAVE_WINDOWS_H */
-
-#ifndef HAVE_WINDOWS_H
-    sLog.Log( "Threading", "Starting TCPConnectionLoop with thread ID %d", pthread_self() );
-#endif /* !HAVE_WINDOWS_H */
-
-    mMLoopRunning.Lock();
-
-    uint32 start = GetTickCount();
-    uint32 etime;
-    uint32 last_time;
-
-    while( Process() )
-    {
-        /* UPDATE */
-        last_time = GetTickCount();
-        etime = last_time - start;
-
-        // do the stuff for thread sleeping
-        if( TCPCONN_LOOP_GRANULARITY > etime )
-            Sleep( TCPCONN_LOOP_GRANULARITY - etime );
-
-        start = GetTickCount();
-    }
-
-    mMLoopRunning.Unlock();
-
-#ifndef HAVE_WINDOWS_H
-    sLog.Log( "Threading", "Ending TCPConnectionLoop with thread ID %d", pthread_self() );
-#endif /* !HAVE_WINDOWS_H */
-}
@@ -26,7 +26,9 @@
 #ifndef __NETWORK__TCP_CONNECTION_H__INCL__
 #define __NETWORK__TCP_CONNECTION_H__INCL__
 
+#include "network/NetReactor.h"
 #include "network/Socket.h"
+#include "threading/MPSCQueue.h"
 #include "threading/Mutex.h"
 #include "utils/Buffer.h"
 
@@ -34,15 +36,22 @@
 static const uint32 TCPCONN_ERRBUF_SIZE = 1024;
 /** Size of receive buffer TCPConnection uses. */
 extern const uint32 TCPCONN_RECVBUF_SIZE;
-/** Time (in milliseconds) between periodical process for incoming/outgoing data. */
-extern const uint32 TCPCONN_LOOP_GRANULARITY;
+/** Number of buffers which may wait to be picked up by the I/O thread. */
+extern const uint32 TCPCONN_SEND_INBOX_SIZE;
+/** Time (in milliseconds) a disconnecting connection may spend sending pending data. */
+extern const uint32 TCPCONN_DISCONNECT_TIMEOUT;
 
 /**
  * @brief Generic class for TCP connections.
  *
+ * Connections don't own any thread; they are registered with
+ * NetReactor, which processes them whenever their socket
+ * becomes readable or writable.
+ *
  * @author Zhur, Bloody.Rabbit
  */
 class TCPConnection
+: protected NetEventHandler
 {
 public:
     /** Describes all states this object may be in. */
@@ -54,6 +63,25 @@ public:
         STATE_DISCONNECTING /**< Disconnect pending, waiting for all data to be sent. */
     };
 
+    /**
+     * @brief Statistics of outgoing traffic.
+     *
+     * Comparing sendCalls to packets tells how well the queued
+     * packets are coalesced into vectored sends.
+     */
+    struct SendStats
+    {
+        /** Number of send system calls issued. */
+        uint64 sendCalls;
+        /** Number of packets (queued buffers) completely sent. */
+        uint64 packets;
+        /** Number of bytes sent. */
+        uint64 bytes;
+    };
+
+    /** @return Send statistics accumulated over all connections. */
+    static SendStats GetTotalSendStats();
+
     /**
      * @brief Creates new connection in STATE_DISCONNECTED.
      */
@@ -74,7 +102,9 @@ public:
      */
     std::string GetAddress();
     /** @return Current state of connection. */
-    state_t GetState() const { return mSockState; }
+    state_t GetState() const { return AtomicLoad( mSockState ); }
+    /** @return Send statistics of this connection. */
+    SendStats GetSendStats() const;
 
     /**
      * @brief Connects to specified address.
@@ -95,7 +125,8 @@ public:
      *
      * This function does asynchronous connect, ie. does not block
      * calling thread at all. However, result of connect is not
-     * known immediately.
+     * known immediately; it's checked by NetReactor once the
+     * socket becomes writable.
      *
      * @param[in] rIP   Target remote IP address.
      * @param[in] rPort Target remote TCP port.
@@ -106,13 +137,17 @@ public:
      *
      * Connection will be closed as soon as possible. Note that
      * this may take some time since we wait for emptying send
-     * queue before actually disconnecting.
+     * queue before actually disconnecting; if it doesn't empty
+     * within TCPCONN_DISCONNECT_TIMEOUT, pending data are dropped.
      */
-    void Disconnect();
+    virtual void Disconnect();
 
     /**
      * @brief Enqueues data to be sent.
      *
+     * Doesn't lock anything unless the I/O thread has to be woken
+     * up or the send inbox is full; may be called from any thread.
+     *
      * @param[in] data Buffer with data; pointer is invalidated by the function.
      *
      * @return True if data has been accepted, false if not.
@@ -130,39 +165,88 @@ protected:
     TCPConnection( Socket* sock, uint32 rIP, uint16 rPort );
 
     /**
-     * @brief Starts working thread.
+     * @brief Registers the socket with NetReactor.
      *
-     * This function just starts a thread, does not check
-     * whether there is already one running!
+     * @param[in] events Combination of NetEventHandler::EVENT_* flags to wait for.
+     *
+     * @return True if registration succeeded, false if not.
      */
-    void StartLoop();
+    bool StartLoop( uint32 events = EVENT_READ );
     /**
-     * @brief Blocks calling thread until working thread terminates.
+     * @brief Blocks calling thread until the connection is unregistered from NetReactor.
      */
     void WaitLoop();
 
+    /**
+     * @brief Enables or disables waiting for the socket to become writable.
+     *
+     * The caller must hold mMSock.
+     *
+     * @param[in] enable True if we have data to send, false if not.
+     */
+    void SetWriteInterest( bool enable );
+
+    /**
+     * @brief Called by NetReactor when the socket is ready.
+     *
+     * @param[in] events Combination of EVENT_* flags which occurred.
+     */
+    void HandleEvent( uint32 events );
+    /**
+     * @brief Called periodically by NetReactor.
+     */
+    void HandleTimer();
+
     /**
      * @brief Does all stuff that needs to be periodically done to keep connection alive.
      *
      * @return True if connection should be further processed, false if not (eg. error, disconnected).
      */
     virtual bool Process();
+    /**
+     * @brief Provides memory the received data are stored to.
+     *
+     * Default implementation returns receive buffer mRecvBuf;
+     * children may override this to receive data directly
+     * into their own storage.
+     *
+     * @param[out] len Size of the provided memory.
+     *
+     * @return Pointer to the memory.
+     */
+    virtual uint8* GetRecvWindow( size_t& len );
     /**
      * @brief Processes received data.
      *
      * This function must be overloaded by children to process received data.
-     * Called every time a chunk of new data is received. Please note that
-     * receive buffer is overwritten every time data is received.
+     * Called every time a chunk of new data is received into the memory
+     * provided by GetRecvWindow. Please note that the default receive
+     * buffer is overwritten every time data is received.
      *
+     * @param[in]  len    Number of bytes received.
      * @param[out] errbuf Buffer which receives description of error.
      *
      * @return True if processing ran fine, false if not.
      */
-    virtual bool ProcessReceivedData( char* errbuf = 0 ) = 0;
+    virtual bool ProcessReceivedData( size_t len, char* errbuf = 0 ) = 0;
+    /**
+     * @brief Checks whether the connection timed out.
+     *
+     * Called periodically (see NETREACTOR_TIMER_GRANULARITY)
+     * while connected; default implementation never times out.
+     *
+     * @param[out] errbuf Buffer which receives description of error.
+     *
+     * @return True if the connection is alive, false if it timed out.
+     */
+    virtual bool CheckTimeout( char* errbuf = 0 );
 
     /**
      * @brief Sends data in send queue.
      *
+     * Queued buffers are gathered into a single vectored send,
+     * so a burst of small packets costs just one system call.
+     *
      * @param[out] errbuf Buffer which receives desription of error.
      *
      * @return True if send was OK, false if not.
@@ -178,50 +262,51 @@ protected:
     virtual bool RecvData( char* errbuf = 0 );
     /**
      * @brief Disconnects socket.
+     *
+     * Unregisters from NetReactor first, which waits for a dispatch
+     * in progress. The caller must not hold mMSock therefore, unless
+     * it's the I/O thread dispatching this connection or the
+     * connection isn't registered.
      */
     void DoDisconnect();
 
     /**
-     * @brief Clears send and receive buffers.
-     */
-    virtual void ClearBuffers();
-
-    /**
-     * @brief Loop for worker threads.
-     *
-     * This function just casts given arg into TCPConnection and calls
-     * member TCPConnectionLoop.
+     * @brief Moves buffers from the send inbox to the send queue.
      *
-     * @param[in] arg Pointer to TCPConnection.
+     * The caller must hold mMSock.
      */
-#ifdef HAVE_WINDOWS_H
-    static DWORD WINAPI TCPConnectionLoop( LPVOID arg );
-#else /* !HAVE_WINDOWS_H */
-    static void* TCPConnectionLoop( void* arg );
-#endif /* !HAVE_WINDOWS_H */
+    void DrainSendInbox();
     /**
-     * @brief Loop for worker threads.
+     * @brief Clears send and receive buffers.
      */
-    void TCPConnectionLoop();
+    virtual void ClearBuffers();
 
     /** Protection of socket and associated variables. */
     mutable Mutex mMSock;
     /** Socket for connection. */
     Socket* mSock;
-    /** State the socket is in. */
-    state_t mSockState;
+    /** State the socket is in; written under mMSock. */
+    volatile state_t mSockState;
     /** Remote IP the socket is connected to. */
     uint32 mrIP;
     /** Remote TCP port the socket is connected to; is in host byte order. */
     uint16 mrPort;
 
-    /** When a thread is running TCPConnectionLoop, it acquires this mutex first; used for synchronization. */
-    mutable Mutex mMLoopRunning;
+    /** True if we wait for the socket to become writable; protected by mMSock. */
+    bool mWriteInterest;
+    /** Time (GetTickCount) the send queue must be flushed by while disconnecting; protected by mMSock. */
+    uint32 mDisconnectDeadline;
 
-    /** Mutex protecting send queue. */
-    mutable Mutex mMSendQueue;
-    /** Send queue. */
+    /** Buffers pushed by Send; the holder of mMSock pops them. */
+    MPSCQueue<Buffer*> mSendInbox;
+    /** Nonzero if the I/O thread has been told about buffers in the inbox. */
+    volatile long mSendSignaled;
+    /** Send queue; protected by mMSock. */
     std::deque<Buffer*> mSendQueue;
+    /** Number of bytes of the front buffer in send queue which have already been sent. */
+    size_t mSendOffset;
+    /** Send statistics; protected by mMSock. */
+    SendStats mSendStats;
 
     /** Receive buffer. */
     Buffer* mRecvBuf;
@@ -29,7 +29,7 @@
 #include "log/LogNew.h"
 
 const uint32 TCPSRV_ERRBUF_SIZE = 1024;
-const uint32 TCPSRV_LOOP_GRANULARITY = 5;
+const uint32 TCPSRV_QUEUE_SIZE = 0x100;
 
 BaseTCPServer::BaseTCPServer()
 : mSock( NULL ),
@@ -41,9 +41,6 @@ BaseTCPServer::~BaseTCPServer()
 {
     // Close socket
     Close();
-
-    // Wait until worker thread terminates
-    WaitLoop();
 }
 
 bool BaseTCPServer::IsOpen() const
@@ -71,15 +68,6 @@ bool BaseTCPServer::Open( uint16 port, char* errbuf )
             snprintf( errbuf, TCPSRV_ERRBUF_SIZE, "Listening socket already open" );
         return false;
     }
-    else
-    {
-        mMSock.Unlock();
-
-        // Wait for thread to terminate
-        WaitLoop();
-
-        mMSock.Lock();
-    }
 
     // Setting up TCP port for new TCP connections
     mSock = new Socket( AF_INET, SOCK_STREAM, 0 );
@@ -131,37 +119,46 @@ bool BaseTCPServer::Open( uint16 port, char* errbuf )
         return false;
     }
 
-    mPort = port;
+    // Register with the reactor
+    if( !StartLoop() )
+    {
+        if( errbuf != NULL )
+            snprintf( errbuf, TCPSRV_ERRBUF_SIZE, "Failed to register with the reactor" );
 
-    // Start processing thread
-    StartLoop();
+        SafeDelete( mSock );
+        return false;
+    }
+
+    mPort = port;
 
     return true;
 }
 
 void BaseTCPServer::Close()
 {
+    // Stop accepting; must be done before locking the socket,
+    // since the reactor locks it while accepting.
+    WaitLoop();
+
     MutexLock lock( mMSock );
 
     SafeDelete( mSock );
     mPort = 0;
 }
 
-void BaseTCPServer::StartLoop()
+bool BaseTCPServer::StartLoop()
 {
-#ifdef HAVE_WINDOWS_H
-    CreateThread( NULL, 0, TCPServerLoop, this, 0, NULL );
-#else /* !HAVE_WINDOWS_H */
-    pthread_t thread;
-    pthread_create( &thread, NULL, TCPServerLoop, this );
-#endif /* !HAVE_WINDOWS_H */
+    return sNetReactor.Register( mSock, this, EVENT_READ );
 }
 
 void BaseTCPServer::WaitLoop()
 {
-    //wait for loop to stop.
-    mMLoopRunning.Lock();
-    mMLoopRunning.Unlock();
+    sNetReactor.Unregister( this );
+}
+
+void BaseTCPServer::HandleEvent( uint32 events )
+{
+    Process();
 }
 
 bool BaseTCPServer::Process()
@@ -203,57 +200,3 @@ void BaseTCPServer::ListenNewConnections()
         CreateNewConnection( sock, from.sin_addr.s_addr, ntohs( from.sin_port ) );
     }
 }
-
-#ifdef HAVE_WINDOWS_H
-DWORD WINAPI BaseTCPServer::TCPServerLoop( LPVOID arg )
-#else /* !HAVE_WINDOWS_H */
-void* BaseTCPServer::TCPServerLoop( void* arg )
-#endif /* !HAVE_WINDOWS_H */
-{
-    BaseTCPServer* tcps = reinterpret_cast< BaseTCPServer* >( arg );
-    assert( tcps != NULL );
-
-    tcps->TCPServerLoop();
-
-#ifdef HAVE_WINDOWS_H
-    return 0;
-#else /* !HAVE_WINDOWS_H */
-    return NULL;
-#endif /* !HAVE_WINDOWS_H */
-}
-
-void BaseTCPServer::TCPServerLoop()
-{
-#ifdef HAVE_WINDOWS_H
-    SetThreadPriority( GetCurrentThread(), THREAD_PRIORITY_ABOVE_NORMAL );
-#endif /* HAVE_WINDOWS_H */
-
-#ifndef HAVE_WINDOWS_H
-    sLog.Log( "Threading", "Starting TCPServerLoop with thread ID %d", pthread_self() );
-#endif /* !HAVE_WINDOWS_H */
-
-    mMLoopRunning.Lock();
-
-    uint32 start = GetTickCount();
-    uint32 etime;
-    uint32 last_time;
-
-    while( Process() )
-    {
-        /* UPDATE */
-        last_time = GetTickCount();
-        etime = last_time - start;
-
-        // do the stuff for thread sleeping
-        if( TCPSRV_LOOP_GRANULARITY > etime )
-            Sleep( TCPSRV_LOOP_GRANULARITY - etime );
-
-        start = GetTickCount();
-    }
-
-    mMLoopRunning.Unlock();
-
-#ifndef HAVE_WINDOWS_H
-    sLog.Log( "Threading", "Ending TCPServerLoop with thread ID %d", pthread_self() );
-#endif /* !HAVE_WINDOWS_H */
-}
@@ -26,20 +26,26 @@
 #ifndef __NETWORK__TCP_SERVER_H__INCL__
 #define __NETWORK__TCP_SERVER_H__INCL__
 
+#include "network/NetReactor.h"
 #include "network/Socket.h"
+#include "threading/MPSCQueue.h"
 #include "threading/Mutex.h"
 
 /** Size of error buffer BaseTCPServer uses. */
 extern const uint32 TCPSRV_ERRBUF_SIZE;
-/** Time (in milliseconds) between periodical checks of socket for new connections. */
-extern const uint32 TCPSRV_LOOP_GRANULARITY;
+/** Number of accepted connections which may wait to be popped. */
+extern const uint32 TCPSRV_QUEUE_SIZE;
 
 /**
  * @brief Generic class for TCP server.
  *
+ * The listening socket is registered with NetReactor, which
+ * accepts new connections as soon as they arrive.
+ *
  * @author Zhur, Bloody.Rabbit
  */
 class BaseTCPServer
+: protected NetEventHandler
 {
 public:
     /**
@@ -72,17 +78,25 @@ public:
 
 protected:
     /**
-     * @brief Starts worker thread.
+     * @brief Registers the listening socket with NetReactor.
      *
-     * This function just starts worker thread; it doesn't check
-     * whether there already is one running!
+     * @return True if registration succeeded, false if not.
      */
-    void StartLoop();
+    bool StartLoop();
     /**
-     * @brief Waits for worker thread to terminate.
+     * @brief Unregisters the listening socket from NetReactor.
+     *
+     * Once this function returns, no new connections are accepted.
      */
     void WaitLoop();
 
+    /**
+     * @brief Called by NetReactor when there are new connections pending.
+     *
+     * @param[in] events Combination of EVENT_* flags which occurred.
+     */
+    void HandleEvent( uint32 events );
+
     /**
      * @brief Does periodical stuff to keep the server alive.
      *
@@ -102,33 +116,12 @@ protected:
      */
     virtual void CreateNewConnection( Socket* sock, uint32 rIP, uint16 rPort ) = 0;
 
-    /**
-     * @brief Loop for worker threads.
-     *
-     * This function only casts arg to BaseTCPServer and calls
-     * member TCPServerLoop().
-     *
-     * @param[in] arg Pointer to BaseTCPServer.
-     */
-#ifdef HAVE_WINDOWS_H
-    static DWORD WINAPI TCPServerLoop( LPVOID arg );
-#else /* !HAVE_WINDOWS_H */
-    static void* TCPServerLoop( void* arg );
-#endif /* !HAVE_WINDOWS_H */
-    /**
-     * @brief Loop for worker threads.
-     */
-    void TCPServerLoop();
-
     /** Mutex to protect socket and associated variables. */
     mutable Mutex mMSock;
     /** Socket used for listening. */
     Socket* mSock;
     /** Port the socket is listening on. */
     uint16 mPort;
-
-    /** Worker thread acquires this mutex before it starts processing; used for thread synchronization. */
-    mutable Mutex mMLoopRunning;
 };
 
 /**
@@ -140,12 +133,20 @@ template<typename X>
 class TCPServer : public BaseTCPServer
 {
 public:
+    /**
+     * @brief Creates empty TCP server.
+     */
+    TCPServer()
+    : mQueue( TCPSRV_QUEUE_SIZE )
+    {
+    }
     /**
      * @brief Deletes all stored connections.
      */
     ~TCPServer()
     {
-        MutexLock lock( mMQueue );
+        // Make sure nothing is being added
+        Close();
 
         X* conn;
         while( ( conn = PopConnection() ) )
@@ -155,18 +156,14 @@ public:
     /**
      * @brief Pops connection from queue.
      *
+     * Only one thread may pop connections.
+     *
      * @return Popped connection.
      */
     X* PopConnection()
     {
-        MutexLock lock( mMQueue );
-
         X* ret = NULL;
-        if( !mQueue.empty() )
-        {
-            ret = mQueue.front();
-            mQueue.pop();
-        }
+        mQueue.Pop( ret );
 
         return ret;
     }
@@ -175,19 +172,18 @@ protected:
     /**
      * @brief Adds connection to the queue.
      *
+     * Waits for the queue to have room if it's full.
+     *
      * @param[in] con Connection to be added to the queue.
      */
     void AddConnection( X* con )
     {
-        MutexLock lock( mMQueue );
-
-        mQueue.push( con );
+        while( !mQueue.Push( con ) )
+            Sleep( 1 );
     }
 
-    /** Mutex to protect connection queue. */
-    Mutex mMQueue;
     /** Connection queue. */
-    std::queue<X*> mQueue;
+    MPSCQueue<X*> mQueue;
 };
 
 #endif /* !__NETWORK__TCP_SERVER_H__INCL__ */
@@ -0,0 +1,134 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#ifndef __THREADING__ATOMIC_H__INCL__
+#define __THREADING__ATOMIC_H__INCL__
+
+/*
+ * Atomic operations on word-sized variables (integers, pointers).
+ *
+ * Loads have acquire and stores have release semantics, so
+ * whatever a thread wrote before storing a variable is visible
+ * to the thread which loads the stored value. Read-modify-write
+ * operations are full barriers.
+ */
+
+/**
+ * @brief Atomically reads a variable.
+ *
+ * @param[in] var The variable.
+ *
+ * @return Value of the variable.
+ */
+template< typename T >
+inline T AtomicLoad( const volatile T& var )
+{
+#ifdef HAVE_WINDOWS_H
+    // volatile reads have acquire semantics with MSVC
+    const T value = var;
+    _ReadWriteBarrier();
+    return value;
+#else /* !HAVE_WINDOWS_H */
+    return __atomic_load_n( &var, __ATOMIC_ACQUIRE );
+#endif /* !HAVE_WINDOWS_H */
+}
+
+/**
+ * @brief Atomically writes a variable.
+ *
+ * @param[in] var   The variable.
+ * @param[in] value Value to write.
+ */
+template< typename T >
+inline void AtomicStore( volatile T& var, T value )
+{
+#ifdef HAVE_WINDOWS_H
+    // volatile writes have release semantics with MSVC
+    _ReadWriteBarrier();
+    var = value;
+#else /* !HAVE_WINDOWS_H */
+    __atomic_store_n( &var, value, __ATOMIC_RELEASE );
+#endif /* !HAVE_WINDOWS_H */
+}
+
+/**
+ * @brief Atomically adds to a variable.
+ *
+ * @param[in] var   The variable.
+ * @param[in] value Value to add.
+ *
+ * @return The new value of the variable.
+ */
+inline long AtomicAdd( volatile long& var, long value )
+{
+#ifdef HAVE_WINDOWS_H
+    return InterlockedExchangeAdd( &var, value ) + value;
+#else /* !HAVE_WINDOWS_H */
+    return __atomic_add_fetch( &var, value, __ATOMIC_SEQ_CST );
+#endif /* !HAVE_WINDOWS_H */
+}
+
+/**
+ * @brief Atomically replaces value of a variable.
+ *
+ * @param[in] var   The variable.
+ * @param[in] value Value to write.
+ *
+ * @return The previous value of the variable.
+ */
+inline long AtomicExchange( volatile long& var, long value )
+{
+#ifdef HAVE_WINDOWS_H
+    return InterlockedExchange( &var, value );
+#else /* !HAVE_WINDOWS_H */
+    return __atomic_exchange_n( &var, value, __ATOMIC_SEQ_CST );
+#endif /* !HAVE_WINDOWS_H */
+}
+
+/**
+ * @brief Atomically replaces value of a variable if it's equal to another.
+ *
+ * @param[in] var      The variable.
+ * @param[in] expected Value the variable must have.
+ * @param[in] value    Value to write.
+ *
+ * @retval true  The variable was equal to @a expected and has been written.
+ * @retval false The variable has not been written.
+ */
+inline bool AtomicCompareExchange( volatile long& var, long expected, long value )
+{
+#ifdef HAVE_WINDOWS_H
+    return expected == InterlockedCompareExchange( &var, value, expected );
+#else /* !HAVE_WINDOWS_H */
+    return __atomic_compare_exchange_n( &var, &expected, value, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST );
+#endif /* !HAVE_WINDOWS_H */
+}
+
+/** @brief Atomically increments a variable; returns the new value. */
+inline long AtomicIncrement( volatile long& var ) { return AtomicAdd( var, 1 ); }
+/** @brief Atomically decrements a variable; returns the new value. */
+inline long AtomicDecrement( volatile long& var ) { return AtomicAdd( var, -1 ); }
+
+#endif /* !__THREADING__ATOMIC_H__INCL__ */
@@ -0,0 +1,174 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#ifndef __THREADING__MPSC_QUEUE_H__INCL__
+#define __THREADING__MPSC_QUEUE_H__INCL__
+
+#include "threading/Atomic.h"
+
+/**
+ * @brief Bounded lock-free multi-producer/single-consumer queue.
+ *
+ * A ring of cells, each with a sequence number telling whose turn
+ * it is: a producer claims a cell by advancing the enqueue position
+ * with compare-and-swap, writes the value and hands the cell over
+ * to the consumer by bumping its sequence; the consumer hands it
+ * back the same way once the value is taken. Nothing is allocated
+ * after construction.
+ *
+ * Any number of threads may push; only one thread may pop at a
+ * time. A value pushed by a producer which has claimed its cell but
+ * not yet written it holds back values pushed after it, so Pop may
+ * see the queue empty for a moment even though later pushes finished.
+ */
+template< typename T >
+class MPSCQueue
+{
+public:
+    /**
+     * @brief Creates an empty queue.
+     *
+     * @param[in] capacity Minimal number of values the queue can hold;
+     *                     rounded up to a power of two.
+     */
+    MPSCQueue( size_t capacity )
+    : mCells( NULL ),
+      mMask( 0 ),
+      mEnqueuePos( 0 ),
+      mDequeuePos( 0 )
+    {
+        size_t size = 2;
+        while( size < capacity )
+            size <<= 1;
+
+        mCells = new Cell[ size ];
+        mMask = size - 1;
+
+        for( size_t i = 0; i < size; ++i )
+            mCells[ i ].sequence = (long)i;
+    }
+    /**
+     * @brief Destroys the queue; values left in it are not popped.
+     */
+    ~MPSCQueue()
+    {
+        delete[] mCells;
+    }
+
+    /** @return Number of values the queue can hold. */
+    size_t capacity() const { return mMask + 1; }
+
+    /**
+     * @brief Appends a value; any thread.
+     *
+     * @param[in] value The value to append.
+     *
+     * @retval true  The value has been appended.
+     * @retval false The queue is full.
+     */
+    bool Push( const T& value )
+    {
+        long pos = AtomicLoad( mEnqueuePos );
+        Cell* cell;
+
+        while( true )
+        {
+            cell = &mCells[ pos & mMask ];
+
+            // positions wrap around, compare them by their distance
+            const long dist = Advance( AtomicLoad( cell->sequence ), -pos );
+            if( 0 == dist )
+            {
+                // the cell is free, try to claim it
+                if( AtomicCompareExchange( mEnqueuePos, pos, Advance( pos, 1 ) ) )
+                    break;
+            }
+            else if( 0 > dist )
+                // the consumer hasn't taken the value a lap ago
+                return false;
+
+            // another producer has been faster
+            pos = AtomicLoad( mEnqueuePos );
+        }
+
+        cell->value = value;
+        // hand the cell over to the consumer
+        AtomicStore( cell->sequence, Advance( pos, 1 ) );
+
+        return true;
+    }
+
+    /**
+     * @brief Pops the oldest value; consumer only.
+     *
+     * @param[out] value The popped value.
+     *
+     * @retval true  A value has been popped.
+     * @retval false The queue is empty.
+     */
+    bool Pop( T& value )
+    {
+        Cell& cell = mCells[ mDequeuePos & mMask ];
+        if( AtomicLoad( cell.sequence ) != Advance( mDequeuePos, 1 ) )
+            return false;
+
+        value = cell.value;
+        // hand the cell back to producers for the next lap
+        AtomicStore( cell.sequence, Advance( mDequeuePos, (long)capacity() ) );
+        mDequeuePos = Advance( mDequeuePos, 1 );
+
+        return true;
+    }
+
+protected:
+    /** @return @a pos moved by @a count, wrapping around instead of overflowing. */
+    static long Advance( long pos, long count ) { return (long)( (unsigned long)pos + (unsigned long)count ); }
+
+    /** A cell of the ring. */
+    struct Cell
+    {
+        /** Position of the cell, plus one once it holds a value. */
+        volatile long sequence;
+        /** The value. */
+        T value;
+    };
+
+    /** Size of a cache line, to keep producers and the consumer apart. */
+    static const size_t CACHE_LINE_SIZE = 64;
+
+    /** The ring. */
+    Cell* mCells;
+    /** Number of cells minus one. */
+    size_t mMask;
+
+    char mPad1[ CACHE_LINE_SIZE ];
+    /** Position of the next push; shared by producers. */
+    volatile long mEnqueuePos;
+    char mPad2[ CACHE_LINE_SIZE ];
+    /** Position of the next pop; consumer side. */
+    long mDequeuePos;
+};
+
+#endif /* !__THREADING__MPSC_QUEUE_H__INCL__ */
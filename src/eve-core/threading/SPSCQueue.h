@@ -0,0 +1,122 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#ifndef __THREADING__SPSC_QUEUE_H__INCL__
+#define __THREADING__SPSC_QUEUE_H__INCL__
+
+#include "threading/Atomic.h"
+
+/**
+ * @brief Lock-free single-producer/single-consumer queue.
+ *
+ * A linked list of nodes; the producer only touches the tail
+ * and the consumer only touches the head, which is a dummy node
+ * holding the most recently popped value. Neither side ever
+ * waits for the other.
+ *
+ * Only one thread may push and only one (possibly another)
+ * thread may pop at a time.
+ */
+template< typename T >
+class SPSCQueue
+{
+public:
+    /**
+     * @brief Creates an empty queue.
+     */
+    SPSCQueue()
+    : mHead( new Node( T() ) ),
+      mTail( mHead )
+    {
+    }
+    /**
+     * @brief Destroys the queue; values left in it are not popped.
+     */
+    ~SPSCQueue()
+    {
+        while( NULL != mHead )
+        {
+            Node* next = mHead->next;
+            delete mHead;
+            mHead = next;
+        }
+    }
+
+    /**
+     * @brief Appends a value; producer only.
+     *
+     * @param[in] value The value to append.
+     */
+    void Push( const T& value )
+    {
+        Node* node = new Node( value );
+
+        // publish the node along with its value
+        AtomicStore( mTail->next, node );
+        mTail = node;
+    }
+
+    /**
+     * @brief Pops the oldest value; consumer only.
+     *
+     * @param[out] value The popped value.
+     *
+     * @retval true  A value has been popped.
+     * @retval false The queue is empty.
+     */
+    bool Pop( T& value )
+    {
+        Node* next = AtomicLoad( mHead->next );
+        if( NULL == next )
+            return false;
+
+        value = next->value;
+
+        // next becomes the new dummy
+        delete mHead;
+        mHead = next;
+
+        return true;
+    }
+
+protected:
+    /** A node of the list. */
+    struct Node
+    {
+        Node( const T& v ) : value( v ), next( NULL ) {}
+
+        /** The value. */
+        T value;
+        /** The next node; written by the producer, read by the consumer. */
+        Node* volatile next;
+    };
+
+    /** The dummy node; consumer side. */
+    Node* mHead;
+    /** The last node; producer side. */
+    Node* mTail;
+};
+
+#endif /* !__THREADING__SPSC_QUEUE_H__INCL__ */
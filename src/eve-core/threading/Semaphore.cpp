@@ -0,0 +1,83 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#include "eve-core.h"
+
+#include "threading/Semaphore.h"
+
+/*************************************************************************/
+/* Semaphore                                                             */
+/*************************************************************************/
+Semaphore::Semaphore( uint32 count )
+{
+#ifdef HAVE_WINDOWS_H
+    mSemaphore = CreateSemaphore( NULL, count, LONG_MAX, NULL );
+    assert( NULL != mSemaphore );
+#else /* !HAVE_WINDOWS_H */
+    pthread_mutex_init( &mMutex, NULL );
+    pthread_cond_init( &mCond, NULL );
+
+    mCount = count;
+#endif /* !HAVE_WINDOWS_H */
+}
+
+Semaphore::~Semaphore()
+{
+#ifdef HAVE_WINDOWS_H
+    CloseHandle( mSemaphore );
+#else /* !HAVE_WINDOWS_H */
+    pthread_cond_destroy( &mCond );
+    pthread_mutex_destroy( &mMutex );
+#endif /* !HAVE_WINDOWS_H */
+}
+
+void Semaphore::Post()
+{
+#ifdef HAVE_WINDOWS_H
+    ReleaseSemaphore( mSemaphore, 1, NULL );
+#else /* !HAVE_WINDOWS_H */
+    pthread_mutex_lock( &mMutex );
+
+    ++mCount;
+    pthread_cond_signal( &mCond );
+
+    pthread_mutex_unlock( &mMutex );
+#endif /* !HAVE_WINDOWS_H */
+}
+
+void Semaphore::Wait()
+{
+#ifdef HAVE_WINDOWS_H
+    WaitForSingleObject( mSemaphore, INFINITE );
+#else /* !HAVE_WINDOWS_H */
+    pthread_mutex_lock( &mMutex );
+
+    while( 0 == mCount )
+        pthread_cond_wait( &mCond, &mMutex );
+    --mCount;
+
+    pthread_mutex_unlock( &mMutex );
+#endif /* !HAVE_WINDOWS_H */
+}
@@ -0,0 +1,69 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#ifndef __THREADING__SEMAPHORE_H__INCL__
+#define __THREADING__SEMAPHORE_H__INCL__
+
+/**
+ * @brief Common wrapper for platform-specific counting semaphores.
+ */
+class Semaphore
+{
+public:
+    /**
+     * @brief Primary constructor.
+     *
+     * @param[in] count Initial count of the semaphore.
+     */
+    Semaphore( uint32 count = 0 );
+    /**
+     * @brief Destructor, releases allocated resources.
+     */
+    ~Semaphore();
+
+    /**
+     * @brief Increments the count, waking up a waiting thread.
+     */
+    void Post();
+    /**
+     * @brief Blocks calling thread until the count is positive, then decrements it.
+     */
+    void Wait();
+
+protected:
+#ifdef HAVE_WINDOWS_H
+    /// The semaphore object.
+    HANDLE mSemaphore;
+#else /* !HAVE_WINDOWS_H */
+    /// Mutex protecting the count.
+    pthread_mutex_t mMutex;
+    /// Condition signaled when the count becomes positive.
+    pthread_cond_t mCond;
+    /// The count.
+    uint32 mCount;
+#endif /* !HAVE_WINDOWS_H */
+};
+
+#endif /* !__THREADING__SEMAPHORE_H__INCL__ */
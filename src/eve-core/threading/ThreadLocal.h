@@ -0,0 +1,124 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#ifndef __THREADING__THREAD_LOCAL_H__INCL__
+#define __THREADING__THREAD_LOCAL_H__INCL__
+
+/**
+ * @brief Per-thread instance of an object.
+ *
+ * Each thread accessing the object gets its own instance,
+ * which is value-initialized on first access and destroyed
+ * when the thread terminates.
+ *
+ * @note On Windows, instances are not destroyed on thread termination;
+ *       only use this for threads which live as long as the program.
+ */
+template< typename T >
+class ThreadLocal
+{
+public:
+    /**
+     * @brief Primary constructor.
+     */
+    ThreadLocal()
+    {
+#ifdef HAVE_WINDOWS_H
+        mKey = TlsAlloc();
+        assert( TLS_OUT_OF_INDEXES != mKey );
+#else /* !HAVE_WINDOWS_H */
+        int code = pthread_key_create( &mKey, &Destroy );
+        assert( 0 == code );
+#endif /* !HAVE_WINDOWS_H */
+    }
+    /**
+     * @brief Destructor; frees the key, but not the instances.
+     */
+    ~ThreadLocal()
+    {
+#ifdef HAVE_WINDOWS_H
+        TlsFree( mKey );
+#else /* !HAVE_WINDOWS_H */
+        pthread_key_delete( mKey );
+#endif /* !HAVE_WINDOWS_H */
+    }
+
+    /**
+     * @return Instance of calling thread.
+     */
+    T& get()
+    {
+#ifdef HAVE_WINDOWS_H
+        T* instance = static_cast< T* >( TlsGetValue( mKey ) );
+#else /* !HAVE_WINDOWS_H */
+        T* instance = static_cast< T* >( pthread_getspecific( mKey ) );
+#endif /* !HAVE_WINDOWS_H */
+
+        if( NULL == instance )
+        {
+            instance = new T();
+
+#ifdef HAVE_WINDOWS_H
+            TlsSetValue( mKey, instance );
+#else /* !HAVE_WINDOWS_H */
+            pthread_setspecific( mKey, instance );
+#endif /* !HAVE_WINDOWS_H */
+        }
+
+        return *instance;
+    }
+
+    /**
+     * @return Instance of calling thread.
+     */
+    T& operator*() { return get(); }
+    /**
+     * @return Instance of calling thread.
+     */
+    T* operator->() { return &get(); }
+
+protected:
+#ifndef HAVE_WINDOWS_H
+    /**
+     * @brief Destroys an instance.
+     *
+     * @param[in] instance The instance to destroy.
+     */
+    static void Destroy( void* instance )
+    {
+        delete static_cast< T* >( instance );
+    }
+#endif /* !HAVE_WINDOWS_H */
+
+#ifdef HAVE_WINDOWS_H
+    /** The TLS index. */
+    DWORD mKey;
+#else /* !HAVE_WINDOWS_H */
+    /** The TLS key. */
+    pthread_key_t mKey;
+#endif /* !HAVE_WINDOWS_H */
+};
+
+#endif /* !__THREADING__THREAD_LOCAL_H__INCL__ */
@@ -0,0 +1,206 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#include "eve-core.h"
+
+#include "log/LogNew.h"
+#include "threading/WorkerPool.h"
+
+/*************************************************************************/
+/* WorkerPool                                                            */
+/*************************************************************************/
+WorkerPool::WorkerPool( const char* name )
+: mName( name ),
+  mRunning( false )
+{
+    mStats.jobs = 0;
+    mStats.queueDepth = 0;
+    mStats.maxQueueDepth = 0;
+}
+
+WorkerPool::~WorkerPool()
+{
+    Stop();
+}
+
+bool WorkerPool::IsRunning() const
+{
+    MutexLock lock( mMJobs );
+
+    return mRunning;
+}
+
+uint32 WorkerPool::GetThreadCount() const
+{
+    MutexLock lock( mMThreads );
+
+    return mThreads.size();
+}
+
+WorkerPool::Stats WorkerPool::GetStats() const
+{
+    MutexLock lock( mMJobs );
+
+    return mStats;
+}
+
+bool WorkerPool::Start( uint32 threadCount )
+{
+    MutexLock lock( mMThreads );
+
+    if( !mThreads.empty() )
+        return true;
+
+    if( 0 == threadCount )
+        threadCount = 1;
+
+    for( uint32 i = 0; i < threadCount; ++i )
+    {
+#ifdef HAVE_WINDOWS_H
+        HANDLE thread = CreateThread( NULL, 0, WorkerLoop, this, 0, NULL );
+        if( NULL == thread )
+#else /* !HAVE_WINDOWS_H */
+        pthread_t thread;
+        if( 0 != pthread_create( &thread, NULL, WorkerLoop, this ) )
+#endif /* !HAVE_WINDOWS_H */
+        {
+            sLog.Error( mName.c_str(), "Failed to start worker thread %u.", i );
+            continue;
+        }
+
+        mThreads.push_back( thread );
+    }
+
+    if( mThreads.empty() )
+        return false;
+
+    {
+        MutexLock jobLock( mMJobs );
+
+        mRunning = true;
+    }
+
+    sLog.Log( mName.c_str(), "Started %lu worker threads.", mThreads.size() );
+    return true;
+}
+
+void WorkerPool::Stop()
+{
+    MutexLock lock( mMThreads );
+
+    {
+        MutexLock jobLock( mMJobs );
+
+        // Jobs posted from now on are run by the posting thread
+        mRunning = false;
+
+        // The threads quit once they get through the jobs posted so far
+        for( size_t i = 0; i < mThreads.size(); ++i )
+            mJobs.push( NULL );
+    }
+
+    for( size_t i = 0; i < mThreads.size(); ++i )
+        mJobCount.Post();
+
+    for( size_t i = 0; i < mThreads.size(); ++i )
+    {
+#ifdef HAVE_WINDOWS_H
+        WaitForSingleObject( mThreads[ i ], INFINITE );
+        CloseHandle( mThreads[ i ] );
+#else /* !HAVE_WINDOWS_H */
+        pthread_join( mThreads[ i ], NULL );
+#endif /* !HAVE_WINDOWS_H */
+    }
+
+    mThreads.clear();
+}
+
+void WorkerPool::Post( WorkerJob* job )
+{
+    assert( NULL != job );
+
+    {
+        MutexLock lock( mMJobs );
+
+        if( mRunning )
+        {
+            mJobs.push( job );
+
+            if( mStats.maxQueueDepth < ++mStats.queueDepth )
+                mStats.maxQueueDepth = mStats.queueDepth;
+
+            job = NULL;
+        }
+    }
+
+    if( NULL == job )
+        mJobCount.Post();
+    else
+        // Nobody would run it
+        job->Run();
+}
+
+void WorkerPool::Run()
+{
+    while( true )
+    {
+        mJobCount.Wait();
+
+        WorkerJob* job;
+        {
+            MutexLock lock( mMJobs );
+
+            job = mJobs.front();
+            mJobs.pop();
+
+            if( NULL != job )
+            {
+                --mStats.queueDepth;
+                ++mStats.jobs;
+            }
+        }
+
+        if( NULL == job )
+            break;
+
+        job->Run();
+    }
+}
+
+#ifdef HAVE_WINDOWS_H
+DWORD WINAPI WorkerPool::WorkerLoop( LPVOID arg )
+#else /* !HAVE_WINDOWS_H */
+void* WorkerPool::WorkerLoop( void* arg )
+#endif /* !HAVE_WINDOWS_H */
+{
+    WorkerPool* pool = static_cast< WorkerPool* >( arg );
+    pool->Run();
+
+#ifdef HAVE_WINDOWS_H
+    return 0;
+#else /* !HAVE_WINDOWS_H */
+    return NULL;
+#endif /* !HAVE_WINDOWS_H */
+}
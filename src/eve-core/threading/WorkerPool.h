@@ -0,0 +1,143 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#ifndef __THREADING__WORKER_POOL_H__INCL__
+#define __THREADING__WORKER_POOL_H__INCL__
+
+#include "threading/Mutex.h"
+#include "threading/Semaphore.h"
+
+/**
+ * @brief Interface of a job run by WorkerPool.
+ */
+class WorkerJob
+{
+public:
+    virtual ~WorkerJob() {}
+
+    /**
+     * @brief Does the job; called from one of the pool's threads.
+     */
+    virtual void Run() = 0;
+};
+
+/**
+ * @brief Fixed pool of threads running posted jobs.
+ *
+ * Jobs are run in the order they've been posted, each by
+ * one of the threads. A stopped pool runs posted jobs right
+ * away on the posting thread, so nothing is ever lost.
+ */
+class WorkerPool
+{
+public:
+    /** Pool statistics. */
+    struct Stats
+    {
+        /** Number of jobs run by the threads. */
+        uint64 jobs;
+        /** Number of jobs currently waiting for a thread. */
+        size_t queueDepth;
+        /** Maximal number of jobs which have been waiting for a thread. */
+        size_t maxQueueDepth;
+    };
+
+    /**
+     * @param[in] name Name of the pool used in log messages.
+     */
+    WorkerPool( const char* name );
+    /**
+     * @brief Destructor; stops the threads.
+     */
+    ~WorkerPool();
+
+    /** @return True if the threads are running, false if not. */
+    bool IsRunning() const;
+    /** @return Number of running threads. */
+    uint32 GetThreadCount() const;
+    /** @return Pool statistics. */
+    Stats GetStats() const;
+
+    /**
+     * @brief Starts the threads.
+     *
+     * Does nothing if the pool is already running.
+     *
+     * @param[in] threadCount Number of threads to start.
+     *
+     * @return True if the pool is running, false if not.
+     */
+    bool Start( uint32 threadCount );
+    /**
+     * @brief Stops the threads.
+     *
+     * Blocks calling thread until all jobs posted so far
+     * are done, so it must not be called from within a job.
+     */
+    void Stop();
+
+    /**
+     * @brief Posts a job.
+     *
+     * @param[in] job The job; must stay alive until it's run.
+     */
+    void Post( WorkerJob* job );
+
+protected:
+    /** Runs posted jobs until it gets NULL. */
+    void Run();
+
+#ifdef HAVE_WINDOWS_H
+    static DWORD WINAPI WorkerLoop( LPVOID arg );
+#else /* !HAVE_WINDOWS_H */
+    static void* WorkerLoop( void* arg );
+#endif /* !HAVE_WINDOWS_H */
+
+    /** Name of the pool. */
+    const std::string mName;
+
+    /** Protects the thread list. */
+    mutable Mutex mMThreads;
+#ifdef HAVE_WINDOWS_H
+    /** The threads. */
+    std::vector< HANDLE > mThreads;
+#else /* !HAVE_WINDOWS_H */
+    /** The threads. */
+    std::vector< pthread_t > mThreads;
+#endif /* !HAVE_WINDOWS_H */
+
+    /** Protects the job queue, the running flag and statistics. */
+    mutable Mutex mMJobs;
+    /** True if the threads take posted jobs. */
+    bool mRunning;
+    /** Posted jobs; NULL tells a thread to quit. */
+    std::queue< WorkerJob* > mJobs;
+    /** Counts the posted jobs. */
+    Semaphore mJobCount;
+    /** Pool statistics. */
+    Stats mStats;
+};
+
+#endif /* !__THREADING__WORKER_POOL_H__INCL__ */
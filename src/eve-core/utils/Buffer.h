@@ -651,9 +651,9 @@ public:
         // obtain required size in bytes
         const size_type _requiredSize = sizeof( T ) * requiredCount;
 
-        // reallocate if necessary
+        // reallocate if necessary; reserved memory is allocated exactly
         if( _index + _requiredSize > capacity() )
-            _Reallocate( _index + _requiredSize );
+            _SetCapacity( _index + _requiredSize );
     }
 
     /**
@@ -748,8 +748,9 @@ protected:
         // obtain required size in bytes
         const size_type _requiredSize = sizeof( T ) * requiredCount;
 
-        // reallocate
-        _Reallocate( _index + _requiredSize );
+        // reallocate; growing within capacity keeps the (possibly reserved) memory
+        if( _index + _requiredSize > capacity() || _index + _requiredSize < size() )
+            _Reallocate( _index + _requiredSize );
         // set new size
         mSize = ( _index + _requiredSize );
     }
@@ -769,6 +770,16 @@ protected:
         // make sure new capacity is bigger than required size
         assert( requiredSize <= newCapacity );
 
+        _SetCapacity( newCapacity );
+    }
+
+    /**
+     * @brief Sets capacity of buffer.
+     *
+     * @param[in] newCapacity The new capacity, in bytes; must not be less than size.
+     */
+    void _SetCapacity( size_type newCapacity )
+    {
         // has the capacity changed?
         if( newCapacity != capacity() )
         {
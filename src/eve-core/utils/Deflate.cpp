@@ -25,13 +25,98 @@
 
 #include "eve-core.h"
 
+#include "threading/ThreadLocal.h"
 #include "utils/Deflate.h"
 
 const uint8 DeflateHeaderByte = 0x78; //'x'
 
+/**
+ * @brief Persistent zlib streams of a single thread.
+ *
+ * Initializing a zlib stream allocates several hundred kilobytes
+ * of state; resetting it is just a few assignments. Each thread
+ * therefore keeps its streams for its whole lifetime.
+ */
+class ZStreams
+{
+public:
+    ZStreams()
+    : mDeflateLevel( Z_DEFAULT_COMPRESSION ),
+      mDeflateReady( false ),
+      mInflateReady( false )
+    {
+    }
+
+    ~ZStreams()
+    {
+        if( mDeflateReady )
+            deflateEnd( &mDeflate );
+        if( mInflateReady )
+            inflateEnd( &mInflate );
+    }
+
+    /** @return Reset deflate stream with given level, NULL if initialization failed. */
+    z_stream* GetDeflate( int level )
+    {
+        if( mDeflateReady )
+        {
+            deflateReset( &mDeflate );
+
+            // No data have been fed yet, so this is just an assignment.
+            if( mDeflateLevel != level
+                && Z_OK != deflateParams( &mDeflate, level, Z_DEFAULT_STRATEGY ) )
+                return NULL;
+        }
+        else
+        {
+            memset( &mDeflate, 0, sizeof( mDeflate ) );
+
+            mDeflateReady = ( Z_OK == deflateInit( &mDeflate, level ) );
+            if( !mDeflateReady )
+                return NULL;
+        }
+
+        mDeflateLevel = level;
+        return &mDeflate;
+    }
+
+    /** @return Reset inflate stream, NULL if initialization failed. */
+    z_stream* GetInflate()
+    {
+        if( mInflateReady )
+            inflateReset( &mInflate );
+        else
+        {
+            memset( &mInflate, 0, sizeof( mInflate ) );
+
+            mInflateReady = ( Z_OK == inflateInit( &mInflate ) );
+            if( !mInflateReady )
+                return NULL;
+        }
+
+        return &mInflate;
+    }
+
+protected:
+    /** Deflate stream. */
+    z_stream mDeflate;
+    /** Current compression level of mDeflate. */
+    int mDeflateLevel;
+    /** True if mDeflate has been initialized. */
+    bool mDeflateReady;
+
+    /** Inflate stream. */
+    z_stream mInflate;
+    /** True if mInflate has been initialized. */
+    bool mInflateReady;
+};
+
+/** zlib streams of each thread. */
+static ThreadLocal< ZStreams > zStreams;
+
 bool IsDeflated( const Buffer& data )
 {
-    return ( DeflateHeaderByte == data[0] );
+    return ( 0 < data.size() && DeflateHeaderByte == data[0] );
 }
 
 bool DeflateData( Buffer& data )
@@ -44,23 +129,33 @@ bool DeflateData( Buffer& data )
     return true;
 }
 
-bool DeflateData( const Buffer& input, Buffer& output )
+bool DeflateData( const Buffer& input, Buffer& output, int level )
 {
-    const Buffer::iterator<uint8> out = output.end<uint8>();
+    z_stream* stream = zStreams->GetDeflate( level );
+    if( NULL == stream )
+        return false;
+
+    const size_t start = output.size();
 
-    size_t outputSize = compressBound( input.size() );
-    output.ResizeAt( out, outputSize );
+    // The bound is exact enough to deflate in a single pass.
+    const size_t outputSize = deflateBound( stream, input.size() );
+    output.Resize<uint8>( start + outputSize );
 
-    int res = compress( &*out, (uLongf*)&outputSize, &input[0], input.size() );
+    stream->next_in = ( 0 < input.size() ? const_cast< Bytef* >( &input[0] ) : Z_NULL );
+    stream->avail_in = input.size();
+    stream->next_out = &output[ start ];
+    stream->avail_out = outputSize;
 
-    if( Z_OK == res )
+    int res = deflate( stream, Z_FINISH );
+
+    if( Z_STREAM_END == res )
     {
-        output.ResizeAt( out, outputSize );
+        output.Resize<uint8>( start + stream->total_out );
         return true;
     }
     else
     {
-        output.ResizeAt( out, 0 );
+        output.Resize<uint8>( start );
         return false;
     }
 }
@@ -77,28 +172,47 @@ bool InflateData( Buffer& data )
 
 bool InflateData( const Buffer& input, Buffer& output )
 {
-    const Buffer::iterator<uint8> out = output.end<uint8>();
+    if( 0 == input.size() )
+        return false;
 
-    size_t outputSize = 0;
-    size_t sizeMultiplier = 0;
+    z_stream* stream = zStreams->GetInflate();
+    if( NULL == stream )
+        return false;
+
+    const size_t start = output.size();
+    size_t outputSize = ( input.size() << 2 );
+
+    stream->next_in = const_cast< Bytef* >( &input[0] );
+    stream->avail_in = input.size();
 
     int res = 0;
-    do
+    while( true )
     {
-        outputSize = ( input.size() << ++sizeMultiplier );
-        output.ResizeAt( out, outputSize );
+        output.Resize<uint8>( start + outputSize );
+
+        stream->next_out = &output[ start + stream->total_out ];
+        stream->avail_out = outputSize - stream->total_out;
 
-        res = uncompress( &*out, (uLongf*)&outputSize, &input[0], input.size() );
-    } while( Z_BUF_ERROR == res );
+        res = inflate( stream, Z_NO_FLUSH );
+        if( Z_STREAM_END == res )
+            break;
+
+        // Stop on errors and on truncated input;
+        // otherwise just make room for the rest.
+        if( ( Z_OK != res && Z_BUF_ERROR != res ) || 0 != stream->avail_out )
+            break;
+
+        outputSize <<= 1;
+    }
 
-    if( Z_OK == res )
+    if( Z_STREAM_END == res )
     {
-        output.ResizeAt( out, outputSize );
+        output.Resize<uint8>( start + stream->total_out );
         return true;
     }
     else
     {
-        output.ResizeAt( out, 0 );
+        output.Resize<uint8>( start );
         return false;
     }
 }
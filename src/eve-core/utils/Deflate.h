@@ -28,6 +28,11 @@
 
 #include "utils/Buffer.h"
 
+/*
+ * Deflation and inflation use persistent zlib streams kept
+ * per thread, so no zlib state is allocated per call.
+ */
+
 extern const uint8 DeflateHeaderByte;
 
 /**
@@ -54,11 +59,12 @@ bool DeflateData( Buffer& data );
  *
  * @param[in]  input  Data to be deflated.
  * @param[out] output Destination of deflated data.
+ * @param[in]  level  zlib compression level (0-9).
  *
  * @retval true  Deflation ran successfully.
  * @retval false Error occurred during deflation.
  */
-bool DeflateData( const Buffer& input, Buffer& output );
+bool DeflateData( const Buffer& input, Buffer& output, int level = Z_DEFAULT_COMPRESSION );
 
 /**
  * @brief Inflates given data.
@@ -72,22 +78,10 @@ bool InflateData( Buffer& data );
 /**
  * @brief Inflates given data.
  *
- * One of the key things of the ZLIB stuff is that we 'sometimes'
- * don't know the size of the uncompressed data. My idea is to fix
- * this regarding the first phase of the parsing of the data
- * (the parser) is to go trough a couple of output buffer size.
- *
- * The first buffer size would be 2x the initial buffer size,
- * implying that the compression ratio is about 50%.
- * The second buffer size would be 4x the initial buffer size,
- * implying that the compression ratio is about 75%.
- * The third buffer size would be 8x the initial buffer size
- * implying that the compression ratio is about 87.5%.
- *
- * We would go on in this progress until we find buffer size
- * big enough to hold uncompressed data.
- *
- * This theory is really stupid because there is no way to actually know.
+ * The size of the uncompressed data is not known in advance,
+ * so the output starts at 4x the input size and is doubled
+ * whenever it fills up; inflation continues where it stopped,
+ * nothing is decompressed twice.
  *
  * @param[in]  input  Data to be inflated.
  * @param[out] output Destination for inflated data.
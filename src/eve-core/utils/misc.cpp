@@ -71,6 +71,32 @@ uint16 crc_hqx( const uint8* data, size_t len, uint16 crc )
     return crc;
 }
 
+uint32 fnv1a_hash( const char* str, size_t len )
+{
+    uint32 hash = 2166136261U;
+
+    for(; 0 < len; --len )
+    {
+        hash ^= static_cast<uint8>( *str++ );
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+uint32 hash_mix( uint32 hash, uint32 seed )
+{
+    hash ^= seed * 0x9E3779B9U;
+
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6BU;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35U;
+    hash ^= hash >> 16;
+
+    return hash;
+}
+
 uint64 filesize( const char* filename )
 {
     FILE* fd = fopen( filename, "r" );
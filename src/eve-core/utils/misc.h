@@ -37,6 +37,28 @@
  */
 uint16 crc_hqx( const uint8* data, size_t len, uint16 crc = 0 );
 
+/**
+ * @brief Calculates 32-bit FNV-1a hash of a string.
+ *
+ * @param[in] str String to be hashed.
+ * @param[in] len Length of the string.
+ *
+ * @return The hash.
+ */
+uint32 fnv1a_hash( const char* str, size_t len );
+/**
+ * @brief Mixes a seed into a hash.
+ *
+ * Uses the finalizer of MurmurHash3, so that each bit
+ * of the result depends on all bits of both arguments.
+ *
+ * @param[in] hash The hash.
+ * @param[in] seed The seed.
+ *
+ * @return The mixed hash.
+ */
+uint32 hash_mix( uint32 hash, uint32 seed );
+
 /**
  * @brief Obtains filesize.
  *
@@ -71,3 +71,30 @@ uint64 Win32TimeNow() {
     return(UnixTimeToWin32Time(time(NULL), 0));
 #endif /* !HAVE_WINDOWS_H */
 }
+
+uint64 GetTimeUSeconds()
+{
+#ifdef HAVE_WINDOWS_H
+    static LARGE_INTEGER frequency = { 0 };
+    if( 0 == frequency.QuadPart )
+        QueryPerformanceFrequency( &frequency );
+
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter( &counter );
+
+    return counter.QuadPart / frequency.QuadPart * 1000000
+         + counter.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart;
+#elif defined( HAVE_SYS_TIME_H )
+    timeval tv;
+    ::gettimeofday( &tv, NULL );
+
+    return (uint64)tv.tv_sec * 1000000
+         + tv.tv_usec;
+#else /* !HAVE_SYS_TIME_H */
+    timeb tb;
+    ::ftime( &tb );
+
+    return (uint64)tb.time * 1000000
+         + tb.millitm * 1000;
+#endif /* !HAVE_SYS_TIME_H */
+}
@@ -46,4 +46,13 @@ extern uint64 Win32TimeNow();
 extern void Win32TimeToUnixTime( uint64 win32t, time_t &unix_time, uint32 &nsec );
 extern std::string Win32TimeToString(uint64 win32t);
 
+/**
+ * @brief Obtains current time with microsecond resolution.
+ *
+ * Intended for measuring durations; the epoch is unspecified.
+ *
+ * @return Current time in microseconds.
+ */
+extern uint64 GetTimeUSeconds();
+
 #endif /* !__UTILS_TIME_H__INCL__ */
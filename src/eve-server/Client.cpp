@@ -30,6 +30,7 @@
 #include "PyBoundObject.h"
 #include "chat/LSCService.h"
 #include "imageserver/ImageServer.h"
+#include "inventory/AttributeSaveQueue.h"
 #include "npc/NPC.h"
 #include "ship/DestinyManager.h"
 #include "ship/ShipOperatorInterface.h"
@@ -52,6 +53,8 @@ Client::Client(PyServiceMgr &services, EVETCPConnection** con)
   m_timeEndTrain(0),
   m_destinyEventQueue( new PyList ),
   m_destinyUpdateQueue( new PyList ),
+  m_currentCall(NULL),
+  m_currentCallDeferred(false),
   m_nextNotifySequence(1)
 //  m_nextDestinyUpdate(46751)
 {
@@ -70,6 +73,13 @@ Client::Client(PyServiceMgr &services, EVETCPConnection** con)
 }
 
 Client::~Client() {
+    // replies to pending deferred calls have nowhere to go
+    std::set<PyDeferredCall*>::iterator cur, end;
+    cur = m_deferredCalls.begin();
+    end = m_deferredCalls.end();
+    for(; cur != end; cur++)
+        (*cur)->mClient = NULL;
+
     if( GetChar() ) {
         // we have valid character
 
@@ -84,6 +94,7 @@ Client::~Client() {
         GetShip()->SaveShip();                              // Save Ship's and Modules' attributes and info to DB
         GetChar()->SaveCharacter();                         // Save Character info to DB
         GetChar()->SaveSkillQueue();                        // Save Skill Queue to DB
+        sAttributeSaveQueue.BeginFlush();                   // Attributes saved above are written behind; loading them flushes first
 
         // remove ourselves from system
         if(m_system != NULL)
@@ -877,6 +888,24 @@ void Client::QueueDestinyEvent(PyTuple** multiEvent)
     *multiEvent = NULL;
 }
 
+//these are used by bubblecasts; the payload is marshaled just once
+//and shared by all recipients, so we only take a reference.
+void Client::QueueSharedDestinyUpdate(PyPreMarshaled* du)
+{
+    DoDestinyAction act;
+    act.update_id = DestinyManager::GetStamp();
+    act.update = du;
+    PyIncRef( du );
+
+    m_destinyUpdateQueue->AddItem( act.Encode() );
+}
+
+void Client::QueueSharedDestinyEvent(PyPreMarshaled* multiEvent)
+{
+    PyIncRef( multiEvent );
+    m_destinyEventQueue->AddItem( multiEvent );
+}
+
 void Client::_SendQueuedUpdates() {
     if( !m_destinyUpdateQueue->empty() )
     {
@@ -894,10 +923,13 @@ void Client::_SendQueuedUpdates() {
         //I haven't found it yet
         dum.waitForBubble = false;
 
-        //now send it
-        PyTuple* t = dum.Encode();
-        t->Dump(DESTINY__UPDATES, "");
-        SendNotification( "DoDestinyUpdate", "clientID", &t );
+        //now send it; marshal it directly, we don't need the objects.
+        if( is_log_enabled( DESTINY__UPDATES ) )
+            dum.Dump( DESTINY__UPDATES, "" );
+
+        EVENotificationStream notify;
+        if( notify.MarshalArgs( dum ) )
+            SendNotification( "DoDestinyUpdate", "clientID", notify );
     }
     else if( !m_destinyEventQueue->empty() )
     {
@@ -908,9 +940,12 @@ void Client::_SendQueuedUpdates() {
         PyIncRef( m_destinyEventQueue );
 
         //send it
-        PyTuple* t = nom.Encode();   //this is consumed below
-        t->Dump(DESTINY__UPDATES, "");
-        SendNotification( "OnMultiEvent", "charid", &t );
+        if( is_log_enabled( DESTINY__UPDATES ) )
+            nom.Dump( DESTINY__UPDATES, "" );
+
+        EVENotificationStream notify;
+        if( notify.MarshalArgs( nom ) )
+            SendNotification( "OnMultiEvent", "charid", notify );
     } //else nothing to be sent ...
 
     // clear the queues now, after the packets have been sent
@@ -922,17 +957,22 @@ void Client::SendNotification(const char *notifyType, const char *idType, PyTupl
 
     //build a little notification out of it.
     EVENotificationStream notify;
-    notify.remoteObject = 1;
     notify.args = *payload;
     *payload = NULL;    //consumed
 
+    SendNotification(notifyType, idType, notify, seq);
+}
+
+void Client::SendNotification(const char *notifyType, const char *idType, EVENotificationStream &noti, bool seq) {
+    noti.remoteObject = 1;
+
     PyAddress dest;
     dest.type = PyAddress::Broadcast;
     dest.service = notifyType;
     dest.bcast_idtype = idType;
 
     //now send it to the client
-    SendNotification(dest, notify, seq);
+    SendNotification(dest, noti, seq);
 }
 
 
@@ -954,7 +994,7 @@ void Client::SendNotification(const PyAddress &dest, EVENotificationStream &noti
 
     if(seq) {
         p->named_payload = new PyDict();
-        p->named_payload->SetItemString("sn", new PyInt(m_nextNotifySequence++));
+        p->named_payload->SetItemString("sn", new_int(m_nextNotifySequence++));
     }
 
     sLog.Log("Client","Sending notify of type %s with ID type %s", dest.service.c_str(), dest.bcast_idtype.c_str());
@@ -970,10 +1010,10 @@ void Client::SendNotification(const PyAddress &dest, EVENotificationStream &noti
 PyDict *Client::MakeSlimItem() const {
     PyDict *slim = DynamicSystemEntity::MakeSlimItem();
 
-    slim->SetItemString("charID", new PyInt(GetCharacterID()));
-    slim->SetItemString("corpID", new PyInt(GetCorporationID()));
-    slim->SetItemString("allianceID", new PyNone);
-    slim->SetItemString("warFactionID", new PyNone);
+    slim->SetItemString("charID", new_int(GetCharacterID()));
+    slim->SetItemString("corpID", new_int(GetCorporationID()));
+    slim->SetItemString("allianceID", new_none());
+    slim->SetItemString("warFactionID", new_none());
 
     //encode the mModulesMgr list, if we have any visible mModulesMgr
     std::vector<InventoryItemRef> items;
@@ -1568,7 +1608,7 @@ bool Client::_VerifyLogin( CryptoChallengePacket& ccp )
     CryptoServerHandshake server_shake;
 
     /* send passwordVersion required: 1=plain, 2=hashed */
-    PyRep* rsp = new PyInt( 2 );
+    PyRep* rsp = new_int( 2 );
 
     //sLog.Debug("Client","%s: Received Client Challenge.", GetAddress().c_str());
     //sLog.Debug("Client","Login with %s:", ccp.user_name.c_str());
@@ -1639,7 +1679,7 @@ bool Client::_VerifyLogin( CryptoChallengePacket& ccp )
 
     server_shake.serverChallenge = "";
     server_shake.func_marshaled_code = new PyBuffer( handshakeFunc, handshakeFunc + sizeof( handshakeFunc ) );
-    server_shake.verification = new PyBool( false );
+    server_shake.verification = new_bool( false );
     server_shake.cluster_usercount = _GetUserCount();
     server_shake.proxy_nodeid = 0xFFAA;
     server_shake.user_logonqueueposition = _GetQueuePosition();
@@ -1687,13 +1727,13 @@ bool Client::_VerifyFuncResult( CryptoHandshakeResult& result )
     CryptoHandshakeAck ack;
     ack.jit = GetLanguageID();
     ack.userid = GetAccountID();
-    ack.maxSessionTime = new PyNone;
+    ack.maxSessionTime = new_none();
     ack.userType = 1;
     ack.role = GetAccountRole();
     ack.address = GetAddress();
-    ack.inDetention = new PyNone;
+    ack.inDetention = new_none();
     // no client update available
-    ack.client_hash = new PyNone;
+    ack.client_hash = new_none();
     ack.user_clientid = GetAccountID();
     ack.live_updates = sLiveUpdateDB.GetUpdates();
 
@@ -1746,7 +1786,7 @@ bool Client::Handle_CallReq( PyPacket* packet, PyCallStream& req )
             packet->dest.Dump(CLIENT__ERROR, "    ");
 
 #pragma message( "TODO: throw proper exception to client (exceptions.ServiceNotFound)." )
-            throw PyException( new PyNone );
+            throw PyException( new_none() );
         }
     }
 
@@ -1757,18 +1797,53 @@ bool Client::Handle_CallReq( PyPacket* packet, PyCallStream& req )
         //this should be sLog.Debug, but because of the number of messages, I left it as .Log for readability, and ease of finding other debug messages
         sLog.Log("Server", "%s call made to %s",req.method.c_str(),packet->dest.service.c_str());
 
-    //build arguments
-    PyCallArgs args( this, req.arg_tuple, req.arg_dict );
+    //build arguments; these may still be marshaled, see PyCallArgs::Decode
+    PyCallArgs args( this, req.arg_tuple, req.arg_stream, req.arg_dict );
+
+    m_currentCall = packet;
+    m_currentCallDeferred = false;
 
     //parts of call may be consumed here
     PyResult result = dest->Call( req.method, args );
 
+    m_currentCall = NULL;
+
+    //the reply is sent once the deferred call is completed
+    if( m_currentCallDeferred )
+        return true;
+
     _SendSessionChange();  //send out the session change before the return.
     _SendCallReturn( packet->dest, packet->source.callID, &result.ssResult );
 
     return true;
 }
 
+PyDeferredCall* Client::DeferCall()
+{
+    assert( NULL != m_currentCall );
+
+    PyDeferredCall* call = new PyDeferredCall( this, m_currentCall->dest, m_currentCall->source.callID );
+    m_deferredCalls.insert( call );
+    m_currentCallDeferred = true;
+
+    return call;
+}
+
+void Client::ReturnDeferredCall( PyDeferredCall* call, PyRep** result )
+{
+    m_deferredCalls.erase( call );
+
+    _SendSessionChange();  //send out the session change before the return.
+    _SendCallReturn( call->mSource, call->mCallID, result );
+}
+
+void Client::ThrowDeferredCall( PyDeferredCall* call, PyRep** except )
+{
+    m_deferredCalls.erase( call );
+
+    _SendException( call->mSource, call->mCallID, CALL_REQ, WRAPPEDEXCEPTION, except );
+}
+
 bool Client::Handle_Notify( PyPacket* packet )
 {
     //turn this thing into a notify stream:
@@ -161,6 +161,7 @@ public:
 
     void SendNotification(const PyAddress &dest, EVENotificationStream &noti, bool seq=true);
     void SendNotification(const char *notifyType, const char *idType, PyTuple **payload, bool seq=true);
+    void SendNotification(const char *notifyType, const char *idType, EVENotificationStream &noti, bool seq=true);
 
     //destiny stuff...
     void WarpTo(const GPoint &p, double distance);
@@ -219,6 +220,8 @@ public:
     virtual PyDict *MakeSlimItem() const;
     virtual void QueueDestinyUpdate(PyTuple** du);
     virtual void QueueDestinyEvent(PyTuple** multiEvent);
+    virtual void QueueSharedDestinyUpdate(PyPreMarshaled* du);
+    virtual void QueueSharedDestinyEvent(PyPreMarshaled* multiEvent);
 
     virtual void TargetAdded(SystemEntity *who);
     virtual void TargetLost(SystemEntity *who);
@@ -237,6 +240,15 @@ public:
     void DisconnectClient();
     void BanClient();
 
+    /********************************************************************/
+    /* Deferred calls                                                   */
+    /********************************************************************/
+    //defers the reply to the call being handled, see PyCallArgs::Defer
+    PyDeferredCall* DeferCall();
+    //for PyDeferredCall; both consume the rep
+    void ReturnDeferredCall( PyDeferredCall* call, PyRep** result );
+    void ThrowDeferredCall( PyDeferredCall* call, PyRep** except );
+
 protected:
     void _ReduceDamage(Damage &d);
     void _UpdateSession( const CharacterConstRef& character );
@@ -274,6 +286,10 @@ protected:
 
     uint32 m_shipId;
 
+    PyPacket* m_currentCall;    //the call being handled, NULL otherwise; we do not own this
+    bool m_currentCallDeferred;
+    std::set<PyDeferredCall*> m_deferredCalls;    //we do not own these
+
     // THESE VARIABLES ARE HACKS AS WE DONT KNOW WHY THE CLIENT CALLS STOP AT UNDOCK
     // Capt: the reason why the client sends stop is because we undock with the shit already
     // having a speed. This results in the client taking action and tells the server to stop
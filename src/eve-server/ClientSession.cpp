@@ -38,7 +38,7 @@
 ClientSession::ClientSession() : mSession( new PyDict ), mDirty( false )
 {
     /* default value of attribute */
-    PyTuple* v = new_tuple(new PyNone, new PyLong(0x4000000000000000LL));
+    PyTuple* v = new_tuple(new_none(), new PyLong(0x4000000000000000LL));
     mSession->SetItemString( "role", v );
 }
 
@@ -73,7 +73,7 @@ int32 ClientSession::GetCurrentInt( const char* name ) const
 
 void ClientSession::SetInt( const char* name, int32 value )
 {
-    _Set( name, new PyInt( value ) );
+    _Set( name, new_int( value ) );
 }
 
 int64 ClientSession::GetLastLong( const char* name ) const
@@ -136,7 +136,7 @@ void ClientSession::SetString( const char* name, const char* value )
 
 void ClientSession::Clear( const char* name )
 {
-    _Set( name, new PyNone );
+    _Set( name, new_none() );
 }
 
 void ClientSession::EncodeChanges( PyDict* into )
@@ -198,8 +198,8 @@ void ClientSession::_Set( const char* name, PyRep* value )
     if( v == NULL )
     {
         v = new PyTuple( 2 );
-        v->SetItem( 0, new PyNone );
-        v->SetItem( 1, new PyNone );
+        v->SetItem( 0, new_none() );
+        v->SetItem( 1, new_none() );
         mSession->SetItemString( name, v );
     }
 
@@ -60,6 +60,8 @@ EVEServerConfig::EVEServerConfig()
     database.username = "eve";
     database.password = "eve";
     database.db = "evemu";
+    database.connections = 4;
+    database.workers = 2;
 
     // files
     files.logDir = "../log/";
@@ -69,6 +71,8 @@ EVEServerConfig::EVEServerConfig()
 
     // net
     net.port = 26000;
+    net.ioThreads = 4;
+    net.serializerThreads = 2;
     net.imageServer = "localhost";
     net.imageServerPort = 26001;
     net.apiServer = "localhost";
@@ -156,6 +160,8 @@ bool EVEServerConfig::ProcessDatabase( const TiXmlElement* ele )
     AddValueParser( "username", database.username );
     AddValueParser( "password", database.password );
     AddValueParser( "db",       database.db );
+    AddValueParser( "connections", database.connections );
+    AddValueParser( "workers", database.workers );
 
     const bool result = ParseElementChildren( ele );
 
@@ -164,6 +170,8 @@ bool EVEServerConfig::ProcessDatabase( const TiXmlElement* ele )
     RemoveParser( "username" );
     RemoveParser( "password" );
     RemoveParser( "db" );
+    RemoveParser( "connections" );
+    RemoveParser( "workers" );
 
     return result;
 }
@@ -188,6 +196,8 @@ bool EVEServerConfig::ProcessFiles( const TiXmlElement* ele )
 bool EVEServerConfig::ProcessNet( const TiXmlElement* ele )
 {
     AddValueParser( "port", net.port );
+    AddValueParser( "ioThreads", net.ioThreads );
+    AddValueParser( "serializerThreads", net.serializerThreads );
     AddValueParser( "imageServerPort", net.imageServerPort);
     AddValueParser( "imageServer", net.imageServer);
     AddValueParser( "apiServerPort", net.apiServerPort);
@@ -196,6 +206,8 @@ bool EVEServerConfig::ProcessNet( const TiXmlElement* ele )
     const bool result = ParseElementChildren( ele );
 
     RemoveParser( "port" );
+    RemoveParser( "ioThreads" );
+    RemoveParser( "serializerThreads" );
     RemoveParser( "imageServerPort" );
     RemoveParser( "imageServer" );
     RemoveParser( "apiServerPort" );
@@ -91,6 +91,10 @@ public:
         std::string password;
         /// A database to be used by server.
         std::string db;
+        /// Number of connections to the database server; should exceed workers + 1, as the main loop and the attribute writer keep one each.
+        uint32 connections;
+        /// Number of threads running asynchronous queries; should stay below connections - 1.
+        uint32 workers;
     } database;
 
     // From <files/>
@@ -111,6 +115,10 @@ public:
     {
         /// Port at which the server should listen.
         uint16 port;
+        /// Number of threads handling client connection I/O.
+        uint32 ioThreads;
+        /// Number of threads marshaling and compressing outgoing packets.
+        uint32 serializerThreads;
         /// Port at which the imageServer should listen.
         uint16 imageServerPort;
         /// the imageServer for char images. should be the evemu server external ip/host
@@ -280,10 +280,16 @@ void EntityList::Multicast( const char* notifyType, const char* idType, PyTuple*
 
 void EntityList::Multicast(const char *notifyType, const char *idType, PyTuple **in_payload, const MulticastTarget &mcset, bool seq)
 {
-    // consume payload
-    PyTuple *payload = *in_payload;
-    *in_payload = NULL;
+    //build a little notification out of it.
+    EVENotificationStream notify;
+    notify.args = *in_payload;
+    *in_payload = NULL;    //consumed
+
+    Multicast(notifyType, idType, notify, mcset, seq);
+}
 
+void EntityList::Multicast(const char *notifyType, const char *idType, EVENotificationStream &noti, const MulticastTarget &mcset, bool seq)
+{
     //cache all these locally to avoid calling empty all the time.
     const bool chars_empty = mcset.characters.empty();
     const bool locs_empty = mcset.locations.empty();
@@ -317,13 +323,9 @@ void EntityList::Multicast(const char *notifyType, const char *idType, PyTuple *
                 continue;
             }
 
-            PyTuple *temp = new PyTuple( *payload );
-            (*cur)->SendNotification( notifyType, idType, &temp, seq );
-
+            (*cur)->SendNotification( notifyType, idType, noti, seq );
         }
     }
-
-    PyDecRef( payload );
 }
 
 void EntityList::Multicast(const character_set &cset, const char *notifyType, const char *idType, PyTuple **in_payload, bool seq) const {
@@ -83,6 +83,7 @@ public:
     void Broadcast(const PyAddress &dest, EVENotificationStream &noti) const;
     void Multicast(const char *notifyType, const char *idType, PyTuple **payload, NotificationDestination target, uint32 target_id, bool seq=true);
     void Multicast(const char *notifyType, const char *idType, PyTuple **payload, const MulticastTarget &mcset, bool seq=true);
+    void Multicast(const char *notifyType, const char *idType, EVENotificationStream &noti, const MulticastTarget &mcset, bool seq=true);
     void Multicast(const character_set &cset, const PyAddress &dest, EVENotificationStream &noti) const;
     void Multicast(const character_set &cset, const char *notifyType, const char *idType, PyTuple **payload, bool seq=true) const;
     void Unicast(uint32 charID, const char *notifyType, const char *idType, PyTuple **payload, bool seq=true);
@@ -25,6 +25,7 @@
 
 #include "eve-server.h"
 
+#include "Client.h"
 #include "PyCallable.h"
 
 PyCallable::PyCallable()
@@ -56,10 +57,29 @@ PyResult PyCallable::Call(const std::string &method, PyCallArgs &args) {
 
 PyCallArgs::PyCallArgs(Client *c, PyTuple* tup, PyDict* dict)
 : client(c),
-  tuple(tup)
+  tuple(tup),
+  stream(NULL)
 {
     PyIncRef( tup );
 
+    _SetNamedArgs( dict );
+}
+
+PyCallArgs::PyCallArgs(Client *c, PyTuple* tup, PySubStream* args, PyDict* dict)
+: client(c),
+  tuple(tup),
+  stream(args)
+{
+    PySafeIncRef( tup );
+    PySafeIncRef( args );
+
+    _SetNamedArgs( dict );
+}
+
+void PyCallArgs::_SetNamedArgs(PyDict* dict) {
+    if(dict == NULL)
+        return;
+
     PyDict::const_iterator cur, end;
     cur = dict->begin();
     end = dict->end();
@@ -76,6 +96,7 @@ PyCallArgs::PyCallArgs(Client *c, PyTuple* tup, PyDict* dict)
 
 PyCallArgs::~PyCallArgs() {
     PySafeDecRef( tuple );
+    PySafeDecRef( stream );
 
     std::map<std::string, PyRep *>::iterator cur, end;
     cur = byname.begin();
@@ -89,7 +110,10 @@ void PyCallArgs::Dump(LogType type) const {
         return;
 
     _log(type, "  Call Arguments:");
-    tuple->Dump(type, "      ");
+    if(tuple != NULL)
+        tuple->Dump(type, "      ");
+    else if(stream != NULL)
+        stream->Dump(type, "      ");
     if(!byname.empty()) {
         _log(type, "  Call Named Arguments:");
         std::map<std::string, PyRep *>::const_iterator cur, end;
@@ -102,6 +126,28 @@ void PyCallArgs::Dump(LogType type) const {
     }
 }
 
+PyDeferredCall* PyCallArgs::Defer() {
+    return client->DeferCall();
+}
+
+bool PyCallArgs::LoadTuple() {
+    if(tuple != NULL)
+        return true;
+    if(stream == NULL)
+        return false;
+
+    stream->DecodeData();
+    if(stream->decoded() == NULL || !stream->decoded()->IsTuple()) {
+        _log(SERVICE__ERROR, "Unable to decode call arguments.");
+        return false;
+    }
+
+    tuple = stream->decoded()->AsTuple();
+    PyIncRef( tuple );
+
+    return true;
+}
+
 /* PyResult */
 PyResult::PyResult( PyRep* result ) : ssResult( NULL == result ? new PyNone : result ) {}
 PyResult::PyResult( const PyResult& oth ) : ssResult( NULL ) { *this = oth; }
@@ -118,6 +164,31 @@ PyResult& PyResult::operator=( const PyResult& oth )
     return *this;
 }
 
+/* PyDeferredCall */
+PyDeferredCall::PyDeferredCall( Client* c, const PyAddress& source, uint64 callID ) : mClient( c ), mSource( source ), mCallID( callID ) {}
+PyDeferredCall::~PyDeferredCall() {}
+
+void PyDeferredCall::Return( PyRep* result )
+{
+    if( NULL == result )
+        result = new PyNone;
+
+    if( NULL != mClient )
+        mClient->ReturnDeferredCall( this, &result );
+
+    PySafeDecRef( result );
+    delete this;
+}
+
+void PyDeferredCall::Throw( PyRep* except )
+{
+    if( NULL != mClient )
+        mClient->ThrowDeferredCall( this, &except );
+
+    PySafeDecRef( except );
+    delete this;
+}
+
 /* PyException */
 PyException::PyException( PyRep* except ) : ssException( NULL == except ? new PyNone : except ) {}
 PyException::PyException( const PyException& oth ) : ssException( NULL ) { *this = oth; }
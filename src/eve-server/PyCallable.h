@@ -34,21 +34,68 @@ class Client;
 class PyRep;
 class PyTuple;
 class PyDict;
+class PySubStream;
 
 class PyServiceMgr;
 class PyCallStream;
+class PyDeferredCall;
 
 class PyCallArgs
 {
 public:
     PyCallArgs( Client *c, PyTuple* tup, PyDict* dict );
+    //either tup or args may be NULL
+    PyCallArgs( Client *c, PyTuple* tup, PySubStream* args, PyDict* dict );
     ~PyCallArgs();
 
     void Dump( LogType type ) const;
 
+    /**
+     * @brief Makes sure tuple is set, unmarshaling the arguments if needed.
+     *
+     * @retval true  tuple is set.
+     * @retval false The arguments could not be unmarshaled.
+     */
+    bool LoadTuple();
+
+    /**
+     * @brief Decodes the arguments into given packet.
+     *
+     * If the arguments are still marshaled, the packet is loaded
+     * straight from the stream, without building tuple first.
+     *
+     * @param[out] args Packet generated by eve-xmlpktgen.
+     *
+     * @retval true  Decoding ran successfully.
+     * @retval false The arguments do not match the packet.
+     */
+    template<typename T>
+    bool Decode( T& args )
+    {
+        if( NULL == tuple && NULL != stream && NULL != stream->data() )
+            return args.UnmarshalFrom( stream->data()->content() );
+
+        return LoadTuple() && args.Decode( &tuple );
+    }
+
+    /**
+     * @brief Defers the reply to this call.
+     *
+     * The handler's return value is then discarded; the reply is sent
+     * once the returned object is completed, e.g. from the completion
+     * of an asynchronous query. Errors must be reported through it too.
+     *
+     * @return The deferred call, owned by the caller until completed.
+     */
+    PyDeferredCall* Defer();
+
     Client* const client;    //we do not own this
-    PyTuple* tuple;        //we own this, but it may be taken
+    PyTuple* tuple;        //we own this, but it may be taken; NULL until LoadTuple() if stream is set.
+    PySubStream* stream;    //we own this; the marshaled arguments, may be NULL.
     std::map<std::string, PyRep*> byname;    //we own this, but elements may be taken.
+
+protected:
+    void _SetNamedArgs( PyDict* dict );
 };
 
 class PyResult
@@ -63,6 +110,74 @@ public:
     PyRep* ssResult;
 };
 
+/**
+ * @brief Reply to a call, sent later.
+ *
+ * Obtained through PyCallArgs::Defer. Exactly one of Return and
+ * Throw must be called; it deletes the object. If the client has
+ * disconnected meanwhile, the reply is dropped.
+ */
+class PyDeferredCall
+{
+public:
+    /**
+     * @brief Sends the result of the call.
+     *
+     * @param[in] result The result; consumed, NULL means None.
+     */
+    void Return( PyRep* result );
+    /**
+     * @brief Sends an exception instead of the result.
+     *
+     * @param[in] except The exception; consumed.
+     */
+    void Throw( PyRep* except );
+
+    /** @return The calling client, NULL if it has disconnected. */
+    Client* client() const { return mClient; }
+
+protected:
+    //for Client:
+    friend class Client;
+    PyDeferredCall( Client* c, const PyAddress& source, uint64 callID );
+    ~PyDeferredCall();
+
+    Client* mClient;
+    const PyAddress mSource;
+    const uint64 mCallID;
+};
+
+/**
+ * @brief Completion of an asynchronous query which returns the
+ *        converted result to a deferred call.
+ *
+ * A failed query returns None, like most synchronous handlers do.
+ */
+template<typename R>
+class PyDeferredQuery
+: public DBQueryCompletion
+{
+public:
+    typedef R* ( *Converter )( DBQueryResult& result );
+
+    PyDeferredQuery( PyDeferredCall* call, Converter convert ) : mCall( call ), mConvert( convert ) {}
+
+    void Complete( bool success, DBQueryResult& result )
+    {
+        if( !success )
+        {
+            _log( SERVICE__ERROR, "Deferred query failed: %s", result.error.c_str() );
+            mCall->Return( NULL );
+        }
+        else
+            mCall->Return( mConvert( result ) );
+    }
+
+protected:
+    PyDeferredCall* const mCall;
+    const Converter mConvert;
+};
+
 class PyException
 {
 public:
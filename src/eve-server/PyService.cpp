@@ -76,7 +76,7 @@ PyResult PyService::Handle_MachoResolveObject(PyCallArgs &call) {
 PyResult PyService::Handle_MachoBindObject( PyCallArgs& call )
 {
     CallMachoBindObject args;
-    if( !args.Decode( &call.tuple ) )
+    if( !call.Decode( args ) )
     {
         codelog( SERVICE__ERROR, "%s Service: %s: Failed to decode arguments", GetName(), call.client->GetName() );
         return NULL;
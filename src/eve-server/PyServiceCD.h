@@ -38,7 +38,12 @@ class PyCallableDispatcher
     : public PyCallable::CallDispatcher
 {
     typedef PyResult (Svc::*CallProc)(PyCallArgs &call);
-    typedef typename std::map<std::string, CallProc>::iterator mapitr;
+
+    struct CallEntry {
+        CallProc proc;
+        bool streamed;  //the handler only uses PyCallArgs::Decode, so the tuple need not be built.
+    };
+    typedef typename std::map<std::string, CallEntry>::iterator mapitr;
 public:
     PyCallableDispatcher(Svc *parent)
     : m_parent(parent) {
@@ -47,8 +52,10 @@ public:
     virtual ~PyCallableDispatcher() {
     }
 
-    void RegisterCall(const char *call_name, CallProc p) {
-        m_serviceCalls[call_name] = p;
+    void RegisterCall(const char *call_name, CallProc p, bool streamed = false) {
+        CallEntry& e = m_serviceCalls[call_name];
+        e.proc = p;
+        e.streamed = streamed;
     }
 
     //CallDispatcher interface:
@@ -61,18 +68,26 @@ public:
             return NULL;
         }
 
-        CallProc p = res->second;
+        //most handlers expect the tuple
+        if(!res->second.streamed && !call.LoadTuple()) {
+            sLog.Error("Server","Unable to load arguments of call to '%s' by '%s'", method_name.c_str(), call.client->GetName());
+            return NULL;
+        }
+
+        CallProc p = res->second.proc;
         return (m_parent->*p)(call);
     }
 
 protected:   //_MAY_ consume args
-    std::map<std::string, CallProc> m_serviceCalls;
+    std::map<std::string, CallEntry> m_serviceCalls;
 
     Svc *const m_parent;    //we do not own this pointer
 };
 
 //convenience macro, you do not HAVE to use this
 #define PyCallable_REG_CALL(c,m) m_dispatch->RegisterCall(#m, &c::Handle_##m);
+//for handlers which get their arguments by PyCallArgs::Decode only
+#define PyCallable_REG_STREAM_CALL(c,m) m_dispatch->RegisterCall(#m, &c::Handle_##m, true);
 
 //macro of a template... nice.
 #define PyCallable_Make_Dispatcher(objname) \
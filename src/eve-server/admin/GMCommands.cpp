@@ -1345,3 +1345,23 @@ PyResult Command_kill( Client* who, CommandDB* db, PyServiceMgr* services, const
     return NULL;
 }
 
+PyResult Command_pystats( Client* who, CommandDB* db, PyServiceMgr* services, const Seperator& args )
+{
+    const PyRep::AllocStats stats = PyRep::GetAllocStats();
+    const PyArena::Stats arenaStats = PyArena::GetStats();
+
+    char reply[512];
+    snprintf( reply, 512,
+        "<br>"
+        "allocated: %" PRIu64 "<br>"
+        "alive: %" PRIu64 "<br>"
+        "shared on clone: %" PRIu64 "<br>"
+        "interned (allocations avoided): %" PRIu64 "<br>"
+        "allocated from arenas: %" PRIu64 "<br>"
+        "arena chunks: %" PRIu64 " (%" PRIu64 " bytes)",
+        stats.allocated, stats.alive, stats.shared, stats.interned,
+        arenaStats.allocations, arenaStats.chunks, arenaStats.chunkBytes
+    );
+
+    return new PyString( reply );
+}
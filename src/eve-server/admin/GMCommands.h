@@ -63,6 +63,8 @@ COMMAND( kenny, ROLE_ADMIN,
         "(ON,OFF,0,1) - enable/disable the Kenny Translator for your chatting entertainment!")
 COMMAND( kill, ROLE_ADMIN,
         "(entityID) - insta-pops a destroyable ship, drone, structure, if applicable")
+COMMAND( pystats, ROLE_ADMIN,
+        "- reports allocation statistics of Python objects")
 /*COMMAND( entity, ROLE_ADMIN,
         "(entityID) - unknown" )
 COMMAND( chatban, ROLE_ADMIN,
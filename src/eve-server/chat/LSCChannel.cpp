@@ -330,7 +330,6 @@ void LSCChannel::SendMessage(Client * c, const char * message, bool self) {
     }
     }
 
-    PyTuple *answerNotKennyfied;
     sm_NotKennyfied.channelID = EncodeID();
     sm_NotKennyfied.message = message;
     sm_NotKennyfied.member_count = notKennyfiedCharListSize;
@@ -345,16 +344,19 @@ void LSCChannel::SendMessage(Client * c, const char * message, bool self) {
             normal_to_kennyspeak(sm_NotKennyfied.message, kennyfied_message);
             sm_NotKennyfied.message = kennyfied_message;
         }
-        answerNotKennyfied = sm_NotKennyfied.Encode();
-        m_service->entityList().Multicast("OnLSC", GetTypeString(), &answerNotKennyfied, mct_NotKennyfied);
+        //marshal it just once, for all the recipients.
+        EVENotificationStream notifyNotKennyfied;
+        if( notifyNotKennyfied.MarshalArgs( sm_NotKennyfied ) )
+            m_service->entityList().Multicast("OnLSC", GetTypeString(), notifyNotKennyfied, mct_NotKennyfied);
     }
 
     sm_Kennyfied.channelID = EncodeID();
     sm_Kennyfied.message = message;
     sm_Kennyfied.member_count = kennyfiedCharListSize;
 
-    PyTuple *answerKennyfied = sm_Kennyfied.Encode();
-    m_service->entityList().Multicast("OnLSC", GetTypeString(), &answerKennyfied, mct_Kennyfied);
+    EVENotificationStream notifyKennyfied;
+    if( notifyKennyfied.MarshalArgs( sm_Kennyfied ) )
+        m_service->entityList().Multicast("OnLSC", GetTypeString(), notifyKennyfied, mct_Kennyfied);
 }
 
 bool LSCChannel::IsJoined(uint32 charID) {
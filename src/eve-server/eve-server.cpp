@@ -79,6 +79,7 @@
 // imageserver services
 #include "imageserver/ImageServer.h"
 // inventory services
+#include "inventory/AttributeSaveQueue.h"
 #include "inventory/InvBrokerService.h"
 // mail services
 #include "mail/MailMgrService.h"
@@ -131,6 +132,8 @@ static void CatchSignal( int sig_num );
 
 static const char* const CONFIG_FILE = EVEMU_ROOT "/etc/eve-server.xml";
 static const uint32 MAIN_LOOP_DELAY = 10; // delay 10 ms.
+static const uint32 DATABASE_PING_INTERVAL = 60 * 1000; // ping idle database connections every minute.
+static const uint32 ATTRIBUTE_FLUSH_INTERVAL = 1000; // store saved attributes every second.
 
 static volatile bool RunLoops = true;
 dgmtypeattributemgr * _sDgmTypeAttrMgr;
@@ -185,6 +188,9 @@ int main( int argc, char* argv[] )
     //it is important to do this before doing much of anything, in case they use it.
     Timer::SetCurrentTime();
 
+    //build the interned objects before any thread can ask for them
+    init_interned();
+
     // Load server log settings ( will be removed )
     if( load_log_settings( sConfig.files.logSettings.c_str() ) )
         sLog.Success( "server init", "Log settings loaded from %s", sConfig.files.logSettings.c_str() );
@@ -208,7 +214,9 @@ int main( int argc, char* argv[] )
         sConfig.database.username.c_str(),
         sConfig.database.password.c_str(),
         sConfig.database.db.c_str(),
-        sConfig.database.port ) )
+        sConfig.database.port,
+        false, false,
+        sConfig.database.connections ) )
     {
         sLog.Error( "server init", "Unable to connect to the database: %s", err.c_str() );
         std::cout << std::endl << "press any key to exit...";  std::cin.get();
@@ -216,6 +224,41 @@ int main( int argc, char* argv[] )
     }
     _sDgmTypeAttrMgr = new dgmtypeattributemgr(); // needs to be after db init as its using it
 
+    //Start up the database workers; the main loop and the attribute writer use a connection each
+    if( sConfig.database.connections <= sConfig.database.workers + 1 )
+        sLog.Warning( "server init", "%u database connections are too few for %u workers; threads will wait for each other's queries.",
+                      sConfig.database.connections, sConfig.database.workers );
+    if( !sDatabase.StartWorkers( sConfig.database.workers ) )
+    {
+        sLog.Error( "server init", "Failed to start database worker threads." );
+        std::cout << std::endl << "press any key to exit...";  std::cin.get();
+        return 1;
+    }
+
+    //Start up the attribute writer thread
+    if( !sAttributeSaveQueue.Start() )
+    {
+        sLog.Error( "server init", "Failed to start attribute writer thread." );
+        std::cout << std::endl << "press any key to exit...";  std::cin.get();
+        return 1;
+    }
+
+    //Start up the network I/O threads
+    if( !sNetReactor.Start( sConfig.net.ioThreads ) )
+    {
+        sLog.Error( "server init", "Failed to start network I/O threads." );
+        std::cout << std::endl << "press any key to exit...";  std::cin.get();
+        return 1;
+    }
+
+    //Start up the packet serializer threads
+    if( !EVETCPConnection::StartSerializers( sConfig.net.serializerThreads ) )
+    {
+        sLog.Error( "server init", "Failed to start packet serializer threads." );
+        std::cout << std::endl << "press any key to exit...";  std::cin.get();
+        return 1;
+    }
+
     //Start up the TCP server
     EVETCPServer tcps;
 
@@ -362,12 +405,26 @@ int main( int argc, char* argv[] )
     uint32 etime;
     uint32 last_time = GetTickCount();
 
+    Timer dbPingTimer( DATABASE_PING_INTERVAL );
+    Timer attributeFlushTimer( ATTRIBUTE_FLUSH_INTERVAL );
+
     EVETCPConnection* tcpc;
     while( RunLoops == true )
     {
         Timer::SetCurrentTime();
         start = GetTickCount();
 
+        // keep idle database connections alive, reopen lost ones
+        if( dbPingTimer.Check() )
+            sDatabase.ping();
+
+        // finish calls waiting for asynchronous queries
+        sDatabase.ProcessCompletions();
+
+        // store saved attributes in the background
+        if( attributeFlushTimer.Check() )
+            sAttributeSaveQueue.BeginFlush();
+
         //check for timeouts in other threads
         //timeout_manager.CheckTimeouts();
         while( ( tcpc = tcps.PopConnection() ) )
@@ -384,6 +441,9 @@ int main( int argc, char* argv[] )
         last_time = GetTickCount();
         etime = last_time - start;
 
+        // let compression back off if we are overloaded
+        CompressionPolicy::ReportTickTime( etime, MAIN_LOOP_DELAY );
+
         // do the stuff for thread sleeping
         if( MAIN_LOOP_DELAY > etime )
             Sleep( MAIN_LOOP_DELAY - etime );
@@ -395,6 +455,36 @@ int main( int argc, char* argv[] )
     tcps.Close();
     sLog.Log("server shutdown", "TCP listener stopped." );
 
+    const TCPConnection::SendStats sendStats = TCPConnection::GetTotalSendStats();
+    sLog.Log("server shutdown", "Sent %" PRIu64 " packets (%" PRIu64 " bytes) in %" PRIu64 " send calls.",
+             sendStats.packets, sendStats.bytes, sendStats.sendCalls );
+
+    const PyRep::AllocStats pyStats = PyRep::GetAllocStats();
+    sLog.Log("server shutdown", "Allocated %" PRIu64 " Python objects, %" PRIu64 " clones were shared, %" PRIu64 " allocations avoided by interning.",
+             pyStats.allocated, pyStats.shared, pyStats.interned );
+
+    const EVETCPConnection::SerializeStats serializeStats = EVETCPConnection::GetSerializeStats();
+    sLog.Log("server shutdown", "Serialized packets in %" PRIu64 " jobs, at most %lu packets were queued.",
+             serializeStats.pool.jobs, serializeStats.maxQueueDepth );
+
+    // Shutting down attribute writer, storing what's left
+    if( !sAttributeSaveQueue.Stop() )
+        sLog.Error("server shutdown", "Failed to store all item attributes." );
+    sLog.Log("server shutdown", "Attribute writer thread stopped." );
+
+    // Shutting down database workers, completing what they've done
+    sDatabase.StopWorkers();
+    sDatabase.ProcessCompletions();
+    sLog.Log("server shutdown", "Database worker threads stopped." );
+
+    // Shutting down packet serializer threads
+    EVETCPConnection::StopSerializers();
+    sLog.Log("server shutdown", "Packet serializer threads stopped." );
+
+    // Shutting down network I/O threads
+    sNetReactor.Stop();
+    sLog.Log("server shutdown", "Network I/O threads stopped." );
+
     // Shutting down API Server:
     sAPIServer.Stop();
     sLog.Log("server shutdown", "Image Server TCP listener stopped." );
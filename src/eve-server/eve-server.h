@@ -77,6 +77,7 @@
 #include "network/EVEPktDispatch.h"
 #include "network/EVESession.h"
 // marshal
+#include "marshal/CompressionPolicy.h"
 #include "marshal/EVEMarshal.h"
 #include "marshal/EVEMarshalOpcodes.h"
 #include "marshal/EVEMarshalStringTable.h"
@@ -103,6 +104,7 @@
 #include "packets/Tutorial.h"
 #include "packets/Mail.h"
 // python
+#include "python/PyArena.h"
 #include "python/PyVisitor.h"
 #include "python/PyRep.h"
 #include "python/PyPacket.h"
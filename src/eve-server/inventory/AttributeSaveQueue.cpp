@@ -0,0 +1,297 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#include "eve-server.h"
+
+#include "inventory/AttributeSaveQueue.h"
+#include "threading/Atomic.h"
+
+/*************************************************************************/
+/* AttributeSaveQueue::FlushJob                                          */
+/*************************************************************************/
+void AttributeSaveQueue::FlushJob::Run()
+{
+    // values queued from now on need another job
+    AtomicStore( mQueue.mFlushPosted, 0L );
+
+    mQueue.Write();
+}
+
+/*************************************************************************/
+/* AttributeSaveQueue::Key                                               */
+/*************************************************************************/
+bool AttributeSaveQueue::Key::operator<( const Key& oth ) const
+{
+    if( isDefault != oth.isDefault )
+        return isDefault < oth.isDefault;
+    if( itemID != oth.itemID )
+        return itemID < oth.itemID;
+    return attributeID < oth.attributeID;
+}
+
+/*************************************************************************/
+/* AttributeSaveQueue                                                    */
+/*************************************************************************/
+AttributeSaveQueue::AttributeSaveQueue()
+: mStoredValues( 0 ),
+  mStatements( 0 ),
+  mWriter( "Attributes" ),
+  mFlushJob( *this ),
+  mFlushPosted( 0 )
+{
+    for( size_t t = 0; t < 2; ++t )
+    {
+        for( size_t i = 0; i < BATCH_SIZE_COUNT; ++i )
+        {
+            std::string& sql = mSQL[ t ][ i ];
+
+            sql = ( t ? "REPLACE INTO entity_default_attributes" : "REPLACE INTO entity_attributes" );
+            sql += " (itemID, attributeID, valueInt, valueFloat) VALUES (?, ?, ?, ?)";
+
+            for( size_t row = 1; row < ( (size_t)1 << i ); ++row )
+                sql += ", (?, ?, ?, ?)";
+        }
+    }
+}
+
+AttributeSaveQueue::~AttributeSaveQueue()
+{
+    mWriter.Stop();
+}
+
+bool AttributeSaveQueue::Start()
+{
+    return mWriter.Start( 1 );
+}
+
+bool AttributeSaveQueue::Stop()
+{
+    mWriter.Stop();
+    const bool res = Flush();
+
+    sLog.Log( "AttributeSaveQueue", "Stored %" PRIu64 " attribute values with %" PRIu64 " statements.",
+              mStoredValues, mStatements );
+
+    if( !res )
+    {
+        MutexLock lock( mMQueue );
+        sLog.Error( "AttributeSaveQueue", "%lu attribute values have not been stored.", (unsigned long)mQueued.size() );
+    }
+
+    return res;
+}
+
+void AttributeSaveQueue::Queue( bool isDefault, uint32 itemID, uint32 attributeID, const EvilNumber& value )
+{
+    Key key;
+    key.isDefault = isDefault;
+    key.itemID = itemID;
+    key.attributeID = attributeID;
+
+    MutexLock lock( mMQueue );
+    mQueued[ key ] = value;
+}
+
+void AttributeSaveQueue::Discard( bool isDefault, uint32 itemID )
+{
+    MutexLock wlock( mMWrite );
+    MutexLock lock( mMQueue );
+
+    Key key;
+    key.isDefault = isDefault;
+    key.itemID = itemID;
+    key.attributeID = 0;
+
+    ValueMap::iterator begin = mQueued.lower_bound( key );
+    ValueMap::iterator end = begin;
+    while( end != mQueued.end() && end->first.isDefault == isDefault && end->first.itemID == itemID )
+        ++end;
+
+    mQueued.erase( begin, end );
+
+    std::map<Key, uint32>::iterator abegin = mAttempts.lower_bound( key );
+    std::map<Key, uint32>::iterator aend = abegin;
+    while( aend != mAttempts.end() && aend->first.isDefault == isDefault && aend->first.itemID == itemID )
+        ++aend;
+
+    mAttempts.erase( abegin, aend );
+}
+
+bool AttributeSaveQueue::IsQueued( bool isDefault, uint32 itemID ) const
+{
+    MutexLock lock( mMQueue );
+
+    if( mWriting.find( std::make_pair( isDefault, itemID ) ) != mWriting.end() )
+        return true;
+
+    Key key;
+    key.isDefault = isDefault;
+    key.itemID = itemID;
+    key.attributeID = 0;
+
+    ValueMap::const_iterator res = mQueued.lower_bound( key );
+    return ( res != mQueued.end() && res->first.isDefault == isDefault && res->first.itemID == itemID );
+}
+
+void AttributeSaveQueue::BeginFlush()
+{
+    {
+        MutexLock lock( mMQueue );
+        if( mQueued.empty() )
+            return;
+    }
+
+    if( 0 == AtomicExchange( mFlushPosted, 1L ) )
+        mWriter.Post( &mFlushJob );
+}
+
+bool AttributeSaveQueue::Flush()
+{
+    return Write();
+}
+
+bool AttributeSaveQueue::Write()
+{
+    MutexLock wlock( mMWrite );
+
+    ValueMap batch;
+    {
+        MutexLock lock( mMQueue );
+        batch.swap( mQueued );
+
+        ValueMap::const_iterator cur, end;
+        cur = batch.begin();
+        end = batch.end();
+        for(; cur != end; ++cur )
+            mWriting.insert( std::make_pair( cur->first.isDefault, cur->first.itemID ) );
+    }
+
+    // collect rows of a table, storing them in as few statements as possible
+    ValueMap::iterator rows[ MAX_BATCH_SIZE ];
+    size_t count = 0;
+    ValueMap failed;
+
+    ValueMap::iterator cur = batch.begin();
+    while( count > 0 || cur != batch.end() )
+    {
+        if( cur != batch.end()
+            && count < MAX_BATCH_SIZE
+            && ( 0 == count || rows[ 0 ]->first.isDefault == cur->first.isDefault ) )
+        {
+            rows[ count++ ] = cur++;
+            continue;
+        }
+
+        // largest prepared batch which fits
+        size_t size = MAX_BATCH_SIZE;
+        while( size > count )
+            size >>= 1;
+
+        if( !Store( rows, size ) )
+        {
+            // find the rows which fail on their own
+            for( size_t i = 0; i < size; ++i )
+            {
+                if( ( 1 == size || !Store( &rows[ i ], 1 ) ) && Retry( *rows[ i ] ) )
+                    failed.insert( *rows[ i ] );
+            }
+        }
+
+        count -= size;
+        for( size_t i = 0; i < count; ++i )
+            rows[ i ] = rows[ size + i ];
+    }
+
+    MutexLock lock( mMQueue );
+    mWriting.clear();
+
+    // retry on the next flush; values queued meanwhile are newer, keep those
+    mQueued.insert( failed.begin(), failed.end() );
+
+    return failed.empty();
+}
+
+bool AttributeSaveQueue::Store( ValueMap::iterator* rows, size_t count )
+{
+    size_t sizeIndex = 0;
+    while( ( (size_t)1 << sizeIndex ) < count )
+        ++sizeIndex;
+
+    const bool isDefault = rows[ 0 ]->first.isDefault;
+    DBStatement stmt( mSQL[ isDefault ? 1 : 0 ][ sizeIndex ].c_str() );
+
+    for( size_t i = 0; i < count; ++i )
+    {
+        const Key& key = rows[ i ]->first;
+        EvilNumber& value = rows[ i ]->second;
+
+        stmt.Param( key.itemID );
+        stmt.Param( key.attributeID );
+
+        if( value.get_type() == evil_number_int )
+        {
+            stmt.Param( value.get_int() );
+            stmt.ParamNull();
+        }
+        else
+        {
+            stmt.ParamNull();
+            stmt.Param( value.get_float() );
+        }
+    }
+
+    if( !sDatabase.RunStatement( stmt ) )
+    {
+        sLog.Error( "AttributeSaveQueue", "Failed to store %lu %sattribute values: %s",
+                    (unsigned long)count, ( isDefault ? "DEFAULT " : "" ), stmt.error.c_str() );
+        return false;
+    }
+
+    mStoredValues += count;
+    ++mStatements;
+
+    if( !mAttempts.empty() )
+    {
+        for( size_t i = 0; i < count; ++i )
+            mAttempts.erase( rows[ i ]->first );
+    }
+
+    return true;
+}
+
+bool AttributeSaveQueue::Retry( const ValueMap::value_type& row )
+{
+    const Key& key = row.first;
+
+    uint32& attempts = mAttempts[ key ];
+    if( ++attempts < MAX_STORE_ATTEMPTS )
+        return true;
+
+    sLog.Error( "AttributeSaveQueue", "Dropping %sattribute %u of item %u after %u failed writes.",
+                ( key.isDefault ? "DEFAULT " : "" ), key.attributeID, key.itemID, attempts );
+    mAttempts.erase( key );
+
+    return false;
+}
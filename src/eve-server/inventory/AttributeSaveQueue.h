@@ -0,0 +1,195 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#ifndef __INVENTORY__ATTRIBUTE_SAVE_QUEUE_H__INCL__
+#define __INVENTORY__ATTRIBUTE_SAVE_QUEUE_H__INCL__
+
+#include "threading/Mutex.h"
+#include "threading/WorkerPool.h"
+#include "utils/EvilNumber.h"
+#include "utils/Singleton.h"
+
+/**
+ * @brief Write-behind store of item attributes.
+ *
+ * Saved attributes are queued in memory, where later values
+ * replace earlier ones of the same attribute. The queue is
+ * written out with multi-row REPLACE statements, either by
+ * a background thread (see BeginFlush) or synchronously by Flush.
+ * Writes happen in the order the values were queued. A batch which
+ * fails is stored row by row, so one bad value doesn't hold back the
+ * others. Values which failed to be stored are queued again, unless
+ * newer values of the same attributes have been queued meanwhile;
+ * after MAX_STORE_ATTEMPTS failed writes, they are dropped.
+ */
+class AttributeSaveQueue
+: public Singleton<AttributeSaveQueue>
+{
+public:
+    AttributeSaveQueue();
+    /**
+     * @brief Destructor; stops the background thread.
+     */
+    ~AttributeSaveQueue();
+
+    /**
+     * @brief Starts the background thread.
+     *
+     * Until it runs, BeginFlush writes on the calling thread.
+     *
+     * @return True if the thread is running, false if not.
+     */
+    bool Start();
+    /**
+     * @brief Stops the background thread and writes out the queue.
+     *
+     * @return True if the queue has been stored, false if values are left.
+     */
+    bool Stop();
+
+    /**
+     * @brief Queues a value of an attribute.
+     *
+     * @param[in] isDefault   True for entity_default_attributes, false for entity_attributes.
+     * @param[in] itemID      ID of the item.
+     * @param[in] attributeID ID of the attribute.
+     * @param[in] value       The value.
+     */
+    void Queue( bool isDefault, uint32 itemID, uint32 attributeID, const EvilNumber& value );
+    /**
+     * @brief Drops queued values of an item, whose attributes are about to be deleted.
+     *
+     * Waits for a write in progress, so the values aren't stored after the delete.
+     *
+     * @param[in] isDefault True for entity_default_attributes, false for entity_attributes.
+     * @param[in] itemID    ID of the item.
+     */
+    void Discard( bool isDefault, uint32 itemID );
+    /**
+     * @brief Checks whether an item has values which aren't stored yet.
+     *
+     * @param[in] isDefault True for entity_default_attributes, false for entity_attributes.
+     * @param[in] itemID    ID of the item.
+     *
+     * @return True if values of the item are queued or being written.
+     */
+    bool IsQueued( bool isDefault, uint32 itemID ) const;
+
+    /**
+     * @brief Lets the background thread write out the queue.
+     *
+     * Does nothing if the queue is empty or a write is pending already.
+     */
+    void BeginFlush();
+    /**
+     * @brief Writes out the queue, returning once it's stored.
+     *
+     * @return True if the queue has been stored, false if some values failed to.
+     */
+    bool Flush();
+
+protected:
+    /** Writes out the queue when run. */
+    class FlushJob
+    : public WorkerJob
+    {
+    public:
+        FlushJob( AttributeSaveQueue& queue ) : mQueue( queue ) {}
+
+        void Run();
+
+    protected:
+        AttributeSaveQueue& mQueue;
+    };
+
+    /** Identifies a queued attribute; ordered by table, then item. */
+    struct Key
+    {
+        bool isDefault;
+        uint32 itemID;
+        uint32 attributeID;
+
+        bool operator<( const Key& oth ) const;
+    };
+    typedef std::map<Key, EvilNumber> ValueMap;
+
+    /**
+     * @brief Stores a batch of rows of one table with a single statement.
+     *
+     * @param[in] rows  The rows.
+     * @param[in] count Number of rows; must be one of the prepared batch sizes.
+     *
+     * @return True if the rows have been stored, false if not.
+     */
+    bool Store( ValueMap::iterator* rows, size_t count );
+    /**
+     * @brief Counts a failed write of a row.
+     *
+     * @param[in] row The row.
+     *
+     * @return True if the row should be retried, false if it's dropped.
+     */
+    bool Retry( const ValueMap::value_type& row );
+    /** Takes the queue and stores it; returns false if some values had to be queued again. */
+    bool Write();
+
+    /** Number of prepared batch sizes; they are 1, 2, 4, ... rows. */
+    static const size_t BATCH_SIZE_COUNT = 7;
+    /** Maximal number of rows in a statement. */
+    static const size_t MAX_BATCH_SIZE = 1 << ( BATCH_SIZE_COUNT - 1 );
+    /** Number of failed writes after which a value is dropped. */
+    static const uint32 MAX_STORE_ATTEMPTS = 5;
+
+    /** The REPLACE statements by table and batch size. */
+    std::string mSQL[ 2 ][ BATCH_SIZE_COUNT ];
+
+    /** Protects the queue and the items being written. */
+    mutable Mutex mMQueue;
+    /** The queued values. */
+    ValueMap mQueued;
+    /** Items with values being written, pairs of isDefault and itemID. */
+    std::set< std::pair<bool, uint32> > mWriting;
+
+    /** Held while writing, so writes don't overtake each other. */
+    Mutex mMWrite;
+    /** Failed writes of values being retried; protected by mMWrite. */
+    std::map<Key, uint32> mAttempts;
+    /** Number of stored values. */
+    uint64 mStoredValues;
+    /** Number of statements storing them. */
+    uint64 mStatements;
+
+    /** The background thread. */
+    WorkerPool mWriter;
+    /** The job run by the background thread. */
+    FlushJob mFlushJob;
+    /** Nonzero while the job is posted. */
+    volatile long mFlushPosted;
+};
+
+#define sAttributeSaveQueue \
+    ( AttributeSaveQueue::get() )
+
+#endif /* !__INVENTORY__ATTRIBUTE_SAVE_QUEUE_H__INCL__ */
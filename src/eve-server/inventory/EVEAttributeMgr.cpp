@@ -27,6 +27,7 @@
 
 #include "Client.h"
 #include "EntityList.h"
+#include "inventory/AttributeSaveQueue.h"
 #include "inventory/EVEAttributeMgr.h"
 #include "inventory/InventoryDB.h"
 #include "inventory/InventoryItem.h"
@@ -605,9 +606,28 @@ bool AttributeMap::Load()
     for (; itr != attr_set->attributeset.end(); itr++)
         SetAttribute((*itr)->attributeID, (*itr)->number, false);
 
+    /* The saved attributes may have been loaded along with the rest of our inventory */
+    InventoryDB::AttributeValues preloaded;
+    if (mItem.GetItemFactory()->TakePreloadedAttributes(mDefault, mItem.itemID(), preloaded))
+    {
+        InventoryDB::AttributeValues::iterator cur = preloaded.begin();
+        for (; cur != preloaded.end(); cur++)
+            SetAttribute(cur->first, cur->second, false);
+
+        return true;
+    }
+
     /* Then we load the saved attributes from the db, if there are any yet, and overwrite the defaults */
     DBQueryResult res;
 
+    // make sure the db has what has been saved before; values of other items may fail meanwhile
+    if(sAttributeSaveQueue.IsQueued(mDefault, mItem.itemID())
+        && !sAttributeSaveQueue.Flush()
+        && sAttributeSaveQueue.IsQueued(mDefault, mItem.itemID())) {
+        sLog.Error("AttributeMap", "Failed to store queued attributes of item %u before loading them.", mItem.itemID());
+        return false;
+    }
+
 	if(mDefault)
 	{
 		if(!sDatabase.RunQuery(res, "SELECT * FROM entity_default_attributes WHERE itemID='%u'", mItem.itemID())) {
@@ -703,70 +723,16 @@ bool AttributeMap::Load()
 
 bool AttributeMap::SaveIntAttribute(uint32 attributeID, int64 value)
 {
-    // SAVE INTEGER ATTRIBUTE
-    DBerror err;
-
-	if(mDefault)
-	{
-		if(!sDatabase.RunQuery(err,
-			"REPLACE INTO entity_default_attributes"
-			"   (itemID, attributeID, valueInt, valueFloat)"
-			" VALUES"
-			"   (%u, %u, %d, NULL)",
-			mItem.itemID(), attributeID, value)
-		) {
-			codelog(SERVICE__ERROR, "Failed to store DEFAULT attribute %d for item %u: %s", attributeID, mItem.itemID(), err.c_str());
-			return false;
-		}
-	}
-	else
-	{
-		if(!sDatabase.RunQuery(err,
-			"REPLACE INTO entity_attributes"
-			"   (itemID, attributeID, valueInt, valueFloat)"
-			" VALUES"
-			"   (%u, %u, %d, NULL)",
-			mItem.itemID(), attributeID, value)
-		) {
-			codelog(SERVICE__ERROR, "Failed to store attribute %d for item %u: %s", attributeID, mItem.itemID(), err.c_str());
-			return false;
-		}
-	}
+    // SAVE INTEGER ATTRIBUTE, written behind
+    sAttributeSaveQueue.Queue(mDefault, mItem.itemID(), attributeID, EvilNumber(value));
 
     return true;
 }
 
 bool AttributeMap::SaveFloatAttribute(uint32 attributeID, double value)
 {
-    // SAVE FLOAT ATTRIBUTE
-    DBerror err;
-
-	if(mDefault)
-	{
-		if(!sDatabase.RunQuery(err,
-			"REPLACE INTO entity_default_attributes"
-			"   (itemID, attributeID, valueInt, valueFloat)"
-			" VALUES"
-			"   (%u, %u, NULL, %f)",
-			mItem.itemID(), attributeID, value)
-		) {
-			codelog(SERVICE__ERROR, "Failed to store DEFAULT attribute %d for item %u: %s", attributeID, mItem.itemID(), err.c_str());
-			return false;
-		}
-	}
-	else
-	{
-		if(!sDatabase.RunQuery(err,
-			"REPLACE INTO entity_attributes"
-			"   (itemID, attributeID, valueInt, valueFloat)"
-			" VALUES"
-			"   (%u, %u, NULL, %f)",
-			mItem.itemID(), attributeID, value)
-		) {
-			codelog(SERVICE__ERROR, "Failed to store attribute %d for item %u: %s", attributeID, mItem.itemID(), err.c_str());
-			return false;
-		}
-	}
+    // SAVE FLOAT ATTRIBUTE, written behind
+    sAttributeSaveQueue.Queue(mDefault, mItem.itemID(), attributeID, EvilNumber(value));
 
     return true;
 }
@@ -775,56 +741,17 @@ bool AttributeMap::SaveFloatAttribute(uint32 attributeID, double value)
 /* we should save skills */
 bool AttributeMap::Save()
 {
-	bool success = false;
-
     /* if nothing changed... it means this action has been successful we return true... */
     if (mChanged == false)
         return true;
 
+    // the values are coalesced and stored in batches by sAttributeSaveQueue
     AttrMapItr itr = mAttributes.begin();
     AttrMapItr itr_end = mAttributes.end();
     for (; itr != itr_end; itr++)
     {
-        if ( itr->second.get_type() == evil_number_int ) {
-
-            DBerror err;
-
-			if(mDefault)
-			{
-				success = sDatabase.RunQuery(err,
-					"REPLACE INTO entity_default_attributes (itemID, attributeID, valueInt, valueFloat) VALUES (%u, %u, %" PRId64 ", NULL)",
-					mItem.itemID(), itr->first, itr->second.get_int());
-			}
-			else
-			{
-				success = sDatabase.RunQuery(err,
-					"REPLACE INTO entity_attributes (itemID, attributeID, valueInt, valueFloat) VALUES (%u, %u, %" PRId64 ", NULL)",
-					mItem.itemID(), itr->first, itr->second.get_int());
-			}
-
-            if (!success)
-                sLog.Error("AttributeMap", "unable to save attribute");
-
-        } else if (itr->second.get_type() == evil_number_float ) {
-
-            DBerror err;
-
-			if(mDefault)
-			{
-				success = sDatabase.RunQuery(err,
-					"REPLACE INTO entity_default_attributes (itemID, attributeID, valueInt, valueFloat) VALUES (%u, %u, NULL, %f)",
-					mItem.itemID(), itr->first, itr->second.get_float());
-			}
-			else
-			{
-				success = sDatabase.RunQuery(err,
-					"REPLACE INTO entity_attributes (itemID, attributeID, valueInt, valueFloat) VALUES (%u, %u, NULL, %f)",
-					mItem.itemID(), itr->first, itr->second.get_float());
-			}
-
-            if (!success)
-                sLog.Error("AttributeMap", "unable to save attribute");
-        }
+        if ( itr->second.get_type() == evil_number_int || itr->second.get_type() == evil_number_float )
+            sAttributeSaveQueue.Queue(mDefault, mItem.itemID(), itr->first, itr->second);
     }
 
     mChanged = false;
@@ -842,6 +769,9 @@ bool AttributeMap::Delete()
 {
     // Remove all attributes from the entity_default_attributes table or entity_attributes table for this item:
     DBerror err;
+
+    // values waiting to be saved would bring them back
+    sAttributeSaveQueue.Discard(mDefault, mItem.itemID());
     
 	if(mDefault)
 	{
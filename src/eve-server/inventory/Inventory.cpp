@@ -146,28 +146,35 @@ bool Inventory::LoadContents(ItemFactory &factory)
 
     sLog.Debug("Inventory", "Recursively loading contents of inventory %u", inventoryID() );
 
-    //load the list of items we need
-    std::vector<uint32> items;
+    //load the items we need, along with their attributes
+    std::map<uint32, ItemData> items;
     if( !GetItems( factory, items ) )
     {
         sLog.Error("Inventory", "Failed  to get items of %u", inventoryID() );
         return false;
     }
 
+    std::vector<uint32> itemIDs;
+    std::map<uint32, ItemData>::iterator cur, end;
+    cur = items.begin();
+    end = items.end();
+    for(; cur != end; cur++)
+        itemIDs.push_back( cur->first );
+
+    if( !factory.PreloadAttributes( inventoryID(), itemIDs ) )
+        sLog.Error("Inventory", "Failed to preload attributes of items of %u, loading them one by one", inventoryID() );
+
     //Now get each one from the factory (possibly recursing)
-    ItemData into;
     uint32 characterID = 0;
     uint32 corporationID = 0;
     uint32 locationID = 0;
-    std::vector<uint32>::iterator cur, end;
     cur = items.begin();
-    end = items.end();
     for(; cur != end; cur++)
     {
         // Each "cur" item should be checked to see if they are "owned" by the character connected to this client,
         // and if not, then do not "get" the entire contents of this for() loop for that item, except in the case that
         // this item is located in space or belongs to this character's corporation:
-        factory.db().GetItem( *cur, into );
+        const ItemData &into = cur->second;
         if( factory.GetUsingClient() != NULL )
         {
             characterID = factory.GetUsingClient()->GetCharacterID();
@@ -187,10 +194,10 @@ bool Inventory::LoadContents(ItemFactory &factory)
             if( factory.GetUsingClient() == NULL )
                 sLog.Error( "Inventory::LoadContents()", "WARNING! Loading Contents while ItemFactory::GetUsingClient() returned NULL!" );
 
-            InventoryItemRef i = factory.GetItem( *cur );
+            InventoryItemRef i = factory.GetItem( cur->first, into );
             if( !i )
             {
-                sLog.Error("Inventory::LoadContents()", "Failed to load item %u contained in %u. Skipping.", *cur, inventoryID() );
+                sLog.Error("Inventory::LoadContents()", "Failed to load item %u contained in %u. Skipping.", cur->first, inventoryID() );
                 continue;
             }
 
@@ -198,6 +205,9 @@ bool Inventory::LoadContents(ItemFactory &factory)
         }
     }
 
+    // attributes of items which were skipped or loaded before
+    factory.DropPreloadedAttributes( itemIDs );
+
     mContentsLoaded = true;
     return true;
 }
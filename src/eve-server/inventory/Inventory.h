@@ -95,7 +95,7 @@ protected:
     virtual void AddItem(InventoryItemRef item);
     virtual void RemoveItem(InventoryItemRef item);
 
-    virtual bool GetItems(ItemFactory &factory, std::vector<uint32> &into) const { return factory.db().GetItemContents( inventoryID(), into ); }
+    virtual bool GetItems(ItemFactory &factory, std::map<uint32, ItemData> &into) const { return factory.db().GetItemContents( inventoryID(), into ); }
 
     bool mContentsLoaded;
     std::map<uint32, InventoryItemRef> mContents;    //maps item ID to its instance. we own a ref to all of these.
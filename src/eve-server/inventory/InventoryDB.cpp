@@ -410,116 +410,108 @@ bool InventoryDB::GetStationType(uint32 stationTypeID, StationTypeData &into) {
 }
 
 bool InventoryDB::GetItem(uint32 itemID, ItemData &into) {
-    DBQueryResult res;
+    const char *query;
 
     // For certain ranges of itemID-s we use specialized tables:
     if(IsRegion(itemID)) {
         //region
-        if(!sDatabase.RunQuery(res,
+        query =
             "SELECT"
             " regionName, 3 AS typeID, factionID, 1 AS locationID, 0 AS flag, 0 AS contraband,"
             " 1 AS singleton, 1 AS quantity, x, y, z, '' AS customInfo"
             " FROM mapRegions"
-            " WHERE regionID=%u", itemID))
-        {
-            codelog(SERVICE__ERROR, "Error in query for region %u: %s", itemID, res.error.c_str());
-            return NULL;
-        }
+            " WHERE regionID=?";
     } else if(IsConstellation(itemID)) {
         //contellation
-        if(!sDatabase.RunQuery(res,
+        query =
             "SELECT"
             " constellationName, 4 AS typeID, factionID, regionID, 0 AS flag, 0 AS contraband,"
             " 1 AS singleton, 1 AS quantity, x, y, z, '' AS customInfo"
             " FROM mapConstellations"
-            " WHERE constellationID=%u", itemID))
-        {
-            codelog(SERVICE__ERROR, "Error in query for contellation %u: %s", itemID, res.error.c_str());
-            return NULL;
-        }
+            " WHERE constellationID=?";
     } else if(IsSolarSystem(itemID)) {
         //solar system
-        if(!sDatabase.RunQuery(res,
+        query =
             "SELECT"
             " solarSystemName, 5 AS typeID, factionID, constellationID, 0 AS flag, 0 AS contraband,"
             " 1 AS singleton, 1 AS quantity, x, y, z, '' AS customInfo"
             " FROM mapSolarSystems"
-            " WHERE solarSystemID=%u", itemID))
-        {
-            codelog(SERVICE__ERROR, "Error in query for solar system %u: %s", itemID, res.error.c_str());
-            return NULL;
-        }
+            " WHERE solarSystemID=?";
     } else if(IsUniverseCelestial(itemID)) {
         //use mapDenormalize
-        if(!sDatabase.RunQuery(res,
+        query =
             "SELECT"
             " itemName, typeID, 1 AS ownerID, solarSystemID, 0 AS flag, 0 AS contraband,"
             " 1 AS singleton, 1 AS quantity, x, y, z, '' AS customInfo"
             " FROM mapDenormalize"
-            " WHERE itemID=%u", itemID))
-        {
-            codelog(SERVICE__ERROR, "Error in query for universe celestial %u: %s", itemID, res.error.c_str());
-            return NULL;
-        }
+            " WHERE itemID=?";
     } else if(IsStargate(itemID)) {
         //use mapDenormalize LEFT-JOIN-ing mapSolarSystems to get factionID
-        if(!sDatabase.RunQuery(res,
+        query =
             "SELECT"
             " itemName, typeID, factionID, solarSystemID, 0 AS flag, 0 AS contraband,"
             " 1 AS singleton, 1 AS quantity, mapDenormalize.x, mapDenormalize.y, mapDenormalize.z, '' AS customInfo"
             " FROM mapDenormalize"
             " LEFT JOIN mapSolarSystems USING (solarSystemID)"
-            " WHERE itemID=%u", itemID))
-        {
-            codelog(SERVICE__ERROR, "Error in query for stargate %u: %s", itemID, res.error.c_str());
-            return NULL;
-        }
+            " WHERE itemID=?";
     } else if(IsStation(itemID)) {
         //station
-        if(!sDatabase.RunQuery(res,
+        query =
             "SELECT"
             " stationName, stationTypeID, corporationID, solarSystemID, 0 AS flag, 0 AS contraband,"
             " 1 AS singleton, 1 AS quantity, x, y, z, '' AS customInfo"
             " FROM staStations"
-            " WHERE stationID=%u", itemID))
-        {
-            codelog(SERVICE__ERROR, "Error in query for station %u: %s", itemID, res.error.c_str());
-            return NULL;
-        }
+            " WHERE stationID=?";
     } else {
         //fallback to entity
-        if(!sDatabase.RunQuery(res,
+        query =
             "SELECT"
             " itemName, typeID, ownerID, locationID, flag, contraband,"
             " singleton, quantity, x, y, z, customInfo"
-            " FROM entity WHERE itemID=%u", itemID))
-        {
-            codelog(SERVICE__ERROR, "Error in query for item %u: %s", itemID, res.error.c_str());
-            return NULL;
-        }
+            " FROM entity WHERE itemID=?";
     }
 
-    DBResultRow row;
-    if(!res.GetRow(row))
+    DBStatement stmt(query);
+    stmt.Param(itemID);
+
+    bool ownerNull, locationNull;
+    uint32 flag;
+    int32 contraband, singleton;
+    double x, y, z;
+
+    stmt.Result(into.name);
+    stmt.Result(into.typeID);
+    stmt.Result(into.ownerID, &ownerNull);
+    stmt.Result(into.locationID, &locationNull);
+    stmt.Result(flag);
+    stmt.Result(contraband);
+    stmt.Result(singleton);
+    stmt.Result(into.quantity);
+    stmt.Result(x);
+    stmt.Result(y);
+    stmt.Result(z);
+    stmt.Result(into.customInfo);
+
+    if(!sDatabase.RunStatement(stmt))
     {
-        codelog(SERVICE__ERROR, "Item %u not found.", itemID);
+        codelog(SERVICE__ERROR, "Error in query for item %u: %s", itemID, stmt.error.c_str());
         return false;
     }
 
-    into.name = row.GetText(0);
-    into.typeID = row.GetUInt(1);
-    into.ownerID = (row.IsNull(2) ? 1 : row.GetUInt(2));
-    into.locationID = (row.IsNull(3) ? 1 : row.GetUInt(3));
-    into.flag = (EVEItemFlags)row.GetUInt(4);
-    into.contraband = (row.GetInt(5) ? true : false);
-    into.singleton = (row.GetInt(6) ? true : false);
-    into.quantity = row.GetUInt(7);
-
-    into.position.x = row.GetDouble(8);
-    into.position.y = row.GetDouble(9);
-    into.position.z = row.GetDouble(10);
+    if(!stmt.Fetch())
+    {
+        codelog(SERVICE__ERROR, "Item %u not found.", itemID);
+        return false;
+    }
 
-    into.customInfo = (row.IsNull(11) ? "" : row.GetText(11));
+    if(ownerNull)
+        into.ownerID = 1;
+    if(locationNull)
+        into.locationID = 1;
+    into.flag = (EVEItemFlags)flag;
+    into.contraband = (contraband ? true : false);
+    into.singleton = (singleton ? true : false);
+    into.position = GPoint(x, y, z);
 
     return true;
 }
@@ -623,11 +615,6 @@ bool InventoryDB::DeleteItem(uint32 itemID) {
     return true;
 }
 
-//this could be optimized to load the full row of each
-//item which is to be loaded (and used to be), but it made
-//for some overly complex knowledge in the DB side which
-// really did not belong here, so weo go to the simpler
-// solution until it becomes a problem.
 bool InventoryDB::GetItemContents(uint32 itemID, std::vector<uint32> &into)
 {
     DBQueryResult res;
@@ -696,6 +683,77 @@ bool InventoryDB::GetItemContents(uint32 itemID, EVEItemFlags flag, uint32 owner
     return true;
 }
 
+//loads the full row of each item, so loading an inventory
+//doesn't need one query per item
+bool InventoryDB::GetItemContents(uint32 itemID, std::map<uint32, ItemData> &into)
+{
+    DBStatement stmt(
+        "SELECT"
+        " itemID, itemName, typeID, ownerID, locationID, flag, contraband,"
+        " singleton, quantity, x, y, z, customInfo"
+        " FROM entity"
+        " WHERE locationID=?");
+    stmt.Param(itemID);
+
+    uint32 contentID, flag;
+    int32 contraband, singleton;
+    double x, y, z;
+    bool ownerNull, locationNull;
+    ItemData data;
+
+    stmt.Result(contentID);
+    stmt.Result(data.name);
+    stmt.Result(data.typeID);
+    stmt.Result(data.ownerID, &ownerNull);
+    stmt.Result(data.locationID, &locationNull);
+    stmt.Result(flag);
+    stmt.Result(contraband);
+    stmt.Result(singleton);
+    stmt.Result(data.quantity);
+    stmt.Result(x);
+    stmt.Result(y);
+    stmt.Result(z);
+    stmt.Result(data.customInfo);
+
+    if(!sDatabase.RunStatement(stmt))
+    {
+        codelog(SERVICE__ERROR, "Error in query for item %u: %s", itemID, stmt.error.c_str());
+        return false;
+    }
+
+    std::vector<uint32> staticItems;
+    while(stmt.Fetch())
+    {
+        // static map items come from their own tables, see GetItem
+        if(IsStaticMapItem(contentID)) {
+            staticItems.push_back(contentID);
+            continue;
+        }
+
+        if(ownerNull)
+            data.ownerID = 1;
+        if(locationNull)
+            data.locationID = 1;
+        data.flag = (EVEItemFlags)flag;
+        data.contraband = (contraband ? true : false);
+        data.singleton = (singleton ? true : false);
+        data.position = GPoint(x, y, z);
+
+        into[contentID] = data;
+    }
+
+    std::vector<uint32>::iterator cur, end;
+    cur = staticItems.begin();
+    end = staticItems.end();
+    for(; cur != end; cur++)
+    {
+        if(GetItem(*cur, data))
+            into[*cur] = data;
+    }
+
+    return true;
+}
+
 bool InventoryDB::LoadTypeAttributes(uint32 typeID, EVEAttributeMgr &into) {
 #if 0
     DBQueryResult res;
@@ -793,31 +851,83 @@ bool InventoryDB::LoadItemAttributes(uint32 itemID, EVEAttributeMgr &into) {
     return true;
 }
 
+bool InventoryDB::LoadItemContentsAttributes(uint32 itemID, bool isDefault, std::map<uint32, AttributeValues> &into) {
+    DBStatement stmt(isDefault
+        ? "SELECT"
+          " a.itemID,"
+          " a.attributeID,"
+          " a.valueInt,"
+          " a.valueFloat"
+          " FROM entity_default_attributes AS a"
+          " JOIN entity AS e ON e.itemID = a.itemID"
+          " WHERE e.locationID=?"
+        : "SELECT"
+          " a.itemID,"
+          " a.attributeID,"
+          " a.valueInt,"
+          " a.valueFloat"
+          " FROM entity_attributes AS a"
+          " JOIN entity AS e ON e.itemID = a.itemID"
+          " WHERE e.locationID=?");
+    stmt.Param(itemID);
+
+    uint32 contentID, attributeID;
+    int64 valueInt;
+    double valueFloat;
+    bool intNull;
+
+    stmt.Result(contentID);
+    stmt.Result(attributeID);
+    stmt.Result(valueInt, &intNull);
+    stmt.Result(valueFloat);
+
+    if(!sDatabase.RunStatement(stmt))
+    {
+        _log(DATABASE__ERROR, "Failed to query attributes of contents of item %u: %s.", itemID, stmt.error.c_str());
+        return false;
+    }
+
+    while(stmt.Fetch())
+    {
+        // same precedence as AttributeMap::Load
+        if(!intNull)
+            into[contentID][attributeID] = EvilNumber(valueInt);
+        else
+            into[contentID][attributeID] = EvilNumber(valueFloat);
+    }
+
+    return true;
+}
+
 bool InventoryDB::UpdateAttribute_int(uint32 itemID, uint32 attributeID, int v) {
-    DBerror err;
-    if(!sDatabase.RunQuery(err,
+    DBStatement stmt(
         "REPLACE INTO entity_attributes"
         "   (itemID, attributeID, valueInt, valueFloat)"
         " VALUES"
-        "   (%u, %u, %d, NULL)",
-        itemID, attributeID, v)
-    ) {
-        codelog(SERVICE__ERROR, "Failed to store attribute %d for item %u: %s", attributeID, itemID, err.c_str());
+        "   (?, ?, ?, NULL)");
+    stmt.Param(itemID);
+    stmt.Param(attributeID);
+    stmt.Param((int32)v);
+
+    if(!sDatabase.RunStatement(stmt)) {
+        codelog(SERVICE__ERROR, "Failed to store attribute %d for item %u: %s", attributeID, itemID, stmt.error.c_str());
         return false;
     }
     return true;
 }
 
 bool InventoryDB::UpdateAttribute_double(uint32 itemID, uint32 attributeID, double v) {
-    DBerror err;
-    if(!sDatabase.RunQuery(err,
+    DBStatement stmt(
         "REPLACE INTO entity_attributes"
         "   (itemID, attributeID, valueInt, valueFloat)"
         " VALUES"
-        "   (%u, %u, NULL, %f)",
-        itemID, attributeID, v)
-    ) {
-        codelog(SERVICE__ERROR, "Failed to store attribute %d for item %u: %s", attributeID, itemID, err.c_str());
+        "   (?, ?, NULL, ?)");
+    stmt.Param(itemID);
+    stmt.Param(attributeID);
+    stmt.Param(v);
+
+    if(!sDatabase.RunStatement(stmt)) {
+        codelog(SERVICE__ERROR, "Failed to store attribute %d for item %u: %s", attributeID, itemID, stmt.error.c_str());
         return false;
     }
     return true;
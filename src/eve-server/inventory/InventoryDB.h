@@ -164,6 +164,14 @@ public:
     bool GetItemContents(uint32 itemID, std::vector<uint32> &into);
     bool GetItemContents(uint32 itemID, EVEItemFlags flag, std::vector<uint32> &into);
     bool GetItemContents(uint32 itemID, EVEItemFlags flag, uint32 ownerID, std::vector<uint32> &into);
+    /**
+     * Loads data of all items in given item.
+     *
+     * @param[in] itemID ID of item which contents should be loaded.
+     * @param[in] into Map of item IDs to item data.
+     * @return True if load was successful, false if not.
+     */
+    bool GetItemContents(uint32 itemID, std::map<uint32, ItemData> &into);
 
     /*
      * Item attribute stuff
@@ -178,6 +186,17 @@ public:
      */
     bool LoadItemAttributes(uint32 itemID, EVEAttributeMgr &into);
 
+    typedef std::map<uint32, EvilNumber> AttributeValues;
+    /**
+     * Loads saved attributes of all items in given item.
+     *
+     * @param[in] itemID ID of item which contents' attributes should be loaded.
+     * @param[in] isDefault True to load entity_default_attributes, false to load entity_attributes.
+     * @param[in] into Map of item IDs to their attribute values; items without saved attributes are left out.
+     * @return True if load was successful, false if not.
+     */
+    bool LoadItemContentsAttributes(uint32 itemID, bool isDefault, std::map<uint32, AttributeValues> &into);
+
     bool UpdateAttribute_int(uint32 itemID, uint32 attributeID, int v);
     bool UpdateAttribute_double(uint32 itemID, uint32 attributeID, double v);
     bool EraseAttribute(uint32 itemID, uint32 attributeID);
@@ -160,6 +160,11 @@ InventoryItemRef InventoryItem::Load(ItemFactory &factory, uint32 itemID)
     return InventoryItem::Load<InventoryItem>( factory, itemID );
 }
 
+InventoryItemRef InventoryItem::Load(ItemFactory &factory, uint32 itemID, const ItemData &data)
+{
+    return InventoryItem::Load<InventoryItem>( factory, itemID, data );
+}
+
 template<class _Ty>
 RefPtr<_Ty> InventoryItem::_LoadItem(ItemFactory &factory, uint32 itemID,
     // InventoryItem stuff:
@@ -614,14 +619,14 @@ PyPackedRow* InventoryItem::GetItemStatusRow() const
 
 void InventoryItem::GetItemStatusRow( PyPackedRow* into ) const
 {
-    into->SetField( "instanceID",    new PyLong( itemID() ) );
-	into->SetField( "online",        new PyBool( (mAttributeMap.HasAttribute(AttrIsOnline) ? GetAttribute(AttrIsOnline).get_int() : 0) ) );
-    into->SetField( "damage",        new PyFloat( (mAttributeMap.HasAttribute(AttrDamage) ? GetAttribute(AttrDamage).get_float() : 0) ) );
-    into->SetField( "charge",        new PyFloat( (mAttributeMap.HasAttribute(AttrCharge) ? GetAttribute(AttrCharge).get_float() : 0) ) );
-    into->SetField( "skillPoints",   new PyInt( (mAttributeMap.HasAttribute(AttrSkillPoints) ? GetAttribute(AttrSkillPoints).get_int() : 0) ) );
-    into->SetField( "armorDamage",   new PyFloat( (mAttributeMap.HasAttribute(AttrArmorDamageAmount) ? GetAttribute(AttrArmorDamageAmount).get_float() : 0.0) ) );
-    into->SetField( "shieldCharge",  new PyFloat( (mAttributeMap.HasAttribute(AttrShieldCharge) ? GetAttribute(AttrShieldCharge).get_float() : 0.0) ) );
-    into->SetField( "incapacitated", new PyBool( (mAttributeMap.HasAttribute(AttrIsIncapacitated) ? GetAttribute(AttrIsIncapacitated).get_int() : 0) ) );
+    into->SetFieldInt( "instanceID",    itemID() );
+	into->SetFieldInt( "online",        (mAttributeMap.HasAttribute(AttrIsOnline) ? GetAttribute(AttrIsOnline).get_int() : 0) );
+    into->SetFieldFloat( "damage",        (mAttributeMap.HasAttribute(AttrDamage) ? GetAttribute(AttrDamage).get_float() : 0) );
+    into->SetFieldFloat( "charge",        (mAttributeMap.HasAttribute(AttrCharge) ? GetAttribute(AttrCharge).get_float() : 0) );
+    into->SetFieldInt( "skillPoints",   (mAttributeMap.HasAttribute(AttrSkillPoints) ? GetAttribute(AttrSkillPoints).get_int() : 0) );
+    into->SetFieldFloat( "armorDamage",   (mAttributeMap.HasAttribute(AttrArmorDamageAmount) ? GetAttribute(AttrArmorDamageAmount).get_float() : 0.0) );
+    into->SetFieldFloat( "shieldCharge",  (mAttributeMap.HasAttribute(AttrShieldCharge) ? GetAttribute(AttrShieldCharge).get_float() : 0.0) );
+    into->SetFieldInt( "incapacitated", (mAttributeMap.HasAttribute(AttrIsIncapacitated) ? GetAttribute(AttrIsIncapacitated).get_int() : 0) );
 }
 
 PyPackedRow* InventoryItem::GetItemRow() const
@@ -652,14 +657,14 @@ PyPackedRow* InventoryItem::GetItemRow() const
 
 void InventoryItem::GetItemRow( PyPackedRow* into ) const
 {
-    into->SetField( "itemID",     new PyLong( itemID() ) );
-    into->SetField( "typeID",     new PyInt( typeID() ) );
-    into->SetField( "ownerID",    new PyInt( ownerID() ) );
-    into->SetField( "locationID", new PyLong( locationID() ) );
-    into->SetField( "flagID",     new PyInt( flag() ) );
-    into->SetField( "quantity",   new PyInt( singleton() ? -1 : quantity()) );
-    into->SetField( "groupID",    new PyInt( groupID() ) );
-    into->SetField( "categoryID", new PyInt( categoryID() ) );
+    into->SetFieldInt( "itemID",     itemID() );
+    into->SetFieldInt( "typeID",     typeID() );
+    into->SetFieldInt( "ownerID",    ownerID() );
+    into->SetFieldInt( "locationID", locationID() );
+    into->SetFieldInt( "flagID",     flag() );
+    into->SetFieldInt( "quantity",   singleton() ? -1 : quantity() );
+    into->SetFieldInt( "groupID",    groupID() );
+    into->SetFieldInt( "categoryID", categoryID() );
     into->SetField( "customInfo", new PyString( customInfo() ) );
 
     //into->SetField( "singleton",  new PyBool( singleton() ) );
@@ -686,12 +691,12 @@ bool InventoryItem::Populate( Rsp_CommonGetInfo_Entry& result )
         es.env_charID = ownerID();  //may not be quite right...
         es.env_shipID = locationID();
         es.env_target = locationID();   //this is what they do.
-        es.env_other = new PyNone;
+        es.env_other = new_none();
         es.env_effectID = effectOnline;
         es.startTime = Win32TimeNow() - Win32Time_Hour; //act like it happened an hour ago
         es.duration = INT_MAX;
         es.repeat = 0;
-        es.randomSeed = new PyNone;
+        es.randomSeed = new_none();
 
         result.activeEffects[es.env_effectID] = es.Encode();
     }
@@ -760,9 +765,9 @@ void InventoryItem::Move(uint32 new_location, EVEItemFlags new_flag, bool notify
         std::map<int32, PyRep *> changes;
 
         if( new_location != old_location )
-            changes[ixLocationID] = new PyInt(old_location);
+            changes[ixLocationID] = new_int(old_location);
         if( new_flag != old_flag )
-            changes[ixFlag] = new PyInt(old_flag);
+            changes[ixFlag] = new_int(old_flag);
 
         SendItemChange( ownerID(), changes );   //changes is consumed
     }
@@ -802,7 +807,7 @@ bool InventoryItem::SetQuantity(uint32 qty_new, bool notify) {
         std::map<int32, PyRep *> changes;
 
         //send the notify to the new owner.
-        changes[ixQuantity] = new PyInt(old_qty);
+        changes[ixQuantity] = new_int(old_qty);
         SendItemChange(m_ownerID, changes); //changes is consumed
     }
 
@@ -818,7 +823,7 @@ bool InventoryItem::SetFlag(EVEItemFlags new_flag, bool notify) {
         std::map<int32, PyRep *> changes;
 	
 	//send the notify to the new owner.
-	changes[ixFlag] = new PyInt(new_flag);
+	changes[ixFlag] = new_int(new_flag);
 	SendItemChange(m_ownerID, changes); //changes is consumed
     }
     return true;
@@ -892,7 +897,7 @@ bool InventoryItem::ChangeSingleton(bool new_singleton, bool notify) {
     //notify about the changes.
     if(notify) {
         std::map<int32, PyRep *> changes;
-        changes[ixSingleton] = new PyInt(old_singleton);
+        changes[ixSingleton] = new_int(old_singleton);
         SendItemChange(m_ownerID, changes); //changes is consumed
     }
 
@@ -914,11 +919,11 @@ void InventoryItem::ChangeOwner(uint32 new_owner, bool notify) {
         std::map<int32, PyRep *> changes;
 
         //send the notify to the new owner.
-        changes[ixOwnerID] = new PyInt(old_owner);
+        changes[ixOwnerID] = new_int(old_owner);
         SendItemChange(new_owner, changes); //changes is consumed
 
         //also send the notify to the old owner.
-        changes[ixOwnerID] = new PyInt(old_owner);
+        changes[ixOwnerID] = new_int(old_owner);
         SendItemChange(old_owner, changes); //changes is consumed
     }
 }
@@ -993,20 +998,20 @@ void InventoryItem::SetOnline(bool online) {
     ogf.active = online?1:0;
 
 	PyList *environment = new PyList;
-	environment->AddItem(new PyInt(ogf.itemID));
-	environment->AddItem(new PyInt(m_ownerID));
-	environment->AddItem(new PyInt(m_locationID));
-	environment->AddItem(new PyNone);
-	environment->AddItem(new PyNone);
-	environment->AddItem(new PyNone);
-	environment->AddItem(new PyInt(ogf.effectID));
+	environment->AddItem(new_int(ogf.itemID));
+	environment->AddItem(new_int(m_ownerID));
+	environment->AddItem(new_int(m_locationID));
+	environment->AddItem(new_none());
+	environment->AddItem(new_none());
+	environment->AddItem(new_none());
+	environment->AddItem(new_int(ogf.effectID));
 	
 	ogf.environment = environment;
 	ogf.startTime = ogf.when;
 	ogf.duration = 10000;
-	ogf.repeat = online?new PyInt(1000):new PyInt(0);
-    ogf.randomSeed = new PyNone();
-    ogf.error = new PyNone();
+	ogf.repeat = online?new_int(1000):new_int(0);
+    ogf.randomSeed = new_none();
+    ogf.error = new_none();
 
     Notify_OnMultiEvent multi;
     multi.events = new PyList;
@@ -1034,20 +1039,20 @@ void InventoryItem::SetActive(bool active, uint32 effectID, double duration, boo
 	shipEffect.active = active?1:0;
 
 	PyList* env = new PyList;
-	env->AddItem(new PyInt(m_itemID));
-	env->AddItem(new PyInt(ownerID()));
-	env->AddItem(new PyInt(m_locationID));
-	env->AddItem(new PyNone);				//targetID
-	env->AddItem(new PyNone);				//otherID
-	env->AddItem(new PyNone);				//area
-	env->AddItem(new PyInt(effectID));
+	env->AddItem(new_int(m_itemID));
+	env->AddItem(new_int(ownerID()));
+	env->AddItem(new_int(m_locationID));
+	env->AddItem(new_none());				//targetID
+	env->AddItem(new_none());				//otherID
+	env->AddItem(new_none());				//area
+	env->AddItem(new_int(effectID));
 
 	shipEffect.environment = env;
 	shipEffect.startTime = shipEffect.when;
 	shipEffect.duration = duration;
-	shipEffect.repeat = repeat?new PyInt(1000):new PyInt(0);
-	shipEffect.randomSeed = new PyNone;
-	shipEffect.error = new PyNone;
+	shipEffect.repeat = repeat?new_int(1000):new_int(0);
+	shipEffect.randomSeed = new_none();
+	shipEffect.error = new_none();
 
 	Notify_OnMultiEvent multi;
     multi.events = new PyList;
@@ -96,6 +96,15 @@ public:
      * @return Pointer to InventoryItem object; NULL if failed.
      */
     static InventoryItemRef Load(ItemFactory &factory, uint32 itemID);
+    /**
+     * Loads item using data which has been loaded already.
+     *
+     * @param[in] factory
+     * @param[in] itemID ID of item to load.
+     * @param[in] data Item data of item to load.
+     * @return Pointer to InventoryItem object; NULL if failed.
+     */
+    static InventoryItemRef Load(ItemFactory &factory, uint32 itemID, const ItemData &data);
     /**
      * Spawns new item.
      *
@@ -256,6 +265,21 @@ protected:
         return i;
     }
 
+    template<class _Ty>
+    static RefPtr<_Ty> Load(ItemFactory &factory, uint32 itemID, const ItemData &data)
+    {
+        // static load
+        RefPtr<_Ty> i = _Ty::template _Load<_Ty>( factory, itemID, data );
+        if( !i )
+            return RefPtr<_Ty>();
+
+        // dynamic load
+        if( !i->_Load() )
+            return RefPtr<_Ty>();
+
+        return i;
+    }
+
     // Template loader:
     template<class _Ty>
     static RefPtr<_Ty> _Load(ItemFactory &factory, uint32 itemID)
@@ -265,6 +289,12 @@ protected:
         if( !factory.db().GetItem( itemID, data ) )
             return RefPtr<_Ty>();
 
+        return _Ty::template _Load<_Ty>( factory, itemID, data );
+    }
+
+    template<class _Ty>
+    static RefPtr<_Ty> _Load(ItemFactory &factory, uint32 itemID, const ItemData &data)
+    {
         // obtain type
         const ItemType *type = factory.GetType( data.typeID );
         if( type == NULL )
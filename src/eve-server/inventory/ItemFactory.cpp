@@ -26,6 +26,7 @@
 #include "eve-server.h"
 
 #include "character/Character.h"
+#include "inventory/AttributeSaveQueue.h"
 #include "manufacturing/Blueprint.h"
 #include "pos/Structure.h"
 #include "ship/Ship.h"
@@ -56,6 +57,9 @@ ItemFactory::~ItemFactory() {
 				sLog.Log( "Saving Items", " %3.2f%%", (current_percent_items_saved * 100.0) );
 			}
         }
+        // attributes are written behind, make sure they're stored
+        if( !sAttributeSaveQueue.Flush() )
+            sLog.Error( "Saving Items", "Failed to store item attributes; they stay queued." );
 		sLog.Log( "Saving Items", " COMPLETE!" );
     }
     // types
@@ -184,6 +188,23 @@ InventoryItemRef ItemFactory::GetItem(uint32 itemID)
     return _GetItem<InventoryItem>( itemID );
 }
 
+InventoryItemRef ItemFactory::GetItem(uint32 itemID, const ItemData &data)
+{
+    std::map<uint32, InventoryItemRef>::iterator res = m_items.find( itemID );
+    if( res == m_items.end() )
+    {
+        // load the item from the data we've got
+        InventoryItemRef item = InventoryItem::Load( *this, itemID, data );
+        if( !item )
+            return InventoryItemRef();
+
+        //we keep the original ref.
+        res = m_items.insert( std::make_pair( itemID, item ) ).first;
+    }
+    // return to the user.
+    return res->second;
+}
+
 BlueprintRef ItemFactory::GetBlueprint(uint32 blueprintID)
 {
     return _GetItem<Blueprint>( blueprintID );
@@ -354,3 +375,67 @@ void ItemFactory::UnsetUsingClient()
 {
     m_pClient = NULL;
 }
+
+bool ItemFactory::PreloadAttributes(uint32 locationID, const std::vector<uint32> &itemIDs)
+{
+    // the database must have what has been saved so far
+    std::vector<uint32>::const_iterator cur, end;
+    cur = itemIDs.begin();
+    end = itemIDs.end();
+    for(; cur != end; cur++)
+    {
+        if( sAttributeSaveQueue.IsQueued( false, *cur ) || sAttributeSaveQueue.IsQueued( true, *cur ) )
+        {
+            if( !sAttributeSaveQueue.Flush() )
+            {
+                // values of other items may fail, only these matter
+                for( cur = itemIDs.begin(); cur != end; cur++ )
+                {
+                    if( sAttributeSaveQueue.IsQueued( false, *cur ) || sAttributeSaveQueue.IsQueued( true, *cur ) )
+                        return false;
+                }
+            }
+
+            break;
+        }
+    }
+
+    std::map<uint32, InventoryDB::AttributeValues> loaded[2];
+    if( !db().LoadItemContentsAttributes( locationID, false, loaded[0] )
+        || !db().LoadItemContentsAttributes( locationID, true, loaded[1] ) )
+        return false;
+
+    // items without saved attributes get an empty entry, so they don't query again
+    for( size_t i = 0; i < 2; i++ )
+    {
+        for( cur = itemIDs.begin(); cur != end; cur++ )
+            m_preloadedAttributes[i][*cur].swap( loaded[i][*cur] );
+    }
+
+    return true;
+}
+
+bool ItemFactory::TakePreloadedAttributes(bool isDefault, uint32 itemID, InventoryDB::AttributeValues &into)
+{
+    std::map<uint32, InventoryDB::AttributeValues> &preloaded = m_preloadedAttributes[ isDefault ? 1 : 0 ];
+
+    std::map<uint32, InventoryDB::AttributeValues>::iterator res = preloaded.find( itemID );
+    if( res == preloaded.end() )
+        return false;
+
+    into.swap( res->second );
+    preloaded.erase( res );
+    return true;
+}
+
+void ItemFactory::DropPreloadedAttributes(const std::vector<uint32> &itemIDs)
+{
+    std::vector<uint32>::const_iterator cur, end;
+    cur = itemIDs.begin();
+    end = itemIDs.end();
+    for(; cur != end; cur++)
+    {
+        m_preloadedAttributes[0].erase( *cur );
+        m_preloadedAttributes[1].erase( *cur );
+    }
+}
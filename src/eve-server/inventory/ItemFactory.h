@@ -102,6 +102,14 @@ public:
      * Item stuff
      */
     InventoryItemRef GetItem(uint32 itemID);
+    /**
+     * Gets item, loading it from given data if it's not loaded yet.
+     *
+     * @param[in] itemID ID of item.
+     * @param[in] data Data of item, as loaded by InventoryDB::GetItemContents.
+     * @return Ref to InventoryItem object.
+     */
+    InventoryItemRef GetItem(uint32 itemID, const ItemData &data);
 
     BlueprintRef GetBlueprint(uint32 blueprintID);
 
@@ -237,6 +245,34 @@ public:
 
     void UnsetUsingClient();
 
+    /*
+     * Bulk loading of inventory contents
+     */
+    /**
+     * Loads saved attributes of all items in given item, to be taken
+     * by the items' attribute maps when they're loaded.
+     *
+     * @param[in] locationID ID of item which contents' attributes should be loaded.
+     * @param[in] itemIDs IDs of the contents.
+     * @return True if load was successful, false if not.
+     */
+    bool PreloadAttributes(uint32 locationID, const std::vector<uint32> &itemIDs);
+    /**
+     * Takes preloaded attributes of an item.
+     *
+     * @param[in] isDefault True for default attributes, false for attributes.
+     * @param[in] itemID ID of item.
+     * @param[in] into Attribute values of the item.
+     * @return True if the attributes have been preloaded, false if they have to be loaded.
+     */
+    bool TakePreloadedAttributes(bool isDefault, uint32 itemID, InventoryDB::AttributeValues &into);
+    /**
+     * Drops preloaded attributes which haven't been taken.
+     *
+     * @param[in] itemIDs IDs of items which attributes should be dropped.
+     */
+    void DropPreloadedAttributes(const std::vector<uint32> &itemIDs);
+
 protected:
     InventoryDB m_db;
 
@@ -264,6 +300,9 @@ protected:
     void _DeleteItem(uint32 itemID);
 
     std::map<uint32, InventoryItemRef> m_items;
+
+    // Preloaded attributes, by itemID; [0] is entity_attributes, [1] is entity_default_attributes:
+    std::map<uint32, InventoryDB::AttributeValues> m_preloadedAttributes[2];
 };
 
 
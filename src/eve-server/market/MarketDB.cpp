@@ -221,9 +221,7 @@ PyRep *MarketDB::GetOrderRow(uint32 orderID) {
     return(DBRowToPackedRow(row));
 }
 
-PyRep *MarketDB::GetOldPriceHistory(uint32 regionID, uint32 typeID) {
-    DBQueryResult res;
-
+void MarketDB::GetOldPriceHistory(uint32 regionID, uint32 typeID, DBQueryCompletion *completion) {
     /*DBColumnTypeMap colmap;
     colmap["historyDate"] = DBTYPE_FILETIME;
     colmap["lowPrice"] = DBTYPE_CY;
@@ -241,23 +239,15 @@ PyRep *MarketDB::GetOldPriceHistory(uint32 regionID, uint32 typeID) {
     ordering.push_back("volume");
     ordering.push_back("orders");*/
 
-    if(!sDatabase.RunQuery(res,
+    sDatabase.RunQueryAsync(completion,
         "SELECT"
         "    historyDate, lowPrice, highPrice, avgPrice,"
         "    volume, orders "
         " FROM market_history_old "
-        " WHERE regionID=%u AND typeID=%u", regionID, typeID))
-    {
-        codelog(MARKET__ERROR, "Error in query: %s", res.error.c_str());
-        return NULL;
-    }
-
-    return(DBResultToCRowset(res));
+        " WHERE regionID=%u AND typeID=%u", regionID, typeID);
 }
 
-PyRep *MarketDB::GetNewPriceHistory(uint32 regionID, uint32 typeID) {
-    DBQueryResult res;
-
+void MarketDB::GetNewPriceHistory(uint32 regionID, uint32 typeID, DBQueryCompletion *completion) {
     /*DBColumnTypeMap colmap;
     colmap["historyDate"] = DBTYPE_FILETIME;
     colmap["lowPrice"] = DBTYPE_CY;
@@ -279,7 +269,7 @@ PyRep *MarketDB::GetNewPriceHistory(uint32 regionID, uint32 typeID) {
     //NOTE: it may be a good idea to cache the historyDate column in each
     //record when they are inserted instead of re-calculating it each query.
     // this would also allow us to put together an index as well...
-    if(!sDatabase.RunQuery(res,
+    sDatabase.RunQueryAsync(completion,
         "SELECT"
         "    transactionDateTime - ( transactionDateTime %% %" PRId64 " ) AS historyDate,"
         "    MIN(price) AS lowPrice,"
@@ -291,13 +281,7 @@ PyRep *MarketDB::GetNewPriceHistory(uint32 regionID, uint32 typeID) {
         " WHERE regionID=%u AND typeID=%u"
         "    AND transactionType=%d "    //both buy and sell transactions get recorded, only compound one set of data... choice was arbitrary.
         " GROUP BY historyDate",
-        Win32Time_Day, regionID, typeID, TransactionTypeBuy))
-    {
-        codelog(MARKET__ERROR, "Error in query: %s", res.error.c_str());
-        return NULL;
-    }
-
-    return(DBResultToCRowset(res));
+        Win32Time_Day, regionID, typeID, TransactionTypeBuy);
 }
 
 bool MarketDB::BuildOldPriceHistory() {
@@ -529,32 +513,34 @@ uint32 MarketDB::FindBuyOrder(
     uint32 quantity,
     uint32 orderRange
 ) {
-    DBQueryResult res;
-
-    if(!sDatabase.RunQuery(res,
+    DBStatement stmt(
         "SELECT orderID"
         "    FROM market_orders"
         "    WHERE bid=1"
-        "        AND typeID=%u"
-        "        AND stationID=%u"
-        "        AND volRemaining >= %u"
-        "        AND price <= %f"
+        "        AND typeID=?"
+        "        AND stationID=?"
+        "        AND volRemaining >= ?"
+        "        AND price <= ?"
         "    ORDER BY price DESC"
-        "    LIMIT 1",    //right now, we just care about the first order which can satisfy our needs.
-        typeID,
-        stationID,
-        quantity,
-        price))
+        "    LIMIT 1");    //right now, we just care about the first order which can satisfy our needs.
+    stmt.Param(typeID);
+    stmt.Param(stationID);
+    stmt.Param(quantity);
+    stmt.Param(price);
+
+    uint32 orderID;
+    stmt.Result(orderID);
+
+    if(!sDatabase.RunStatement(stmt))
     {
-        codelog(MARKET__ERROR, "Error in query: %s", res.error.c_str());
+        codelog(MARKET__ERROR, "Error in query: %s", stmt.error.c_str());
         return false;
     }
 
-    DBResultRow row;
-    if(!res.GetRow(row))
+    if(!stmt.Fetch())
         return(0);    //no order found.
 
-    return(row.GetUInt(0));
+    return(orderID);
 }
 
 uint32 MarketDB::FindSellOrder(
@@ -564,38 +550,38 @@ uint32 MarketDB::FindSellOrder(
     uint32 quantity,
     uint32 orderRange
 ) {
-    DBQueryResult res;
-
-    if(!sDatabase.RunQuery(res,
+    DBStatement stmt(
         "SELECT orderID"
         "    FROM market_orders"
         "    WHERE bid=0"
-        "        AND typeID=%u"
-        "        AND stationID=%u"
-        "        AND volRemaining >= %u"
-        "        AND price <= %f"
+        "        AND typeID=?"
+        "        AND stationID=?"
+        "        AND volRemaining >= ?"
+        "        AND price <= ?"
         "    ORDER BY price ASC"
-        "    LIMIT 1",    //right now, we just care about the first order which can satisfy our needs.
-        typeID,
-        stationID,
-        quantity,
-        price))
+        "    LIMIT 1");    //right now, we just care about the first order which can satisfy our needs.
+    stmt.Param(typeID);
+    stmt.Param(stationID);
+    stmt.Param(quantity);
+    stmt.Param(price);
+
+    uint32 orderID;
+    stmt.Result(orderID);
+
+    if(!sDatabase.RunStatement(stmt))
     {
-        codelog(MARKET__ERROR, "Error in query: %s", res.error.c_str());
+        codelog(MARKET__ERROR, "Error in query: %s", stmt.error.c_str());
         return false;
     }
 
-    DBResultRow row;
-    if(!res.GetRow(row))
+    if(!stmt.Fetch())
         return(0);    //no order found.
 
-    return(row.GetUInt(0));
+    return(orderID);
 }
 
 bool MarketDB::GetOrderInfo(uint32 orderID, uint32 *orderOwnerID, uint32 *typeID, uint32 *stationID, uint32 *quantity, double *price, bool *isBuy, bool *isCorp) {
-    DBQueryResult res;
-
-    if(!sDatabase.RunQuery(res,
+    DBStatement stmt(
         "SELECT"
         " volRemaining,"
         " price,"
@@ -605,49 +591,62 @@ bool MarketDB::GetOrderInfo(uint32 orderID, uint32 *orderOwnerID, uint32 *typeID
         " bid,"
         " isCorp"
         " FROM market_orders"
-        " WHERE orderID=%u",
-        orderID))
+        " WHERE orderID=?");
+    stmt.Param(orderID);
+
+    uint32 volRemaining, orderTypeID, orderStationID, charID;
+    double orderPrice;
+    int32 bid, corp;
+    stmt.Result(volRemaining);
+    stmt.Result(orderPrice);
+    stmt.Result(orderTypeID);
+    stmt.Result(orderStationID);
+    stmt.Result(charID);
+    stmt.Result(bid);
+    stmt.Result(corp);
+
+    if(!sDatabase.RunStatement(stmt))
     {
-        _log(MARKET__ERROR, "Error in query: %s.", res.error.c_str());
+        _log(MARKET__ERROR, "Error in query: %s.", stmt.error.c_str());
         return false;
     }
 
-    DBResultRow row;
-    if(!res.GetRow(row)) {
+    if(!stmt.Fetch()) {
         _log(MARKET__ERROR, "Order %u not found.", orderID);
         return false;
     }
 
     if(quantity != NULL)
-        *quantity = row.GetUInt(0);
+        *quantity = volRemaining;
     if(price != NULL)
-        *price = row.GetDouble(1);
+        *price = orderPrice;
     if(typeID != NULL)
-        *typeID = row.GetUInt(2);
+        *typeID = orderTypeID;
     if(stationID != NULL)
-        *stationID = row.GetUInt(3);
+        *stationID = orderStationID;
     if(orderOwnerID != NULL)
-        *orderOwnerID = row.GetUInt(4);
+        *orderOwnerID = charID;
     if(isBuy != NULL)
-        *isBuy = row.GetInt(5) ? true : false;
+        *isBuy = bid ? true : false;
     if(isCorp != NULL)
-        *isCorp = row.GetInt(6) ? true : false;
+        *isCorp = corp ? true : false;
 
     return true;
 }
 
 //NOTE: this logic needs some work if there are multiple concurrent market services running at once.
 bool MarketDB::AlterOrderQuantity(uint32 orderID, uint32 new_qty) {
-    DBerror err;
-
-    if(!sDatabase.RunQuery(err,
+    DBStatement stmt(
         "UPDATE"
         " market_orders"
-        " SET volRemaining = %u"
-        " WHERE orderID = %u",
-        new_qty, orderID))
+        " SET volRemaining = ?"
+        " WHERE orderID = ?");
+    stmt.Param(new_qty);
+    stmt.Param(orderID);
+
+    if(!sDatabase.RunStatement(stmt))
     {
-        _log(MARKET__ERROR, "Error in query: %s.", err.c_str());
+        _log(MARKET__ERROR, "Error in query: %s.", stmt.error.c_str());
         return false;
     }
 
@@ -655,16 +654,17 @@ bool MarketDB::AlterOrderQuantity(uint32 orderID, uint32 new_qty) {
 }
 
 bool MarketDB::AlterOrderPrice(uint32 orderID, double new_price) {
-    DBerror err;
-
-    if(!sDatabase.RunQuery(err,
+    DBStatement stmt(
         "UPDATE"
         " market_orders"
-        " SET price = %f"
-        " WHERE orderID = %u",
-        new_price, orderID))
+        " SET price = ?"
+        " WHERE orderID = ?");
+    stmt.Param(new_price);
+    stmt.Param(orderID);
+
+    if(!sDatabase.RunStatement(stmt))
     {
-        _log(MARKET__ERROR, "Error in query: %s.", err.c_str());
+        _log(MARKET__ERROR, "Error in query: %s.", stmt.error.c_str());
         return false;
     }
 
@@ -672,15 +672,15 @@ bool MarketDB::AlterOrderPrice(uint32 orderID, double new_price) {
 }
 
 bool MarketDB::DeleteOrder(uint32 orderID) {
-    DBerror err;
-
-    if(!sDatabase.RunQuery(err,
+    DBStatement stmt(
         "DELETE"
         " FROM market_orders"
-        " WHERE orderID = %u",
-        orderID))
+        " WHERE orderID = ?");
+    stmt.Param(orderID);
+
+    if(!sDatabase.RunStatement(stmt))
     {
-        _log(MARKET__ERROR, "Error in query: %s.", err.c_str());
+        _log(MARKET__ERROR, "Error in query: %s.", stmt.error.c_str());
         return false;
     }
 
@@ -51,8 +51,9 @@ public:
     PyRep *GetCharOrders(uint32 characterID);
     PyRep *GetOrderRow(uint32 orderID);
 
-    PyRep *GetOldPriceHistory(uint32 regionID, uint32 typeID);
-    PyRep *GetNewPriceHistory(uint32 regionID, uint32 typeID);
+    //asynchronous, completion gets the history rows
+    void GetOldPriceHistory(uint32 regionID, uint32 typeID, DBQueryCompletion *completion);
+    void GetNewPriceHistory(uint32 regionID, uint32 typeID, DBQueryCompletion *completion);
     PyRep *GetTransactions(uint32 characterID, uint32 typeID, uint32 quantity, double minPrice, double maxPrice, uint64 fromDate, int buySell);
 
     PyRep *GetMarketGroups();
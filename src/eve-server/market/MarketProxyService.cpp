@@ -242,8 +242,6 @@ PyResult MarketProxyService::Handle_GetOldPriceHistory(PyCallArgs &call) {
         return NULL;
     }
 
-    PyRep *result = NULL;
-
     uint32 locid = call.client->GetSystemID();
     if(!IsSolarSystem(locid)) {
         codelog(SERVICE__ERROR, "%s: GetSystemID() returned a non-system %u!", call.client->GetName(), locid);
@@ -256,13 +254,10 @@ PyResult MarketProxyService::Handle_GetOldPriceHistory(PyCallArgs &call) {
         return NULL;
     }
 
-    result = m_db.GetOldPriceHistory(regionID, args.arg);
-    if(result == NULL) {
-        _log(SERVICE__ERROR, "%s: Failed to load Old Price History for item %u of region %u", call.client->GetName(), args.arg, regionID);
-        return NULL;
-    }
+    //don't hold the main loop up, the reply is sent once the query finishes.
+    m_db.GetOldPriceHistory(regionID, args.arg, new PyDeferredQuery<PyObjectEx>(call.Defer(), DBResultToCRowset));
 
-    return result;
+    return NULL;
 }
 
 PyResult MarketProxyService::Handle_GetNewPriceHistory(PyCallArgs &call) {
@@ -272,8 +267,6 @@ PyResult MarketProxyService::Handle_GetNewPriceHistory(PyCallArgs &call) {
         return NULL;
     }
 
-    PyRep *result = NULL;
-
     uint32 locid = call.client->GetSystemID();
     if(!IsSolarSystem(locid)) {
         codelog(SERVICE__ERROR, "%s: GetSystemID() returned a non-system %u!", call.client->GetName(), locid);
@@ -286,13 +279,11 @@ PyResult MarketProxyService::Handle_GetNewPriceHistory(PyCallArgs &call) {
         return NULL;
     }
 
-    result = m_db.GetNewPriceHistory(regionID, args.arg);
-    if(result == NULL) {
-        _log(SERVICE__ERROR, "%s: Failed to load New Price History for item %u of region %u", call.client->GetName(), args.arg, regionID);
-        return NULL;
-    }
+    //the history is aggregated from all transactions of the region, which is slow;
+    //don't hold the main loop up, the reply is sent once the query finishes.
+    m_db.GetNewPriceHistory(regionID, args.arg, new PyDeferredQuery<PyObjectEx>(call.Defer(), DBResultToCRowset));
 
-    return result;
+    return NULL;
 }
 
 PyResult MarketProxyService::Handle_PlaceCharOrder(PyCallArgs &call) {
@@ -48,18 +48,18 @@ public:
 
         m_strBoundObjectName = "BeyonceBound";
 
-        PyCallable_REG_CALL(BeyonceBound, CmdFollowBall)
-        PyCallable_REG_CALL(BeyonceBound, CmdOrbit)
-        PyCallable_REG_CALL(BeyonceBound, CmdAlignTo)
-        PyCallable_REG_CALL(BeyonceBound, CmdGotoDirection)
+        PyCallable_REG_STREAM_CALL(BeyonceBound, CmdFollowBall)
+        PyCallable_REG_STREAM_CALL(BeyonceBound, CmdOrbit)
+        PyCallable_REG_STREAM_CALL(BeyonceBound, CmdAlignTo)
+        PyCallable_REG_STREAM_CALL(BeyonceBound, CmdGotoDirection)
         PyCallable_REG_CALL(BeyonceBound, CmdGotoBookmark)
-        PyCallable_REG_CALL(BeyonceBound, CmdSetSpeedFraction)
+        PyCallable_REG_STREAM_CALL(BeyonceBound, CmdSetSpeedFraction)
         PyCallable_REG_CALL(BeyonceBound, CmdStop)
-        PyCallable_REG_CALL(BeyonceBound, CmdWarpToStuff)
-        PyCallable_REG_CALL(BeyonceBound, CmdDock)
-        PyCallable_REG_CALL(BeyonceBound, CmdStargateJump)
+        PyCallable_REG_STREAM_CALL(BeyonceBound, CmdWarpToStuff)
+        PyCallable_REG_STREAM_CALL(BeyonceBound, CmdDock)
+        PyCallable_REG_STREAM_CALL(BeyonceBound, CmdStargateJump)
         PyCallable_REG_CALL(BeyonceBound, UpdateStateRequest)
-        PyCallable_REG_CALL(BeyonceBound, CmdWarpToStuffAutopilot)
+        PyCallable_REG_STREAM_CALL(BeyonceBound, CmdWarpToStuffAutopilot)
 
         if(c->Destiny() != NULL)
             c->Destiny()->SendSetState(c->Bubble());
@@ -144,7 +144,7 @@ PyResult BeyonceService::Handle_(PyCallArgs &call) {
 
 PyResult BeyonceBound::Handle_CmdFollowBall(PyCallArgs &call) {
     Call_FollowBall args;
-    if(!args.Decode(&call.tuple)) {
+    if(!call.Decode(args)) {
         codelog(CLIENT__ERROR, "%s: Failed to decode arguments.", call.client->GetName());
         return NULL;
     }
@@ -184,7 +184,7 @@ PyResult BeyonceBound::Handle_CmdFollowBall(PyCallArgs &call) {
 
 PyResult BeyonceBound::Handle_CmdSetSpeedFraction(PyCallArgs &call) {
     Call_SingleRealArg arg;
-    if(!arg.Decode(&call.tuple)) {
+    if(!call.Decode(arg)) {
         codelog(CLIENT__ERROR, "%s: failed to decode args", call.client->GetName());
         return NULL;
     }
@@ -207,7 +207,7 @@ PyResult BeyonceBound::Handle_CmdSetSpeedFraction(PyCallArgs &call) {
 */
 PyResult BeyonceBound::Handle_CmdAlignTo(PyCallArgs &call) {
     CallAlignTo arg;
-    if(!arg.Decode(&call.tuple)) {
+    if(!call.Decode(arg)) {
         codelog(CLIENT__ERROR, "%s: failed to decode args", call.client->GetName());
         return NULL;
     }
@@ -238,7 +238,7 @@ PyResult BeyonceBound::Handle_CmdAlignTo(PyCallArgs &call) {
 
 PyResult BeyonceBound::Handle_CmdGotoDirection(PyCallArgs &call) {
     Call_PointArg arg;
-    if(!arg.Decode(&call.tuple)) {
+    if(!call.Decode(arg)) {
         codelog(CLIENT__ERROR, "%s: failed to decode args", call.client->GetName());
         return NULL;
     }
@@ -318,7 +318,7 @@ PyResult BeyonceBound::Handle_CmdGotoBookmark(PyCallArgs &call) {
 
 PyResult BeyonceBound::Handle_CmdOrbit(PyCallArgs &call) {
     Call_Orbit arg;
-    if(!arg.Decode(&call.tuple)) {
+    if(!call.Decode(arg)) {
         codelog(CLIENT__ERROR, "%s: failed to decode args", call.client->GetName());
         return NULL;
     }
@@ -357,7 +357,7 @@ PyResult BeyonceBound::Handle_CmdOrbit(PyCallArgs &call) {
 
 PyResult BeyonceBound::Handle_CmdWarpToStuff(PyCallArgs &call) {
     CallWarpToStuff arg;
-    if(!arg.Decode(&call.tuple)) {
+    if(!call.Decode(arg)) {
         codelog(CLIENT__ERROR, "%s: failed to decode args", call.client->GetName());
         return NULL;
     }
@@ -590,7 +590,7 @@ PyResult BeyonceBound::Handle_CmdWarpToStuff(PyCallArgs &call) {
 PyResult BeyonceBound::Handle_CmdWarpToStuffAutopilot(PyCallArgs &call) {
     CallWarpToStuffAutopilot arg;
 
-    if(!arg.Decode(&call.tuple)) {
+    if(!call.Decode(arg)) {
         codelog(CLIENT__ERROR, "%s: failed to decode args", call.client->GetName());
         return NULL;
     }
@@ -653,7 +653,7 @@ PyResult BeyonceBound::Handle_CmdStop(PyCallArgs &call) {
 
 PyResult BeyonceBound::Handle_CmdDock(PyCallArgs &call) {
     Call_TwoIntegerArgs arg;
-    if(!arg.Decode(&call.tuple)) {
+    if(!call.Decode(arg)) {
         codelog(CLIENT__ERROR, "%s: failed to decode args", call.client->GetName());
         return NULL;
     }
@@ -677,7 +677,7 @@ PyResult BeyonceBound::Handle_CmdDock(PyCallArgs &call) {
 PyResult BeyonceBound::Handle_CmdStargateJump(PyCallArgs &call) {
     //Call_TwoIntegerArgs arg;
     Call_StargateJump arg;
-    if(!arg.Decode(&call.tuple)) {
+    if(!call.Decode(arg)) {
         codelog(CLIENT__ERROR, "%s: failed to decode args", call.client->GetName());
         return NULL;
     }
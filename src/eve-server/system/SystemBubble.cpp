@@ -73,25 +73,27 @@ void SystemBubble::BubblecastDestiny(std::vector<PyTuple *> &updates, std::vecto
 void SystemBubble::BubblecastDestinyUpdate( PyTuple** payload, const char* desc ) const
 {
     PyTuple* up = *payload;
-    *payload = NULL;    //could optimize out one of the Clones in here...
+    *payload = NULL;
 
-    PyTuple* up_dup = NULL;
+    if( m_dynamicEntities.empty() )
+    {
+        PyDecRef( up );
+        return;
+    }
+
+    //marshal it just once, everybody shares the result.
+    PyPreMarshaled* shared = new PyPreMarshaled( up );
 
     std::set<SystemEntity*>::const_iterator cur, end, tmp;
     cur = m_dynamicEntities.begin();
     end = m_dynamicEntities.end();
     for(; cur != end; ++cur)
     {
-        if( NULL == up_dup )
-            up_dup = new PyTuple( *up );
-
         _log( DESTINY__BUBBLE_TRACE, "Bubblecast %s update to %s (%u)", desc, (*cur)->GetName(), (*cur)->GetID() );
-        (*cur)->QueueDestinyUpdate( &up_dup );
-        //they may not have consumed it (NPCs for example), so dont re-dup it in that case.
+        (*cur)->QueueSharedDestinyUpdate( shared );
     }
 
-    PySafeDecRef( up_dup );
-    PyDecRef( up );
+    PyDecRef( shared );
 }
 
 //send a destiny event to everybody in the bubble.
@@ -99,25 +101,27 @@ void SystemBubble::BubblecastDestinyUpdate( PyTuple** payload, const char* desc
 void SystemBubble::BubblecastDestinyEvent( PyTuple** payload, const char* desc ) const
 {
     PyTuple* up = *payload;
-    *payload = NULL;    //could optimize out one of the Clones in here...
+    *payload = NULL;
 
-    PyTuple* up_dup = NULL;
+    if( m_dynamicEntities.empty() )
+    {
+        PyDecRef( up );
+        return;
+    }
+
+    //marshal it just once, everybody shares the result.
+    PyPreMarshaled* shared = new PyPreMarshaled( up );
 
     std::set<SystemEntity *>::const_iterator cur, end, tmp;
     cur = m_dynamicEntities.begin();
     end = m_dynamicEntities.end();
     for(; cur != end; ++cur)
     {
-        if( NULL == up_dup )
-            up_dup = new PyTuple( *up );
-
         _log( DESTINY__BUBBLE_TRACE, "Bubblecast %s event to %s (%u)", desc, (*cur)->GetName(), (*cur)->GetID() );
-        (*cur)->QueueDestinyEvent( &up_dup );
-        //they may not have consumed it (NPCs for example), so dont re-dup it in that case.
+        (*cur)->QueueSharedDestinyEvent( shared );
     }
 
-    PySafeDecRef( up_dup );
-    PyDecRef( up );
+    PyDecRef( shared );
 }
 
 //called at some regular interval from the bubble manager.
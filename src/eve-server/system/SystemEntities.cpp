@@ -67,9 +67,9 @@ bool SimpleSystemEntity::LoadExtras(SystemDB *db) {
 
 PyDict *SimpleSystemEntity::MakeSlimItem() const {
     PyDict *slim = new PyDict();
-    slim->SetItemString("typeID", new PyInt(data.typeID));
-    slim->SetItemString("ownerID", new PyInt(1));
-    slim->SetItemString("itemID", new PyInt(data.itemID));
+    slim->SetItemString("typeID", new_int(data.typeID));
+    slim->SetItemString("ownerID", new_int(1));
+    slim->SetItemString("itemID", new_int(data.itemID));
     return slim;
 }
 
@@ -148,10 +148,10 @@ void SystemStationEntity::EncodeDestiny( Buffer& into ) const
 
 PyDict *SystemStationEntity::MakeSlimItem() const {
     PyDict *slim = new PyDict();
-    slim->SetItemString("typeID", new PyInt(data.typeID));
+    slim->SetItemString("typeID", new_int(data.typeID));
     //HACKED:::
-    slim->SetItemString("ownerID", new PyInt(1000044));
-    slim->SetItemString("itemID", new PyInt(data.itemID));
+    slim->SetItemString("ownerID", new_int(1000044));
+    slim->SetItemString("itemID", new_int(data.itemID));
     return(slim);
 }
 
@@ -255,18 +255,18 @@ PyDict *SystemDungeonEntranceEntity::MakeSlimItem() const {
     //slim->SetItemString("typeID", new PyInt(12273));
     //slim->SetItemString("ownerID", new PyInt(500021));
 
-    slim->SetItemString("dunSkillLevel", new PyInt(0));
-    slim->SetItemString("dunSkillTypeID", new PyNone);
-    slim->SetItemString("dunObjectID", new PyInt(160449));
-    slim->SetItemString("dunWipeNPC", new PyInt(1));
-    slim->SetItemString("dunToGateID", new PyInt(160484));
-    slim->SetItemString("dunCloaked", new PyInt(0));
-    slim->SetItemString("dunScenarioID", new PyInt(23));
-    slim->SetItemString("dunSpawnID", new PyInt(4));
+    slim->SetItemString("dunSkillLevel", new_int(0));
+    slim->SetItemString("dunSkillTypeID", new_none());
+    slim->SetItemString("dunObjectID", new_int(160449));
+    slim->SetItemString("dunWipeNPC", new_int(1));
+    slim->SetItemString("dunToGateID", new_int(160484));
+    slim->SetItemString("dunCloaked", new_int(0));
+    slim->SetItemString("dunScenarioID", new_int(23));
+    slim->SetItemString("dunSpawnID", new_int(4));
     slim->SetItemString("dunAmount", new PyFloat(0.0));
     slim->SetItemString("dunShipClasses", new PyList(/*237, 31*/));
     slim->SetItemString("dunDirection", new PyList(/*235, 0, 1*/));
-    slim->SetItemString("dunKeyLock", new PyInt(0));
+    slim->SetItemString("dunKeyLock", new_int(0));
     //slim->SetItemString("dunKeyQuantity", new PyInt(1));
     //slim->SetItemString("dunKeyTypeID", new PyInt(21839));
     //slim->SetItemString("dunOpenUntil", new PyInt(Win32TimeNow()+Win32Time_Hour));
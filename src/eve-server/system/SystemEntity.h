@@ -33,6 +33,7 @@
 class PyDict;
 class PyList;
 class PyTuple;
+class PyPreMarshaled;
 class DoDestiny_AddBall;
 class DoDestinyDamageState;
 class DBSystemEntity;
@@ -91,6 +92,9 @@ public:
     //may consume the arguments, or not.
     virtual void QueueDestinyUpdate(PyTuple **du) = 0;
     virtual void QueueDestinyEvent(PyTuple **multiEvent) = 0;
+    //shared between recipients (bubblecasts), never consumed; take a reference to keep it.
+    virtual void QueueSharedDestinyUpdate(PyPreMarshaled *du) {}
+    virtual void QueueSharedDestinyEvent(PyPreMarshaled *multiEvent) {}
 
     //get the item ID of this entity
     virtual uint32 GetID() const = 0;
@@ -0,0 +1,230 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#include "eve-test.h"
+
+#include "bench/MarshalCorpus.h"
+
+PyRep* MarshalCorpus::CreateSessionChange()
+{
+    static const char* const ints[] =
+    {
+        "charid", "corpid", "solarsystemid", "solarsystemid2", "constellationid",
+        "regionid", "locationid", "stationid", "stationid2", "worldspaceid",
+        "shipid", "hqID", "baseID", "allianceid", "warfactionid", "userid", "userType"
+    };
+
+    PyDict* changes = new PyDict;
+    for( size_t i = 0; i < sizeof( ints ) / sizeof( ints[0] ); ++i )
+        changes->SetItemString( ints[i], new_tuple( new PyNone, new PyInt( 60000000 + i ) ) );
+    changes->SetItemString( "role", new_tuple( new PyLong( 0x4000000000000000LL ), new PyLong( 0x7FFFFFFFFFFFFFFFLL ) ) );
+    changes->SetItemString( "corprole", new_tuple( new PyLong( 0 ), new PyLong( 0x4000000000000000LL ) ) );
+    changes->SetItemString( "address", new_tuple( new PyNone, new PyString( "127.0.0.1:26000" ) ) );
+
+    PyDict* kwargs = new PyDict;
+    kwargs->SetItemString( "sessionID", new PyLong( 0x1234567890LL ) );
+    kwargs->SetItemString( "nodesOfInterest", new_tuple( new PyInt( 888444 ), new PyInt( -1 ) ) );
+
+    return new_tuple( new PyInt( 0 ), new_tuple( changes, kwargs ) );
+}
+
+PyRep* MarshalCorpus::CreateAttributes()
+{
+    PyDict* attributes = new PyDict;
+    for( int32 i = 0; i < 160; ++i )
+        attributes->SetItem( new PyInt( 3 * i + 1 ), new PyFloat( 1.5 * i ) );
+
+    PyDict* item = new PyDict;
+    item->SetItemString( "itemID", new PyInt( 140000001 ) );
+    item->SetItemString( "invItem", new PyNone );
+    item->SetItemString( "activeEffects", new PyDict );
+    item->SetItemString( "attributes", attributes );
+    item->SetItemString( "time", new PyLong( Win32TimeNow() ) );
+
+    return new PyObject( "util.KeyVal", item );
+}
+
+PyRep* MarshalCorpus::CreateMarketHistory()
+{
+    DBRowDescriptor* header = new DBRowDescriptor;
+    header->AddColumn( "historyDate", DBTYPE_FILETIME );
+    header->AddColumn( "lowPrice", DBTYPE_CY );
+    header->AddColumn( "highPrice", DBTYPE_CY );
+    header->AddColumn( "avgPrice", DBTYPE_CY );
+    header->AddColumn( "volume", DBTYPE_I8 );
+    header->AddColumn( "orders", DBTYPE_I4 );
+
+    CRowSet* rs = new CRowSet( &header );
+
+    const uint64 now = Win32TimeNow();
+    for( int64 day = 0; day < 365; ++day )
+    {
+        PyPackedRow* row = rs->NewRow();
+        row->SetField( "historyDate", new PyLong( now - day * Win32Time_Day ) );
+        row->SetField( "lowPrice", new PyLong( 18000 + day % 17 * 100 ) );
+        row->SetField( "highPrice", new PyLong( 19000 + day % 23 * 100 ) );
+        row->SetField( "avgPrice", new PyLong( 18400 + day % 19 * 100 ) );
+        row->SetField( "volume", new PyLong( 5463586 + day * 1021 ) );
+        row->SetField( "orders", new PyInt( 254 + day % 31 ) );
+    }
+
+    return rs;
+}
+
+PyRep* MarshalCorpus::CreateCallReq()
+{
+    PyCallStream call;
+    call.remoteObject = 0;
+    call.remoteObjectStr = "marketProxy";
+    call.method = "GetStationAsks";
+    call.arg_tuple = new_tuple( new PyInt( 60003760 ) );
+    call.arg_dict = new PyDict;
+    call.arg_dict->SetItemString( "machoVersion", new PyInt( 1 ) );
+
+    PyPacket packet;
+    packet.type_string = "macho.CallReq";
+    packet.type = CALL_REQ;
+
+    packet.source.type = PyAddress::Client;
+    packet.source.typeID = 1000001;
+    packet.source.callID = 42;
+
+    packet.dest.type = PyAddress::Any;
+    packet.dest.service = "marketProxy";
+
+    packet.userid = 100001;
+    packet.payload = call.Encode();
+
+    return packet.Encode();
+}
+
+PyRep* MarshalCorpus::CreateCachedObject()
+{
+    PyRep* history = CreateMarketHistory();
+
+    Buffer* data = new Buffer;
+    const bool deflated = ( Marshal( history, *data ) && DeflateData( *data ) );
+    PyDecRef( history );
+
+    PyTuple* objectID = new_tuple( "Method Call", "server", new_tuple( "marketProxy", "GetOldPriceHistory" ) );
+
+    PyTuple* args = new PyTuple( 7 );
+    args->SetItem( 0, new_tuple( new PyLong( Win32TimeNow() ), new PyInt( 1 ) ) );
+    args->SetItem( 1, new PyNone );
+    args->SetItem( 2, new PyInt( 888444 ) );
+    args->SetItem( 3, new PyInt( 1 ) );
+    args->SetItem( 4, new PyBuffer( &data ) );
+    args->SetItem( 5, new PyInt( deflated ? 1 : 0 ) );
+    args->SetItem( 6, objectID );
+
+    return new PyObject( "objectCaching.CachedObject", args );
+}
+
+bool MarshalCorpus::AddBuiltin()
+{
+    return ( AddRep( "session change", CreateSessionChange() )
+             && AddRep( "ship attributes", CreateAttributes() )
+             && AddRep( "call request", CreateCallReq() )
+             && AddRep( "market history", CreateMarketHistory(), true )
+             && AddRep( "cached object", CreateCachedObject() ) );
+}
+
+bool MarshalCorpus::AddRep( const char* name, PyRep* rep, bool deflate )
+{
+    Sample sample;
+    sample.name = name;
+
+    bool res = Marshal( rep, sample.data );
+    PyDecRef( rep );
+
+    if( res && deflate )
+        res = DeflateData( sample.data );
+    if( res )
+        mSamples.push_back( sample );
+
+    return res;
+}
+
+size_t MarshalCorpus::AddDir( const char* dir )
+{
+    DirWalker walker;
+    if( !walker.OpenDir( dir ) )
+        return 0;
+
+    size_t count = 0;
+    while( walker.NextFile() )
+    {
+        Sample sample;
+        sample.name = walker.currentFileName();
+
+        std::string path( dir );
+        path += '/';
+        path += sample.name;
+
+        FILE* f = fopen( path.c_str(), "rb" );
+        if( NULL == f )
+            continue;
+
+        uint8 chunk[ 0x1000 ];
+        size_t len;
+        while( 0 < ( len = fread( chunk, 1, sizeof( chunk ), f ) ) )
+            sample.data.AppendSeq( &chunk[0], &chunk[len] );
+        fclose( f );
+
+        if( 0 < sample.data.size() )
+        {
+            mSamples.push_back( sample );
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+bool MarshalCorpus::SaveDir( const char* dir ) const
+{
+    for( size_t i = 0; i < mSamples.size(); ++i )
+    {
+        std::string name( mSamples[i].name );
+        std::replace( name.begin(), name.end(), ' ', '_' );
+
+        std::string path( dir );
+        path += '/';
+        path += name;
+
+        FILE* f = fopen( path.c_str(), "wb" );
+        if( NULL == f )
+            return false;
+
+        const Buffer& data = mSamples[i].data;
+        const bool res = ( fwrite( &data[0], 1, data.size(), f ) == data.size() );
+        fclose( f );
+
+        if( !res )
+            return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,119 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#ifndef __BENCH__MARSHAL_CORPUS_H__INCL__
+#define __BENCH__MARSHAL_CORPUS_H__INCL__
+
+/**
+ * @brief Set of marshal streams used by eve-bench and eve-fuzz.
+ *
+ * The built-in samples mirror what the server actually sends
+ * (session changes, dogma attributes, rowsets, call packets and
+ * cached objects); captured streams, each saved in a file of its
+ * own, exactly as they went over the wire or into the cache
+ * (deflated or not), may be added on top of them.
+ *
+ * @author EVEmu Team
+ */
+class MarshalCorpus
+{
+public:
+    /** A single stream of the corpus. */
+    struct Sample
+    {
+        /** Name of the sample, for reports. */
+        std::string name;
+        /** The stream, as captured (possibly deflated). */
+        Buffer data;
+    };
+
+    /**
+     * @name Built-in samples
+     *
+     * Each returns a new object, owned by the caller.
+     */
+    //@{
+    /** builds the session change sent to the client on character selection */
+    static PyRep* CreateSessionChange();
+    /** builds the attribute dictionary of a ship, as sent by dogma on login */
+    static PyRep* CreateAttributes();
+    /** builds a year of market history of an item */
+    static PyRep* CreateMarketHistory();
+    /** builds a call request, as sent by the client */
+    static PyRep* CreateCallReq();
+    /** builds a cached method call result, as kept by CachedObjectMgr */
+    static PyRep* CreateCachedObject();
+    //@}
+
+    /** @return Number of samples. */
+    size_t size() const { return mSamples.size(); }
+    /** @return Sample at given index. */
+    const Sample& operator[]( size_t index ) const { return mSamples[ index ]; }
+
+    /**
+     * @brief Adds the built-in samples.
+     *
+     * @retval true  All samples were added.
+     * @retval false Error occured while marshaling a sample.
+     */
+    bool AddBuiltin();
+    /**
+     * @brief Marshals given object and adds it as a sample.
+     *
+     * @param[in] name    Name of the sample.
+     * @param[in] rep     Object to marshal; consumed.
+     * @param[in] deflate Whether the stream should be deflated.
+     *
+     * @retval true  The sample was added.
+     * @retval false Error occured during marshaling.
+     */
+    bool AddRep( const char* name, PyRep* rep, bool deflate = false );
+    /**
+     * @brief Adds every file in given directory as a sample.
+     *
+     * @param[in] dir Path to directory; must NOT end with slash.
+     *
+     * @return Number of samples added.
+     */
+    size_t AddDir( const char* dir );
+
+    /**
+     * @brief Saves every sample into a file of given directory.
+     *
+     * Makes a seed corpus out of the built-in samples.
+     *
+     * @param[in] dir Path to existing directory; must NOT end with slash.
+     *
+     * @retval true  All samples were saved.
+     * @retval false Failed to write a file.
+     */
+    bool SaveDir( const char* dir ) const;
+
+protected:
+    /** The samples. */
+    std::vector<Sample> mSamples;
+};
+
+#endif /* !__BENCH__MARSHAL_CORPUS_H__INCL__ */
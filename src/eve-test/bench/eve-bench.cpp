@@ -0,0 +1,278 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#include "eve-test.h"
+
+#include "bench/MarshalCorpus.h"
+
+/*
+ * eve-bench: throughput and allocation counts of marshaling.
+ *
+ * Usage: eve-bench [-r rounds] [-s seed-dir] [corpus-dir ...]
+ *
+ * Each corpus directory holds captured marshal streams, one per file
+ * (e.g. packets dumped off the wire or objects from the cache). They
+ * are benchmarked together with the built-in samples; -s saves the
+ * built-in samples into a directory, as a seed corpus for eve-fuzz.
+ */
+
+/** Default number of times each operation is run over each sample. */
+static const size_t BENCH_DEFAULT_ROUNDS = 1000;
+
+/** Number of heap allocations done through operator new. */
+static size_t sNewCount = 0;
+
+void* operator new( size_t size )
+{
+    ++sNewCount;
+
+    void* p = malloc( 0 < size ? size : 1 );
+    if( NULL == p )
+        throw std::bad_alloc();
+
+    return p;
+}
+
+void operator delete( void* p )
+{
+    free( p );
+}
+
+/** The measured operations. */
+enum BenchOp
+{
+    BENCH_MARSHAL,
+    BENCH_UNMARSHAL,
+    BENCH_DEFLATE,
+    BENCH_INFLATE,
+
+    BENCH_OP_COUNT
+};
+
+/** Names of the measured operations. */
+static const char* const BENCH_OP_NAMES[ BENCH_OP_COUNT ] =
+{
+    "marshal",
+    "unmarshal",
+    "deflate",
+    "inflate"
+};
+
+/** A sample prepared for all operations. */
+struct BenchInput
+{
+    /** The unmarshaled sample. */
+    PyRep* rep;
+    /** The sample marshaled, not deflated. */
+    Buffer raw;
+    /** The sample marshaled and deflated. */
+    Buffer deflated;
+};
+
+/** Totals of an operation over the corpus. */
+struct BenchTotal
+{
+    uint64 time;
+    uint64 bytes;
+    uint64 news;
+    uint64 reps;
+};
+
+/**
+ * @brief Runs an operation once.
+ *
+ * @retval true  The operation succeeded.
+ * @retval false The operation failed.
+ */
+static bool RunOp( BenchOp op, const BenchInput& input )
+{
+    switch( op )
+    {
+        case BENCH_MARSHAL:
+        {
+            Buffer out;
+            return Marshal( input.rep, out );
+        }
+        case BENCH_UNMARSHAL:
+        {
+            PyRep* res = Unmarshal( input.raw );
+            if( NULL == res )
+                return false;
+
+            PyDecRef( res );
+            return true;
+        }
+        case BENCH_DEFLATE:
+        {
+            Buffer out;
+            return DeflateData( input.raw, out );
+        }
+        case BENCH_INFLATE:
+        {
+            Buffer out;
+            return InflateData( input.deflated, out );
+        }
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Prepares a sample for all operations.
+ *
+ * @retval true  The sample is a valid marshal stream.
+ * @retval false The sample cannot be used.
+ */
+static bool PrepareInput( const MarshalCorpus::Sample& sample, BenchInput& input )
+{
+    input.raw = sample.data;
+    if( IsDeflated( input.raw ) && !InflateData( input.raw ) )
+        return false;
+
+    input.rep = Unmarshal( input.raw );
+    if( NULL == input.rep )
+        return false;
+
+    if( !DeflateData( input.raw, input.deflated ) )
+    {
+        PyDecRef( input.rep );
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Measures all operations over a sample.
+ *
+ * @retval true  All operations succeeded.
+ * @retval false An operation failed.
+ */
+static bool BenchSample( const MarshalCorpus::Sample& sample, size_t rounds, BenchTotal* totals )
+{
+    BenchInput input;
+    if( !PrepareInput( sample, input ) )
+    {
+        ::printf( "%-20s not a valid marshal stream, skipped\n", sample.name.c_str() );
+        return true;
+    }
+
+    bool res = true;
+    for( int op = 0; res && op < BENCH_OP_COUNT; ++op )
+    {
+        const uint64 bytes = ( BENCH_INFLATE == op ? input.deflated.size() : input.raw.size() );
+
+        // warm up
+        res = RunOp( (BenchOp)op, input );
+
+        const PyRep::AllocStats repsBefore = PyRep::GetAllocStats();
+        const size_t newsBefore = sNewCount;
+        const uint64 start = GetTimeUSeconds();
+
+        for( size_t i = 0; res && i < rounds; ++i )
+            res = RunOp( (BenchOp)op, input );
+
+        const uint64 time = GetTimeUSeconds() - start;
+        const uint64 news = sNewCount - newsBefore;
+        const uint64 reps = PyRep::GetAllocStats().allocated - repsBefore.allocated;
+
+        if( !res )
+        {
+            ::printf( "%-20s %s failed\n", sample.name.c_str(), BENCH_OP_NAMES[ op ] );
+            break;
+        }
+
+        ::printf( "%-20s %-9s %7lu bytes %9.2f us %8.2f MB/s %8.1f new %8.1f PyRep\n",
+                  sample.name.c_str(), BENCH_OP_NAMES[ op ], (unsigned long)bytes,
+                  (double)time / rounds, 0 < time ? (double)bytes * rounds / time : 0.0,
+                  (double)news / rounds, (double)reps / rounds );
+
+        totals[ op ].time += time;
+        totals[ op ].bytes += bytes * rounds;
+        totals[ op ].news += news;
+        totals[ op ].reps += reps;
+    }
+
+    PyDecRef( input.rep );
+    return res;
+}
+
+int main( int argc, char* argv[] )
+{
+    size_t rounds = BENCH_DEFAULT_ROUNDS;
+    const char* seedDir = NULL;
+
+    MarshalCorpus corpus;
+    if( !corpus.AddBuiltin() )
+    {
+        ::puts( "Failed to build the built-in samples." );
+        return EXIT_FAILURE;
+    }
+
+    for( int i = 1; i < argc; ++i )
+    {
+        if( 0 == strcmp( argv[i], "-r" ) && i + 1 < argc )
+            rounds = std::max( atoi( argv[++i] ), 1 );
+        else if( 0 == strcmp( argv[i], "-s" ) && i + 1 < argc )
+            seedDir = argv[++i];
+        else if( 0 == corpus.AddDir( argv[i] ) )
+            ::printf( "No samples found in '%s'.\n", argv[i] );
+    }
+
+    if( NULL != seedDir )
+    {
+        if( !corpus.SaveDir( seedDir ) )
+        {
+            ::printf( "Failed to save the corpus into '%s'.\n", seedDir );
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    ::printf( "Benchmarking %lu samples, %lu rounds each...\n",
+              (unsigned long)corpus.size(), (unsigned long)rounds );
+
+    BenchTotal totals[ BENCH_OP_COUNT ];
+    memset( totals, 0, sizeof( totals ) );
+
+    for( size_t i = 0; i < corpus.size(); ++i )
+    {
+        if( !BenchSample( corpus[i], rounds, totals ) )
+            return EXIT_FAILURE;
+    }
+
+    ::puts( "Totals:" );
+    for( int op = 0; op < BENCH_OP_COUNT; ++op )
+    {
+        const BenchTotal& total = totals[ op ];
+
+        ::printf( "%-9s %8.2f MB/s %10lu new %10lu PyRep\n", BENCH_OP_NAMES[ op ],
+                  0 < total.time ? (double)total.bytes / total.time : 0.0,
+                  (unsigned long)total.news, (unsigned long)total.reps );
+    }
+
+    return EXIT_SUCCESS;
+}
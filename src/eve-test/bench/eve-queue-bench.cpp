@@ -0,0 +1,224 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#include "eve-test.h"
+
+/*
+ * eve-queue-bench: hand-off throughput between producer threads
+ * and a single consumer, as between network threads and the main
+ * loop. Compares MPSCQueue to a mutex-protected std::queue and
+ * checks that each producer's values come out in order.
+ *
+ * Usage: eve-queue-bench [-p producers] [-n values-per-producer]
+ */
+
+/** Default number of producer threads. */
+static const uint32 QUEUE_BENCH_DEFAULT_PRODUCERS = 4;
+/** Default number of values each producer pushes. */
+static const uint32 QUEUE_BENCH_DEFAULT_COUNT = 1000000;
+/** Capacity of the lock-free queue. */
+static const size_t QUEUE_BENCH_CAPACITY = 0x400;
+
+/** A value pushed through the queues: producer in the high half, sequence number in the low one. */
+typedef uint64 QueueValue;
+
+/**
+ * @brief The lock-free queue.
+ */
+class LockFreeQueue
+{
+public:
+    static const char* Name() { return "MPSCQueue"; }
+
+    LockFreeQueue() : mQueue( QUEUE_BENCH_CAPACITY ) {}
+
+    void Push( QueueValue value )
+    {
+        // let the consumer catch up
+        while( !mQueue.Push( value ) )
+            Sleep( 0 );
+    }
+    bool Pop( QueueValue& value ) { return mQueue.Pop( value ); }
+
+protected:
+    MPSCQueue< QueueValue > mQueue;
+};
+
+/**
+ * @brief The mutex-protected queue, the way the hand-offs used to be done.
+ */
+class LockedQueue
+{
+public:
+    static const char* Name() { return "Mutex+queue"; }
+
+    void Push( QueueValue value )
+    {
+        MutexLock lock( mMutex );
+
+        mQueue.push( value );
+    }
+    bool Pop( QueueValue& value )
+    {
+        MutexLock lock( mMutex );
+
+        if( mQueue.empty() )
+            return false;
+
+        value = mQueue.front();
+        mQueue.pop();
+
+        return true;
+    }
+
+protected:
+    Mutex mMutex;
+    std::queue< QueueValue > mQueue;
+};
+
+/**
+ * @brief A producer pushing its values into a queue.
+ */
+template< typename Q >
+class Producer
+: public WorkerJob
+{
+public:
+    Producer( Q& queue, uint32 id, uint32 count ) : mQueue( queue ), mId( id ), mCount( count ) {}
+
+    void Run()
+    {
+        for( uint32 i = 0; i < mCount; ++i )
+            mQueue.Push( ( (QueueValue)mId << 32 ) | i );
+    }
+
+protected:
+    Q& mQueue;
+    const uint32 mId;
+    const uint32 mCount;
+};
+
+/**
+ * @brief Measures a queue.
+ *
+ * @retval true  All values came out in order.
+ * @retval false Values were lost or reordered.
+ */
+template< typename Q >
+static bool BenchQueue( uint32 producerCount, uint32 count )
+{
+    WorkerPool pool( "QueueBench" );
+    if( !pool.Start( producerCount ) )
+    {
+        ::puts( "Failed to start the producer threads." );
+        return false;
+    }
+
+    Q queue;
+
+    std::vector< Producer< Q >* > producers;
+    for( uint32 i = 0; i < producerCount; ++i )
+        producers.push_back( new Producer< Q >( queue, i, count ) );
+
+    std::vector< uint32 > next( producerCount, 0 );
+    const uint64 total = (uint64)producerCount * count;
+    uint64 popped = 0, empty = 0;
+    bool res = true;
+
+    const uint64 start = GetTimeUSeconds();
+
+    for( uint32 i = 0; i < producerCount; ++i )
+        pool.Post( producers[ i ] );
+
+    while( popped < total )
+    {
+        QueueValue value;
+        if( !queue.Pop( value ) )
+        {
+            ++empty;
+            Sleep( 0 );
+            continue;
+        }
+
+        const uint32 id = (uint32)( value >> 32 );
+        const uint32 seq = (uint32)value;
+        if( producerCount <= id || next[ id ] != seq )
+            res = false;
+        else
+            ++next[ id ];
+
+        ++popped;
+    }
+
+    const uint64 time = GetTimeUSeconds() - start;
+
+    ::printf( "%-12s %2u producers %10.2f Mvalues/s %6.1f%% empty pops\n",
+              Q::Name(), producerCount, 0 < time ? (double)total / time : 0.0,
+              100.0 * empty / ( popped + empty ) );
+
+    // the producers are done once all values are popped,
+    // but their threads may still be leaving Run
+    pool.Stop();
+
+    for( uint32 i = 0; i < producerCount; ++i )
+        delete producers[ i ];
+
+    if( !res )
+        ::printf( "%-12s values were lost or reordered\n", Q::Name() );
+
+    return res;
+}
+
+int main( int argc, char* argv[] )
+{
+    uint32 producerCount = QUEUE_BENCH_DEFAULT_PRODUCERS;
+    uint32 count = QUEUE_BENCH_DEFAULT_COUNT;
+
+    for( int i = 1; i < argc; ++i )
+    {
+        if( 0 == strcmp( argv[i], "-p" ) && i + 1 < argc )
+            producerCount = std::max( atoi( argv[++i] ), 1 );
+        else if( 0 == strcmp( argv[i], "-n" ) && i + 1 < argc )
+            count = std::max( atoi( argv[++i] ), 1 );
+        else
+        {
+            ::printf( "Usage: %s [-p producers] [-n values-per-producer]\n", argv[0] );
+            return EXIT_FAILURE;
+        }
+    }
+
+    // contention grows with the number of producers
+    bool res = true;
+    for( uint32 n = 1; ; n = std::min( n << 1, producerCount ) )
+    {
+        res = BenchQueue< LockedQueue >( n, count ) && res;
+        res = BenchQueue< LockFreeQueue >( n, count ) && res;
+
+        if( producerCount == n )
+            break;
+    }
+
+    return res ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -31,6 +31,12 @@
 /*************************************************************************/
 #include "eve-core.h"
 
+// threading
+#include "threading/MPSCQueue.h"
+#include "threading/WorkerPool.h"
+// utils
+#include "utils/DirWalker.h"
+
 /*************************************************************************/
 /* eve-common                                                            */
 /*************************************************************************/
@@ -40,7 +46,11 @@
 #include "auth/PasswordModule.h"
 // marshal
 #include "marshal/EVEMarshal.h"
+#include "marshal/EVEMarshalStringTable.h"
 #include "marshal/EVEUnmarshal.h"
+// python
+#include "python/PyArena.h"
+#include "python/PyPacket.h"
 // python/classes
 #include "python/classes/PyDatabase.h"
 // utils
@@ -0,0 +1,314 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#include "eve-test.h"
+
+#include "bench/MarshalCorpus.h"
+
+/*
+ * eve-fuzz: fuzzes InflateUnmarshal.
+ *
+ * When built with EVEMU_FUZZ (clang only), this is a coverage-guided
+ * libFuzzer target; run it as
+ *
+ *     eve-fuzz [libFuzzer options] <corpus-dir> [seed-dir ...]
+ *
+ * where the seeds come from "eve-bench -s <seed-dir>" and captured
+ * streams. Otherwise it's a standalone driver which mutates the
+ * built-in samples (and given directories) on its own:
+ *
+ *     eve-fuzz [-runs count] [-seed number] [corpus-dir ...]
+ */
+
+/**
+ * @brief Tells whether the server may marshal an object.
+ *
+ * Checksumed streams are only ever received from the client.
+ */
+class FuzzMarshalable
+: public PyVisitor
+{
+public:
+    bool VisitChecksumedStream( const PyChecksumedStream* rep ) { return false; }
+};
+
+/**
+ * @brief Feeds a stream to InflateUnmarshal.
+ *
+ * Whatever InflateUnmarshal accepts must marshal again (unless
+ * it's something the server never sends), and the result must
+ * survive another round trip unchanged.
+ *
+ * @param[in]  data     The stream.
+ * @param[in]  size     Length of the stream.
+ * @param[out] accepted Whether InflateUnmarshal accepted the stream.
+ *
+ * @retval true  The stream was handled correctly.
+ * @retval false The stream broke the round trip.
+ */
+static bool FuzzOne( const uint8* data, size_t size, bool* accepted = NULL )
+{
+    const Buffer input( data, data + size );
+
+    PyRep* rep = InflateUnmarshal( input );
+    if( NULL != accepted )
+        *accepted = ( NULL != rep );
+    if( NULL == rep )
+        return true;
+
+    FuzzMarshalable marshalable;
+    if( !rep->visit( marshalable ) )
+    {
+        PyDecRef( rep );
+        return true;
+    }
+
+    Buffer first;
+    bool res = Marshal( rep, first );
+    PyDecRef( rep );
+
+    if( !res )
+        return false;
+
+    rep = Unmarshal( first );
+    if( NULL == rep )
+        return false;
+
+    Buffer second;
+    res = ( Marshal( rep, second )
+            && first.size() == second.size()
+            && 0 == memcmp( &first[0], &second[0], first.size() ) );
+    PyDecRef( rep );
+
+    return res;
+}
+
+#ifdef HAVE_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput( const uint8_t* data, size_t size )
+{
+    if( !FuzzOne( data, size ) )
+        abort();
+
+    return 0;
+}
+
+#else /* !HAVE_LIBFUZZER */
+
+/** Default number of mutated streams fed to InflateUnmarshal. */
+static const size_t FUZZ_DEFAULT_RUNS = 20000;
+/** Name of the file the failing stream is saved into. */
+static const char* const FUZZ_FAILURE_FILE = "eve-fuzz-failure.bin";
+
+/** Bytes likely to hit edge cases. */
+static const uint8 FUZZ_INTERESTING[] =
+{
+    0x00, 0x01, 0x02, 0x7E, 0x7F, 0x80, 0xFE, 0xFF
+};
+
+/**
+ * @brief A small reproducible random number generator (xorshift).
+ */
+class FuzzRandom
+{
+public:
+    FuzzRandom( uint32 seed ) : mState( 0 != seed ? seed : 1 ) {}
+
+    /** @return Random number in [0, limit). */
+    uint32 operator()( uint32 limit )
+    {
+        mState ^= mState << 13;
+        mState ^= mState >> 17;
+        mState ^= mState << 5;
+
+        return ( 0 < limit ? mState % limit : 0 );
+    }
+
+protected:
+    uint32 mState;
+};
+
+/**
+ * @brief Mutates a stream in place.
+ *
+ * @param[in,out] data   The stream.
+ * @param[in]     other  Another stream to splice from.
+ * @param[in]     random The random number generator.
+ */
+static void Mutate( Buffer& data, const Buffer& other, FuzzRandom& random )
+{
+    const uint32 count = 1 + random( 4 );
+    for( uint32 i = 0; i < count; ++i )
+    {
+        const size_t size = data.size();
+        const size_t pos = random( size + 1 );
+
+        switch( random( 6 ) )
+        {
+            case 0:
+                // flip a bit
+                if( pos < size )
+                    data[ pos ] ^= ( 1 << random( 8 ) );
+                break;
+
+            case 1:
+                // an interesting byte
+                if( pos < size )
+                    data[ pos ] = FUZZ_INTERESTING[ random( sizeof( FUZZ_INTERESTING ) ) ];
+                break;
+
+            case 2:
+            {
+                // insert random bytes
+                Buffer tail( data.begin<uint8>() + pos, data.end<uint8>() );
+                data.Resize<uint8>( pos );
+
+                const uint32 len = 1 + random( 8 );
+                for( uint32 j = 0; j < len; ++j )
+                    data.Append<uint8>( random( 0x100 ) );
+                data.AppendSeq( tail.begin<uint8>(), tail.end<uint8>() );
+                break;
+            }
+
+            case 3:
+            {
+                // erase a range
+                const size_t len = std::min<size_t>( 1 + random( 16 ), size - pos );
+                Buffer tail( data.begin<uint8>() + pos + len, data.end<uint8>() );
+                data.Resize<uint8>( pos );
+                data.AppendSeq( tail.begin<uint8>(), tail.end<uint8>() );
+                break;
+            }
+
+            case 4:
+            {
+                // splice in the tail of another stream
+                const size_t from = random( other.size() + 1 );
+                data.Resize<uint8>( pos );
+                data.AppendSeq( other.begin<uint8>() + from, other.end<uint8>() );
+                break;
+            }
+
+            case 5:
+                // truncate
+                data.Resize<uint8>( pos );
+                break;
+        }
+    }
+}
+
+/**
+ * @brief Saves the failing stream for later examination.
+ */
+static void SaveFailure( const Buffer& data )
+{
+    FILE* f = fopen( FUZZ_FAILURE_FILE, "wb" );
+    if( NULL == f )
+        return;
+
+    if( 0 < data.size() )
+        fwrite( &data[0], 1, data.size(), f );
+    fclose( f );
+
+    ::printf( "Failing stream saved into '%s'.\n", FUZZ_FAILURE_FILE );
+}
+
+int main( int argc, char* argv[] )
+{
+    size_t runs = FUZZ_DEFAULT_RUNS;
+    uint32 seed = 1;
+
+    MarshalCorpus corpus;
+    if( !corpus.AddBuiltin() )
+    {
+        ::puts( "Failed to build the built-in samples." );
+        return EXIT_FAILURE;
+    }
+
+    for( int i = 1; i < argc; ++i )
+    {
+        if( 0 == strcmp( argv[i], "-runs" ) && i + 1 < argc )
+            runs = atoi( argv[++i] );
+        else if( 0 == strcmp( argv[i], "-seed" ) && i + 1 < argc )
+            seed = atoi( argv[++i] );
+        else if( 0 == corpus.AddDir( argv[i] ) )
+            ::printf( "No samples found in '%s'.\n", argv[i] );
+    }
+
+    // each sample must pass unchanged
+    for( size_t i = 0; i < corpus.size(); ++i )
+    {
+        const Buffer& data = corpus[i].data;
+        if( !FuzzOne( &data[0], data.size() ) )
+        {
+            ::printf( "Sample '%s' failed.\n", corpus[i].name.c_str() );
+            SaveFailure( data );
+            return EXIT_FAILURE;
+        }
+    }
+
+    ::printf( "Fuzzing InflateUnmarshal with %lu samples, %lu runs, seed %u...\n",
+              (unsigned long)corpus.size(), (unsigned long)runs, seed );
+
+    FuzzRandom random( seed );
+    size_t accepted = 0;
+
+    for( size_t run = 0; run < runs; ++run )
+    {
+        const MarshalCorpus::Sample& sample = corpus[ random( corpus.size() ) ];
+        const MarshalCorpus::Sample& other = corpus[ random( corpus.size() ) ];
+
+        // mutate the stream itself, not its deflated form, most of the time
+        Buffer data( sample.data );
+        if( IsDeflated( data ) && 0 < random( 4 ) )
+            InflateData( data );
+
+        Mutate( data, other.data, random );
+
+        // let inflation succeed now and then
+        if( 0 == random( 8 ) )
+            DeflateData( data );
+
+        bool unmarshaled = false;
+        const bool res = ( 0 < data.size() ? FuzzOne( &data[0], data.size(), &unmarshaled )
+                                           : FuzzOne( NULL, 0 ) );
+        if( unmarshaled )
+            ++accepted;
+
+        if( !res )
+        {
+            ::printf( "Run %lu (seed %u) failed.\n", (unsigned long)run, seed );
+            SaveFailure( data );
+            return EXIT_FAILURE;
+        }
+    }
+
+    ::printf( "Done; %lu of %lu mutated streams unmarshaled.\n",
+              (unsigned long)accepted, (unsigned long)runs );
+
+    return EXIT_SUCCESS;
+}
+
+#endif /* !HAVE_LIBFUZZER */
@@ -0,0 +1,142 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#include "eve-test.h"
+
+/** An integer and the opcode it's expected to be saved with. */
+struct IntegerCase
+{
+    int64 value;
+    uint8 opcode;
+};
+
+/** Edges of the ranges SaveLong picks the opcode by. */
+static const IntegerCase SAVE_LONG_CASES[] =
+{
+    { 127LL,            Op_PyByte },
+    { -128LL,           Op_PyByte },
+    { 128LL,            Op_PySignedShort },
+    { -129LL,           Op_PySignedShort },
+    { 32767LL,          Op_PySignedShort },
+    { -32768LL,         Op_PySignedShort },
+    { 32768LL,          Op_PyLong },
+    { -32769LL,         Op_PyLong },
+    { 2147483647LL,     Op_PyLong },
+    { -2147483648LL,    Op_PyLong },
+    { 2147483648LL,     Op_PyLongLong },
+    { 4286578688LL,     Op_PyLongLong },
+    { 4294967295LL,     Op_PyLongLong },
+    { -2147483649LL,    Op_PyLongLong },
+};
+
+/** Integers SaveVarInteger sizes by their highest nonzero byte. */
+static const IntegerCase SAVE_VAR_INTEGER_CASES[] =
+{
+    { 0x0000000100000000LL, Op_PyVarInteger },
+    { 0x00007FFFFFFFFFFFLL, Op_PyVarInteger },
+    { 0x0000FFFFFFFFFFFFLL, Op_PyVarInteger },
+    { 0x0001000000000000LL, Op_PyLongLong },
+    { 0x0100000000000000LL, Op_PyLongLong },
+    { 0x0100000100000000LL, Op_PyLongLong },
+    { 0x7FFF000100000000LL, Op_PyLongLong },
+    { (int64)0xFF00000100000000ULL, Op_PyLongLong },
+    { (int64)0xFFFF000000000000ULL, Op_PyLongLong },
+};
+
+/**
+ * @brief Marshals an integer and loads it back.
+ *
+ * @param[in] c The integer and its expected opcode.
+ *
+ * @return True if the opcode and the loaded value match.
+ */
+static bool CheckInteger( const IntegerCase& c )
+{
+    PyLong* rep = new PyLong( c.value );
+
+    Buffer marshaled;
+    bool res = Marshal( rep, marshaled );
+    PyDecRef( rep );
+
+    // header byte and map count precede the opcode
+    const size_t opcodeIndex = sizeof( uint8 ) + sizeof( uint32 );
+    if( !res || marshaled.size() <= opcodeIndex )
+    {
+        ::printf( "Failed to marshal %" PRId64 ".\n", c.value );
+        return false;
+    }
+    if( c.opcode != marshaled[ opcodeIndex ] )
+    {
+        ::printf( "%" PRId64 " saved with opcode 0x%02X instead of 0x%02X.\n", c.value, marshaled[ opcodeIndex ], c.opcode );
+        return false;
+    }
+
+    PyRep* loaded = Unmarshal( marshaled );
+    if( NULL == loaded )
+    {
+        ::printf( "Failed to unmarshal %" PRId64 ".\n", c.value );
+        return false;
+    }
+
+    int64 value;
+    if( loaded->IsInt() )
+        value = loaded->AsInt()->value();
+    else if( loaded->IsLong() )
+        value = loaded->AsLong()->value();
+    else
+    {
+        ::printf( "%" PRId64 " loaded as %s.\n", c.value, loaded->TypeString() );
+        PyDecRef( loaded );
+        return false;
+    }
+    PyDecRef( loaded );
+
+    if( c.value != value )
+    {
+        ::printf( "%" PRId64 " loaded as %" PRId64 ".\n", c.value, value );
+        return false;
+    }
+
+    return true;
+}
+
+int marshal_EVEMarshalIntegerTest( int argc, char* argv[] )
+{
+    ::puts( "Checking integer ranges..." );
+
+    for( size_t i = 0; i < sizeof( SAVE_LONG_CASES ) / sizeof( IntegerCase ); ++i )
+    {
+        if( !CheckInteger( SAVE_LONG_CASES[ i ] ) )
+            return EXIT_FAILURE;
+    }
+
+    for( size_t i = 0; i < sizeof( SAVE_VAR_INTEGER_CASES ) / sizeof( IntegerCase ); ++i )
+    {
+        if( !CheckInteger( SAVE_VAR_INTEGER_CASES[ i ] ) )
+            return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
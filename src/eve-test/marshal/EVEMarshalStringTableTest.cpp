@@ -0,0 +1,116 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     Bloody.Rabbit
+*/
+
+#include "eve-test.h"
+
+/** Strings which must not be found within the table. */
+static const char* const STRING_TABLE_MISSES[] =
+{
+    "",
+    "x",
+    "corpi",
+    "*corpidx",
+    "util.Row ",
+    "agent.Item2",
+    "macho.CallRs"
+};
+
+int marshal_EVEMarshalStringTableTest( int argc, char* argv[] )
+{
+    ::puts( "Looking up table strings..." );
+
+    for( uint8 i = 1; NULL != MarshalStringTable::LookupString( i ); ++i )
+    {
+        const std::string str = MarshalStringTable::LookupString( i );
+        if( MarshalStringTable::LookupIndex( str ) != i )
+        {
+            ::printf( "String '%s' not found at index %u.\n", str.c_str(), i );
+            return EXIT_FAILURE;
+        }
+
+        const PyString* pyStr = MarshalStringTable::LookupPyString( i );
+        if( NULL == pyStr || pyStr->content() != str )
+        {
+            ::printf( "Prebuilt object of string '%s' doesn't match.\n", str.c_str() );
+            return EXIT_FAILURE;
+        }
+        if( !pyStr->IsImmortal() )
+        {
+            ::printf( "Prebuilt object of string '%s' isn't immortal.\n", str.c_str() );
+            return EXIT_FAILURE;
+        }
+
+        PyRep* clone;
+        {
+            PyArena arena;
+            clone = pyStr->Clone();
+        }
+        PyDecRef( clone );
+
+        if( clone != pyStr )
+        {
+            ::printf( "Clone of prebuilt string '%s' isn't shared.\n", str.c_str() );
+            return EXIT_FAILURE;
+        }
+    }
+
+    ::puts( "Looking up other strings..." );
+
+    for( size_t i = 0; i < sizeof( STRING_TABLE_MISSES ) / sizeof( const char* ); ++i )
+    {
+        if( STRING_TABLE_ERROR != MarshalStringTable::LookupIndex( std::string( STRING_TABLE_MISSES[ i ] ) ) )
+        {
+            ::printf( "String '%s' found within the table.\n", STRING_TABLE_MISSES[ i ] );
+            return EXIT_FAILURE;
+        }
+    }
+
+    ::puts( "Unmarshaling table string..." );
+
+    const uint8 index = MarshalStringTable::LookupIndex( std::string( "macho.CallReq" ) );
+    PyString* str = new PyString( "macho.CallReq" );
+
+    Buffer marshaled;
+    bool res = Marshal( str, marshaled );
+    PyDecRef( str );
+
+    if( !res )
+    {
+        ::puts( "Failed to marshal Python object." );
+        return EXIT_FAILURE;
+    }
+
+    PyRep* rep = Unmarshal( marshaled );
+    res = ( rep == MarshalStringTable::LookupPyString( index ) );
+    PyDecRef( rep );
+
+    if( !res )
+    {
+        ::puts( "Unmarshaled string is not the prebuilt one." );
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,213 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#include "eve-test.h"
+
+#include "bench/MarshalCorpus.h"
+
+/** Nesting depth the unmarshaler must still accept. */
+static const size_t UNMARSHAL_TEST_DEPTH = 100;
+/** Nesting depth the unmarshaler must reject. */
+static const size_t UNMARSHAL_TEST_DEEP_DEPTH = 100000;
+
+/**
+ * @brief Starts a marshal stream with no saved objects.
+ *
+ * @param[out] data Empty buffer for the stream.
+ */
+static void BeginStream( Buffer& data )
+{
+    data.Append<uint8>( MarshalHeaderByte );
+    data.Append<uint32>( 0 );
+}
+
+/**
+ * @brief Unmarshals given stream.
+ *
+ * @param[in] data     The stream.
+ * @param[in] accepted Whether the stream should be accepted.
+ *
+ * @return True if it was accepted or rejected as expected.
+ */
+static bool CheckStream( const Buffer& data, bool accepted )
+{
+    PyRep* rep = Unmarshal( data );
+    PySafeDecRef( rep );
+
+    return accepted == ( NULL != rep );
+}
+
+/**
+ * @brief Unmarshals every truncated prefix of a sample.
+ *
+ * @param[in] sample The sample.
+ *
+ * @return True if the whole sample loads and none of the prefixes do.
+ */
+static bool CheckTruncated( const MarshalCorpus::Sample& sample )
+{
+    Buffer data;
+    if( IsDeflated( sample.data ) )
+    {
+        if( !InflateData( sample.data, data ) )
+        {
+            ::printf( "Failed to inflate sample %s.\n", sample.name.c_str() );
+            return false;
+        }
+    }
+    else
+        data = sample.data;
+
+    if( !CheckStream( data, true ) )
+    {
+        ::printf( "Sample %s failed to load.\n", sample.name.c_str() );
+        return false;
+    }
+
+    for( size_t len = 0; len < data.size(); ++len )
+    {
+        const Buffer prefix( data.begin<uint8>(), data.begin<uint8>() + len );
+        if( !CheckStream( prefix, false ) )
+        {
+            ::printf( "Sample %s truncated to %lu bytes was accepted.\n", sample.name.c_str(), (unsigned long)len );
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Unmarshals a tuple nested in itself.
+ *
+ * @param[in] depth    Number of nested tuples.
+ * @param[in] accepted Whether the stream should be accepted.
+ *
+ * @return True if it was accepted or rejected as expected.
+ */
+static bool CheckNesting( size_t depth, bool accepted )
+{
+    Buffer data;
+    BeginStream( data );
+    for( size_t i = 0; i < depth; ++i )
+        data.Append<uint8>( Op_PyOneTuple );
+    data.Append<uint8>( Op_PyNone );
+
+    if( !CheckStream( data, accepted ) )
+    {
+        ::printf( "Tuples nested %lu deep were %s.\n", (unsigned long)depth, accepted ? "rejected" : "accepted" );
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Unmarshals a string table item.
+ *
+ * @param[in] index    Index into the string table.
+ * @param[in] accepted Whether the stream should be accepted.
+ *
+ * @return True if it was accepted or rejected as expected.
+ */
+static bool CheckStringTableItem( uint8 index, bool accepted )
+{
+    Buffer data;
+    BeginStream( data );
+    data.Append<uint8>( Op_PyStringTableItem );
+    data.Append<uint8>( index );
+
+    if( !CheckStream( data, accepted ) )
+    {
+        ::printf( "String table item %u was %s.\n", index, accepted ? "rejected" : "accepted" );
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Unmarshals a packed row whose header is not a row descriptor.
+ *
+ * @return True if it was rejected.
+ */
+static bool CheckPackedRowHeader()
+{
+    Buffer data;
+    BeginStream( data );
+    data.Append<uint8>( Op_PyPackedRow );
+    data.Append<uint8>( Op_PyNone );
+    data.Append<uint8>( 0 );
+
+    if( !CheckStream( data, false ) )
+    {
+        ::puts( "Packed row without a row descriptor was accepted." );
+        return false;
+    }
+
+    return true;
+}
+
+int marshal_EVEUnmarshalTest( int argc, char* argv[] )
+{
+    ::puts( "Checking truncated streams..." );
+
+    MarshalCorpus corpus;
+    if( !corpus.AddBuiltin() )
+    {
+        ::puts( "Failed to build the samples." );
+        return EXIT_FAILURE;
+    }
+
+    for( size_t i = 0; i < corpus.size(); ++i )
+    {
+        if( !CheckTruncated( corpus[ i ] ) )
+            return EXIT_FAILURE;
+    }
+
+    ::puts( "Checking nesting depth..." );
+
+    if( !CheckNesting( UNMARSHAL_TEST_DEPTH, true )
+        || !CheckNesting( UNMARSHAL_TEST_DEEP_DEPTH, false ) )
+        return EXIT_FAILURE;
+
+    ::puts( "Checking string table items..." );
+
+    uint8 end = 1;
+    while( NULL != MarshalStringTable::LookupString( end ) )
+        ++end;
+
+    if( !CheckStringTableItem( 1, true )
+        || !CheckStringTableItem( 0, false )
+        || !CheckStringTableItem( end, false ) )
+        return EXIT_FAILURE;
+
+    ::puts( "Checking packed row header..." );
+
+    if( !CheckPackedRowHeader() )
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
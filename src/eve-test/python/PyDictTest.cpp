@@ -0,0 +1,144 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#include "eve-test.h"
+
+#include "bench/MarshalCorpus.h"
+
+/**
+ * @brief Checks PyDict against std::map under a mix of operations.
+ *
+ * @return True if they agree.
+ */
+static bool CheckDict()
+{
+    PyDict* dict = new PyDict;
+    std::map<int32, int32> model;
+    bool res = true;
+
+    srand( 1234 );
+    for( size_t i = 0; res && i < 100000; ++i )
+    {
+        const int32 key = rand() % 300;
+        const int32 value = rand();
+
+        if( rand() % 4 )
+        {
+            PyInt* k = new PyInt( key );
+            PyInt* v = new PyInt( value );
+            dict->SetItem( k, v );
+            PyDecRef( k );
+            PyDecRef( v );
+
+            model[ key ] = value;
+        }
+        else
+        {
+            PyInt* k = new PyInt( key );
+            PyDict::iterator found = dict->items.find( k );
+            PyDecRef( k );
+
+            if( found != dict->items.end() )
+            {
+                PyDecRef( found->first );
+                PyDecRef( found->second );
+                dict->items.erase( found );
+            }
+
+            model.erase( key );
+        }
+
+        res = ( dict->size() == model.size() );
+    }
+
+    std::map<int32, int32>::const_iterator cur, end;
+    cur = model.begin();
+    end = model.end();
+    for(; res && cur != end; cur++)
+    {
+        PyInt* k = new PyInt( cur->first );
+        PyRep* v = dict->GetItem( k );
+        PyDecRef( k );
+
+        res = ( NULL != v && v->IsInt() && v->AsInt()->value() == cur->second );
+    }
+
+    PyDecRef( dict );
+    return res;
+}
+
+/**
+ * @brief Marshals given packet, unmarshals it and marshals it again.
+ *
+ * @return True if both streams are the same.
+ */
+static bool CheckRoundTrip( PyRep* rep )
+{
+    Buffer data;
+    if( !Marshal( rep, data ) )
+        return false;
+
+    PyRep* res = Unmarshal( data );
+    if( NULL == res )
+        return false;
+
+    Buffer again;
+    const bool same = ( Marshal( res, again )
+                        && again.size() == data.size()
+                        && 0 == memcmp( &again[ 0 ], &data[ 0 ], data.size() ) );
+    PyDecRef( res );
+
+    return same;
+}
+
+int python_PyDictTest( int argc, char* argv[] )
+{
+    ::puts( "Checking PyDict..." );
+
+    if( !CheckDict() )
+    {
+        ::puts( "PyDict does not match the model." );
+        return EXIT_FAILURE;
+    }
+
+    ::puts( "Checking round trips..." );
+
+    PyRep* session = MarshalCorpus::CreateSessionChange();
+    PyRep* attributes = MarshalCorpus::CreateAttributes();
+
+    const bool res = ( CheckRoundTrip( session )
+                       && CheckRoundTrip( attributes ) );
+
+    PyDecRef( session );
+    PyDecRef( attributes );
+
+    if( !res )
+    {
+        ::puts( "Round trip failed." );
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
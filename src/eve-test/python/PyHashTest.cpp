@@ -0,0 +1,95 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#include "eve-test.h"
+
+/**
+ * @brief Checks that a buffer hashes like a string of the same bytes.
+ *
+ * @param[in] str The bytes to hash.
+ *
+ * @return True if the hashes match.
+ */
+static bool CheckBufferHash( const char* str )
+{
+    PyString* string = new PyString( str );
+    PyBuffer* buffer = new PyBuffer( *string );
+
+    const int32 stringHash = string->hash();
+    const int32 bufferHash = buffer->hash();
+
+    PyDecRef( string );
+    PyDecRef( buffer );
+
+    if( stringHash != bufferHash )
+    {
+        ::printf( "Buffer \"%s\" hashes to %d instead of %d.\n", str, bufferHash, stringHash );
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Checks that a packed row is reported as unhashable.
+ *
+ * @return True if the hash is -1.
+ */
+static bool CheckPackedRowHash()
+{
+    DBRowDescriptor* header = new DBRowDescriptor;
+    header->AddColumn( "itemID", DBTYPE_I4 );
+
+    PyPackedRow* row = new PyPackedRow( header );
+    row->SetField( "itemID", new PyInt( 140000000 ) );
+
+    const int32 hash = row->hash();
+    PyDecRef( row );
+
+    if( -1 != hash )
+    {
+        ::printf( "Packed row hashes to %d.\n", hash );
+        return false;
+    }
+
+    return true;
+}
+
+int python_PyHashTest( int argc, char* argv[] )
+{
+    ::puts( "Checking buffer hashes..." );
+
+    if( !CheckBufferHash( "" )
+        || !CheckBufferHash( "a" )
+        || !CheckBufferHash( "blue.DBRowDescriptor" ) )
+        return EXIT_FAILURE;
+
+    ::puts( "Checking packed row hash..." );
+
+    if( !CheckPackedRowHash() )
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,117 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#include "eve-test.h"
+
+/** Number of producer threads. */
+static const uint32 MPSCQUEUE_TEST_PRODUCERS = 4;
+/** Number of values each producer pushes. */
+static const uint32 MPSCQUEUE_TEST_COUNT = 100000;
+/** Capacity of the queue; small, so that producers often find it full. */
+static const size_t MPSCQUEUE_TEST_CAPACITY = 0x40;
+
+/**
+ * @brief A producer pushing its values, its ID in the high half
+ *        and a sequence number in the low one.
+ */
+class MPSCQueueTestProducer
+: public WorkerJob
+{
+public:
+    MPSCQueueTestProducer( MPSCQueue<uint64>& queue, uint32 id ) : mQueue( queue ), mId( id ) {}
+
+    void Run()
+    {
+        for( uint32 i = 0; i < MPSCQUEUE_TEST_COUNT; ++i )
+        {
+            // let the consumer catch up
+            while( !mQueue.Push( ( (uint64)mId << 32 ) | i ) )
+                Sleep( 0 );
+        }
+    }
+
+protected:
+    MPSCQueue<uint64>& mQueue;
+    const uint32 mId;
+};
+
+int threading_MPSCQueueTest( int argc, char* argv[] )
+{
+    WorkerPool pool( "MPSCQueueTest" );
+    if( !pool.Start( MPSCQUEUE_TEST_PRODUCERS ) )
+    {
+        ::puts( "Failed to start the producer threads." );
+        return EXIT_FAILURE;
+    }
+
+    MPSCQueue<uint64> queue( MPSCQUEUE_TEST_CAPACITY );
+
+    std::vector<MPSCQueueTestProducer*> producers;
+    for( uint32 i = 0; i < MPSCQUEUE_TEST_PRODUCERS; ++i )
+    {
+        producers.push_back( new MPSCQueueTestProducer( queue, i ) );
+        pool.Post( producers.back() );
+    }
+
+    ::puts( "Checking order of popped values..." );
+
+    // each producer's values must come out in order, none lost
+    std::vector<uint32> next( MPSCQUEUE_TEST_PRODUCERS, 0 );
+    const uint64 total = (uint64)MPSCQUEUE_TEST_PRODUCERS * MPSCQUEUE_TEST_COUNT;
+    bool res = true;
+
+    for( uint64 popped = 0; popped < total; )
+    {
+        uint64 value;
+        if( !queue.Pop( value ) )
+        {
+            Sleep( 0 );
+            continue;
+        }
+
+        const uint32 id = (uint32)( value >> 32 );
+        const uint32 seq = (uint32)value;
+        if( MPSCQUEUE_TEST_PRODUCERS <= id || next[ id ] != seq )
+            res = false;
+        else
+            ++next[ id ];
+
+        ++popped;
+    }
+
+    // the producers are done once all values are popped
+    pool.Stop();
+
+    for( uint32 i = 0; i < MPSCQUEUE_TEST_PRODUCERS; ++i )
+        delete producers[ i ];
+
+    if( !res )
+    {
+        ::puts( "Values were lost or reordered." );
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
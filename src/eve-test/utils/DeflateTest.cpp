@@ -0,0 +1,86 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#include "eve-test.h"
+
+/**
+ * @brief Deflates given data and inflates it back.
+ *
+ * @param[in] data The data to compress.
+ *
+ * @return True if the data is marked deflated and comes back unchanged.
+ */
+static bool CheckRoundTrip( const Buffer& data )
+{
+    Buffer deflated;
+    if( !DeflateData( data, deflated ) || !IsDeflated( deflated ) )
+    {
+        ::printf( "Failed to deflate %lu bytes.\n", (unsigned long)data.size() );
+        return false;
+    }
+
+    Buffer inflated;
+    if( !InflateData( deflated, inflated ) )
+    {
+        ::printf( "Failed to inflate %lu bytes.\n", (unsigned long)deflated.size() );
+        return false;
+    }
+
+    if( inflated.size() != data.size()
+        || 0 != memcmp( &inflated[ 0 ], &data[ 0 ], data.size() ) )
+    {
+        ::printf( "%lu bytes inflated to different data.\n", (unsigned long)data.size() );
+        return false;
+    }
+
+    return true;
+}
+
+int utils_DeflateTest( int argc, char* argv[] )
+{
+    ::puts( "Checking deflate header..." );
+
+    if( IsDeflated( Buffer() ) )
+    {
+        ::puts( "Empty buffer reported as deflated." );
+        return EXIT_FAILURE;
+    }
+    if( !IsDeflated( Buffer( 1, DeflateHeaderByte ) ) )
+    {
+        ::puts( "Deflate header not recognized." );
+        return EXIT_FAILURE;
+    }
+
+    ::puts( "Checking round trips..." );
+
+    Buffer data;
+    for( uint32 i = 0; i < 0x10000; ++i )
+        data.Append<uint32>( i % 251 );
+
+    if( !CheckRoundTrip( data ) )
+        return EXIT_FAILURE;
+
+    return EXIT_SUCCESS;
+}
@@ -41,6 +41,7 @@ void TimeToString( const Seperator& cmd );
 void TriToOBJ( const Seperator& cmd );
 void UnmarshalLogText( const Seperator& cmd );
 void StuffExtract( const Seperator& cmd );
+void DeflateBenchmark( const Seperator& cmd );
 
 /************************************************************************/
 /* Command array stuff                                                  */
@@ -57,7 +58,8 @@ const EVEToolCommand EVETOOL_COMMANDS[] =
     { "time",      &TimeToString,       "Interprets given integer as Win32 time."                         },
     { "tri2obj",   &TriToOBJ,           "Dumps specified TRI file."                                       },
     { "unmarshal", &UnmarshalLogText,   "Converts given string to binary and unmarshals it."              },
-    { "xstuff",    &StuffExtract,       "Dumps specified STUFF file."                                     }
+    { "xstuff",    &StuffExtract,       "Dumps specified STUFF file."                                     },
+    { "zbench",    &DeflateBenchmark,   "Compares one-shot and streaming zlib on specified files."        }
 };
 const size_t EVETOOL_COMMAND_COUNT = ( sizeof( EVETOOL_COMMANDS ) / sizeof( EVEToolCommand ) );
 
@@ -485,3 +487,121 @@ void StuffExtract( const Seperator& cmd )
     sLog.Log( cmdName, "Extracting from archive %s finished.", filename.c_str() );
 }
 
+/* The former one-shot implementations, kept for comparison. */
+static bool DeflateDataOneShot( const Buffer& input, Buffer& output )
+{
+    uLongf outputSize = compressBound( input.size() );
+    output.Resize<uint8>( outputSize );
+
+    if( Z_OK != compress( &output[0], &outputSize, &input[0], input.size() ) )
+        return false;
+
+    output.Resize<uint8>( outputSize );
+    return true;
+}
+
+static bool InflateDataOneShot( const Buffer& input, Buffer& output )
+{
+    uLongf outputSize = 0;
+    size_t sizeMultiplier = 0;
+
+    int res = 0;
+    do
+    {
+        outputSize = ( input.size() << ++sizeMultiplier );
+        output.Resize<uint8>( outputSize );
+
+        res = uncompress( &output[0], &outputSize, &input[0], input.size() );
+    } while( Z_BUF_ERROR == res );
+
+    if( Z_OK != res )
+        return false;
+
+    output.Resize<uint8>( outputSize );
+    return true;
+}
+
+void DeflateBenchmark( const Seperator& cmd )
+{
+    const char* cmdName = cmd.arg( 0 ).c_str();
+
+    if( 3 > cmd.argCount() || !cmd.isNumber( 1 ) )
+    {
+        sLog.Error( cmdName, "Usage: %s iterations file [file] ...", cmdName );
+        return;
+    }
+    const uint32 iterations = atoi( cmd.arg( 1 ).c_str() );
+
+    for( size_t i = 2; i < cmd.argCount(); ++i )
+    {
+        const std::string& filename = cmd.arg( i );
+
+        FILE* in = fopen( filename.c_str(), "rb" );
+        if( NULL == in )
+        {
+            sLog.Error( cmdName, "Unable to open %s.", filename.c_str() );
+            continue;
+        }
+
+        Buffer plain( static_cast< size_t >( filesize( in ) ) );
+        const bool read = ( 0 == plain.size() || plain.size() == fread( &plain[0], sizeof( uint8 ), plain.size(), in ) );
+        fclose( in );
+
+        if( !read || 0 == plain.size() )
+        {
+            sLog.Error( cmdName, "Unable to read %s.", filename.c_str() );
+            continue;
+        }
+
+        // Cached objects are often stored deflated
+        if( IsDeflated( plain ) && !InflateData( plain ) )
+        {
+            sLog.Error( cmdName, "Unable to inflate %s.", filename.c_str() );
+            continue;
+        }
+
+        Buffer deflated;
+        if( !DeflateData( plain, deflated ) )
+        {
+            sLog.Error( cmdName, "Unable to deflate %s.", filename.c_str() );
+            continue;
+        }
+
+        uint32 deflateOld, deflateNew, inflateOld, inflateNew;
+        uint32 start = GetTickCount();
+        for( uint32 j = 0; j < iterations; ++j )
+        {
+            Buffer out;
+            DeflateDataOneShot( plain, out );
+        }
+        deflateOld = GetTickCount() - start;
+
+        start = GetTickCount();
+        for( uint32 j = 0; j < iterations; ++j )
+        {
+            Buffer out;
+            DeflateData( plain, out );
+        }
+        deflateNew = GetTickCount() - start;
+
+        start = GetTickCount();
+        for( uint32 j = 0; j < iterations; ++j )
+        {
+            Buffer out;
+            InflateDataOneShot( deflated, out );
+        }
+        inflateOld = GetTickCount() - start;
+
+        start = GetTickCount();
+        for( uint32 j = 0; j < iterations; ++j )
+        {
+            Buffer out;
+            InflateData( deflated, out );
+        }
+        inflateNew = GetTickCount() - start;
+
+        sLog.Log( cmdName, "%s: %lu bytes, %lu deflated, %u iterations:", filename.c_str(), plain.size(), deflated.size(), iterations );
+        sLog.Log( cmdName, "    deflate: one-shot %u ms, streaming %u ms", deflateOld, deflateNew );
+        sLog.Log( cmdName, "    inflate: one-shot %u ms, streaming %u ms", inflateOld, inflateNew );
+    }
+}
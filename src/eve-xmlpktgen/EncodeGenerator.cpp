@@ -110,7 +110,7 @@ bool ClassEncodeGenerator::ProcessElementPtr( const TiXmlElement* field )
         "    if( NULL == %s )\n"
         "    {\n"
         "        _log(NET__PACKET_ERROR, \"Encode %s: %s is NULL! hacking in a PyNone\");\n"
-        "        %s = new PyNone;\n"
+        "        %s = new_none();\n"
         "    }\n"
         "    else\n"
         "        %s = %s->Encode();\n"
@@ -140,7 +140,7 @@ bool ClassEncodeGenerator::ProcessRaw( const TiXmlElement* field )
         "    if( NULL == %s )\n"
         "    {\n"
         "        _log(NET__PACKET_ERROR, \"Encode %s: %s is NULL! hacking in a PyNone\");\n"
-        "        %s = new PyNone;\n"
+        "        %s = new_none();\n"
         "    }\n"
         "    else\n"
         "    {\n"
@@ -176,14 +176,14 @@ bool ClassEncodeGenerator::ProcessInt( const TiXmlElement* field )
     if( none_marker != NULL )
         fprintf( mOutputFile,
             "    if( %s == %s )\n"
-            "        %s = new PyNone;\n"
+            "        %s = new_none();\n"
             "    else\n",
             name, none_marker,
                 v
         );
 
     fprintf( mOutputFile,
-        "        %s = new PyInt( %s );\n"
+        "        %s = new_int( %s );\n"
         "\n",
         v, name
     );
@@ -208,7 +208,7 @@ bool ClassEncodeGenerator::ProcessLong( const TiXmlElement* field )
     if( none_marker != NULL )
         fprintf( mOutputFile,
             "    if( %s == %s )\n"
-            "        %s = new PyNone;\n"
+            "        %s = new_none();\n"
             "    else\n",
             name, none_marker,
                 v
@@ -240,7 +240,7 @@ bool ClassEncodeGenerator::ProcessReal( const TiXmlElement* field )
     if( none_marker != NULL )
         fprintf( mOutputFile,
             "    if( %s == %s )\n"
-            "        %s = new PyNone;\n"
+            "        %s = new_none();\n"
             "    else\n",
             name, none_marker,
                 v
@@ -266,7 +266,7 @@ bool ClassEncodeGenerator::ProcessBool( const TiXmlElement* field )
     }
 
     fprintf( mOutputFile,
-        "        %s = new PyBool( %s );\n"
+        "        %s = new_bool( %s );\n"
         "\n",
         top(), name
     );
@@ -278,7 +278,7 @@ bool ClassEncodeGenerator::ProcessBool( const TiXmlElement* field )
 bool ClassEncodeGenerator::ProcessNone( const TiXmlElement* field )
 {
     fprintf( mOutputFile,
-        "    %s = new PyNone;\n"
+        "    %s = new_none();\n"
         "\n",
         top()
     );
@@ -336,14 +336,14 @@ bool ClassEncodeGenerator::ProcessString( const TiXmlElement* field )
     if( none_marker != NULL )
         fprintf( mOutputFile,
             "    if( %s == \"%s\" )\n"
-            "        %s = new PyNone;\n"
+            "        %s = new_none();\n"
             "    else\n",
             name, none_marker,
                 v
         );
 
     fprintf( mOutputFile,
-        "        %s = new PyString( %s );\n"
+        "        %s = new_string( %s );\n"
         "\n",
         v, name
     );
@@ -363,7 +363,7 @@ bool ClassEncodeGenerator::ProcessStringInline( const TiXmlElement* field )
 
     const char* v = top();
     fprintf( mOutputFile,
-        "    %s = new PyString( \"%s\" );\n"
+        "    %s = new_string( \"%s\" );\n"
         "\n",
         v, value
     );
@@ -387,7 +387,7 @@ bool ClassEncodeGenerator::ProcessWString( const TiXmlElement* field )
     if( none_marker != NULL )
         fprintf( mOutputFile,
             "    if( %s == \"%s\" )\n"
-            "        %s = new PyNone;\n"
+            "        %s = new_none();\n"
             "    else\n",
             name, none_marker,
                 v
@@ -441,7 +441,7 @@ bool ClassEncodeGenerator::ProcessToken( const TiXmlElement* field )
     if( optional )
         fprintf( mOutputFile,
             "    if( %s == NULL )\n"
-            "        %s = new PyNone;\n"
+            "        %s = new_none();\n"
             "    else\n",
             name,
                 v
@@ -451,7 +451,7 @@ bool ClassEncodeGenerator::ProcessToken( const TiXmlElement* field )
             "    if( %s == NULL )\n"
             "    {\n"
             "        _log( NET__PACKET_ERROR, \"Encode %s: %s is NULL! hacking in a PyNone\" );\n"
-            "        %s = new PyNone;\n"
+            "        %s = new_none();\n"
             "    }\n"
             "    else\n",
             name,
@@ -511,7 +511,7 @@ bool ClassEncodeGenerator::ProcessObject( const TiXmlElement* field )
     if( optional )
         fprintf( mOutputFile,
             "    if( NULL == %s )\n"
-            "        %s = new PyNone;\n"
+            "        %s = new_none();\n"
             "    else\n",
             name,
                 v
@@ -521,7 +521,7 @@ bool ClassEncodeGenerator::ProcessObject( const TiXmlElement* field )
             "    if( NULL == %s )\n"
             "    {\n"
             "        _log( NET__PACKET_ERROR, \"Encode %s: %s is NULL! hacking in a PyNone\" );\n"
-            "        %s = new PyNone;\n"
+            "        %s = new_none();\n"
             "    }\n"
             "    else\n",
             name,
@@ -604,7 +604,7 @@ bool ClassEncodeGenerator::ProcessObjectEx( const TiXmlElement* field )
     if( optional )
         fprintf( mOutputFile,
             "    if( %s == NULL )\n"
-            "        %s = new PyNone;\n"
+            "        %s = new_none();\n"
             "    else\n",
             name,
                 v
@@ -614,7 +614,7 @@ bool ClassEncodeGenerator::ProcessObjectEx( const TiXmlElement* field )
             "    if( %s == NULL )\n"
             "    {\n"
             "        _log(NET__PACKET_ERROR, \"Encode %s: %s is NULL! hacking in a PyNone\");\n"
-            "        %s = new PyNone;\n"
+            "        %s = new_none();\n"
             "    }\n"
             "    else\n",
             name,
@@ -666,7 +666,7 @@ bool ClassEncodeGenerator::ProcessTuple( const TiXmlElement* field )
     if( optional )
         fprintf( mOutputFile,
             "    if( %s->empty() )\n"
-            "        %s = new PyNone;\n"
+            "        %s = new_none();\n"
             "    else\n",
             name,
                 v
@@ -761,7 +761,7 @@ bool ClassEncodeGenerator::ProcessList( const TiXmlElement* field )
     if( optional )
         fprintf( mOutputFile,
             "    if( %s->empty() )\n"
-            "        %s = new PyNone;\n"
+            "        %s = new_none();\n"
             "    else\n",
             name,
                 v
@@ -966,7 +966,7 @@ bool ClassEncodeGenerator::ProcessDict( const TiXmlElement* field )
     if( optional )
         fprintf( mOutputFile,
             "    if( %s->empty() )\n"
-            "        %s = new PyNone;\n"
+            "        %s = new_none();\n"
             "    else\n",
             name,
                 v
@@ -1046,7 +1046,7 @@ bool ClassEncodeGenerator::ProcessDictInline( const TiXmlElement* field )
             if( keyTypeInt )
                 fprintf( mOutputFile,
                     "    %s->SetItem(\n"
-                    "        new PyInt( %s ), %s\n"
+                    "        new_int( %s ), %s\n"
                     "    );\n"
                     "\n",
                     iname,
@@ -1158,7 +1158,7 @@ bool ClassEncodeGenerator::ProcessDictInt( const TiXmlElement* field )
         "        PyIncRef( %s_cur->second );\n"
         "\n"
         "        %s->SetItem(\n"
-        "            new PyInt( %s_cur->first ), %s_cur->second\n"
+        "            new_int( %s_cur->first ), %s_cur->second\n"
         "        );\n"
         "    }\n"
         "    %s = %s;\n"
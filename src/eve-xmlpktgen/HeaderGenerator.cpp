@@ -90,6 +90,11 @@ bool ClassHeaderGenerator::ProcessElementDef( const TiXmlElement* field )
         "    bool Decode( %s** packet );\n"
         "    %s* Encode() const;\n"
         "\n"
+        "    bool MarshalTo( Buffer& into ) const;\n"
+        "    bool MarshalInto( MarshalStream& stream ) const;\n"
+        "    bool UnmarshalFrom( const Buffer& data );\n"
+        "    bool UnmarshalFrom( UnmarshalStream& stream );\n"
+        "\n"
         "    %s& operator=( const %s& oth );\n"
         "\n",
         name,
@@ -0,0 +1,961 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#include "eve-xmlpktgen.h"
+
+#include "MarshalGenerator.h"
+
+ClassMarshalGenerator::ClassMarshalGenerator( FILE* outputFile )
+: Generator( outputFile ),
+  mItemNumber( 0 ),
+  mName( NULL )
+{
+    RegisterProcessors();
+}
+
+bool ClassMarshalGenerator::ProcessElementDef( const TiXmlElement* field )
+{
+    mName = field->Attribute( "name" );
+    if( mName == NULL )
+    {
+        _log( COMMON__ERROR, "<element> at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    const TiXmlElement* main = field->FirstChildElement();
+    if( main->NextSiblingElement() != NULL )
+    {
+        _log( COMMON__ERROR, "<element> at line %d contains more than one root element. skipping.", field->Row() );
+        return false;
+    }
+
+    fprintf( mOutputFile,
+        "bool %s::MarshalTo( Buffer& into ) const\n"
+        "{\n"
+        "    MarshalStream stream;\n"
+        "\n"
+        "    stream.BeginStream( into );\n"
+        "    const bool res = MarshalInto( stream );\n"
+        "    stream.End();\n"
+        "\n"
+        "    return res;\n"
+        "}\n"
+        "\n"
+        "bool %s::MarshalInto( MarshalStream& stream ) const\n"
+        "{\n",
+        mName,
+        mName
+    );
+
+    mItemNumber = 0;
+    clear();
+
+    push( "stream" );
+    if( !ParseElement( main ) )
+        return false;
+
+    fprintf( mOutputFile,
+        "    return true;\n"
+        "}\n"
+        "\n"
+    );
+
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessElement( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    fprintf( mOutputFile,
+        "    if( !%s.MarshalInto( %s ) )\n"
+        "        return false;\n"
+        "\n",
+        name, stream()
+    );
+
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessElementPtr( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    const char* s = stream();
+    fprintf( mOutputFile,
+        "    if( NULL == %s )\n"
+        "    {\n"
+        "        _log(NET__PACKET_ERROR, \"MarshalTo %s: %s is NULL! hacking in a PyNone\");\n"
+        "        %s.SaveNone();\n"
+        "    }\n"
+        "    else if( !%s->MarshalInto( %s ) )\n"
+        "        return false;\n"
+        "\n",
+        name,
+            mName, name,
+            s,
+        name, s
+    );
+
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessRaw( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    SaveRepField( name, false, NULL, NULL );
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessInt( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    //this should be done better:
+    const char* none_marker = field->Attribute( "none_marker" );
+
+    const char* s = stream();
+    if( none_marker != NULL )
+        fprintf( mOutputFile,
+            "    if( %s == %s )\n"
+            "        %s.SaveNone();\n"
+            "    else\n"
+            "        %s.SaveInt( %s );\n"
+            "\n",
+            name, none_marker,
+                s,
+                s, name
+        );
+    else
+        fprintf( mOutputFile,
+            "    %s.SaveInt( %s );\n"
+            "\n",
+            s, name
+        );
+
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessLong( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    //this should be done better:
+    const char* none_marker = field->Attribute( "none_marker" );
+
+    const char* s = stream();
+    if( none_marker != NULL )
+        fprintf( mOutputFile,
+            "    if( %s == %s )\n"
+            "        %s.SaveNone();\n"
+            "    else\n"
+            "        %s.SaveLong( %s );\n"
+            "\n",
+            name, none_marker,
+                s,
+                s, name
+        );
+    else
+        fprintf( mOutputFile,
+            "    %s.SaveLong( %s );\n"
+            "\n",
+            s, name
+        );
+
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessReal( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    //this should be done better:
+    const char* none_marker = field->Attribute( "none_marker" );
+
+    const char* s = stream();
+    if( none_marker != NULL )
+        fprintf( mOutputFile,
+            "    if( %s == %s )\n"
+            "        %s.SaveNone();\n"
+            "    else\n"
+            "        %s.SaveFloat( %s );\n"
+            "\n",
+            name, none_marker,
+                s,
+                s, name
+        );
+    else
+        fprintf( mOutputFile,
+            "    %s.SaveFloat( %s );\n"
+            "\n",
+            s, name
+        );
+
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessBool( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    fprintf( mOutputFile,
+        "    %s.SaveBool( %s );\n"
+        "\n",
+        stream(), name
+    );
+
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessNone( const TiXmlElement* field )
+{
+    fprintf( mOutputFile,
+        "    %s.SaveNone();\n"
+        "\n",
+        stream()
+    );
+
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessBuffer( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    SaveRepField( name, false, "SaveBuffer( Buffer() )", "an empty buffer" );
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessString( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    const char* none_marker = field->Attribute( "none_marker" );
+
+    const char* s = stream();
+    if( none_marker != NULL )
+        fprintf( mOutputFile,
+            "    if( %s == \"%s\" )\n"
+            "        %s.SaveNone();\n"
+            "    else\n"
+            "        %s.SaveString( %s );\n"
+            "\n",
+            name, none_marker,
+                s,
+                s, name
+        );
+    else
+        fprintf( mOutputFile,
+            "    %s.SaveString( %s );\n"
+            "\n",
+            s, name
+        );
+
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessStringInline( const TiXmlElement* field )
+{
+    const char* value = field->Attribute( "value" );
+    if( NULL == value )
+    {
+        _log( COMMON__ERROR, "String element at line %d has no value attribute.", field->Row() );
+        return false;
+    }
+
+    fprintf( mOutputFile,
+        "    %s.SaveString( \"%s\", %lu );\n"
+        "\n",
+        stream(), value, strlen( value )
+    );
+
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessWString( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    const char* none_marker = field->Attribute( "none_marker" );
+
+    const char* s = stream();
+    if( none_marker != NULL )
+        fprintf( mOutputFile,
+            "    if( %s == \"%s\" )\n"
+            "        %s.SaveNone();\n"
+            "    else\n"
+            "        %s.SaveWString( %s );\n"
+            "\n",
+            name, none_marker,
+                s,
+                s, name
+        );
+    else
+        fprintf( mOutputFile,
+            "    %s.SaveWString( %s );\n"
+            "\n",
+            s, name
+        );
+
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessWStringInline( const TiXmlElement* field )
+{
+    const char* value = field->Attribute( "value" );
+    if( NULL == value )
+    {
+        _log( COMMON__ERROR, "WString element at line %d has no value attribute.", field->Row() );
+        return false;
+    }
+
+    fprintf( mOutputFile,
+        "    %s.SaveWString( \"%s\", %lu );\n"
+        "\n",
+        stream(), value, strlen( value )
+    );
+
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessToken( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    bool optional = false;
+    const char* optional_str = field->Attribute( "optional" );
+    if( optional_str != NULL )
+        optional = str2<bool>( optional_str );
+
+    SaveRepField( name, optional, NULL, NULL );
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessTokenInline( const TiXmlElement* field )
+{
+    const char* value = field->Attribute( "value" );
+    if( NULL == value )
+    {
+        _log( COMMON__ERROR, "Token element at line %d has no type attribute.", field->Row() );
+        return false;
+    }
+
+    fprintf( mOutputFile,
+        "    %s.SaveToken( \"%s\", %lu );\n"
+        "\n",
+        stream(), value, strlen( value )
+    );
+
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessObject( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    bool optional = false;
+    const char* optional_str = field->Attribute( "optional" );
+    if( NULL != optional_str )
+        optional = str2<bool>( optional_str );
+
+    SaveRepField( name, optional, NULL, NULL );
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessObjectInline( const TiXmlElement* field )
+{
+    fprintf( mOutputFile,
+        "    %s.SaveObjectHeader();\n"
+        "\n",
+        stream()
+    );
+
+    //type and arguments follow in stream order
+    return ParseElementChildren( field, 2 );
+}
+
+bool ClassMarshalGenerator::ProcessObjectEx( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+    const char* type = field->Attribute( "type" );
+    if( type == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the type attribute.", field->Row() );
+        return false;
+    }
+
+    bool optional = false;
+    const char* optional_str = field->Attribute( "optional" );
+    if( optional_str != NULL )
+        optional = str2<bool>( optional_str );
+
+    SaveRepField( name, optional, NULL, NULL );
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessTuple( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    bool optional = false;
+    const char* optional_str = field->Attribute( "optional" );
+    if( optional_str != NULL )
+        optional = str2<bool>( optional_str );
+
+    SaveRepField( name, optional, "SaveTupleHeader( 0 )", "an empty tuple" );
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessTupleInline( const TiXmlElement* field )
+{
+    //first, we need to know how many elements this tuple has:
+    const TiXmlNode* i = NULL;
+
+    uint32 count = 0;
+    while( ( i = field->IterateChildren( i ) ) )
+    {
+        if( i->Type() == TiXmlNode::TINYXML_ELEMENT )
+            count++;
+    }
+
+    fprintf( mOutputFile,
+        "    %s.SaveTupleHeader( %u );\n"
+        "\n",
+        stream(), count
+    );
+
+    return ParseElementChildren( field );
+}
+
+bool ClassMarshalGenerator::ProcessList( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    bool optional = false;
+    const char* optional_str = field->Attribute( "optional" );
+    if( optional_str != NULL )
+        optional = str2<bool>( optional_str );
+
+    SaveRepField( name, optional, "SaveListHeader( 0 )", "an empty list" );
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessListInline( const TiXmlElement* field )
+{
+    //first, we need to know how many elements this list has:
+    const TiXmlNode* i = NULL;
+
+    uint32 count = 0;
+    while( ( i = field->IterateChildren( i ) ) )
+    {
+        if( i->Type() == TiXmlNode::TINYXML_ELEMENT )
+            count++;
+    }
+
+    fprintf( mOutputFile,
+        "    %s.SaveListHeader( %u );\n"
+        "\n",
+        stream(), count
+    );
+
+    return ParseElementChildren( field );
+}
+
+bool ClassMarshalGenerator::ProcessListInt( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    const char* s = stream();
+    fprintf( mOutputFile,
+        "    %s.SaveListHeader( %s.size() );\n"
+        "    std::vector<int32>::const_iterator %s_cur, %s_end;\n"
+        "    %s_cur = %s.begin();\n"
+        "    %s_end = %s.end();\n"
+        "    for(; %s_cur != %s_end; %s_cur++)\n"
+        "        %s.SaveInt( *%s_cur );\n"
+        "\n",
+        s, name,
+        name, name,
+        name, name,
+        name, name,
+        name, name, name,
+            s, name
+    );
+
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessListLong( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    const char* s = stream();
+    fprintf( mOutputFile,
+        "    %s.SaveListHeader( %s.size() );\n"
+        "    std::vector<int64>::const_iterator %s_cur, %s_end;\n"
+        "    %s_cur = %s.begin();\n"
+        "    %s_end = %s.end();\n"
+        "    for(; %s_cur != %s_end; %s_cur++)\n"
+        "        %s.SaveLong( *%s_cur );\n"
+        "\n",
+        s, name,
+        name, name,
+        name, name,
+        name, name,
+        name, name, name,
+            s, name
+    );
+
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessListStr( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    const char* s = stream();
+    fprintf( mOutputFile,
+        "    %s.SaveListHeader( %s.size() );\n"
+        "    std::vector<std::string>::const_iterator %s_cur, %s_end;\n"
+        "    %s_cur = %s.begin();\n"
+        "    %s_end = %s.end();\n"
+        "    for(; %s_cur != %s_end; %s_cur++)\n"
+        "        %s.SaveString( *%s_cur );\n"
+        "\n",
+        s, name,
+        name, name,
+        name, name,
+        name, name,
+        name, name, name,
+            s, name
+    );
+
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessDict( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    bool optional = false;
+    const char* optional_str = field->Attribute( "optional" );
+    if( optional_str != NULL )
+        optional = str2<bool>( optional_str );
+
+    SaveRepField( name, optional, "SaveDictHeader( 0 )", "an empty dict" );
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessDictInline( const TiXmlElement* field )
+{
+    //first, we need to know how many entries this dict has:
+    const TiXmlNode* i = NULL;
+
+    uint32 count = 0;
+    while( ( i = field->IterateChildren( i ) ) )
+    {
+        if( i->Type() == TiXmlNode::TINYXML_ELEMENT
+            && strcmp( i->Value(), "dictInlineEntry" ) == 0 )
+            count++;
+    }
+
+    const char* s = stream();
+    fprintf( mOutputFile,
+        "    %s.SaveDictHeader( %u );\n"
+        "\n",
+        s, count
+    );
+
+    //now we process each entry; value goes first, followed by the key
+    i = NULL;
+    while( ( i = field->IterateChildren( i ) ) )
+    {
+        if( i->Type() == TiXmlNode::TINYXML_ELEMENT )
+        {
+            const TiXmlElement* ele = i->ToElement();
+
+            //we only handle dictInlineEntry elements
+            if( strcmp( ele->Value(), "dictInlineEntry" ) != 0 )
+            {
+                _log( COMMON__ERROR, "non-dictInlineEntry in <dictInline> at line %d, ignoring.", ele->Row() );
+                continue;
+            }
+            const char* key = ele->Attribute( "key" );
+            if( key == NULL )
+            {
+                _log( COMMON__ERROR, "<dictInlineEntry> at line %d lacks a key attribute", ele->Row() );
+                return false;
+            }
+
+            bool keyTypeInt = false;
+            const char* keyType = ele->Attribute( "key_type" );
+            if( keyType != NULL )
+                keyTypeInt = ( strcmp( keyType, "int" ) == 0 );
+
+            if( !ParseElementChildren( ele, 1 ) )
+                return false;
+
+            //taking the keyType into account
+            if( keyTypeInt )
+                fprintf( mOutputFile,
+                    "    %s.SaveInt( %s );\n"
+                    "\n",
+                    s, key
+                );
+            else
+                fprintf( mOutputFile,
+                    "    %s.SaveString( \"%s\", %lu );\n"
+                    "\n",
+                    s, key, strlen( key )
+                );
+        }
+    }
+
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessDictRaw( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    const char* key = field->Attribute( "key" );
+    if( key == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the key attribute, skipping.", field->Row() );
+        return false;
+    }
+    const char* pykey = field->Attribute( "pykey" );
+    if( pykey == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the pykey attribute, skipping.", field->Row() );
+        return false;
+    }
+    const char* value = field->Attribute( "value" );
+    if( value == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the value attribute, skipping.", field->Row() );
+        return false;
+    }
+    const char* pyvalue = field->Attribute( "pyvalue" );
+    if( pyvalue == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the pyvalue attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    //MarshalStream's Save methods are named after the Python types
+    const char* s = stream();
+    fprintf( mOutputFile,
+        "    %s.SaveDictHeader( %s.size() );\n"
+        "    std::map<%s, %s>::const_iterator %s_cur, %s_end;\n"
+        "    %s_cur = %s.begin();\n"
+        "    %s_end = %s.end();\n"
+        "    for(; %s_cur != %s_end; %s_cur++)\n"
+        "    {\n"
+        "        %s.Save%s( %s_cur->second );\n"
+        "        %s.Save%s( %s_cur->first );\n"
+        "    }\n"
+        "\n",
+        s, name,
+        key, value, name, name,
+        name, name,
+        name, name,
+        name, name, name,
+            s, pyvalue, name,
+            s, pykey, name
+    );
+
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessDictInt( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    const char* s = stream();
+    fprintf( mOutputFile,
+        "    %s.SaveDictHeader( %s.size() );\n"
+        "    std::map<int32, PyRep*>::const_iterator %s_cur, %s_end;\n"
+        "    %s_cur = %s.begin();\n"
+        "    %s_end = %s.end();\n"
+        "    for(; %s_cur != %s_end; %s_cur++)\n"
+        "    {\n"
+        "        if( !%s.SaveRep( %s_cur->second ) )\n"
+        "            return false;\n"
+        "        %s.SaveInt( %s_cur->first );\n"
+        "    }\n"
+        "\n",
+        s, name,
+        name, name,
+        name, name,
+        name, name,
+        name, name, name,
+            s, name,
+            s, name
+    );
+
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessDictStr( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    const char* s = stream();
+    fprintf( mOutputFile,
+        "    %s.SaveDictHeader( %s.size() );\n"
+        "    std::map<std::string, PyRep*>::const_iterator %s_cur, %s_end;\n"
+        "    %s_cur = %s.begin();\n"
+        "    %s_end = %s.end();\n"
+        "    for(; %s_cur != %s_end; %s_cur++)\n"
+        "    {\n"
+        "        if( !%s.SaveRep( %s_cur->second ) )\n"
+        "            return false;\n"
+        "        %s.SaveString( %s_cur->first );\n"
+        "    }\n"
+        "\n",
+        s, name,
+        name, name,
+        name, name,
+        name, name,
+        name, name, name,
+            s, name,
+            s, name
+    );
+
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessSubStreamInline( const TiXmlElement* field )
+{
+    char varname[16];
+    snprintf( varname, sizeof( varname ), "ss_%u", mItemNumber++ );
+
+    char sname[32];
+    snprintf( sname, sizeof( sname ), "%s_stream", varname );
+
+    //the sub-element is a complete stream on its own, save it into a temp
+    fprintf( mOutputFile,
+        "    Buffer %s;\n"
+        "    MarshalStream %s;\n"
+        "    %s.BeginStream( %s );\n"
+        "\n",
+        varname,
+        sname,
+        sname, varname
+    );
+
+    push( sname );
+    if( !ParseElementChildren( field, 1 ) )
+        return false;
+    pop();
+
+    //now store the temp as a substream
+    fprintf( mOutputFile,
+        "    %s.End();\n"
+        "    %s.SaveSubStream( %s );\n"
+        "\n",
+        sname,
+        stream(), varname
+    );
+
+    return true;
+}
+
+bool ClassMarshalGenerator::ProcessSubStructInline( const TiXmlElement* field )
+{
+    fprintf( mOutputFile,
+        "    %s.SaveSubStructHeader();\n"
+        "\n",
+        stream()
+    );
+
+    return ParseElementChildren( field, 1 );
+}
+
+void ClassMarshalGenerator::SaveRepField( const char* name, bool optional, const char* emptyCode, const char* emptyDesc )
+{
+    const char* s = stream();
+    if( emptyCode == NULL )
+    {
+        if( optional )
+            fprintf( mOutputFile,
+                "    if( NULL == %s )\n"
+                "        %s.SaveNone();\n",
+                name,
+                    s
+            );
+        else
+            fprintf( mOutputFile,
+                "    if( NULL == %s )\n"
+                "    {\n"
+                "        _log(NET__PACKET_ERROR, \"MarshalTo %s: %s is NULL! hacking in a PyNone\");\n"
+                "        %s.SaveNone();\n"
+                "    }\n",
+                name,
+                    mName, name,
+                    s
+            );
+    }
+    else
+    {
+        fprintf( mOutputFile,
+            "    if( NULL == %s )\n"
+            "    {\n"
+            "        _log(NET__PACKET_ERROR, \"MarshalTo %s: %s is NULL! hacking in %s.\");\n"
+            "        %s.%s;\n"
+            "    }\n",
+            name,
+                mName, name, emptyDesc,
+                s, emptyCode
+        );
+
+        if( optional )
+            fprintf( mOutputFile,
+                "    else if( %s->empty() )\n"
+                "        %s.SaveNone();\n",
+                name,
+                    s
+            );
+    }
+
+    fprintf( mOutputFile,
+        "    else if( !%s.SaveRep( %s ) )\n"
+        "        return false;\n"
+        "\n",
+        s, name
+    );
+}
@@ -0,0 +1,285 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#include "eve-xmlpktgen.h"
+
+#include "StringTableGenerator.h"
+
+/** Orders buckets by size, the largest first. */
+struct BucketSizeGreater
+{
+    BucketSizeGreater( const std::vector< std::vector<size_t> >& buckets ) : mBuckets( buckets ) {}
+
+    bool operator()( size_t a, size_t b ) const { return mBuckets[ a ].size() > mBuckets[ b ].size(); }
+
+    const std::vector< std::vector<size_t> >& mBuckets;
+};
+
+StringTableGenerator::StringTableGenerator( FILE* headerFile, FILE* sourceFile )
+: mHeaderFile( headerFile ),
+  mSourceFile( sourceFile ),
+  mBucketCount( 0 ),
+  mSlotCount( 0 )
+{
+    AddMemberParser( "string", &StringTableGenerator::ParseString );
+}
+
+bool StringTableGenerator::ParseStringTable( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "<stringTable> at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    mStrings.clear();
+    if( !ParseElementChildren( field ) )
+        return false;
+
+    // the indexes are 1-based bytes, 0 is left for errors
+    if( mStrings.empty() || 0xFF < mStrings.size() )
+    {
+        _log( COMMON__ERROR, "<stringTable> at line %d has %lu strings, which is not in range 1-255.", field->Row(), mStrings.size() );
+        return false;
+    }
+
+    if( !BuildHash() )
+    {
+        _log( COMMON__ERROR, "Unable to build perfect hash of <stringTable> at line %d.", field->Row() );
+        return false;
+    }
+
+    WriteHeader( name );
+    WriteSource( name );
+
+    return true;
+}
+
+bool StringTableGenerator::ParseString( const TiXmlElement* field )
+{
+    const char* value = field->Attribute( "value" );
+    if( value == NULL )
+    {
+        _log( COMMON__ERROR, "<string> at line %d is missing the value attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    if( 0xFF < strlen( value ) )
+    {
+        _log( COMMON__ERROR, "<string> at line %d is longer than 255 characters.", field->Row() );
+        return false;
+    }
+
+    if( mStrings.end() != std::find( mStrings.begin(), mStrings.end(), value ) )
+    {
+        _log( COMMON__ERROR, "<string> at line %d duplicates string '%s'.", field->Row(), value );
+        return false;
+    }
+
+    mStrings.push_back( value );
+    return true;
+}
+
+bool StringTableGenerator::BuildHash()
+{
+    const size_t count = mStrings.size();
+
+    // keep about two strings per bucket and four slots per string
+    mSlotCount = npowof2( count ) * 2;
+    mBucketCount = std::max< size_t >( npowof2( count ) / 2, 1 );
+
+    std::vector<uint32> hashes( count );
+    std::vector< std::vector<size_t> > buckets( mBucketCount );
+    for( size_t i = 0; i < count; ++i )
+    {
+        hashes[ i ] = fnv1a_hash( mStrings[ i ].c_str(), mStrings[ i ].size() );
+        buckets[ hashes[ i ] & ( mBucketCount - 1 ) ].push_back( i );
+    }
+
+    // place the largest buckets first, while there are plenty of free slots
+    std::vector<size_t> order( mBucketCount );
+    for( size_t i = 0; i < mBucketCount; ++i )
+        order[ i ] = i;
+    std::stable_sort( order.begin(), order.end(), BucketSizeGreater( buckets ) );
+
+    mSeeds.assign( mBucketCount, 0 );
+    mSlots.assign( mSlotCount, 0 );
+
+    std::vector<size_t> slots;
+    for( size_t i = 0; i < mBucketCount; ++i )
+    {
+        const std::vector<size_t>& bucket = buckets[ order[ i ] ];
+        if( bucket.empty() )
+            break;
+
+        uint32 seed = 0;
+        for(; seed <= 0xFFFF; ++seed )
+        {
+            slots.clear();
+
+            size_t j = 0;
+            for(; j < bucket.size(); ++j )
+            {
+                const size_t slot = hash_mix( hashes[ bucket[ j ] ], seed ) & ( mSlotCount - 1 );
+                if( 0 != mSlots[ slot ] || slots.end() != std::find( slots.begin(), slots.end(), slot ) )
+                    break;
+
+                slots.push_back( slot );
+            }
+
+            if( bucket.size() == j )
+                break;
+        }
+
+        if( 0xFFFF < seed )
+            return false;
+
+        mSeeds[ order[ i ] ] = seed;
+        for( size_t j = 0; j < bucket.size(); ++j )
+            mSlots[ slots[ j ] ] = static_cast<uint8>( bucket[ j ] + 1 );
+    }
+
+    return true;
+}
+
+void StringTableGenerator::WriteHeader( const char* name )
+{
+    fprintf( mHeaderFile,
+        "/**\n"
+        " * @brief Static data of a string table.\n"
+        " *\n"
+        " * Index of a string is 1-based; use the perfect hash to look it up:\n"
+        " *\n"
+        " *   hash  = fnv1a_hash( str, len )\n"
+        " *   seed  = seeds[ hash %% bucketCount ]\n"
+        " *   index = slots[ hash_mix( hash, seed ) %% slotCount ]\n"
+        " *\n"
+        " * and compare the string with the one at the index (0 means none).\n"
+        " */\n"
+        "struct %s\n"
+        "{\n"
+        "    enum\n"
+        "    {\n"
+        "        size        = %lu, /**< Number of strings. */\n"
+        "        bucketCount = %lu, /**< Number of hash buckets; a power of two. */\n"
+        "        slotCount   = %lu  /**< Number of hash slots; a power of two. */\n"
+        "    };\n"
+        "\n"
+        "    /** The strings. */\n"
+        "    static const char* const strings[ size ];\n"
+        "    /** Lengths of the strings. */\n"
+        "    static const uint8 lengths[ size ];\n"
+        "    /** Prebuilt immortal Python objects of the strings. */\n"
+        "    static PyString* const pyStrings[ size ];\n"
+        "\n"
+        "    /** Seed of each hash bucket. */\n"
+        "    static const uint16 seeds[ bucketCount ];\n"
+        "    /** Index of the string in each hash slot. */\n"
+        "    static const uint8 slots[ slotCount ];\n"
+        "};\n"
+        "\n",
+        name,
+        mStrings.size(),
+        mBucketCount,
+        mSlotCount
+    );
+}
+
+void StringTableGenerator::WriteSource( const char* name )
+{
+    std::vector<std::string> literals( mStrings.size() );
+    for( size_t i = 0; i < mStrings.size(); ++i )
+    {
+        std::string& lit = literals[ i ];
+
+        lit = '"';
+        for( size_t j = 0; j < mStrings[ i ].size(); ++j )
+        {
+            const char c = mStrings[ i ][ j ];
+            if( '"' == c || '\\' == c )
+                lit += '\\';
+            lit += c;
+        }
+        lit += '"';
+    }
+
+    fprintf( mSourceFile,
+        "const char* const %s::strings[ %s::size ] =\n"
+        "{\n",
+        name, name
+    );
+    for( size_t i = 0; i < mStrings.size(); ++i )
+        fprintf( mSourceFile, "    %s,\n", literals[ i ].c_str() );
+    fprintf( mSourceFile,
+        "};\n"
+        "\n"
+        "const uint8 %s::lengths[ %s::size ] =\n"
+        "{\n",
+        name, name
+    );
+    for( size_t i = 0; i < mStrings.size(); ++i )
+        fprintf( mSourceFile, "    %lu,\n", mStrings[ i ].size() );
+    fprintf( mSourceFile,
+        "};\n"
+        "\n"
+        "/** Creates an immortal string on the heap, whatever arena is current. */\n"
+        "static PyString* NewTableString( const char* str, size_t len )\n"
+        "{\n"
+        "    PyHeapScope heap;\n"
+        "    return PyRep::MakeImmortal( new PyString( str, len ) );\n"
+        "}\n"
+        "\n"
+        "PyString* const %s::pyStrings[ %s::size ] =\n"
+        "{\n",
+        name, name
+    );
+    for( size_t i = 0; i < mStrings.size(); ++i )
+        fprintf( mSourceFile, "    NewTableString( %s, %lu ),\n", literals[ i ].c_str(), mStrings[ i ].size() );
+    fprintf( mSourceFile,
+        "};\n"
+        "\n"
+        "const uint16 %s::seeds[ %s::bucketCount ] =\n"
+        "{",
+        name, name
+    );
+    for( size_t i = 0; i < mBucketCount; ++i )
+        fprintf( mSourceFile, "%s%u,", ( 0 == i % 16 ? "\n    " : " " ), mSeeds[ i ] );
+    fprintf( mSourceFile,
+        "\n"
+        "};\n"
+        "\n"
+        "const uint8 %s::slots[ %s::slotCount ] =\n"
+        "{",
+        name, name
+    );
+    for( size_t i = 0; i < mSlotCount; ++i )
+        fprintf( mSourceFile, "%s%u,", ( 0 == i % 16 ? "\n    " : " " ), mSlots[ i ] );
+    fprintf( mSourceFile,
+        "\n"
+        "};\n"
+        "\n"
+    );
+}
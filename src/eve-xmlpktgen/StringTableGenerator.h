@@ -0,0 +1,103 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#ifndef __STRINGTABLEGENERATOR_H_INCL__
+#define __STRINGTABLEGENERATOR_H_INCL__
+
+/**
+ * @brief Generates a static string table with a perfect hash.
+ *
+ * The table is a struct of static data: the strings, their
+ * lengths, a prebuilt PyString for each of them and a
+ * hash-and-displace perfect hash, which maps a string to its
+ * 1-based index with one hash pass and a single comparison:
+ *
+ *   hash  = fnv1a_hash( str, len )
+ *   seed  = seeds[ hash % bucketCount ]
+ *   index = slots[ hash_mix( hash, seed ) % slotCount ]
+ *
+ * An index of 0 means the string is not in the table.
+ */
+class StringTableGenerator
+: public XMLParserEx
+{
+public:
+    StringTableGenerator( FILE* headerFile = NULL, FILE* sourceFile = NULL );
+
+    /**
+     * @brief Sets output header file.
+     *
+     * @param[in] headerFile New output header file.
+     */
+    void SetHeaderFile( FILE* headerFile ) { mHeaderFile = headerFile; }
+    /**
+     * @brief Sets output source file.
+     *
+     * @param[in] sourceFile New output source file.
+     */
+    void SetSourceFile( FILE* sourceFile ) { mSourceFile = sourceFile; }
+
+    /**
+     * @brief Generates the table defined by given element.
+     *
+     * @param[in] field The <stringTable> element.
+     *
+     * @retval true  Generation succeeded.
+     * @retval false Generation failed.
+     */
+    bool ParseStringTable( const TiXmlElement* field );
+
+protected:
+    bool ParseString( const TiXmlElement* field );
+
+    /**
+     * @brief Builds the perfect hash of collected strings.
+     *
+     * @retval true  Build succeeded.
+     * @retval false No seed could be found for some bucket.
+     */
+    bool BuildHash();
+
+    void WriteHeader( const char* name );
+    void WriteSource( const char* name );
+
+private:
+    FILE* mHeaderFile;
+    FILE* mSourceFile;
+
+    /** The strings in order of their indexes. */
+    std::vector<std::string> mStrings;
+
+    /** Number of hash buckets; a power of two. */
+    size_t mBucketCount;
+    /** Number of hash slots; a power of two. */
+    size_t mSlotCount;
+    /** Seed of each bucket. */
+    std::vector<uint16> mSeeds;
+    /** Index of the string in each slot; 0 if empty. */
+    std::vector<uint8> mSlots;
+};
+
+#endif
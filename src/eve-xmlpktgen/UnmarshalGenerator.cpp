@@ -0,0 +1,1394 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#include "eve-xmlpktgen.h"
+
+#include "UnmarshalGenerator.h"
+
+ClassUnmarshalGenerator::ClassUnmarshalGenerator( FILE* outputFile )
+: Generator( outputFile ),
+  mItemNumber( 0 ),
+  mName( NULL )
+{
+    RegisterProcessors();
+}
+
+bool ClassUnmarshalGenerator::ProcessElementDef( const TiXmlElement* field )
+{
+    mName = field->Attribute( "name" );
+    if( mName == NULL )
+    {
+        _log( COMMON__ERROR, "<element> at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    const TiXmlElement* main = field->FirstChildElement();
+    if( main->NextSiblingElement() != NULL )
+    {
+        _log( COMMON__ERROR, "<element> at line %d contains more than one root element. skipping.", field->Row() );
+        return false;
+    }
+
+    fprintf( mOutputFile,
+        "bool %s::UnmarshalFrom( const Buffer& data )\n"
+        "{\n"
+        "    UnmarshalStream stream;\n"
+        "    if( !stream.BeginStream( data ) )\n"
+        "    {\n"
+        "        // the stream references saved objects, load it whole\n"
+        "        PyRep* packet = Unmarshal( data );\n"
+        "        if( NULL == packet )\n"
+        "            return false;\n"
+        "\n"
+        "        return Decode( &packet );\n"
+        "    }\n"
+        "\n"
+        "    const bool res = UnmarshalFrom( stream );\n"
+        "    stream.End();\n"
+        "\n"
+        "    return res;\n"
+        "}\n"
+        "\n"
+        "bool %s::UnmarshalFrom( UnmarshalStream& stream )\n"
+        "{\n",
+        mName,
+        mName
+    );
+
+    if( !IsStreamable( main ) )
+    {
+        fprintf( mOutputFile,
+            "    PyRep* packet = stream.LoadRep();\n"
+            "    if( NULL == packet )\n"
+            "    {\n"
+            "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: unable to load the packet\" );\n"
+            "\n"
+            "        return false;\n"
+            "    }\n"
+            "\n"
+            "    return Decode( &packet );\n"
+            "}\n"
+            "\n",
+            mName
+        );
+
+        return true;
+    }
+
+    mItemNumber = 0;
+
+    if( !ParseElement( main ) )
+        return false;
+
+    fprintf( mOutputFile,
+        "    return true;\n"
+        "}\n"
+        "\n"
+    );
+
+    return true;
+}
+
+bool ClassUnmarshalGenerator::ProcessElement( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    fprintf( mOutputFile,
+        "    if( !%s.UnmarshalFrom( stream ) )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: unable to load element %s\" );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n",
+        name,
+            mName, name
+    );
+
+    return true;
+}
+
+bool ClassUnmarshalGenerator::ProcessElementPtr( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    const char* type = field->Attribute( "type" );
+    if( type == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the type attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    fprintf( mOutputFile,
+        "    SafeDelete( %s );\n"
+        "    %s = new %s;\n"
+        "\n"
+        "    if( !%s->UnmarshalFrom( stream ) )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: unable to load element %s\" );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n",
+        name,
+        name, type,
+
+        name,
+            mName, name
+    );
+
+    return true;
+}
+
+bool ClassUnmarshalGenerator::ProcessRaw( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    fprintf( mOutputFile,
+        "    PySafeDecRef( %s );\n"
+        "    %s = stream.LoadRep();\n"
+        "    if( NULL == %s )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: unable to load %s\" );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n",
+        name,
+        name,
+        name,
+            mName, name
+    );
+
+    return true;
+}
+
+bool ClassUnmarshalGenerator::ProcessInt( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    //this should be done better:
+    const char* none_marker = field->Attribute( "none_marker" );
+
+    if( none_marker != NULL )
+        fprintf( mOutputFile,
+            "    if( stream.SkipNone() )\n"
+            "        %s = %s;\n"
+            "    else\n",
+            name, none_marker
+        );
+
+    fprintf( mOutputFile,
+        "    if( !stream.LoadInt( %s ) )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: %s is not an int\" );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n",
+        name,
+            mName, name
+    );
+
+    return true;
+}
+
+bool ClassUnmarshalGenerator::ProcessLong( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    //this should be done better:
+    const char* none_marker = field->Attribute( "none_marker" );
+
+    if( none_marker != NULL )
+        fprintf( mOutputFile,
+            "    if( stream.SkipNone() )\n"
+            "        %s = %s;\n"
+            "    else\n",
+            name, none_marker
+        );
+
+    fprintf( mOutputFile,
+        "    if( !stream.LoadLong( %s ) )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: %s is not a long int\" );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n",
+        name,
+            mName, name
+    );
+
+    return true;
+}
+
+bool ClassUnmarshalGenerator::ProcessReal( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    //this should be done better:
+    const char* none_marker = field->Attribute( "none_marker" );
+
+    if( none_marker != NULL )
+        fprintf( mOutputFile,
+            "    if( stream.SkipNone() )\n"
+            "        %s = %s;\n"
+            "    else\n",
+            name, none_marker
+        );
+
+    fprintf( mOutputFile,
+        "    if( !stream.LoadFloat( %s ) )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: %s is not a real\" );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n",
+        name,
+            mName, name
+    );
+
+    return true;
+}
+
+bool ClassUnmarshalGenerator::ProcessBool( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    bool soft = false;
+    const char* soft_str = field->Attribute( "soft" );
+    if( soft_str != NULL )
+        soft = str2<bool>( soft_str );
+
+    const char* none_marker = field->Attribute( "none_marker" );
+
+    if( none_marker != NULL )
+        fprintf( mOutputFile,
+            "    if( stream.SkipNone() )\n"
+            "        %s = %s;\n"
+            "    else\n",
+            name, none_marker
+        );
+
+    fprintf( mOutputFile,
+        "    if( !stream.LoadBool( %s ) )\n"
+        "    {\n",
+        name
+    );
+
+    if( soft )
+    {
+        char iname[16];
+        snprintf( iname, sizeof( iname ), "int_%u", mItemNumber++ );
+
+        fprintf( mOutputFile,
+            "        int32 %s;\n"
+            "        if( stream.LoadInt( %s ) )\n"
+            "            %s = ( %s != 0 );\n"
+            "        else\n"
+            "        {\n"
+            "            _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: %s is not a boolean\" );\n"
+            "\n"
+            "            return false;\n"
+            "        }\n"
+            "    }\n"
+            "\n",
+            iname,
+            iname,
+                name, iname,
+
+                mName, name
+        );
+    }
+    else
+        fprintf( mOutputFile,
+            "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: %s is not a boolean\" );\n"
+            "\n"
+            "        return false;\n"
+            "    }\n"
+            "\n",
+            mName, name
+        );
+
+    return true;
+}
+
+bool ClassUnmarshalGenerator::ProcessNone( const TiXmlElement* field )
+{
+    fprintf( mOutputFile,
+        "    if( !stream.SkipNone() )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: expecting a None\" );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n",
+        mName
+    );
+
+    return true;
+}
+
+bool ClassUnmarshalGenerator::ProcessBuffer( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    char iname[16];
+    snprintf( iname, sizeof( iname ), "rep_%u", mItemNumber++ );
+
+    fprintf( mOutputFile,
+        "    PySafeDecRef( %s );\n"
+        "    %s = NULL;\n"
+        "\n"
+        "    PyRep* %s = stream.LoadRep();\n"
+        "    if( NULL == %s )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: unable to load %s\" );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n"
+        "    if( %s->IsBuffer() )\n"
+        "    {\n"
+        "        %s = %s->AsBuffer();\n"
+        "        PyIncRef( %s );\n"
+        "    }\n"
+        "    else if( %s->IsString() )\n"
+        "        %s = new PyBuffer( *%s->AsString() );\n"
+        "    else\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: %s is not a buffer: %%s\", %s->TypeString() );\n"
+        "\n"
+        "        PyDecRef( %s );\n"
+        "        return false;\n"
+        "    }\n"
+        "    PyDecRef( %s );\n"
+        "\n",
+        name,
+        name,
+
+        iname,
+        iname,
+            mName, name,
+
+        iname,
+            name, iname,
+            name,
+        iname,
+            name, iname,
+
+            mName, name, iname,
+            iname,
+        iname
+    );
+
+    return true;
+}
+
+bool ClassUnmarshalGenerator::ProcessString( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    //this should be done better:
+    const char* none_marker = field->Attribute( "none_marker" );
+
+    if( none_marker != NULL )
+        fprintf( mOutputFile,
+            "    if( stream.SkipNone() )\n"
+            "        %s = \"%s\";\n"
+            "    else\n",
+            name, none_marker
+        );
+
+    fprintf( mOutputFile,
+        "    if( !stream.LoadString( %s ) )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: %s is not a string\" );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n",
+        name,
+            mName, name
+    );
+
+    return true;
+}
+
+bool ClassUnmarshalGenerator::ProcessStringInline( const TiXmlElement* field )
+{
+    const char* value = field->Attribute( "value" );
+    if( NULL == value )
+    {
+        _log( COMMON__ERROR, "String element at line %d has no value attribute.", field->Row() );
+        return false;
+    }
+
+    char iname[16];
+    snprintf( iname, sizeof( iname ), "string_%u", mItemNumber++ );
+
+    fprintf( mOutputFile,
+        "    std::string %s;\n"
+        "    if( !stream.LoadString( %s ) )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: %s is not a string\" );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n"
+        "    if( \"%s\" != %s )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: expected %s to be '%s', but it's '%%s'\", %s.c_str() );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n",
+        iname,
+        iname,
+            mName, iname,
+
+        value, iname,
+            mName, iname, value, iname
+    );
+
+    return true;
+}
+
+bool ClassUnmarshalGenerator::ProcessWString( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    bool soft = false;
+    const char* soft_str = field->Attribute( "soft" );
+    if( soft_str != NULL )
+        soft = str2<bool>( soft_str );
+
+    const char* none_marker = field->Attribute( "none_marker" );
+
+    if( none_marker != NULL )
+        fprintf( mOutputFile,
+            "    if( stream.SkipNone() )\n"
+            "        %s = \"%s\";\n"
+            "    else\n",
+            name, none_marker
+        );
+
+    fprintf( mOutputFile,
+        "    if( !stream.LoadWString( %s )",
+        name
+    );
+
+    if( soft )
+        fprintf( mOutputFile,
+            " && !stream.LoadString( %s )",
+            name
+        );
+
+    fprintf( mOutputFile,
+        " )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: %s is not a wide string\" );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n",
+        mName, name
+    );
+
+    return true;
+}
+
+bool ClassUnmarshalGenerator::ProcessWStringInline( const TiXmlElement* field )
+{
+    const char* value = field->Attribute( "value" );
+    if( NULL == value )
+    {
+        _log( COMMON__ERROR, "WString element at line %d has no value attribute.", field->Row() );
+        return false;
+    }
+
+    char iname[16];
+    snprintf( iname, sizeof( iname ), "wstring_%u", mItemNumber++ );
+
+    fprintf( mOutputFile,
+        "    std::string %s;\n"
+        "    if( !stream.LoadWString( %s ) )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: %s is not a wstring\" );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n"
+        "    if( \"%s\" != %s )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: expected %s to be '%s', but it's '%%s'\", %s.c_str() );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n",
+        iname,
+        iname,
+            mName, iname,
+
+        value, iname,
+            mName, iname, value, iname
+    );
+
+    return true;
+}
+
+bool ClassUnmarshalGenerator::ProcessToken( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    bool optional = false;
+    const char* optional_str = field->Attribute( "optional" );
+    if( optional_str != NULL )
+        optional = str2<bool>( optional_str );
+
+    LoadRepField( name, optional, "Token", NULL, "a token" );
+    return true;
+}
+
+bool ClassUnmarshalGenerator::ProcessTokenInline( const TiXmlElement* field )
+{
+    const char* value = field->Attribute( "value" );
+    if( NULL == value )
+    {
+        _log( COMMON__ERROR, "Token element at line %d has no value attribute.", field->Row() );
+        return false;
+    }
+
+    char iname[16];
+    snprintf( iname, sizeof( iname ), "token_%u", mItemNumber++ );
+
+    fprintf( mOutputFile,
+        "    std::string %s;\n"
+        "    if( !stream.LoadToken( %s ) )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: %s is not a token\" );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n"
+        "    if( \"%s\" != %s )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: expected %s to be '%s', but it's '%%s'\", %s.c_str() );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n",
+        iname,
+        iname,
+            mName, iname,
+
+        value, iname,
+            mName, iname, value, iname
+    );
+
+    return true;
+}
+
+bool ClassUnmarshalGenerator::ProcessObject( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    bool optional = false;
+    const char* optional_str = field->Attribute( "optional" );
+    if( NULL != optional_str )
+        optional = str2<bool>( optional_str );
+
+    LoadRepField( name, optional, "Object", NULL, "an object" );
+    return true;
+}
+
+bool ClassUnmarshalGenerator::ProcessObjectInline( const TiXmlElement* field )
+{
+    char iname[16];
+    snprintf( iname, sizeof( iname ), "obj_%u", mItemNumber++ );
+
+    fprintf( mOutputFile,
+        "    if( !stream.LoadObjectHeader() )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: %s is the wrong type\" );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n",
+        mName, iname
+    );
+
+    //type and arguments follow in stream order
+    return ParseElementChildren( field, 2 );
+}
+
+bool ClassUnmarshalGenerator::ProcessObjectEx( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+    const char* type = field->Attribute( "type" );
+    if( type == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the type attribute.", field->Row() );
+        return false;
+    }
+
+    bool optional = false;
+    const char* optional_str = field->Attribute( "optional" );
+    if( optional_str != NULL )
+        optional = str2<bool>( optional_str );
+
+    LoadRepField( name, optional, "ObjectEx", type, "an extended object" );
+    return true;
+}
+
+bool ClassUnmarshalGenerator::ProcessTuple( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    bool optional = false;
+    const char* optional_str = field->Attribute( "optional" );
+    if( optional_str != NULL )
+        optional = str2<bool>( optional_str );
+
+    LoadRepField( name, optional, "Tuple", NULL, "a tuple" );
+    return true;
+}
+
+bool ClassUnmarshalGenerator::ProcessTupleInline( const TiXmlElement* field )
+{
+    //first, we need to know how many elements this tuple has:
+    const TiXmlNode* i = NULL;
+
+    uint32 count = 0;
+    while( ( i = field->IterateChildren( i ) ) )
+    {
+        if( i->Type() == TiXmlNode::TINYXML_ELEMENT )
+            count++;
+    }
+
+    char iname[16];
+    snprintf( iname, sizeof( iname ), "tuple%u", mItemNumber++ );
+
+    fprintf( mOutputFile,
+        "    uint32 %s_size;\n"
+        "    if( !stream.LoadTupleHeader( %s_size ) )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: %s is the wrong type\" );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n"
+        "    if( %s_size != %u )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: %s is the wrong size: expected %u, but got %%u\", %s_size );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n",
+        iname,
+        iname,
+            mName, iname,
+
+        iname, count,
+            mName, iname, count, iname
+    );
+
+    return ParseElementChildren( field );
+}
+
+bool ClassUnmarshalGenerator::ProcessList( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    //this should be done better:
+    bool optional = false;
+    const char* optional_str = field->Attribute( "optional" );
+    if( optional_str != NULL )
+        optional = str2<bool>( optional_str );
+
+    LoadRepField( name, optional, "List", NULL, "a list" );
+    return true;
+}
+
+bool ClassUnmarshalGenerator::ProcessListInline( const TiXmlElement* field )
+{
+    //first, we need to know how many elements this list has:
+    const TiXmlNode* i = NULL;
+
+    uint32 count = 0;
+    while( ( i = field->IterateChildren( i ) ) )
+    {
+        if( i->Type() == TiXmlNode::TINYXML_ELEMENT )
+            count++;
+    }
+
+    char iname[16];
+    snprintf( iname, sizeof( iname ), "list%u", mItemNumber++ );
+
+    fprintf( mOutputFile,
+        "    uint32 %s_size;\n"
+        "    if( !stream.LoadListHeader( %s_size ) )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: %s is not a list\" );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n"
+        "    if( %s_size != %u )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: %s is the wrong size: expected %u, but got %%u\", %s_size );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n",
+        iname,
+        iname,
+            mName, iname,
+
+        iname, count,
+            mName, iname, count, iname
+    );
+
+    return ParseElementChildren( field );
+}
+
+bool ClassUnmarshalGenerator::ProcessListInt( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    char iname[16];
+    snprintf( iname, sizeof( iname ), "list_%u", mItemNumber++ );
+
+    fprintf( mOutputFile,
+        "    uint32 %s_size;\n"
+        "    if( !stream.LoadListHeader( %s_size ) )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: %s is not a list\" );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n"
+        "    %s.clear();\n"
+        "    for( uint32 %s_index = 0; %s_index < %s_size; %s_index++ )\n"
+        "    {\n"
+        "        int32 t;\n"
+        "        if( !stream.LoadInt( t ) )\n"
+        "        {\n"
+        "            _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: Element %%u in list %s is not an integer\", %s_index );\n"
+        "\n"
+        "            return false;\n"
+        "        }\n"
+        "\n"
+        "        %s.push_back( t );\n"
+        "    }\n"
+        "\n",
+        iname,
+        iname,
+            mName, name,
+
+        name,
+        iname, iname, iname, iname,
+                mName, name, iname,
+            name
+    );
+
+    return true;
+}
+
+bool ClassUnmarshalGenerator::ProcessListLong( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    char iname[16];
+    snprintf( iname, sizeof( iname ), "list_%u", mItemNumber++ );
+
+    fprintf( mOutputFile,
+        "    uint32 %s_size;\n"
+        "    if( !stream.LoadListHeader( %s_size ) )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: %s is not a list\" );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n"
+        "    %s.clear();\n"
+        "    for( uint32 %s_index = 0; %s_index < %s_size; %s_index++ )\n"
+        "    {\n"
+        "        int64 t;\n"
+        "        if( !stream.LoadLong( t ) )\n"
+        "        {\n"
+        "            _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: Element %%u in list %s is not a long integer\", %s_index );\n"
+        "\n"
+        "            return false;\n"
+        "        }\n"
+        "\n"
+        "        %s.push_back( t );\n"
+        "    }\n"
+        "\n",
+        iname,
+        iname,
+            mName, name,
+
+        name,
+        iname, iname, iname, iname,
+                mName, name, iname,
+            name
+    );
+
+    return true;
+}
+
+bool ClassUnmarshalGenerator::ProcessListStr( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    char iname[16];
+    snprintf( iname, sizeof( iname ), "list_%u", mItemNumber++ );
+
+    fprintf( mOutputFile,
+        "    uint32 %s_size;\n"
+        "    if( !stream.LoadListHeader( %s_size ) )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: %s is not a list\" );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n"
+        "    %s.clear();\n"
+        "    for( uint32 %s_index = 0; %s_index < %s_size; %s_index++ )\n"
+        "    {\n"
+        "        std::string t;\n"
+        "        if( !stream.LoadString( t ) )\n"
+        "        {\n"
+        "            _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: Element %%u in list %s is not a string\", %s_index );\n"
+        "\n"
+        "            return false;\n"
+        "        }\n"
+        "\n"
+        "        %s.push_back( t );\n"
+        "    }\n"
+        "\n",
+        iname,
+        iname,
+            mName, name,
+
+        name,
+        iname, iname, iname, iname,
+                mName, name, iname,
+            name
+    );
+
+    return true;
+}
+
+bool ClassUnmarshalGenerator::ProcessDict( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    //this should be done better:
+    bool optional = false;
+    const char* optional_str = field->Attribute( "optional" );
+    if( optional_str != NULL )
+        optional = str2<bool>( optional_str );
+
+    LoadRepField( name, optional, "Dict", NULL, "a dict" );
+    return true;
+}
+
+bool ClassUnmarshalGenerator::ProcessDictInline( const TiXmlElement* field )
+{
+    // values precede their keys in the stream; see IsStreamable
+    _log( COMMON__ERROR, "<dictInline> at line %d cannot be loaded directly.", field->Row() );
+    return false;
+}
+
+bool ClassUnmarshalGenerator::ProcessDictRaw( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    const char* pykey = field->Attribute( "pykey" );
+    if( pykey == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the pykey attribute, skipping.", field->Row() );
+        return false;
+    }
+    const char* pyvalue = field->Attribute( "pyvalue" );
+    if( pyvalue == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the pyvalue attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    // IsStreamable made sure these exist
+    const char* keyLoad = GetLoadMethod( pykey );
+    const char* keyType = GetLoadType( pykey );
+    const char* valueLoad = GetLoadMethod( pyvalue );
+    const char* valueType = GetLoadType( pyvalue );
+
+    char iname[16];
+    snprintf( iname, sizeof( iname ), "dict_%u", mItemNumber++ );
+
+    fprintf( mOutputFile,
+        "    uint32 %s_size;\n"
+        "    if( !stream.LoadDictHeader( %s_size ) )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: %s is not a dict\" );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n"
+        "    %s.clear();\n"
+        "    for( uint32 %s_index = 0; %s_index < %s_size; %s_index++ )\n"
+        "    {\n"
+        "        %s v;\n"
+        "        if( !stream.%s( v ) )\n"
+        "        {\n"
+        "            _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: Value %%u in dict %s is not %s\", %s_index );\n"
+        "\n"
+        "            return false;\n"
+        "        }\n"
+        "\n"
+        "        %s k;\n"
+        "        if( !stream.%s( k ) )\n"
+        "        {\n"
+        "            _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: Key %%u in dict %s is not %s\", %s_index );\n"
+        "\n"
+        "            return false;\n"
+        "        }\n"
+        "\n"
+        "        %s[ k ] = v;\n"
+        "    }\n"
+        "\n",
+        iname,
+        iname,
+            mName, name,
+
+        name,
+        iname, iname, iname, iname,
+            valueType,
+            valueLoad,
+                mName, name, pyvalue, iname,
+
+            keyType,
+            keyLoad,
+                mName, name, pykey, iname,
+
+            name
+    );
+
+    return true;
+}
+
+bool ClassUnmarshalGenerator::ProcessDictInt( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    char iname[16];
+    snprintf( iname, sizeof( iname ), "dict_%u", mItemNumber++ );
+
+    fprintf( mOutputFile,
+        "    uint32 %s_size;\n"
+        "    if( !stream.LoadDictHeader( %s_size ) )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: %s is not a dict\" );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n"
+        "    std::map<int32, PyRep*>::iterator %s_cur, %s_end;\n"
+        "    %s_cur = %s.begin();\n"
+        "    %s_end = %s.end();\n"
+        "    for(; %s_cur != %s_end; %s_cur++)\n"
+        "        PyDecRef( %s_cur->second );\n"
+        "    %s.clear();\n"
+        "\n"
+        "    for( uint32 %s_index = 0; %s_index < %s_size; %s_index++ )\n"
+        "    {\n"
+        "        PyRep* v = stream.LoadRep();\n"
+        "        if( NULL == v )\n"
+        "        {\n"
+        "            _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: unable to load value %%u in dict %s\", %s_index );\n"
+        "\n"
+        "            return false;\n"
+        "        }\n"
+        "\n"
+        "        int32 k;\n"
+        "        if( !stream.LoadInt( k ) )\n"
+        "        {\n"
+        "            _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: Key %%u in dict %s is not an integer\", %s_index );\n"
+        "\n"
+        "            PyDecRef( v );\n"
+        "            return false;\n"
+        "        }\n"
+        "\n"
+        "        PyRep*& slot = %s[ k ];\n"
+        "        PySafeDecRef( slot );\n"
+        "        slot = v;\n"
+        "    }\n"
+        "\n",
+        iname,
+        iname,
+            mName, name,
+
+        iname, iname,
+        iname, name,
+        iname, name,
+        iname, iname, iname,
+            iname,
+        name,
+
+        iname, iname, iname, iname,
+                mName, name, iname,
+                mName, name, iname,
+            name
+    );
+
+    return true;
+}
+
+bool ClassUnmarshalGenerator::ProcessDictStr( const TiXmlElement* field )
+{
+    const char* name = field->Attribute( "name" );
+    if( name == NULL )
+    {
+        _log( COMMON__ERROR, "field at line %d is missing the name attribute, skipping.", field->Row() );
+        return false;
+    }
+
+    char iname[16];
+    snprintf( iname, sizeof( iname ), "dict_%u", mItemNumber++ );
+
+    fprintf( mOutputFile,
+        "    uint32 %s_size;\n"
+        "    if( !stream.LoadDictHeader( %s_size ) )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: %s is not a dict\" );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n"
+        "    std::map<std::string, PyRep*>::iterator %s_cur, %s_end;\n"
+        "    %s_cur = %s.begin();\n"
+        "    %s_end = %s.end();\n"
+        "    for(; %s_cur != %s_end; %s_cur++)\n"
+        "        PyDecRef( %s_cur->second );\n"
+        "    %s.clear();\n"
+        "\n"
+        "    for( uint32 %s_index = 0; %s_index < %s_size; %s_index++ )\n"
+        "    {\n"
+        "        PyRep* v = stream.LoadRep();\n"
+        "        if( NULL == v )\n"
+        "        {\n"
+        "            _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: unable to load value %%u in dict %s\", %s_index );\n"
+        "\n"
+        "            return false;\n"
+        "        }\n"
+        "\n"
+        "        std::string k;\n"
+        "        if( !stream.LoadString( k ) )\n"
+        "        {\n"
+        "            _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: Key %%u in dict %s is not a string\", %s_index );\n"
+        "\n"
+        "            PyDecRef( v );\n"
+        "            return false;\n"
+        "        }\n"
+        "\n"
+        "        PyRep*& slot = %s[ k ];\n"
+        "        PySafeDecRef( slot );\n"
+        "        slot = v;\n"
+        "    }\n"
+        "\n",
+        iname,
+        iname,
+            mName, name,
+
+        iname, iname,
+        iname, name,
+        iname, name,
+        iname, iname, iname,
+            iname,
+        name,
+
+        iname, iname, iname, iname,
+                mName, name, iname,
+                mName, name, iname,
+            name
+    );
+
+    return true;
+}
+
+bool ClassUnmarshalGenerator::ProcessSubStreamInline( const TiXmlElement* field )
+{
+    // the substream is a stream of its own; see IsStreamable
+    _log( COMMON__ERROR, "<substreamInline> at line %d cannot be loaded directly.", field->Row() );
+    return false;
+}
+
+bool ClassUnmarshalGenerator::ProcessSubStructInline( const TiXmlElement* field )
+{
+    char iname[16];
+    snprintf( iname, sizeof( iname ), "ss_%u", mItemNumber++ );
+
+    fprintf( mOutputFile,
+        "    if( !stream.LoadSubStructHeader() )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: %s is not a substruct\" );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n",
+        mName, iname
+    );
+
+    return ParseElementChildren( field, 1 );
+}
+
+bool ClassUnmarshalGenerator::IsStreamable( const TiXmlElement* field )
+{
+    const char* type = field->Value();
+
+    if( 0 == strcmp( type, "dictInline" )
+        || 0 == strcmp( type, "substreamInline" ) )
+        return false;
+
+    if( 0 == strcmp( type, "dictRaw" ) )
+    {
+        const char* pykey = field->Attribute( "pykey" );
+        const char* pyvalue = field->Attribute( "pyvalue" );
+
+        return NULL != pykey && NULL != GetLoadMethod( pykey )
+            && NULL != pyvalue && NULL != GetLoadMethod( pyvalue );
+    }
+
+    const TiXmlElement* child = field->FirstChildElement();
+    for(; child != NULL; child = child->NextSiblingElement() )
+    {
+        if( !IsStreamable( child ) )
+            return false;
+    }
+
+    return true;
+}
+
+const char* ClassUnmarshalGenerator::GetLoadMethod( const char* pytype )
+{
+    if( 0 == strcmp( pytype, "Int" ) )
+        return "LoadInt";
+    else if( 0 == strcmp( pytype, "Long" ) )
+        return "LoadLong";
+    else if( 0 == strcmp( pytype, "Float" ) )
+        return "LoadFloat";
+    else if( 0 == strcmp( pytype, "Bool" ) )
+        return "LoadBool";
+    else
+        return NULL;
+}
+
+const char* ClassUnmarshalGenerator::GetLoadType( const char* pytype )
+{
+    if( 0 == strcmp( pytype, "Int" ) )
+        return "int32";
+    else if( 0 == strcmp( pytype, "Long" ) )
+        return "int64";
+    else if( 0 == strcmp( pytype, "Float" ) )
+        return "double";
+    else if( 0 == strcmp( pytype, "Bool" ) )
+        return "bool";
+    else
+        return NULL;
+}
+
+void ClassUnmarshalGenerator::LoadRepField( const char* name, bool optional, const char* pytype, const char* cast, const char* desc )
+{
+    char iname[16];
+    snprintf( iname, sizeof( iname ), "rep_%u", mItemNumber++ );
+
+    fprintf( mOutputFile,
+        "    PySafeDecRef( %s );\n"
+        "    %s = NULL;\n"
+        "\n"
+        "    PyRep* %s = stream.LoadRep();\n"
+        "    if( NULL == %s )\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: unable to load %s\" );\n"
+        "\n"
+        "        return false;\n"
+        "    }\n"
+        "\n",
+        name,
+        name,
+
+        iname,
+        iname,
+            mName, name
+    );
+
+    if( optional )
+        fprintf( mOutputFile,
+            "    if( %s->IsNone() )\n"
+            "        PyDecRef( %s );\n"
+            "    else\n",
+            iname,
+                iname
+        );
+
+    //the loaded reference is handed over to the field
+    if( NULL != cast )
+        fprintf( mOutputFile,
+            "    if( %s->Is%s() )\n"
+            "        %s = (%s*)%s->As%s();\n",
+            iname, pytype,
+                name, cast, iname, pytype
+        );
+    else
+        fprintf( mOutputFile,
+            "    if( %s->Is%s() )\n"
+            "        %s = %s->As%s();\n",
+            iname, pytype,
+                name, iname, pytype
+        );
+
+    fprintf( mOutputFile,
+        "    else\n"
+        "    {\n"
+        "        _log( NET__PACKET_ERROR, \"UnmarshalFrom %s failed: %s is not %s: %%s\", %s->TypeString() );\n"
+        "\n"
+        "        PyDecRef( %s );\n"
+        "        return false;\n"
+        "    }\n"
+        "\n",
+            mName, name, desc, iname,
+
+            iname
+    );
+}
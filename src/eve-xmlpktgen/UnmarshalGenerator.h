@@ -0,0 +1,128 @@
+/*
+    ------------------------------------------------------------------------------------
+    LICENSE:
+    ------------------------------------------------------------------------------------
+    This file is part of EVEmu: EVE Online Server Emulator
+    Copyright 2006 - 2011 The EVEmu Team
+    For the latest information visit http://evemu.org
+    ------------------------------------------------------------------------------------
+    This program is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by the Free Software
+    Foundation; either version 2 of the License, or (at your option) any later
+    version.
+
+    This program is distributed in the hope that it will be useful, but WITHOUT
+    ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along with
+    this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+    Place - Suite 330, Boston, MA 02111-1307, USA, or go to
+    http://www.gnu.org/copyleft/lesser.txt.
+    ------------------------------------------------------------------------------------
+    Author:     EVEmu Team
+*/
+
+#ifndef __UNMARSHALGENERATOR_H_INCL__
+#define __UNMARSHALGENERATOR_H_INCL__
+
+#include "Generator.h"
+
+/**
+ * @brief Generates UnmarshalFrom methods.
+ *
+ * The generated methods load the packet straight from an UnmarshalStream,
+ * accepting the same streams as Decode does with the result of Unmarshal,
+ * but without building the Python objects first. Fields which are kept
+ * as Python objects are loaded the generic way; elements which cannot be
+ * loaded in stream order (inline dicts and substreams) are loaded whole
+ * and passed to Decode.
+ */
+class ClassUnmarshalGenerator
+: public Generator
+{
+public:
+    ClassUnmarshalGenerator( FILE* outputFile = NULL );
+
+protected:
+    bool ProcessElementDef( const TiXmlElement* field );
+    bool ProcessElement( const TiXmlElement* field );
+    bool ProcessElementPtr( const TiXmlElement* field );
+
+    bool ProcessRaw( const TiXmlElement* field );
+    bool ProcessInt( const TiXmlElement* field );
+    bool ProcessLong( const TiXmlElement* field );
+    bool ProcessReal( const TiXmlElement* field );
+    bool ProcessBool( const TiXmlElement* field );
+    bool ProcessNone( const TiXmlElement* field );
+    bool ProcessBuffer( const TiXmlElement* field );
+
+    bool ProcessString( const TiXmlElement* field );
+    bool ProcessStringInline( const TiXmlElement* field );
+    bool ProcessWString( const TiXmlElement* field );
+    bool ProcessWStringInline( const TiXmlElement* field );
+    bool ProcessToken( const TiXmlElement* field );
+    bool ProcessTokenInline( const TiXmlElement* field );
+
+    bool ProcessObject( const TiXmlElement* field );
+    bool ProcessObjectInline( const TiXmlElement* field );
+    bool ProcessObjectEx( const TiXmlElement* field );
+
+    bool ProcessTuple( const TiXmlElement* field );
+    bool ProcessTupleInline( const TiXmlElement* field );
+    bool ProcessList( const TiXmlElement* field );
+    bool ProcessListInline( const TiXmlElement* field );
+    bool ProcessListInt( const TiXmlElement* field );
+    bool ProcessListLong( const TiXmlElement* field );
+    bool ProcessListStr( const TiXmlElement* field );
+    bool ProcessDict( const TiXmlElement* field );
+    bool ProcessDictInline( const TiXmlElement* field );
+    bool ProcessDictRaw( const TiXmlElement* field );
+    bool ProcessDictInt( const TiXmlElement* field );
+    bool ProcessDictStr( const TiXmlElement* field );
+
+    bool ProcessSubStreamInline( const TiXmlElement* field );
+    bool ProcessSubStructInline( const TiXmlElement* field );
+
+private:
+    /**
+     * @brief Checks whether given element can be loaded in stream order.
+     *
+     * @param[in] field The element to check.
+     *
+     * @return True if direct loading code can be generated for the element.
+     */
+    static bool IsStreamable( const TiXmlElement* field );
+    /**
+     * @brief Obtains the direct loading method for a Python type name.
+     *
+     * @param[in] pytype Python type name, as used by dictRaw.
+     *
+     * @return Name of the UnmarshalStream method; NULL if there is none.
+     */
+    static const char* GetLoadMethod( const char* pytype );
+    /**
+     * @brief Obtains the native type loaded for a Python type name.
+     *
+     * @param[in] pytype Python type name, as used by dictRaw.
+     *
+     * @return The native type; NULL if there is none.
+     */
+    static const char* GetLoadType( const char* pytype );
+
+    /**
+     * @brief Writes code loading a Python object field.
+     *
+     * @param[in] name     Name of the field.
+     * @param[in] optional Whether the field may be None.
+     * @param[in] pytype   Python type of the field, e.g. "Tuple".
+     * @param[in] cast     Type the field is cast to; NULL if none.
+     * @param[in] desc     Description of the type for error messages.
+     */
+    void LoadRepField( const char* name, bool optional, const char* pytype, const char* cast, const char* desc );
+
+    uint32 mItemNumber;
+    const char* mName;
+};
+
+#endif
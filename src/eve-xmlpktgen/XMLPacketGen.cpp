@@ -62,9 +62,10 @@ XMLPacketGen::XMLPacketGen( const char* header, const char* source )
   mSourceFile( NULL ),
   mSourceFileName( source )
 {
-    AddMemberParser( "elements",   &XMLPacketGen::ParseElements );
-    AddMemberParser( "include",    &XMLPacketGen::ParseInclude );
-    AddMemberParser( "elementDef", &XMLPacketGen::ParseElementDef );
+    AddMemberParser( "elements",    &XMLPacketGen::ParseElements );
+    AddMemberParser( "include",     &XMLPacketGen::ParseInclude );
+    AddMemberParser( "elementDef",  &XMLPacketGen::ParseElementDef );
+    AddMemberParser( "stringTable", &XMLPacketGen::ParseStringTable );
 }
 
 XMLPacketGen::~XMLPacketGen()
@@ -85,32 +86,44 @@ bool XMLPacketGen::ParseElements( const TiXmlElement* field )
     const std::string def = FNameToDef( mHeaderFileName.c_str() );
 
     //headers:
-    fprintf( mHeaderFile,
-        "%s\n"
-        "\n"
-        "#ifndef %s\n"
-        "#define %s\n"
-        "\n"
+    WriteProlog( def,
+        "#include \"marshal/EVEMarshal.h\"\n"
+        "#include \"marshal/EVEUnmarshal.h\"\n"
         "#include \"python/PyVisitor.h\"\n"
         "#include \"python/PyRep.h\"\n"
+    );
+
+    //content
+    bool res = ParseElementChildren( field );
+
+    //footers:
+    fprintf( mHeaderFile,
+        "#endif /* !%s */\n"
         "\n",
-        smGenFileComment,
-        def.c_str(),
         def.c_str()
     );
-    fprintf( mSourceFile,
-        "%s\n"
-        "\n"
-        "#include \"eve-common.h\"\n"
-        "\n"
-        "#include \"%s\"\n"
-        "\n",
-        smGenFileComment,
-        mHeaderFileName.c_str()
+
+    return res;
+}
+
+bool XMLPacketGen::ParseStringTable( const TiXmlElement* field )
+{
+    if( !OpenFiles() )
+    {
+        sLog.Error( "XMLPacketGen", "Unable to open output files: %s.", strerror( errno ) );
+        return false;
+    }
+
+    const std::string def = FNameToDef( mHeaderFileName.c_str() );
+
+    //headers:
+    WriteProlog( def,
+        "#include \"python/PyArena.h\"\n"
+        "#include \"python/PyRep.h\"\n"
     );
 
     //content
-    bool res = ParseElementChildren( field );
+    bool res = mStringTable.ParseStringTable( field );
 
     //footers:
     fprintf( mHeaderFile,
@@ -147,6 +160,8 @@ bool XMLPacketGen::ParseElementDef( const TiXmlElement* field )
                  && mDestruct.ParseElement( field )
                  && mDump.ParseElement( field )
                  && mEncode.ParseElement( field )
+                 && mMarshal.ParseElement( field )
+                 && mUnmarshal.ParseElement( field )
                  && mHeader.ParseElement( field ) );
 
     return res;
@@ -163,6 +178,7 @@ void XMLPacketGen::SetHeaderFile( const char* header )
 
             // propagate the change to the generators
             mHeader.SetOutputFile( NULL );
+            mStringTable.SetHeaderFile( NULL );
         }
 
         mHeaderFileName = header;
@@ -185,6 +201,9 @@ void XMLPacketGen::SetSourceFile( const char* source )
             mDestruct.SetOutputFile( NULL );
             mDump.SetOutputFile( NULL );
             mEncode.SetOutputFile( NULL );
+            mMarshal.SetOutputFile( NULL );
+            mUnmarshal.SetOutputFile( NULL );
+            mStringTable.SetSourceFile( NULL );
         }
 
         mSourceFileName = source;
@@ -205,6 +224,7 @@ bool XMLPacketGen::OpenFiles()
         {
             // propagate the change to the generators
             mHeader.SetOutputFile( mHeaderFile );
+            mStringTable.SetHeaderFile( mHeaderFile );
         }
     }
 
@@ -223,12 +243,42 @@ bool XMLPacketGen::OpenFiles()
             mDestruct.SetOutputFile( mSourceFile );
             mDump.SetOutputFile( mSourceFile );
             mEncode.SetOutputFile( mSourceFile );
+            mMarshal.SetOutputFile( mSourceFile );
+            mUnmarshal.SetOutputFile( mSourceFile );
+            mStringTable.SetSourceFile( mSourceFile );
         }
     }
 
     return res;
 }
 
+void XMLPacketGen::WriteProlog( const std::string& def, const char* includes )
+{
+    fprintf( mHeaderFile,
+        "%s\n"
+        "\n"
+        "#ifndef %s\n"
+        "#define %s\n"
+        "\n"
+        "%s"
+        "\n",
+        smGenFileComment,
+        def.c_str(),
+        def.c_str(),
+        includes
+    );
+    fprintf( mSourceFile,
+        "%s\n"
+        "\n"
+        "#include \"eve-common.h\"\n"
+        "\n"
+        "#include \"%s\"\n"
+        "\n",
+        smGenFileComment,
+        mHeaderFileName.c_str()
+    );
+}
+
 std::string XMLPacketGen::FNameToDef( const char* buf )
 {
     std::string res;
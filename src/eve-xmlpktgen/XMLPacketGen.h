@@ -31,8 +31,11 @@
 #include "DestructGenerator.h"
 #include "DumpGenerator.h"
 #include "EncodeGenerator.h"
+#include "MarshalGenerator.h"
+#include "UnmarshalGenerator.h"
 #include "DecodeGenerator.h"
 #include "CloneGenerator.h"
+#include "StringTableGenerator.h"
 
 /**
  * @brief XML Packet Generator class.
@@ -75,6 +78,7 @@ protected:
     bool ParseElements( const TiXmlElement* field );
     bool ParseInclude( const TiXmlElement* field );
     bool ParseElementDef( const TiXmlElement* field );
+    bool ParseStringTable( const TiXmlElement* field );
 
 private:
     /**
@@ -96,7 +100,18 @@ private:
     ClassDestructGenerator    mDestruct;
     ClassDumpGenerator        mDump;
     ClassEncodeGenerator    mEncode;
+    ClassMarshalGenerator    mMarshal;
+    ClassUnmarshalGenerator    mUnmarshal;
     ClassHeaderGenerator    mHeader;
+    StringTableGenerator    mStringTable;
+
+    /**
+     * @brief Writes the file comments and the header include guard.
+     *
+     * @param[in] def      The include guard.
+     * @param[in] includes Includes of the header file.
+     */
+    void WriteProlog( const std::string& def, const char* includes );
 
     static std::string FNameToDef( const char* buf );
 
@@ -35,6 +35,7 @@
 #include "log/logsys.h"
 #include "log/LogNew.h"
 // utils
+#include "utils/misc.h"
 #include "utils/str2conv.h"
 #include "utils/utils_string.h"
 #include "utils/XMLParserEx.h"